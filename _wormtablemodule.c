@@ -20,6 +20,7 @@
 #include <Python.h>
 #include <structmember.h>
 #include <db.h>
+#include <zlib.h>
 #include "halffloat.h"
 
 #ifdef _WIN32
@@ -46,6 +47,17 @@ on non-MSVC build systems. */
 #define DLLEXPORT __declspec(dllexport)
 #endif
 
+/* Bulk puts with DB_MULTIPLE_KEY were introduced in Berkeley DB 4.8 */
+#if DB_VERSION_MAJOR > 4 || (DB_VERSION_MAJOR == 4 && DB_VERSION_MINOR >= 8)
+#define WT_HAVE_BULK_PUT
+#endif
+
+/* Rows can be written on a background thread where pthreads are available */
+#ifndef _WIN32
+#define WT_HAVE_WRITER_THREAD
+#include <pthread.h>
+#endif
+
 
 #if PY_MAJOR_VERSION >= 3
 #define IS_PY3K
@@ -53,19 +65,140 @@ on non-MSVC build systems. */
 
 #define WT_READ 0
 #define WT_WRITE 1
+#define WT_APPEND 2
 
 #define WT_UINT 0
 #define WT_INT 1
 #define WT_FLOAT 2
 #define WT_CHAR 3
+#define WT_DICT 4
+#define WT_GENOTYPE 5
 
 #define WT_VAR_1 0
 #define WT_VAR_2 (-1)
 #define WT_VAR_1_MAX_ELEMENTS 254
 #define WT_VAR_2_MAX_ELEMENTS 65534
 #define MAX_ROW_SIZE 65536
+/*
+ * Addresses within rows are 2 bytes by default, limiting rows to
+ * MAX_ROW_SIZE. Tables with 3 or 4 byte addresses can hold larger rows,
+ * up to WT_MAX_WIDE_ROW_SIZE. The row buffer of a table starts with room
+ * for MAX_ROW_SIZE bytes in each family and grows as larger rows are
+ * stored or read, so that wide addresses cost nothing until they are used.
+ */
+#define WT_DEFAULT_ADDRESS_SIZE 2
+#define WT_MAX_ADDRESS_SIZE 4
+#define WT_MAX_WIDE_ROW_SIZE (1024 * 1024 * 1024)
 #define WT_MISSING_VALUE 1
+/*
+ * Sparse columns share a header in the fixed region holding the address
+ * of the most recently stored sparse value and a presence bitmap. Each
+ * value in the variable region is preceded by the address of the previous
+ * sparse value, the column's bit and, for variable length columns, the
+ * number of elements.
+ */
+#define WT_SPARSE_BIT_SIZE 2
+#define WT_MAX_SPARSE_COLUMNS 65534
+/*
+ * Primary DB records hold the offset of the row in the data file and its
+ * length, which is 4 bytes in tables with wide addresses. Tables with
+ * more than one column family have an offset and length for each family,
+ * and each family's rows are stored in a separate data file.
+ */
 #define OFFSET_LEN_RECORD_SIZE 10
+#define WT_WIDE_OFFSET_LEN_RECORD_SIZE 12
+/*
+ * Lengths are packed in the same way as unsigned integers, so the 2 byte
+ * lengths of tables with 2 byte addresses hold rows of up to 2^16 - 2
+ * bytes. The row_id is not stored with the row of family 0, so only the
+ * rows of the other families are limited to less than MAX_ROW_SIZE.
+ */
+#define WT_MAX_STORED_ROW_SIZE 65534
+#define WT_MAX_FAMILIES 32
+#define WT_ALL_FAMILIES 0xffffffffU
+/* The maximum amount of data read in a single call when reading batches */
+#define WT_READ_BUFFER_SIZE (1024 * 1024)
+/* The number of keys we step over in a batch lookup before re-seeking */
+#define WT_MAX_SEEK_STEPS 8
+/* Index records are sorted in batches of this size before insertion */
+#define WT_INDEX_BATCH_SIZE (16 * 1024 * 1024)
+#define WT_INDEX_BATCH_RECORDS 65536
+/* The number of blocks in the ring buffer used by the writer thread */
+#define WT_WRITE_QUEUE_BLOCKS 4
+/*
+ * Each queued row is stored as its key, the length of the row in each
+ * column family and then the row data for each family.
+ */
+#define WT_WRITE_MIN_BLOCK_SIZE (sizeof(uint64_t) + sizeof(uint32_t) \
+        + MAX_ROW_SIZE)
+/* Values up to this size are compared when profiling constant columns */
+#define WT_PROFILE_CONSTANT_SIZE 256
+/* Distinct values in char columns are counted up to this number */
+#define WT_PROFILE_MAX_DISTINCT 255
+/* The size of the buffer used to insert primary records in bulk */
+#define WT_PRIMARY_BULK_SIZE (1024 * 1024)
+/* Errors encountered when writing a row to the data file or primary DB */
+#define WT_WRITE_IO_ERROR 1
+#define WT_WRITE_DB_ERROR 2
+/*
+ * Compressed rows are stored as a marker byte followed by the row, either
+ * as it is or deflated with a preset dictionary for the row's column
+ * family. The dictionaries are trained on the first rows written to the
+ * table, and are built from the segments of these samples whose k-mers
+ * occur most often; see train_dictionary.
+ */
+#define WT_ROW_STORED 0
+#define WT_ROW_DEFLATED 1
+#define WT_DICTIONARY_SIZE (16 * 1024)
+#define WT_DICTIONARY_SEGMENT_SIZE 64
+#define WT_DICTIONARY_SEGMENT_STEP 16
+#define WT_DICTIONARY_KMER_SIZE 8
+#define WT_DICTIONARY_HASH_BITS 20
+#define WT_COMPRESSION_SAMPLE_SIZE (2 * 1024 * 1024)
+#define WT_DICTIONARY_HEADER_SIZE 5
+/* Packed integer column files; see Table_write_packed_column */
+#define WT_PACKED_MAGIC "WTPACK01"
+#define WT_PACKED_HEADER_SIZE 32
+#define WT_PACKED_BLOCK_HEADER_SIZE 18
+#define WT_PACKED_BLOCK_SIZE 128
+/* The per-row reductions computed by row iterators over groups of columns */
+#define WT_REDUCE_MISSING 0
+#define WT_REDUCE_MEAN 1
+#define WT_REDUCE_MIN 2
+#define WT_REDUCE_MAX 3
+#define WT_REDUCE_GENOTYPE_COUNTS 4
+/* The classes of genotype call counted by WT_REDUCE_GENOTYPE_COUNTS */
+#define WT_CALL_HOM_REF 0
+#define WT_CALL_HET 1
+#define WT_CALL_HOM_ALT 2
+#define WT_CALL_MISSING 3
+#define WT_NUM_CALL_CLASSES 4
+
+/*
+ * Interval indexes use the hierarchical binning scheme from the UCSC
+ * genome browser. Coordinates up to 2^32 are binned into six levels,
+ * the finest of which has bins of 128Kb and each subsequent level has
+ * bins eight times larger than the last. An interval is assigned to
+ * the smallest bin that contains it.
+ */
+#define WT_INTERVAL_BIN_SIZE 2
+#define WT_INTERVAL_NUM_LEVELS 6
+#define WT_INTERVAL_FIRST_SHIFT 17
+#define WT_INTERVAL_NEXT_SHIFT 3
+#define WT_INTERVAL_MAX_COORDINATE 0xffffffffULL
+
+/*
+ * The fixed fields in a VCF line; CHROM to FILTER are mapped directly to
+ * columns, followed by the INFO and FORMAT fields and then the samples.
+ */
+#define WT_VCF_NUM_FIXED_FIELDS 7
+#define WT_VCF_INFO_FIELD 7
+#define WT_VCF_FORMAT_FIELD 8
+#define WT_VCF_REF_FIELD 3
+#define WT_VCF_ALT_FIELD 4
+#define WT_VCF_MAX_TRUNCATED_LENGTH 254
+/* The number of distinct FORMAT strings we keep compiled plans for */
+#define WT_VCF_FORMAT_CACHE_SIZE 8
 
 /* This is the default defined by the linux fopen man pages. */
 #define WT_DB_FILE_PERMS 0666
@@ -75,6 +208,157 @@ on non-MSVC build systems. */
 
 static PyObject *WormtableError;
 
+/* A row requested in a batch read, and where it is stored in the data file */
+typedef struct {
+    uint64_t row_id;
+    uint64_t offset;
+    uint32_t len;
+    PyObject *value;
+} row_request_t;
+
+/* A secondary key and primary key pair waiting to be inserted in an index */
+typedef struct {
+    void *key;
+    uint32_t key_size;
+    void *data;
+    uint32_t data_size;
+} index_record_t;
+
+/* A block of rows waiting to be written by the writer thread */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} write_block_t;
+
+/*
+ * The state of the background thread that writes committed rows to the
+ * data file and primary DB. Blocks head to head + count - 1 (modulo
+ * num_blocks) are queued for the writer, and the block after these is
+ * filled by the committing thread. The queue and error fields are
+ * protected by mutex.
+ */
+typedef struct {
+#ifdef WT_HAVE_WRITER_THREAD
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+    write_block_t blocks[WT_WRITE_QUEUE_BLOCKS];
+    size_t block_size;
+    uint32_t key_size;
+    int head;
+    int count;
+    int fill;
+    int shutdown;
+    int error_kind;
+    int error;
+} table_writer_t;
+
+/* The distinct values in a dictionary, indexed by their codes */
+typedef struct {
+    PyObject *values;       /* list of bytes objects */
+    uint32_t max_size;
+    uint32_t *slots;        /* hash table of code + 1, or 0 if empty */
+    uint32_t num_slots;
+} dictionary_t;
+
+/* The values seen in a column while profiling VCF lines */
+typedef struct {
+    uint64_t num_rows;
+    uint64_t num_values;
+    uint32_t min_num_elements;
+    uint32_t max_num_elements;
+    uint64_t min_uint;
+    uint64_t max_uint;
+    int64_t min_int;
+    int64_t max_int;
+    int constant;
+    uint32_t constant_size;
+    char constant_value[WT_PROFILE_CONSTANT_SIZE];
+    int too_many_distinct;
+    dictionary_t distinct;
+} column_profile_t;
+
+/* A key requested in a batch lookup */
+typedef struct {
+    void *key;
+    uint32_t size;
+    Py_ssize_t position;
+} key_request_t;
+
+/*
+ * An INFO or FORMAT field name in a VCF and the columns it is stored in.
+ * INFO fields have a single column, and FORMAT fields have one column
+ * for each sample, which is -1 if the sample does not have the field.
+ */
+typedef struct {
+    char *name;
+    size_t name_length;
+    int *columns;
+} vcf_field_t;
+
+/*
+ * A FORMAT string compiled into the column for each value of each sample,
+ * so that sample values can be mapped to columns by their position alone.
+ * The column for value k of sample j is columns[j * num_values + k].
+ */
+typedef struct {
+    char *format;
+    size_t format_length;
+    uint32_t num_values;
+    int *columns;
+    uint64_t last_used;
+} vcf_format_plan_t;
+
+/* The mapping from the fields of a VCF line to the columns of a table */
+typedef struct {
+    int fixed_columns[WT_VCF_NUM_FIXED_FIELDS];
+    int truncate;
+    uint32_t num_samples;
+    uint32_t num_info_fields;
+    vcf_field_t *info_fields;
+    uint32_t num_format_fields;
+    vcf_field_t *format_fields;
+    /* the genotype column holding a FORMAT field for every sample, or -1 */
+    int genotype_column;
+    /* working storage for parsing lines */
+    char *line_buffer;
+    size_t line_buffer_size;
+    char **values;
+    char **genotype_calls;
+    vcf_format_plan_t format_cache[WT_VCF_FORMAT_CACHE_SIZE];
+    uint64_t format_cache_clock;
+} vcf_plan_t;
+
+/* A segment of the sample rows considered for a compression dictionary */
+typedef struct {
+    size_t start;
+    uint64_t score;
+} dictionary_segment_t;
+
+/*
+ * The zlib streams and buffers used to compress or expand the rows of a
+ * table with compressed rows. Until the dictionaries are trained, rows
+ * are stored uncompressed and copied to the samples of each family.
+ */
+typedef struct {
+    z_stream stream;
+    int stream_ready;
+    int writing;
+    int trained;
+    uint64_t num_samples;
+    unsigned char *buffer;   /* the stored row of each family in turn */
+    uint32_t buffer_size;    /* room for each family's stored row */
+} row_compressor_t;
+
+/* Maps the position of a requested row id to the row_request_t for it */
+typedef struct {
+    uint64_t row_id;
+    Py_ssize_t position;
+    Py_ssize_t row;
+} row_position_t;
+
 
 typedef struct Column_t {
     PyObject_HEAD
@@ -87,15 +371,28 @@ typedef struct Column_t {
     int element_size;
     int num_elements;
     int fixed_region_offset;
+    int address_size;     /* size of addresses in the table's rows */
+    int sparse;           /* values are stored only when present */
+    int sparse_bit;       /* index in the table's sparse presence bitmap */
+    void *sparse_missing; /* packed missing value for fixed sparse columns */
+    int native;           /* values are stored in little-endian native form */
+    int family;           /* the column family holding this column */
+    size_t row_offset;    /* start of the family's row in the row buffer */
+    uint32_t row_buffer_size; /* room for the family's row in the buffer */
+    uint32_t max_row_size; /* maximum size of the family's rows */
     void **input_elements; /* pointer to each elements in input format */
     void *element_buffer; /* parsed input elements in native CPU format */
     int num_buffered_elements;
+    dictionary_t *dictionary; /* values of WT_DICT columns */
     int (*string_to_native)(struct Column_t*, char *);
     int (*python_to_native)(struct Column_t*, PyObject *);
     int (*verify_elements)(struct Column_t*);
     int (*truncate_elements)(struct Column_t*, double);
     int (*pack_elements)(struct Column_t*, void *);
     int (*unpack_elements)(struct Column_t*, void *);
+    /* index keys always use the order preserving format */
+    int (*pack_key_elements)(struct Column_t*, void *);
+    int (*unpack_key_elements)(struct Column_t*, void *);
     PyObject *(*native_to_python)(struct Column_t *, int);
 } Column;
 
@@ -105,26 +402,64 @@ typedef struct Column_t {
  * with Python. Ideally, all of the types would be fixed size for simplicity
  */
 
+/*
+ * A column family; the columns in each family are stored in separate rows
+ * in the family's own data file, and family 0 holds the row_id column.
+ */
+typedef struct {
+    PyObject *data_filename;
+    FILE *data_file;
+    unsigned int fixed_region_size;
+    unsigned int num_sparse_columns;
+    void *missing_row;            /* fixed region with every value missing */
+    uint32_t current_row_size;    /* current size */
+    unsigned char *dictionary;    /* preset dictionary for compressed rows */
+    uint32_t dictionary_size;
+    unsigned char *samples;       /* rows sampled to train the dictionary */
+    size_t samples_size;
+    size_t samples_capacity;
+} column_family_t;
+
 typedef struct {
     PyObject_HEAD
     DB *db;
     PyObject *db_filename;
-    FILE *data_file;
     PyObject *data_filename;
     Column **columns;
     unsigned long long cache_size;
     unsigned int fixed_region_size;
     unsigned int num_columns;
-    void *row_buffer;
-    uint32_t row_buffer_size;     /* max size */
-    uint32_t current_row_size;    /* current size */
+    int address_size;
+    uint32_t record_size;         /* size of the offset|length records */
+    int native_rows;
+    int dense_rows;               /* rows are stored at fixed strides */
+    int compressed_rows;          /* rows are compressed with dictionaries */
+    unsigned long long compression_sample_rows;
+    PyObject *dictionary_filename;
+    row_compressor_t *compressor;
+    char dense_key[sizeof(uint64_t)];
+    char dense_record[WT_MAX_FAMILIES * WT_WIDE_OFFSET_LEN_RECORD_SIZE];
+    column_family_t *families;
+    uint32_t num_families;
+    void *row_buffer;             /* the row of each family in turn */
+    uint32_t row_buffer_size;     /* room for each family's row */
     unsigned long long num_rows;
     /* row stats */
     unsigned long long total_row_size;
     unsigned int min_row_size;
     unsigned int max_row_size;
+    vcf_plan_t *vcf_plan;
+    table_writer_t *writer;
+    /* primary records waiting to be inserted with a single bulk put */
+    void *bulk_buffer;
+    void *bulk_pointer;
+    uint32_t num_bulk_records;
+    column_profile_t *profiles;
+    unsigned long long num_profiled_rows;
 } Table;
 
+static PyTypeObject TableType;
+
 
 typedef struct {
     PyObject_HEAD
@@ -137,6 +472,7 @@ typedef struct {
     void *key_buffer;
     uint32_t key_buffer_size;
     double *bin_widths;
+    int interval;
 } Index;
 
 typedef struct {
@@ -146,6 +482,7 @@ typedef struct {
     int completed;
     uint32_t *read_columns;
     uint32_t num_read_columns;
+    uint32_t families;    /* the column families read for each row */
     void *min_key;
     uint32_t min_key_size;
     void *max_key;
@@ -153,6 +490,13 @@ typedef struct {
 } IndexRowIterator;
 
 
+/* A reduction computed over a group of columns in each row */
+typedef struct {
+    int kind;
+    uint32_t *columns;
+    uint32_t num_columns;
+} row_reduction_t;
+
 typedef struct {
     PyObject_HEAD
     Table *table;
@@ -160,6 +504,10 @@ typedef struct {
     int completed;
     uint32_t *read_columns;
     uint32_t num_read_columns;
+    row_reduction_t *reductions;
+    uint32_t num_reductions;
+    uint32_t families;    /* the column families read for each row */
+    uint64_t position;    /* the next row id in tables with dense rows */
     void *min_key;
     uint32_t min_key_size;
     void *max_key;
@@ -173,6 +521,55 @@ typedef struct {
     DBC *cursor;
 } IndexKeyIterator;
 
+typedef struct {
+    PyObject_HEAD
+    Index *index;
+    DBC *cursor;
+    int completed;
+    uint32_t *read_columns;
+    uint32_t num_read_columns;
+    uint32_t families;    /* the column families read for each row */
+    void *key;
+    uint32_t prefix_size;
+    int query_set;
+    uint64_t start;
+    uint64_t end;
+    int level;
+    int bin_active;
+    uint64_t bin;
+    uint64_t last_bin;
+} IndexIntervalIterator;
+
+typedef struct {
+    PyObject_HEAD
+    Index *left;
+    Index *right;
+    DBC *left_cursor;
+    DBC *right_cursor;
+    int completed;
+    int outer;
+    uint32_t num_key_columns;
+    uint32_t *left_columns;
+    uint32_t num_left_columns;
+    uint32_t *right_columns;
+    uint32_t num_right_columns;
+    PyObject *left_row;
+    void *left_key;
+    uint32_t left_key_size;
+    PyObject *group;
+    Py_ssize_t group_position;
+    int group_valid;
+    void *group_key;
+    uint32_t group_key_size;
+    int lookahead_valid;
+    void *lookahead_key;
+    uint32_t lookahead_key_size;
+    PyObject *missing_right_row;
+} IndexJoinIterator;
+
+static const uint32_t interval_bin_offsets[WT_INTERVAL_NUM_LEVELS] =
+    {4681, 585, 73, 9, 1, 0};
+
 
 static void
 handle_bdb_error(int err)
@@ -186,7 +583,6 @@ handle_io_error(void)
     PyErr_SetFromErrno(WormtableError);
 }
 
-#ifndef WORDS_BIGENDIAN
 /*
  * Copies n bytes of source into destination, swapping the order of the
  * bytes.
@@ -201,7 +597,6 @@ byteswap_copy(void* dest, void *source, size_t n)
         dest_c[j] = source_c[n - j - 1];
     }
 }
-#endif
 
 /*
  * Floating point packing and unpacking. Floating point values are stored as a
@@ -336,6 +731,20 @@ unpack_uint(void *src, uint8_t size)
     return dest;
 }
 
+/*
+ * Compares the specified keys in the same way as the default Berkeley DB
+ * btree comparison function.
+ */
+static int
+compare_keys(void *a, uint32_t a_size, void *b, uint32_t b_size)
+{
+    int ret = memcmp(a, b, a_size < b_size ? a_size : b_size);
+    if (ret == 0) {
+        ret = a_size < b_size ? -1 : (a_size > b_size ? 1 : 0);
+    }
+    return ret;
+}
+
 
 static void
 pack_int(int64_t value, void *dest, uint8_t size)
@@ -371,6 +780,36 @@ unpack_int(void *src, uint8_t size)
     return dest;
 }
 
+/*
+ * Native row packing and unpacking. In tables with native rows, values
+ * are stored as little-endian two's complement integers and IEEE floats,
+ * so that on little-endian machines they are read with a plain copy.
+ * This format does not sort correctly, and so index keys are always
+ * packed using the functions above.
+ */
+
+static void
+pack_native(uint64_t value, void *dest, uint8_t size)
+{
+#ifdef WORDS_BIGENDIAN
+    byteswap_copy(dest, (char *) &value + (8 - size), size);
+#else
+    memcpy(dest, &value, size);
+#endif
+}
+
+static uint64_t
+unpack_native(void *src, uint8_t size)
+{
+    uint64_t dest = 0;
+#ifdef WORDS_BIGENDIAN
+    byteswap_copy((char *) &dest + (8 - size), src, size);
+#else
+    memcpy(&dest, src, size);
+#endif
+    return dest;
+}
+
 
 /*
  * Returns the missing value for a k byte integer.
@@ -461,6 +900,247 @@ missing_float(uint32_t k)
 }
 
 
+/*==========================================================
+ * Dictionaries
+ *==========================================================
+ */
+
+static uint32_t
+dictionary_hash(const char *s, size_t length)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+    size_t j;
+    for (j = 0; j < length; j++) {
+        h ^= (unsigned char) s[j];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Initialises the specified dictionary to hold up to max_size values.
+ * Returns 0 on success or -1 with the appropriate Python exception set.
+ */
+static int
+dictionary_init(dictionary_t *self, uint32_t max_size)
+{
+    int ret = -1;
+    self->max_size = max_size;
+    self->slots = NULL;
+    self->num_slots = 0;
+    self->values = PyList_New(0);
+    if (self->values == NULL) {
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static void
+dictionary_free(dictionary_t *self)
+{
+    Py_XDECREF(self->values);
+    self->values = NULL;
+    PyMem_Free(self->slots);
+    self->slots = NULL;
+    self->num_slots = 0;
+}
+
+/*
+ * Rebuilds the hash table for this dictionary with the specified number
+ * of slots, which must be a power of two.
+ */
+static int
+dictionary_resize(dictionary_t *self, uint32_t num_slots)
+{
+    int ret = -1;
+    uint32_t *slots = NULL;
+    uint32_t code, h;
+    uint32_t mask = num_slots - 1;
+    Py_ssize_t n = PyList_GET_SIZE(self->values);
+    PyObject *v;
+
+    slots = PyMem_Malloc(num_slots * sizeof(uint32_t));
+    if (slots == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(slots, 0, num_slots * sizeof(uint32_t));
+    for (code = 0; code < (uint32_t) n; code++) {
+        v = PyList_GET_ITEM(self->values, code);
+        h = dictionary_hash(PyBytes_AS_STRING(v), PyBytes_GET_SIZE(v)) & mask;
+        while (slots[h] != 0) {
+            h = (h + 1) & mask;
+        }
+        slots[h] = code + 1;
+    }
+    PyMem_Free(self->slots);
+    self->slots = slots;
+    self->num_slots = num_slots;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Finds the code for the specified string in this dictionary. If the
+ * string is not present and insert is true, it is added with the next
+ * code. Returns 0 if the code was found or inserted, 1 if the string is
+ * not present and was not inserted (because insert is false or the
+ * dictionary is full), or -1 with the appropriate Python exception set.
+ */
+static int
+dictionary_get_code(dictionary_t *self, const char *s, size_t length,
+        int insert, uint32_t *code)
+{
+    int ret = -1;
+    uint32_t h, mask;
+    uint32_t n = (uint32_t) PyList_GET_SIZE(self->values);
+    PyObject *v;
+
+    if (insert && 2 * (n + 1) > self->num_slots) {
+        if (dictionary_resize(self, self->num_slots == 0 ? 64
+                    : 2 * self->num_slots) != 0) {
+            goto out;
+        }
+    }
+    if (self->num_slots == 0) {
+        ret = 1;
+        goto out;
+    }
+    mask = self->num_slots - 1;
+    h = dictionary_hash(s, length) & mask;
+    while (self->slots[h] != 0) {
+        v = PyList_GET_ITEM(self->values, self->slots[h] - 1);
+        if ((size_t) PyBytes_GET_SIZE(v) == length
+                && memcmp(PyBytes_AS_STRING(v), s, length) == 0) {
+            *code = self->slots[h] - 1;
+            ret = 0;
+            goto out;
+        }
+        h = (h + 1) & mask;
+    }
+    if (!insert || n >= self->max_size) {
+        ret = 1;
+        goto out;
+    }
+    v = PyBytes_FromStringAndSize(s, (Py_ssize_t) length);
+    if (v == NULL) {
+        goto out;
+    }
+    if (PyList_Append(self->values, v) != 0) {
+        Py_DECREF(v);
+        goto out;
+    }
+    Py_DECREF(v);
+    self->slots[h] = n + 1;
+    *code = n;
+    ret = 0;
+out:
+    return ret;
+}
+
+
+/*==========================================================
+ * Packed genotypes
+ *==========================================================
+ */
+
+/*
+ * Genotype columns store the diploid calls for num_elements samples as a
+ * packed vector. Each allele is stored in element_size bits as its index
+ * plus one, so that 0 denotes a missing allele and a zeroed vector holds
+ * a missing call for every sample. The codes for the alleles of sample j
+ * are at positions 2j and 2j + 1, and are followed by a bitmap in which
+ * bit j is set if the call for sample j is phased.
+ */
+
+static uint32_t
+genotype_alleles_size(uint32_t num_samples, uint32_t bits)
+{
+    return (2 * num_samples * bits + 7) / 8;
+}
+
+static uint32_t
+genotype_vector_size(uint32_t num_samples, uint32_t bits)
+{
+    return genotype_alleles_size(num_samples, bits) + (num_samples + 7) / 8;
+}
+
+static uint32_t
+genotype_get_code(const unsigned char *v, uint32_t index, uint32_t bits)
+{
+    uint32_t bit = index * bits;
+    return (v[bit / 8] >> (bit % 8)) & ((1u << bits) - 1);
+}
+
+static void
+genotype_set_code(unsigned char *v, uint32_t index, uint32_t bits,
+        uint32_t code)
+{
+    uint32_t bit = index * bits;
+    uint32_t mask = ((1u << bits) - 1) << (bit % 8);
+    v[bit / 8] = (unsigned char) ((v[bit / 8] & ~mask) | (code << (bit % 8)));
+}
+
+static int
+genotype_get_phased(const unsigned char *v, uint32_t sample,
+        uint32_t num_samples, uint32_t bits)
+{
+    const unsigned char *phase = v + genotype_alleles_size(num_samples, bits);
+    return (phase[sample / 8] >> (sample % 8)) & 1;
+}
+
+static void
+genotype_set_phased(unsigned char *v, uint32_t sample, uint32_t num_samples,
+        uint32_t bits)
+{
+    unsigned char *phase = v + genotype_alleles_size(num_samples, bits);
+    phase[sample / 8] |= (unsigned char) (1 << (sample % 8));
+}
+
+/*
+ * Parses the specified allele, which is either '.' or a decimal allele
+ * index, and stores its code in code. Returns 0 on success, -1 if the
+ * allele is not well formed and 1 if the index is too large for the
+ * specified number of bits.
+ */
+static int
+genotype_parse_allele(const char *s, size_t length, uint32_t bits,
+        uint32_t *code)
+{
+    int ret = -1;
+    uint32_t max_code = (1u << bits) - 1;
+    uint32_t value = 0;
+    size_t j;
+
+    if (length == 1 && s[0] == '.') {
+        *code = 0;
+        ret = 0;
+        goto out;
+    }
+    if (length == 0) {
+        goto out;
+    }
+    for (j = 0; j < length; j++) {
+        if (!isdigit((unsigned char) s[j])) {
+            goto out;
+        }
+        value = 10 * value + (uint32_t) (s[j] - '0');
+        if (value >= max_code) {
+            ret = 1;
+            goto out;
+        }
+    }
+    *code = value + 1;
+    ret = 0;
+out:
+    return ret;
+}
+
+
 /*==========================================================
  * Column object
  *==========================================================
@@ -567,25 +1247,88 @@ Column_native_to_python_char(Column *self, int index)
     return ret;
 }
 
-/**************************************
- *
- * Unpacking from a row to the element buffer.
- *
- *************************************/
+static PyObject *
+Column_native_to_python_dict(Column *self, int index)
+{
+    PyObject *ret = NULL;
+    uint64_t *native = (uint64_t *) self->element_buffer;
+    PyObject *values = self->dictionary->values;
+    if (native[index] >= (uint64_t) PyList_GET_SIZE(values)) {
+        PyErr_Format(PyExc_SystemError,
+                "Dictionary code out of range for column '%s'",
+                PyBytes_AsString(self->name));
+        goto out;
+    }
+    ret = PyList_GET_ITEM(values, native[index]);
+    Py_INCREF(ret);
+out:
+    return ret;
+}
 
 /*
- * Unpack values starting at the specified pointer, and return the
- * number of missing_values encountered.
+ * Returns the call for the specified sample in VCF notation, or None if
+ * both alleles are missing and the call is unphased.
  */
-static int
-Column_unpack_elements_uint(Column *self, void *source)
+static PyObject *
+Column_native_to_python_genotype(Column *self, int index)
 {
-    int j;
-    int ret = 0;
-    char *v = (char *) source;
-    uint64_t *elements = (uint64_t *) self->element_buffer;
-    uint64_t missing_value = missing_uint(self->element_size);
-    int size = self->element_size;
+    PyObject *ret = NULL;
+    unsigned char *v = (unsigned char *) self->element_buffer;
+    uint32_t bits = (uint32_t) self->element_size;
+    uint32_t n = (uint32_t) self->num_elements;
+    uint32_t codes[2];
+    char buffer[16];
+    int j, phased, length;
+
+    codes[0] = genotype_get_code(v, 2 * index, bits);
+    codes[1] = genotype_get_code(v, 2 * index + 1, bits);
+    phased = genotype_get_phased(v, index, n, bits);
+    if (codes[0] == 0 && codes[1] == 0 && !phased) {
+        Py_INCREF(Py_None);
+        ret = Py_None;
+        goto out;
+    }
+    length = 0;
+    for (j = 0; j < 2; j++) {
+        if (j == 1) {
+            buffer[length] = phased ? '|' : '/';
+            length++;
+        }
+        if (codes[j] == 0) {
+            buffer[length] = '.';
+            length++;
+        } else {
+            length += sprintf(buffer + length, "%u",
+                    (unsigned int) (codes[j] - 1));
+        }
+    }
+    ret = PyBytes_FromStringAndSize(buffer, length);
+    if (ret == NULL) {
+        PyErr_NoMemory();
+    }
+out:
+    return ret;
+}
+
+/**************************************
+ *
+ * Unpacking from a row to the element buffer.
+ *
+ *************************************/
+
+/*
+ * Unpack values starting at the specified pointer, and return the
+ * number of missing_values encountered.
+ */
+static int
+Column_unpack_elements_uint(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    uint64_t *elements = (uint64_t *) self->element_buffer;
+    uint64_t missing_value = missing_uint(self->element_size);
+    int size = self->element_size;
     for (j = 0; j < self->num_buffered_elements; j++) {
         elements[j] = unpack_uint(v + j * size, size);
         if (elements[j] == missing_value) {
@@ -690,6 +1433,135 @@ Column_unpack_elements_char(Column *self, void *source)
     return ret;
 }
 
+/*
+ * Genotype vectors are missing only if every call is missing, i.e. all
+ * bytes in the vector are zero.
+ */
+static int
+Column_unpack_elements_genotype(Column *self, void *source)
+{
+    int ret = 1;
+    uint32_t j;
+    char *v = (char *) source;
+    uint32_t size = genotype_vector_size((uint32_t) self->num_elements,
+            (uint32_t) self->element_size);
+    memcpy(self->element_buffer, source, size);
+    for (j = 0; j < size; j++) {
+        if (v[j] != 0) {
+            ret = 0;
+            break;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Unpack values stored in native rows. The missing value of a k byte
+ * unsigned integer is stored as k bytes of ones, and so must be mapped
+ * back to the 64 bit missing value.
+ */
+static int
+Column_unpack_native_elements_uint(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    uint64_t *elements = (uint64_t *) self->element_buffer;
+    uint64_t missing_value = missing_uint(self->element_size);
+    uint8_t size = (uint8_t) self->element_size;
+    uint64_t ones = size == 8 ? missing_value : (1ull << (8 * size)) - 1;
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        elements[j] = unpack_native(v + j * size, size);
+        if (elements[j] == ones) {
+            elements[j] = missing_value;
+            ret += 1;
+        }
+    }
+    return ret;
+}
+
+static int
+Column_unpack_native_elements_int(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    int64_t *elements = (int64_t *) self->element_buffer;
+    int64_t missing_value = missing_int(self->element_size);
+    uint8_t size = (uint8_t) self->element_size;
+    const uint64_t m = 1ull << (size * 8 - 1);
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        /* sign extend */
+        elements[j] = (int64_t) ((unpack_native(v + j * size, size) ^ m) - m);
+        if (elements[j] == missing_value) {
+            ret += 1;
+        }
+    }
+    return ret;
+}
+
+static int
+Column_unpack_native_elements_float_2(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    double *elements = (double *) self->element_buffer;
+    union { double value; uint64_t bits; } conv;
+    uint64_t missing_bits = missing_float(self->element_size);
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        elements[j] = npy_half_to_double((npy_half) unpack_native(v, 2));
+        v += self->element_size;
+        conv.value = elements[j];
+        if (conv.bits == missing_bits) {
+            ret += 1;
+        }
+    }
+    return ret;
+}
+
+static int
+Column_unpack_native_elements_float_4(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    double *elements = (double *) self->element_buffer;
+    union { double value; uint64_t bits; } conv;
+    union { float value; uint32_t bits; } single;
+    uint64_t missing_bits = missing_float(self->element_size);
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        single.bits = (uint32_t) unpack_native(v, sizeof(float));
+        elements[j] = (double) single.value;
+        v += self->element_size;
+        conv.value = elements[j];
+        if (conv.bits == missing_bits) {
+            ret += 1;
+        }
+    }
+    return ret;
+}
+
+static int
+Column_unpack_native_elements_float_8(Column *self, void *source)
+{
+    int j;
+    int ret = 0;
+    char *v = (char *) source;
+    double *elements = (double *) self->element_buffer;
+    union { double value; uint64_t bits; } conv;
+    uint64_t missing_bits = missing_float(self->element_size);
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        conv.bits = unpack_native(v, sizeof(double));
+        elements[j] = conv.value;
+        v += self->element_size;
+        if (conv.bits == missing_bits) {
+            ret += 1;
+        }
+    }
+    return ret;
+}
+
 /**************************************
  *
  * Packing native values from the element_buffer to a row.
@@ -780,6 +1652,78 @@ Column_pack_elements_char(Column *self, void *dest)
     return ret;
 }
 
+static int
+Column_pack_elements_genotype(Column *self, void *dest)
+{
+    int ret = -1;
+    memcpy(dest, self->element_buffer, genotype_vector_size(
+            (uint32_t) self->num_elements, (uint32_t) self->element_size));
+    ret = 0;
+    return ret;
+}
+
+
+
+/*
+ * Pack values into native rows.
+ */
+static int
+Column_pack_native_elements_int(Column *self, void *dest)
+{
+    int j;
+    char *v = (char *) dest;
+    uint64_t *elements = (uint64_t *) self->element_buffer;
+    uint8_t size = (uint8_t) self->element_size;
+    /* two's complement signed values have the same bits as unsigned */
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        pack_native(elements[j], v, size);
+        v += size;
+    }
+    return 0;
+}
+
+static int
+Column_pack_native_elements_float_2(Column *self, void *dest)
+{
+    int j;
+    char *v = (char *) dest;
+    double *elements = (double *) self->element_buffer;
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        pack_native((uint64_t) npy_double_to_half(elements[j]), v, 2);
+        v += self->element_size;
+    }
+    return 0;
+}
+
+static int
+Column_pack_native_elements_float_4(Column *self, void *dest)
+{
+    int j;
+    char *v = (char *) dest;
+    double *elements = (double *) self->element_buffer;
+    union { float value; uint32_t bits; } single;
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        single.value = (float) elements[j];
+        pack_native((uint64_t) single.bits, v, sizeof(float));
+        v += self->element_size;
+    }
+    return 0;
+}
+
+static int
+Column_pack_native_elements_float_8(Column *self, void *dest)
+{
+    int j;
+    char *v = (char *) dest;
+    double *elements = (double *) self->element_buffer;
+    union { double value; uint64_t bits; } conv;
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        conv.value = elements[j];
+        pack_native(conv.bits, v, sizeof(double));
+        v += self->element_size;
+    }
+    return 0;
+}
 
 
 /**************************************
@@ -857,6 +1801,13 @@ Column_verify_elements_char(Column *self)
     return 0;
 }
 
+/* Calls are checked as they are parsed into the packed vector. */
+static int
+Column_verify_elements_genotype(Column *self)
+{
+    return 0;
+}
+
 /**************************************
  *
  * Truncate elements in the buffer.
@@ -1221,78 +2172,262 @@ out:
     return ret;
 }
 
-
-
-/**************************************
- *
- * String input element parsing.
- *
- *************************************/
-
-static void
-Column_encoded_elements_parse_error(Column *self, const char *message,
-        char *source)
-{
-    PyErr_Format(PyExc_ValueError,
-            "Parse error on column '%s': %s: '%s'",
-            PyBytes_AsString(self->name), message, source);
-}
-
-
 /*
- * Takes a string sequence and places pointers to the start
- * of each individual element into the input_elements list.
- * Checks for various errors in the format of this sequence.
+ * Sets the code for the specified string as the single element in the
+ * element buffer of a dictionary column, adding the string to the
+ * dictionary if necessary.
  */
 static int
-Column_parse_string_sequence(Column *self, char *s)
+Column_set_dictionary_code(Column *self, char *s, size_t length)
 {
     int ret = -1;
-    int j, num_elements, delimiter;
-    int max_num_elements = Column_get_max_num_elements(self);
-    self->num_buffered_elements = 0;
-    if (self->num_elements == 1) {
-        self->input_elements[0] = s;
-        num_elements = 1;
-    } else {
-        j = 0;
-        num_elements = 0;
-        delimiter = -1;
-        while (s[j] != '\0') {
-            if (s[j] == ',' || s[j] == ';') {
-                delimiter = j;
-            }
-            if (j == delimiter + 1) {
-                if (num_elements >= max_num_elements) {
-                    Column_encoded_elements_parse_error(self,
-                            "incorrect number of elements", s);
-                    goto out;
-                }
-                /* this is the start of a new element */
-                self->input_elements[num_elements] = &s[j];
-                num_elements++;
-            }
-            j++;
-        }
+    int wt_ret;
+    uint32_t code;
+    uint64_t *native = (uint64_t *) self->element_buffer;
+    wt_ret = dictionary_get_code(self->dictionary, s, length, 1, &code);
+    if (wt_ret < 0) {
+        goto out;
     }
-    if (!Column_is_variable(self)) {
-        if (num_elements != self->num_elements) {
-            Column_encoded_elements_parse_error(self,
-                    "incorrect number of elements", s);
-            goto out;
-        }
+    if (wt_ret == 1) {
+        PyErr_Format(PyExc_ValueError,
+                "Too many distinct values for column '%s'",
+                PyBytes_AsString(self->name));
+        goto out;
     }
-    self->num_buffered_elements = num_elements;
+    native[0] = code;
+    self->num_buffered_elements = 1;
     ret = 0;
 out:
     return ret;
 }
 
 static int
-Column_string_to_native_uint(Column *self, char *string)
+Column_python_to_native_dict(Column *self, PyObject *elements)
 {
     int ret = -1;
-    uint64_t *native= (uint64_t *) self->element_buffer;
+    char *s;
+    Py_ssize_t length;
+    uint64_t *native = (uint64_t *) self->element_buffer;
+
+    if (elements == Py_None) {
+        native[0] = missing_uint(self->element_size);
+        self->num_buffered_elements = 1;
+        ret = WT_MISSING_VALUE;
+    } else {
+        if (!PyBytes_Check(elements)) {
+            PyErr_Format(PyExc_TypeError,
+                    "Values for column '%s' must be bytes",
+                    PyBytes_AsString(self->name));
+            goto out;
+        }
+        if (PyBytes_AsStringAndSize(elements, &s, &length) < 0) {
+            goto out;
+        }
+        if (Column_set_dictionary_code(self, s, (size_t) length) < 0) {
+            goto out;
+        }
+        ret = 0;
+    }
+out:
+    return ret;
+}
+
+/*
+ * Sets the call for every sample in the element buffer of a genotype
+ * column to missing.
+ */
+static void
+Column_clear_genotypes(Column *self)
+{
+    memset(self->element_buffer, 0, genotype_vector_size(
+            (uint32_t) self->num_elements, (uint32_t) self->element_size));
+    self->num_buffered_elements = self->num_elements;
+}
+
+/*
+ * Sets an exception of the specified type for the genotype call of the
+ * specified length in this column. The call is not NUL terminated, so
+ * it is copied into a bytes object for formatting.
+ */
+static void
+Column_set_genotype_error(Column *self, PyObject *type, const char *message,
+        const char *s, size_t length)
+{
+    PyObject *call = PyBytes_FromStringAndSize(s, (Py_ssize_t) length);
+    if (call != NULL) {
+        PyErr_Format(type, "%s '%s' for column '%s'", message,
+                PyBytes_AS_STRING(call), PyBytes_AsString(self->name));
+        Py_DECREF(call);
+    }
+}
+
+/*
+ * Parses the specified VCF call (such as "0/1", "1|1" or ".") and stores
+ * it for the specified sample in the element buffer of a genotype column.
+ */
+static int
+Column_set_genotype(Column *self, uint32_t sample, const char *s,
+        size_t length)
+{
+    int ret = -1;
+    int wt_ret = 0;
+    unsigned char *v = (unsigned char *) self->element_buffer;
+    uint32_t bits = (uint32_t) self->element_size;
+    uint32_t codes[2];
+    size_t split;
+
+    if (length == 1 && s[0] == '.') {
+        codes[0] = 0;
+        codes[1] = 0;
+    } else {
+        split = 0;
+        while (split < length && s[split] != '/' && s[split] != '|') {
+            split++;
+        }
+        if (split == length) {
+            wt_ret = -1;
+        } else {
+            wt_ret = genotype_parse_allele(s, split, bits, &codes[0]);
+            if (wt_ret == 0) {
+                wt_ret = genotype_parse_allele(s + split + 1,
+                        length - split - 1, bits, &codes[1]);
+            }
+        }
+        if (wt_ret < 0) {
+            Column_set_genotype_error(self, PyExc_ValueError,
+                    "Bad genotype", s, length);
+            goto out;
+        }
+        if (wt_ret > 0) {
+            Column_set_genotype_error(self, PyExc_OverflowError,
+                    "Allele index too large in genotype", s, length);
+            goto out;
+        }
+        if (s[split] == '|') {
+            genotype_set_phased(v, sample, (uint32_t) self->num_elements,
+                    bits);
+        }
+    }
+    genotype_set_code(v, 2 * sample, bits, codes[0]);
+    genotype_set_code(v, 2 * sample + 1, bits, codes[1]);
+    ret = 0;
+out:
+    return ret;
+}
+
+static int
+Column_python_to_native_genotype(Column *self, PyObject *elements)
+{
+    int ret = -1;
+    int j;
+    char *s;
+    Py_ssize_t length;
+    PyObject *v;
+
+    Column_clear_genotypes(self);
+    if (elements == Py_None) {
+        ret = WT_MISSING_VALUE;
+    } else {
+        if (Column_parse_python_sequence(self, elements) < 0) {
+            goto out;
+        }
+        for (j = 0; j < self->num_buffered_elements; j++) {
+            v = (PyObject *) self->input_elements[j];
+            if (v == Py_None) {
+                continue;
+            }
+            if (!PyBytes_Check(v)) {
+                PyErr_Format(PyExc_TypeError,
+                        "Values for column '%s' must be bytes",
+                        PyBytes_AsString(self->name));
+                goto out;
+            }
+            if (PyBytes_AsStringAndSize(v, &s, &length) < 0) {
+                goto out;
+            }
+            if (Column_set_genotype(self, (uint32_t) j, s, (size_t) length)
+                    < 0) {
+                goto out;
+            }
+        }
+        ret = 0;
+    }
+out:
+    return ret;
+}
+
+
+
+/**************************************
+ *
+ * String input element parsing.
+ *
+ *************************************/
+
+static void
+Column_encoded_elements_parse_error(Column *self, const char *message,
+        char *source)
+{
+    PyErr_Format(PyExc_ValueError,
+            "Parse error on column '%s': %s: '%s'",
+            PyBytes_AsString(self->name), message, source);
+}
+
+
+/*
+ * Takes a string sequence and places pointers to the start
+ * of each individual element into the input_elements list.
+ * Checks for various errors in the format of this sequence.
+ */
+static int
+Column_parse_string_sequence(Column *self, char *s)
+{
+    int ret = -1;
+    int j, num_elements, delimiter;
+    int max_num_elements = Column_get_max_num_elements(self);
+    self->num_buffered_elements = 0;
+    if (self->num_elements == 1) {
+        self->input_elements[0] = s;
+        num_elements = 1;
+    } else {
+        j = 0;
+        num_elements = 0;
+        delimiter = -1;
+        while (s[j] != '\0') {
+            if (s[j] == ',' || s[j] == ';') {
+                delimiter = j;
+            }
+            if (j == delimiter + 1) {
+                if (num_elements >= max_num_elements) {
+                    Column_encoded_elements_parse_error(self,
+                            "incorrect number of elements", s);
+                    goto out;
+                }
+                /* this is the start of a new element */
+                self->input_elements[num_elements] = &s[j];
+                num_elements++;
+            }
+            j++;
+        }
+    }
+    if (!Column_is_variable(self)) {
+        if (num_elements != self->num_elements) {
+            Column_encoded_elements_parse_error(self,
+                    "incorrect number of elements", s);
+            goto out;
+        }
+    }
+    self->num_buffered_elements = num_elements;
+    ret = 0;
+out:
+    return ret;
+}
+
+static int
+Column_string_to_native_uint(Column *self, char *string)
+{
+    int ret = -1;
+    uint64_t *native= (uint64_t *) self->element_buffer;
     char *v, *tail;
     int j;
     if (Column_parse_string_sequence(self, string) < 0) {
@@ -1424,6 +2559,51 @@ out:
     return ret;
 }
 
+static int
+Column_string_to_native_dict(Column *self, char *string)
+{
+    return Column_set_dictionary_code(self, string, strlen(string));
+}
+
+static int
+Column_string_to_native_genotype(Column *self, char *string)
+{
+    int ret = -1;
+    int j;
+    char *s;
+    Column_clear_genotypes(self);
+    if (Column_parse_string_sequence(self, string) < 0) {
+        goto out;
+    }
+    for (j = 0; j < self->num_buffered_elements; j++) {
+        s = (char *) self->input_elements[j];
+        if (Column_set_genotype(self, (uint32_t) j, s, strcspn(s, ",;"))
+                < 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+/*
+ * Returns the maximum size of a row in a table with the specified address
+ * size. Addresses are stored in the same way as unsigned integers, and so
+ * a 3 byte address can hold values up to 2^24 - 2.
+ */
+static uint32_t
+max_row_size(unsigned int address_size)
+{
+    uint32_t ret = MAX_ROW_SIZE;
+    if (address_size == 3) {
+        ret = (1u << 24) - 1;
+    } else if (address_size > 3) {
+        ret = WT_MAX_WIDE_ROW_SIZE;
+    }
+    return ret;
+}
 
 /*
  * Packs the address and number of elements in a variable length column at the
@@ -1436,10 +2616,9 @@ Column_pack_variable_elements_address(Column *self, void *dest,
 {
     int ret = -1;
     char *v = (char *) dest;
-    /* future version will support more general address size */
-    unsigned int address_size = 2;
+    unsigned int address_size = (unsigned int) self->address_size;
     unsigned int var_size = self->num_elements == WT_VAR_1 ? 1 : 2;
-    if (offset >= MAX_ROW_SIZE) {
+    if (offset >= max_row_size(address_size)) {
         PyErr_SetString(PyExc_SystemError, "Row overflow");
         goto out;
     }
@@ -1467,8 +2646,7 @@ Column_unpack_variable_elements_address(Column *self, void *src,
     char *v = (char *) src;
     uint64_t off = 0;
     uint64_t n = 0;
-    /* future version will support more general address size */
-    unsigned int address_size = 2;
+    unsigned int address_size = (unsigned int) self->address_size;
     unsigned int var_size = self->num_elements == WT_VAR_1 ? 1 : 2;
     off = unpack_uint(v, address_size);
     if (off == missing_uint(address_size)) {
@@ -1476,7 +2654,7 @@ Column_unpack_variable_elements_address(Column *self, void *src,
     } else {
         v += address_size;
         n = unpack_uint(v, var_size);
-        if (off >= MAX_ROW_SIZE) {
+        if (off >= max_row_size(address_size)) {
             PyErr_SetString(PyExc_SystemError, "Row overflow");
             goto out;
         }
@@ -1493,74 +2671,225 @@ out:
 }
 
 /*
- * Inserts the values in the element buffer into the specified row which
- * is currently of the specified size, and return the number of bytes
- * used in the variable region. Returns -1 in the case of an error with
- * the appropriate Python exception set.
+ * Returns the number of bytes that storing the values in the element
+ * buffer adds to the variable region of the row of the column's family.
+ */
+static uint32_t
+Column_get_update_size(Column *self)
+{
+    uint32_t ret = 0;
+    uint32_t num_elements = (uint32_t) self->num_buffered_elements;
+    uint32_t data_size = num_elements * (uint32_t) self->element_size;
+    if (self->sparse) {
+        ret = (uint32_t) self->address_size + WT_SPARSE_BIT_SIZE;
+        if (self->element_type == WT_GENOTYPE) {
+            ret += genotype_vector_size((uint32_t) self->num_elements,
+                    (uint32_t) self->element_size);
+        } else if (Column_is_variable(self)) {
+            ret += (self->num_elements == WT_VAR_1 ? 1 : 2) + data_size;
+        } else {
+            ret += data_size;
+        }
+    } else if (Column_is_variable(self)) {
+        ret = data_size;
+    }
+    return ret;
+}
+
+/*
+ * Inserts the values in the element buffer of this sparse column into the
+ * variable region of the specified row, which is currently of the
+ * specified size, and marks the column as present. Returns the number of
+ * bytes used in the variable region or -1 with a Python exception set.
  */
 static int
-Column_update_row(Column *self, void *row, uint32_t row_size)
+Column_update_sparse_row(Column *self, void *row, uint32_t row_size)
 {
     int ret = -1;
     char *v = (char *) row;
-    void *dest;
-    int bytes_added = 0;
+    unsigned char *header = (unsigned char *) v + self->fixed_region_offset;
+    unsigned int address_size = (unsigned int) self->address_size;
+    unsigned char *bitmap = header + address_size;
+    char *entry = v + row_size;
     uint32_t num_elements = (uint32_t) self->num_buffered_elements;
-    int data_size = num_elements * self->element_size;
-    if (self->verify_elements(self) < 0) {
-        goto out;
-    }
-    dest = v + self->fixed_region_offset;
+    unsigned int var_size = 0;
+    int bytes_added;
+
     if (Column_is_variable(self)) {
-        bytes_added = data_size;
-        if (row_size + bytes_added > MAX_ROW_SIZE) {
-            PyErr_SetString(PyExc_ValueError, "Row overflow");
-            goto out;
-        }
-        if (Column_pack_variable_elements_address(self, dest, row_size,
-                num_elements) < 0) {
+        var_size = self->num_elements == WT_VAR_1 ? 1 : 2;
+        if (num_elements > Column_get_max_num_elements(self)) {
+            PyErr_SetString(PyExc_SystemError, "too many elements");
             goto out;
         }
-        dest = v + row_size;
     }
-    self->pack_elements(self, dest);
+    bytes_added = (int) Column_get_update_size(self);
+    if (row_size + bytes_added > self->max_row_size) {
+        PyErr_SetString(PyExc_ValueError, "Row overflow");
+        goto out;
+    }
+    /* link this value to the previous head of the list */
+    memcpy(entry, header, address_size);
+    entry += address_size;
+    pack_uint((uint64_t) self->sparse_bit, entry, WT_SPARSE_BIT_SIZE);
+    entry += WT_SPARSE_BIT_SIZE;
+    if (var_size != 0) {
+        pack_uint((uint64_t) num_elements, entry, var_size);
+        entry += var_size;
+    }
+    if (self->pack_elements(self, entry) < 0) {
+        goto out;
+    }
+    pack_uint((uint64_t) row_size, header, address_size);
+    bitmap[self->sparse_bit / 8] |= (unsigned char) (1 << (self->sparse_bit % 8));
     ret = bytes_added;
 out:
     return ret;
 }
 
-
 /*
- * Extract values from the specified key buffer starting at the specified
- * offset. Returns a positive value WT_MISSING_VALUE if the missing
- * value is detected, or 0 if not. Returns a negative value if an error
- * occured.
+ * Finds the value of this sparse column in the specified row, setting
+ * offset to its address and num_elements to its number of elements. If
+ * the column is not present offset is set to 0 without reading the
+ * variable region. When a column has been stored more than once in a row
+ * the most recent value is used.
  */
 static int
-Column_extract_key(Column *self, void *key_buffer, uint32_t offset,
-        uint32_t key_size)
+Column_find_sparse_value(Column *self, void *row, uint32_t *offset,
+        uint32_t *num_elements)
 {
     int ret = -1;
-    char *v;
-    char *kb = (char *) key_buffer;
-    char s;
-    uint32_t j, k;
-    uint32_t element_size = self->element_size;
-    uint32_t num_elements = self->num_elements;
-    int not_done;
-
-    if (Column_is_variable(self)) {
-        /* count the number of elements until we hit the sentinel */
-        num_elements = 0;
-        not_done = 1;
-        j = offset;
-        v = kb;
-        while (not_done) {
-            s = 0;
-            k = j + element_size;
-            while (j < k) {
-                if (j >= key_size) {
-                    PyErr_SetString(PyExc_SystemError, "Key buffer overflow");
+    char *v = (char *) row;
+    unsigned char *header = (unsigned char *) v + self->fixed_region_offset;
+    unsigned int address_size = (unsigned int) self->address_size;
+    unsigned char *bitmap = header + address_size;
+    uint64_t address, next;
+    uint64_t none = missing_uint(address_size);
+    uint64_t n = (uint64_t) self->num_elements;
+    unsigned int var_size;
+    char *entry;
+
+    *offset = 0;
+    *num_elements = Column_is_variable(self) ? 0 : (uint32_t) n;
+    if (!(bitmap[self->sparse_bit / 8] & (1 << (self->sparse_bit % 8)))) {
+        ret = 0;
+        goto out;
+    }
+    address = unpack_uint(header, address_size);
+    while (address != none) {
+        /* the entry header must lie within the row buffer */
+        if (address + address_size + WT_SPARSE_BIT_SIZE + 2
+                > self->row_buffer_size) {
+            PyErr_SetString(PyExc_SystemError, "Row overflow");
+            goto out;
+        }
+        entry = v + address;
+        if (unpack_uint(entry + address_size, WT_SPARSE_BIT_SIZE)
+                == (uint64_t) self->sparse_bit) {
+            entry += address_size + WT_SPARSE_BIT_SIZE;
+            if (Column_is_variable(self)) {
+                var_size = self->num_elements == WT_VAR_1 ? 1 : 2;
+                n = unpack_uint(entry, var_size);
+                if (n > Column_get_max_num_elements(self)) {
+                    PyErr_SetString(PyExc_SystemError, "too many elements");
+                    goto out;
+                }
+                entry += var_size;
+            }
+            *offset = (uint32_t) (entry - v);
+            *num_elements = (uint32_t) n;
+            break;
+        }
+        next = unpack_uint(entry, address_size);
+        /* values are linked in decreasing order of address */
+        if (next != none && next >= address) {
+            PyErr_SetString(PyExc_SystemError, "Corrupt sparse column list");
+            goto out;
+        }
+        address = next;
+    }
+    if (*offset == 0) {
+        PyErr_SetString(PyExc_SystemError, "Sparse column value not found");
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Inserts the values in the element buffer into the specified row which
+ * is currently of the specified size, and return the number of bytes
+ * used in the variable region. The row is the table's row buffer, and
+ * the size is that of the row of the column's family. Returns -1 in the
+ * case of an error with the appropriate Python exception set.
+ */
+static int
+Column_update_row(Column *self, void *row, uint32_t row_size)
+{
+    int ret = -1;
+    char *v = (char *) row + self->row_offset;
+    void *dest;
+    int bytes_added = 0;
+    uint32_t num_elements = (uint32_t) self->num_buffered_elements;
+    int data_size = (int) Column_get_update_size(self);
+    if (self->verify_elements(self) < 0) {
+        goto out;
+    }
+    dest = v + self->fixed_region_offset;
+    if (self->sparse) {
+        ret = Column_update_sparse_row(self, v, row_size);
+        goto out;
+    }
+    if (Column_is_variable(self)) {
+        bytes_added = data_size;
+        if (row_size + bytes_added > self->max_row_size) {
+            PyErr_SetString(PyExc_ValueError, "Row overflow");
+            goto out;
+        }
+        if (Column_pack_variable_elements_address(self, dest, row_size,
+                num_elements) < 0) {
+            goto out;
+        }
+        dest = v + row_size;
+    }
+    self->pack_elements(self, dest);
+    ret = bytes_added;
+out:
+    return ret;
+}
+
+
+/*
+ * Extract values from the specified key buffer starting at the specified
+ * offset. Returns a positive value WT_MISSING_VALUE if the missing
+ * value is detected, or 0 if not. Returns a negative value if an error
+ * occured.
+ */
+static int
+Column_extract_key(Column *self, void *key_buffer, uint32_t offset,
+        uint32_t key_size)
+{
+    int ret = -1;
+    char *v;
+    char *kb = (char *) key_buffer;
+    char s;
+    uint32_t j, k;
+    uint32_t element_size = self->element_size;
+    uint32_t num_elements = self->num_elements;
+    int not_done;
+
+    if (Column_is_variable(self)) {
+        /* count the number of elements until we hit the sentinel */
+        num_elements = 0;
+        not_done = 1;
+        j = offset;
+        v = kb;
+        while (not_done) {
+            s = 0;
+            k = j + element_size;
+            while (j < k) {
+                if (j >= key_size) {
+                    PyErr_SetString(PyExc_SystemError, "Key buffer overflow");
                     goto out;
                 }
                 s |= v[j];
@@ -1580,7 +2909,7 @@ Column_extract_key(Column *self, void *key_buffer, uint32_t offset,
     }
     v = kb + offset;
     self->num_buffered_elements = num_elements;
-    ret = self->unpack_elements(self, v);
+    ret = self->unpack_key_elements(self, v);
     if (ret > 0) {
         ret = WT_MISSING_VALUE;
     }
@@ -1589,24 +2918,75 @@ out:
 }
 
 /*
- * Extracts elements from the specified row and inserts them into the
- * element buffer. Returns a positive value WT_MISSING_VALUE if the
- * missing value was stored in this column, 0 if a non-missing value
- * was stored, and a negative value if an error occurs.
+ * Checks that a value of the specified number of elements at the specified
+ * offset in the row of the column's family lies within the family's part
+ * of the row buffer, so that corrupt rows are not read beyond it.
+ */
+static int
+Column_check_value_bounds(Column *self, uint32_t offset,
+        uint32_t num_elements)
+{
+    int ret = -1;
+    uint64_t size = (uint64_t) num_elements * (uint64_t) self->element_size;
+    if (self->element_type == WT_GENOTYPE) {
+        size = genotype_vector_size((uint32_t) self->num_elements,
+                (uint32_t) self->element_size);
+    }
+    if ((uint64_t) offset + size > self->row_buffer_size) {
+        PyErr_SetString(PyExc_SystemError, "Row overflow");
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Extracts elements from the specified row buffer, which holds the row
+ * of each column family, and inserts them into the element buffer.
+ * Returns a positive value WT_MISSING_VALUE if the missing value was
+ * stored in this column, 0 if a non-missing value was stored, and a
+ * negative value if an error occurs.
  */
 static int
 Column_extract_elements(Column *self, void *row)
 {
     int ret = -1;
-    char *v = (char *) row;
+    char *v = (char *) row + self->row_offset;
     void *src;
     uint32_t offset, num_elements;
     src = v + self->fixed_region_offset;
-    if (Column_is_variable(self)) {
+    if (self->sparse) {
+        if (Column_find_sparse_value(self, v, &offset, &num_elements) < 0) {
+            goto out;
+        }
+        if (offset != 0 && Column_check_value_bounds(self, offset,
+                    num_elements) < 0) {
+            goto out;
+        }
+        src = offset == 0 ? self->sparse_missing : v + offset;
+        self->num_buffered_elements = num_elements;
+        ret = self->unpack_elements(self, src);
+        if (ret < 0) {
+            goto out;
+        }
+        if (offset == 0 || ret > 0) {
+            if (offset != 0 && Column_is_variable(self)) {
+                PyErr_SetString(PyExc_SystemError,
+                    "Missing values detected within variable length column");
+                ret = -1;
+                goto out;
+            }
+            ret = WT_MISSING_VALUE;
+        }
+    } else if (Column_is_variable(self)) {
         if (Column_unpack_variable_elements_address(self, src, &offset,
                 &num_elements) < 0) {
             goto out;
         }
+        if (Column_check_value_bounds(self, offset, num_elements) < 0) {
+            goto out;
+        }
         src = v + offset;
         self->num_buffered_elements = num_elements;
         ret = self->unpack_elements(self, src);
@@ -1632,6 +3012,142 @@ out:
     return ret;
 }
 
+/*
+ * Converts the elements extracted from the specified source column into
+ * the element buffer of this column, so that they can be stored with
+ * Column_update_row. Unsigned and signed integers may be converted to
+ * each other, and missing elements are mapped to the missing value of
+ * this column; the range of the converted values is checked when they
+ * are stored. Returns WT_MISSING_VALUE if the value in a fixed length
+ * source column is missing, 0 if the elements were converted, or -1 with
+ * the appropriate Python exception set.
+ */
+static int
+Column_transcode_elements(Column *self, Column *source)
+{
+    int ret = -1;
+    int j, missing;
+    int num_missing = 0;
+    int n = source->num_buffered_elements;
+    uint64_t *src_uint = (uint64_t *) source->element_buffer;
+    int64_t *src_int = (int64_t *) source->element_buffer;
+    double *src_float = (double *) source->element_buffer;
+    char *src_char = (char *) source->element_buffer;
+    uint64_t *dest_uint = (uint64_t *) self->element_buffer;
+    int64_t *dest_int = (int64_t *) self->element_buffer;
+    double *dest_float = (double *) self->element_buffer;
+    char *dest_char = (char *) self->element_buffer;
+    int64_t src_missing_int = missing_int(source->element_size);
+    int64_t dest_missing_int = missing_int(self->element_size);
+    uint64_t src_missing_float = missing_float(source->element_size);
+    uint64_t dest_missing_float = missing_float(self->element_size);
+    union { double value; uint64_t bits; } conv;
+
+    if (self->element_type == WT_CHAR || source->element_type == WT_CHAR) {
+        if (self->element_type != source->element_type) {
+            PyErr_Format(PyExc_TypeError,
+                    "Cannot convert column '%s' between char and numeric "
+                    "types", PyBytes_AsString(self->name));
+            goto out;
+        }
+        if (!Column_is_variable(source)
+                && memchr(src_char, 0, n) != NULL) {
+            /* zero bytes denote a missing value in fixed length columns */
+            ret = WT_MISSING_VALUE;
+            goto out;
+        }
+    } else if ((self->element_type == WT_FLOAT)
+            != (source->element_type == WT_FLOAT)) {
+        PyErr_Format(PyExc_TypeError,
+                "Cannot convert column '%s' between float and integer types",
+                PyBytes_AsString(self->name));
+        goto out;
+    }
+    if (n > Column_get_max_num_elements(self)) {
+        PyErr_Format(PyExc_ValueError,
+                "Too many elements for column '%s'",
+                PyBytes_AsString(self->name));
+        goto out;
+    }
+    if (!Column_is_variable(self) && n != self->num_elements) {
+        PyErr_Format(PyExc_ValueError,
+                "Incorrect number of elements for column '%s'",
+                PyBytes_AsString(self->name));
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        missing = 0;
+        switch (self->element_type) {
+            case WT_CHAR:
+                dest_char[j] = src_char[j];
+                break;
+            case WT_FLOAT:
+                conv.value = src_float[j];
+                if (conv.bits == src_missing_float) {
+                    conv.bits = dest_missing_float;
+                    missing = 1;
+                }
+                dest_float[j] = conv.value;
+                break;
+            case WT_UINT:
+                if (source->element_type == WT_UINT) {
+                    dest_uint[j] = src_uint[j];
+                    missing = src_uint[j] == missing_uint(source->element_size);
+                } else if (src_int[j] == src_missing_int) {
+                    dest_uint[j] = missing_uint(self->element_size);
+                    missing = 1;
+                } else if (src_int[j] < 0) {
+                    PyErr_Format(PyExc_OverflowError,
+                            "Values for column '%s' must be between %lld and "
+                            "%lld", PyBytes_AsString(self->name),
+                            (long long) min_uint(self->element_size),
+                            (long long) max_uint(self->element_size));
+                    goto out;
+                } else {
+                    dest_uint[j] = (uint64_t) src_int[j];
+                }
+                break;
+            case WT_INT:
+                if (source->element_type == WT_INT) {
+                    dest_int[j] = src_int[j];
+                    if (src_int[j] == src_missing_int) {
+                        dest_int[j] = dest_missing_int;
+                        missing = 1;
+                    }
+                } else if (src_uint[j] == missing_uint(source->element_size)) {
+                    dest_int[j] = dest_missing_int;
+                    missing = 1;
+                } else if (src_uint[j] > (uint64_t) max_int(8)) {
+                    PyErr_Format(PyExc_OverflowError,
+                            "Values for column '%s' must be between %lld and "
+                            "%lld", PyBytes_AsString(self->name),
+                            (long long) min_int(self->element_size),
+                            (long long) max_int(self->element_size));
+                    goto out;
+                } else {
+                    dest_int[j] = (int64_t) src_uint[j];
+                }
+                break;
+        }
+        num_missing += missing;
+    }
+    if (!Column_is_variable(source) && num_missing > 0
+            && num_missing == source->num_buffered_elements) {
+        ret = WT_MISSING_VALUE;
+        goto out;
+    }
+    if (Column_is_variable(self) && num_missing > 0) {
+        PyErr_Format(PyExc_ValueError,
+                "Missing elements cannot be stored in variable length "
+                "column '%s'", PyBytes_AsString(self->name));
+        goto out;
+    }
+    self->num_buffered_elements = n;
+    ret = 0;
+out:
+    return ret;
+}
+
 /*
  * Converts the native values in the element buffer to the appropriate
  * Python types, and returns the result.
@@ -1681,8 +3197,14 @@ static int
 Column_get_fixed_region_size(Column *self)
 {
     int ret = self->element_size * self->num_elements;
-    if (Column_is_variable(self)) {
-        ret = 2; // TODO generalise for large address size.
+    if (self->sparse) {
+        /* sparse columns use the table's sparse header */
+        ret = 0;
+    } else if (self->element_type == WT_GENOTYPE) {
+        ret = (int) genotype_vector_size((uint32_t) self->num_elements,
+                (uint32_t) self->element_size);
+    } else if (Column_is_variable(self)) {
+        ret = self->address_size;
         ret += self->num_elements == WT_VAR_1 ? 1 : 2;
     }
     return ret;
@@ -1720,6 +3242,62 @@ Column_set_row_id(Column *self, uint64_t key)
     return ret;
 }
 
+/*
+ * Packs the missing value for this column into the specified buffer,
+ * which must have room for the column's fixed region.
+ */
+static int
+Column_pack_missing(Column *self, void *dest)
+{
+    int ret = -1;
+    if (self->python_to_native(self, Py_None) < 0) {
+        goto out;
+    }
+    if (self->pack_elements(self, dest) < 0) {
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Sets this column to store values in native rows. Char and genotype
+ * values are stored in the same way in both row formats.
+ */
+static int
+Column_set_native(Column *self)
+{
+    int ret = -1;
+    if (self->element_type == WT_UINT || self->element_type == WT_DICT) {
+        self->pack_elements = Column_pack_native_elements_int;
+        self->unpack_elements = Column_unpack_native_elements_uint;
+    } else if (self->element_type == WT_INT) {
+        self->pack_elements = Column_pack_native_elements_int;
+        self->unpack_elements = Column_unpack_native_elements_int;
+    } else if (self->element_type == WT_FLOAT) {
+        if (self->element_size == 2) {
+            self->pack_elements = Column_pack_native_elements_float_2;
+            self->unpack_elements = Column_unpack_native_elements_float_2;
+        } else if (self->element_size == 4) {
+            self->pack_elements = Column_pack_native_elements_float_4;
+            self->unpack_elements = Column_unpack_native_elements_float_4;
+        } else {
+            self->pack_elements = Column_pack_native_elements_float_8;
+            self->unpack_elements = Column_unpack_native_elements_float_8;
+        }
+    }
+    self->native = 1;
+    if (self->sparse_missing != NULL) {
+        if (Column_pack_missing(self, self->sparse_missing) < 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
 static void
 Column_dealloc(Column* self)
 {
@@ -1729,6 +3307,11 @@ Column_dealloc(Column* self)
     Py_XDECREF(self->max_element);
     PyMem_Free(self->element_buffer);
     PyMem_Free(self->input_elements);
+    PyMem_Free(self->sparse_missing);
+    if (self->dictionary != NULL) {
+        dictionary_free(self->dictionary);
+        PyMem_Free(self->dictionary);
+    }
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -1738,21 +3321,36 @@ Column_init(Column *self, PyObject *args, PyObject *kwds)
 {
     int ret = -1;
     static char *kwlist[] = {"name", "description",  "element_type",
-        "element_size", "num_elements", NULL};
+        "element_size", "num_elements", "sparse", "family", NULL};
     Py_ssize_t max_num_elements;
     Py_ssize_t native_element_size;
     PyObject *name = NULL;
     PyObject *description = NULL;
+    int sparse = 0;
     self->position = -1;
+    self->sparse = 0;
+    self->sparse_bit = 0;
+    self->sparse_missing = NULL;
+    self->native = 0;
+    self->family = 0;
+    self->row_offset = 0;
+    self->row_buffer_size = MAX_ROW_SIZE;
+    self->address_size = WT_DEFAULT_ADDRESS_SIZE;
+    self->max_row_size = MAX_ROW_SIZE;
     self->min_element = NULL;
     self->max_element = NULL;
     self->element_buffer = NULL;
     self->input_elements = NULL;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!iii", kwlist,
+    self->dictionary = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!iii|ii", kwlist,
             &PyBytes_Type, &name,
             &PyBytes_Type, &description,
             &self->element_type, &self->element_size,
-            &self->num_elements)) {
+            &self->num_elements, &sparse, &self->family)) {
+        goto out;
+    }
+    if (self->family < 0 || self->family >= WT_MAX_FAMILIES) {
+        PyErr_SetString(PyExc_ValueError, "bad column family");
         goto out;
     }
     self->name = name;
@@ -1842,10 +3440,71 @@ Column_init(Column *self, PyObject *args, PyObject *kwds)
         self->max_element = Py_None;
         Py_INCREF(self->min_element);
         Py_INCREF(self->max_element);
+    } else if (self->element_type == WT_DICT) {
+        /* Each row stores the code for its value in the dictionary */
+        if (self->element_size != 1 && self->element_size != 2) {
+            PyErr_SetString(PyExc_ValueError, "bad element size");
+            goto out;
+        }
+        if (self->num_elements != 1) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Dictionary columns must have one element");
+            goto out;
+        }
+        self->python_to_native = Column_python_to_native_dict;
+        self->string_to_native = Column_string_to_native_dict;
+        self->verify_elements = Column_verify_elements_uint;
+        self->truncate_elements = Column_truncate_elements_char;
+        self->pack_elements = Column_pack_elements_uint;
+        self->unpack_elements = Column_unpack_elements_uint;
+        self->native_to_python = Column_native_to_python_dict;
+        native_element_size = sizeof(uint64_t);
+        self->min_element = Py_None;
+        self->max_element = Py_None;
+        Py_INCREF(self->min_element);
+        Py_INCREF(self->max_element);
+        self->dictionary = PyMem_Malloc(sizeof(dictionary_t));
+        if (self->dictionary == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (dictionary_init(self->dictionary,
+                    (uint32_t) max_uint(self->element_size) + 1) != 0) {
+            PyMem_Free(self->dictionary);
+            self->dictionary = NULL;
+            goto out;
+        }
+    } else if (self->element_type == WT_GENOTYPE) {
+        /* The element size is the number of bits used for each allele */
+        if (self->element_size != 2 && self->element_size != 4
+                && self->element_size != 8) {
+            PyErr_SetString(PyExc_ValueError, "bad element size");
+            goto out;
+        }
+        if (self->num_elements < 1) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Genotype columns must have a fixed number of elements");
+            goto out;
+        }
+        self->python_to_native = Column_python_to_native_genotype;
+        self->string_to_native = Column_string_to_native_genotype;
+        self->verify_elements = Column_verify_elements_genotype;
+        self->truncate_elements = Column_truncate_elements_char;
+        self->pack_elements = Column_pack_elements_genotype;
+        self->unpack_elements = Column_unpack_elements_genotype;
+        self->native_to_python = Column_native_to_python_genotype;
+        /* large enough for the packed vector with 8 bit alleles */
+        native_element_size = 3;
+        self->min_element = Py_None;
+        self->max_element = Py_None;
+        Py_INCREF(self->min_element);
+        Py_INCREF(self->max_element);
     } else {
         PyErr_SetString(PyExc_ValueError, "Unknown element type");
         goto out;
     }
+    self->pack_key_elements = self->pack_elements;
+    self->unpack_key_elements = self->unpack_elements;
     max_num_elements = self->num_elements;
     if (Column_is_variable(self)) {
         max_num_elements = Column_get_max_num_elements(self);
@@ -1868,6 +3527,17 @@ Column_init(Column *self, PyObject *args, PyObject *kwds)
         PyErr_NoMemory();
         goto out;
     }
+    if (sparse && !Column_is_variable(self)) {
+        /* absent values are read as the packed missing value */
+        self->sparse_missing = PyMem_Malloc(
+                Column_get_fixed_region_size(self));
+        if (self->sparse_missing == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        memset(self->sparse_missing, 0, Column_get_fixed_region_size(self));
+    }
+    self->sparse = sparse != 0;
     ret = 0;
 out:
     return ret;
@@ -1882,6 +3552,9 @@ static PyMemberDef Column_members[] = {
     {"num_elements", T_INT, offsetof(Column, num_elements), READONLY, "num_elements"},
     {"fixed_region_offset", T_INT, offsetof(Column, fixed_region_offset),
         READONLY, "fixed_region_offset"},
+    {"sparse", T_INT, offsetof(Column, sparse), READONLY, "sparse"},
+    {"native", T_INT, offsetof(Column, native), READONLY, "native"},
+    {"family", T_INT, offsetof(Column, family), READONLY, "family"},
     {"min_element", T_OBJECT_EX, offsetof(Column, min_element), READONLY, "minimum element"},
     {"max_element", T_OBJECT_EX, offsetof(Column, max_element), READONLY, "maximum element"},
     {NULL}  /* Sentinel */
@@ -1906,26 +3579,110 @@ Column_get_max_num_elements_py(Column *self)
     return PyLong_FromLong((long) Column_get_max_num_elements(self));
 }
 
-static PyMethodDef Column_methods[] = {
-    {"is_variable", (PyCFunction) Column_is_variable_py, METH_NOARGS,
-        Column_is_variable__doc__},
-    {"get_max_num_elements", (PyCFunction) Column_get_max_num_elements_py,
-        METH_NOARGS, Column_get_max_num_elements__doc__},
-    {NULL}  /* Sentinel */
-};
+PyDoc_STRVAR(Column_get_dictionary__doc__,
+"get_dictionary() -> list\n\n"
+"Return the list of values in the dictionary of this Column, indexed "
+"by their codes.");
 
-static PyTypeObject ColumnType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.Column",             /* tp_name */
-    sizeof(Column),             /* tp_basicsize */
-    0,                         /* tp_itemsize */
-    (destructor)Column_dealloc, /* tp_dealloc */
-    0,                         /* tp_print */
-    0,                         /* tp_getattr */
-    0,                         /* tp_setattr */
-    0,                         /* tp_reserved */
-    0,                         /* tp_repr */
-    0,                         /* tp_as_number */
+static PyObject *
+Column_get_dictionary(Column *self)
+{
+    PyObject *ret = NULL;
+    PyObject *values;
+    if (self->dictionary == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Not a dictionary column");
+        goto out;
+    }
+    values = self->dictionary->values;
+    ret = PyList_GetSlice(values, 0, PyList_GET_SIZE(values));
+out:
+    return ret;
+}
+
+PyDoc_STRVAR(Column_set_dictionary__doc__,
+"set_dictionary(values)\n\n"
+"Replace the dictionary of this Column with the specified list of "
+"distinct bytes values, which are assigned codes in order.");
+
+static PyObject *
+Column_set_dictionary(Column *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *values = NULL;
+    PyObject *v;
+    Py_ssize_t j;
+    uint32_t code;
+    int wt_ret;
+    dictionary_t dictionary;
+
+    memset(&dictionary, 0, sizeof(dictionary));
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &values)) {
+        goto out;
+    }
+    if (self->dictionary == NULL) {
+        PyErr_SetString(PyExc_ValueError, "Not a dictionary column");
+        goto out;
+    }
+    if (dictionary_init(&dictionary, self->dictionary->max_size) != 0) {
+        goto out;
+    }
+    for (j = 0; j < PyList_GET_SIZE(values); j++) {
+        v = PyList_GET_ITEM(values, j);
+        if (!PyBytes_Check(v)) {
+            PyErr_SetString(PyExc_TypeError, "Dictionary values must be bytes");
+            goto out;
+        }
+        wt_ret = dictionary_get_code(&dictionary, PyBytes_AS_STRING(v),
+                PyBytes_GET_SIZE(v), 1, &code);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (wt_ret == 1) {
+            PyErr_Format(PyExc_ValueError,
+                    "Too many distinct values for column '%s'",
+                    PyBytes_AsString(self->name));
+            goto out;
+        }
+        if (code != (uint32_t) j) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Duplicate values in dictionary");
+            goto out;
+        }
+    }
+    dictionary_free(self->dictionary);
+    *self->dictionary = dictionary;
+    memset(&dictionary, 0, sizeof(dictionary));
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    dictionary_free(&dictionary);
+    return ret;
+}
+
+static PyMethodDef Column_methods[] = {
+    {"is_variable", (PyCFunction) Column_is_variable_py, METH_NOARGS,
+        Column_is_variable__doc__},
+    {"get_max_num_elements", (PyCFunction) Column_get_max_num_elements_py,
+        METH_NOARGS, Column_get_max_num_elements__doc__},
+    {"get_dictionary", (PyCFunction) Column_get_dictionary, METH_NOARGS,
+        Column_get_dictionary__doc__},
+    {"set_dictionary", (PyCFunction) Column_set_dictionary, METH_VARARGS,
+        Column_set_dictionary__doc__},
+    {NULL}  /* Sentinel */
+};
+
+static PyTypeObject ColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_wormtable.Column",             /* tp_name */
+    sizeof(Column),             /* tp_basicsize */
+    0,                         /* tp_itemsize */
+    (destructor)Column_dealloc, /* tp_dealloc */
+    0,                         /* tp_print */
+    0,                         /* tp_getattr */
+    0,                         /* tp_setattr */
+    0,                         /* tp_reserved */
+    0,                         /* tp_repr */
+    0,                         /* tp_as_number */
     0,                         /* tp_as_sequence */
     0,                         /* tp_as_mapping */
     0,                         /* tp_hash  */
@@ -1961,205 +3718,269 @@ static PyTypeObject ColumnType = {
  */
 
 static void
-Table_dealloc(Table* self)
+vcf_field_free(vcf_field_t *fields, uint32_t num_fields)
 {
     uint32_t j;
-    Py_XDECREF(self->db_filename);
-    Py_XDECREF(self->data_filename);
-    /* make sure that the DB handles are closed. We can ignore errors here. */
-    if (self->db != NULL) {
-        self->db->close(self->db, 0);
-    }
-    if (self->data_file != NULL) {
-        fclose(self->data_file);
-    }
-    if (self->row_buffer != NULL) {
-        PyMem_Free(self->row_buffer);
-    }
-    if (self->columns != NULL) {
-        /* columns must be decref'd but may be null */
-        for (j = 0; j < self->num_columns; j++) {
-            Py_XDECREF(self->columns[j]);
+    if (fields != NULL) {
+        for (j = 0; j < num_fields; j++) {
+            PyMem_Free(fields[j].name);
+            PyMem_Free(fields[j].columns);
         }
-        PyMem_Free(self->columns);
+        PyMem_Free(fields);
+    }
+}
+
+static void
+vcf_plan_free(vcf_plan_t *plan)
+{
+    int j;
+    if (plan != NULL) {
+        vcf_field_free(plan->info_fields, plan->num_info_fields);
+        vcf_field_free(plan->format_fields, plan->num_format_fields);
+        PyMem_Free(plan->line_buffer);
+        PyMem_Free(plan->values);
+        PyMem_Free(plan->genotype_calls);
+        for (j = 0; j < WT_VCF_FORMAT_CACHE_SIZE; j++) {
+            PyMem_Free(plan->format_cache[j].format);
+            PyMem_Free(plan->format_cache[j].columns);
+        }
+        PyMem_Free(plan);
     }
-    Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+/*==========================================================
+ * Table writer
+ *==========================================================
+ */
+
 /*
- * Checks the columns to ensure sanity.
+ * Inserts the primary records in the bulk buffer into the DB. Returns 0
+ * on success, or WT_WRITE_DB_ERROR with the DB error code stored in err.
  */
 static int
-Table_verify_columns(Table *self)
+Table_flush_records(Table *self, int *err)
 {
-    int ret = -1;
-    Column *col;
-    uint32_t j, k;
-    char *cj, *ck;
-    if (self->num_columns < 2) {
-        PyErr_SetString(PyExc_ValueError, "Two or more columns required");
-        goto out;
-    }
-    for (j = 0; j < self->num_columns; j++) {
-        if (!PyObject_TypeCheck(self->columns[j], &ColumnType)) {
-            PyErr_SetString(PyExc_TypeError, "Must be Column objects");
-            goto out;
+    int ret = 0;
+#ifdef WT_HAVE_BULK_PUT
+    int db_ret;
+    DBT key, data;
+    if (self->num_bulk_records > 0) {
+        memset(&key, 0, sizeof(DBT));
+        memset(&data, 0, sizeof(DBT));
+        key.data = self->bulk_buffer;
+        key.ulen = WT_PRIMARY_BULK_SIZE;
+        /* DB_MULTIPLE_KEY puts fail unless the key is marked as bulk */
+        key.flags = DB_DBT_USERMEM | DB_DBT_BULK;
+        db_ret = self->db->put(self->db, NULL, &key, &data, DB_MULTIPLE_KEY);
+        if (db_ret != 0) {
+            *err = db_ret;
+            ret = WT_WRITE_DB_ERROR;
         }
+        DB_MULTIPLE_WRITE_INIT(self->bulk_pointer, &key);
+        self->num_bulk_records = 0;
     }
-    /* check the row_id column */
-    col = self->columns[0];
-    if (col->element_type != WT_UINT || col->num_elements != 1) {
-        PyErr_SetString(PyExc_ValueError,
-                "row_id column must be 1 element uint");
-        goto out;
-    }
-    /* check for duplicate columns */
-    /* TODO this is very slow for large numbers of columns - we should use a
-     * python dictionary to check instead
-     */
-    for (j = 0; j < self->num_columns; j++) {
-        cj = PyBytes_AsString(self->columns[j]->name);
-        for (k = j + 1; k < self->num_columns; k++) {
-            ck = PyBytes_AsString(self->columns[k]->name);
-            if (self->columns[j] == self->columns[k]) {
-                PyErr_SetString(PyExc_ValueError,
-                        "Duplicate columns not permitted");
-                goto out;
-            }
-            /* check for duplicate names */
-            if (strcmp(cj, ck) == 0) {
-                PyErr_SetString(PyExc_ValueError,
-                        "Duplicate column names not permitted");
+#endif
+    return ret;
+}
+
+/*
+ * Stores the specified offset|length record in the primary DB under the
+ * specified key. Row ids are strictly increasing, so where bulk puts are
+ * supported records are gathered in the bulk buffer and inserted together,
+ * which avoids much of the per-call overhead of the DB. Returns 0 on
+ * success, or WT_WRITE_DB_ERROR with the DB error code stored in err.
+ */
+static int
+Table_put_record(Table *self, void *key_buffer, uint32_t key_size,
+        void *record, int *err)
+{
+    int ret = WT_WRITE_DB_ERROR;
+    int db_ret;
+    DBT key, data;
+#ifdef WT_HAVE_BULK_PUT
+    if (self->bulk_buffer != NULL) {
+        memset(&key, 0, sizeof(DBT));
+        key.data = self->bulk_buffer;
+        key.ulen = WT_PRIMARY_BULK_SIZE;
+        key.flags = DB_DBT_USERMEM | DB_DBT_BULK;
+        DB_MULTIPLE_KEY_WRITE_NEXT(self->bulk_pointer, &key, key_buffer,
+                key_size, record, self->record_size);
+        if (self->bulk_pointer == NULL) {
+            /* the buffer is full, so flush it and start again */
+            ret = Table_flush_records(self, err);
+            if (ret != 0) {
                 goto out;
             }
+            DB_MULTIPLE_KEY_WRITE_NEXT(self->bulk_pointer, &key, key_buffer,
+                    key_size, record, self->record_size);
         }
+        self->num_bulk_records++;
+        ret = 0;
+        goto out;
+    }
+#endif
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    key.data = key_buffer;
+    key.size = key_size;
+    data.data = record;
+    data.size = self->record_size;
+    db_ret = self->db->put(self->db, NULL, &key, &data, 0);
+    if (db_ret != 0) {
+        *err = db_ret;
+        goto out;
     }
     ret = 0;
 out:
     return ret;
 }
 
+/*
+ * Writes the row data for each column family to the end of the family's
+ * data file and stores the offsets and lengths in the primary DB under
+ * the specified key, unless the table has dense rows, in which case the
+ * offsets follow from the row id and are not stored. This does not use
+ * the Python API, so that it can be called without the GIL. Returns 0 on
+ * success, or WT_WRITE_IO_ERROR or WT_WRITE_DB_ERROR with the errno or
+ * DB error code stored in err.
+ */
 static int
-Table_init(Table *self, PyObject *args, PyObject *kwds)
+Table_write_record(Table *self, void *key_buffer, uint32_t key_size,
+        void **rows, uint32_t *lens, int *err)
 {
-    int ret = -1;
-    static char *kwlist[] = {"db_filename", "data_filename", "columns",
-            "cache_size", NULL};
-    Column *col;
-    PyObject *db_filename = NULL;
-    PyObject *data_filename = NULL;
-    PyObject *columns = NULL;
-    uint32_t j;
-    self->db = NULL;
-    self->row_buffer = NULL;
-    self->columns = NULL;
-    self->db_filename = NULL;
-    self->cache_size = 0;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!O!K", kwlist,
-            &PyBytes_Type, &db_filename,
-            &PyBytes_Type, &data_filename,
-            &PyList_Type,  &columns,
-            &self->cache_size)) {
-        goto out;
-    }
-    self->db_filename = db_filename;
-    Py_INCREF(self->db_filename);
-    self->data_filename = data_filename;
-    Py_INCREF(self->data_filename);
-    self->num_columns = PyList_GET_SIZE(columns);
-    self->columns = PyMem_Malloc(self->num_columns * sizeof(Column *));
-    if (self->columns == NULL) {
-        PyErr_NoMemory();
-        goto out;
-    }
-    for (j = 0; j < self->num_columns; j++) {
-        col = (Column *) PyList_GET_ITEM(columns, j);
-        Py_INCREF(col);
-        self->columns[j] = col;
-    }
-    if (Table_verify_columns(self) != 0) {
-        goto out;
-    }
-    self->row_buffer = PyMem_Malloc(MAX_ROW_SIZE);
-    if (self->row_buffer == NULL) {
-        PyErr_NoMemory();
-        goto out;
-    }
-    self->row_buffer_size = MAX_ROW_SIZE;
-    memset(self->row_buffer, 0, self->row_buffer_size);
-    self->fixed_region_size = 0;
-    for (j = 0; j < self->num_columns; j++) {
-        col = self->columns[j];
-        col->position = j;
-        col->fixed_region_offset = self->fixed_region_size;
-        self->fixed_region_size += Column_get_fixed_region_size(col);
-        if (self->fixed_region_size > MAX_ROW_SIZE) {
-            PyErr_SetString(WormtableError, "Columns exceed max row size");
-            goto out;
+    int ret = WT_WRITE_IO_ERROR;
+    size_t io_ret;
+    char *v;
+    uint32_t f;
+    uint64_t offset;
+    uint8_t len_size = (uint8_t) (self->record_size / self->num_families
+            - sizeof(offset));
+    char record[WT_MAX_FAMILIES * WT_WIDE_OFFSET_LEN_RECORD_SIZE];
+    v = record;
+    for (f = 0; f < self->num_families; f++) {
+        /* write the data row */
+        offset = (uint64_t) ftello(self->families[f].data_file);
+        if (lens[f] > 0) {
+            io_ret = fwrite(rows[f], lens[f], 1, self->families[f].data_file);
+            if (io_ret != 1) {
+                *err = errno;
+                goto out;
+            }
         }
+        /* pack offset|length into record */
+        pack_uint(offset, v, sizeof(offset));
+        v += sizeof(offset);
+        pack_uint(lens[f], v, len_size);
+        v += len_size;
     }
-    self->current_row_size = self->fixed_region_size;
-    self->num_rows = 0;
-    self->max_row_size = 0;
-    self->min_row_size = MAX_ROW_SIZE;
-    self->total_row_size = 0;
+    /* Now store the offset+length in the DB */
     ret = 0;
+    if (!self->dense_rows) {
+        ret = Table_put_record(self, key_buffer, key_size, record, err);
+    }
 out:
     return ret;
 }
 
-static PyMemberDef Table_members[] = {
-    {"db_filename", T_OBJECT_EX, offsetof(Table, db_filename), READONLY, "db_filename"},
-    {"data_filename", T_OBJECT_EX, offsetof(Table, data_filename), READONLY, "data_filename"},
-    {"cache_size", T_ULONGLONG, offsetof(Table, cache_size), READONLY, "cache_size"},
-    {"num_rows", T_ULONGLONG, offsetof(Table, num_rows), READONLY, "num_rows"},
-    {"total_row_size", T_ULONGLONG, offsetof(Table, total_row_size), READONLY, "total_row_size"},
-    {"min_row_size", T_UINT, offsetof(Table, min_row_size), READONLY, "min_row_size"},
-    {"max_row_size", T_UINT, offsetof(Table, max_row_size), READONLY, "max_row_size"},
-    {"fixed_region_size", T_UINT, offsetof(Table, fixed_region_size), READONLY,
-            "fixed_region_size"},
-    {NULL}  /* Sentinel */
-};
+/*
+ * Sets the Python exception corresponding to the specified error returned
+ * by Table_write_record.
+ */
+static void
+handle_write_error(int error_kind, int err)
+{
+    if (error_kind == WT_WRITE_DB_ERROR) {
+        handle_bdb_error(err);
+    } else {
+        errno = err;
+        handle_io_error();
+    }
+}
 
+#ifdef WT_HAVE_WRITER_THREAD
 
 /*
- * Returns 0 if the column is value. Otherwise
- * -1 is returned with the appropriate Python exception set.
+ * Writes all of the rows in the specified block. Returns 0 or an error
+ * as in Table_write_record.
  */
 static int
-Table_check_column_index(Table *self, int col_index)
+Table_write_block(Table *self, write_block_t *block, int *err)
 {
-    int ret = -1;
-    if (col_index < 0 || col_index >= self->num_columns) {
-        PyErr_Format(WormtableError, "Column index out of range.");
-        goto out;
+    int ret = 0;
+    size_t offset = 0;
+    uint32_t f;
+    uint32_t lens[WT_MAX_FAMILIES];
+    void *rows[WT_MAX_FAMILIES];
+    uint32_t key_size = self->writer->key_size;
+    char *v;
+    while (ret == 0 && offset < block->size) {
+        v = block->data + offset;
+        memcpy(lens, v + key_size, self->num_families * sizeof(uint32_t));
+        offset += key_size + self->num_families * sizeof(uint32_t);
+        for (f = 0; f < self->num_families; f++) {
+            rows[f] = block->data + offset;
+            offset += lens[f];
+        }
+        ret = Table_write_record(self, v, key_size, rows, lens, err);
     }
-    ret = 0;
-out:
     return ret;
 }
 
 /*
- * Returns 0 if the table is opened in write mode. Otherwise
- * -1 is returned with the appropriate Python exception set.
+ * The main loop of the writer thread, which writes queued blocks in order
+ * until shutdown is requested and the queue is empty. After an error,
+ * blocks are discarded so that the committing thread does not block.
  */
-static int
-Table_check_write_mode(Table *self)
+static void *
+Table_writer_run(void *arg)
 {
-    int ret = -1;
-    int db_ret;
-    uint32_t flags;
-    if (self->db == NULL) {
-        PyErr_Format(WormtableError, "Table closed.");
-        goto out;
-    }
-    db_ret = self->db->get_open_flags(self->db, &flags);
-    if (db_ret != 0) {
-        handle_bdb_error(flags);
-        goto out;
+    Table *self = (Table *) arg;
+    table_writer_t *w = self->writer;
+    write_block_t *block;
+    int error_kind = 0;
+    int err = 0;
+    pthread_mutex_lock(&w->mutex);
+    while (1) {
+        while (w->count == 0 && !w->shutdown) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        if (w->count == 0) {
+            break;
+        }
+        block = &w->blocks[w->head];
+        pthread_mutex_unlock(&w->mutex);
+        if (error_kind == 0) {
+            error_kind = Table_write_block(self, block, &err);
+        }
+        pthread_mutex_lock(&w->mutex);
+        if (error_kind != 0 && w->error_kind == 0) {
+            w->error_kind = error_kind;
+            w->error = err;
+        }
+        w->head = (w->head + 1) % WT_WRITE_QUEUE_BLOCKS;
+        w->count--;
+        pthread_cond_broadcast(&w->cond);
     }
-    if ((flags & DB_RDONLY) != 0) {
-        PyErr_Format(WormtableError, "Table must be opened WT_WRITE.");
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+/*
+ * Returns -1 with the appropriate Python exception set if the writer
+ * thread has encountered an error, and 0 otherwise.
+ */
+static int
+Table_check_writer(Table *self)
+{
+    int ret = -1;
+    int error_kind, err;
+    table_writer_t *w = self->writer;
+    pthread_mutex_lock(&w->mutex);
+    error_kind = w->error_kind;
+    err = w->error;
+    pthread_mutex_unlock(&w->mutex);
+    if (error_kind != 0) {
+        handle_write_error(error_kind, err);
         goto out;
     }
     ret = 0;
@@ -2167,662 +3988,1216 @@ out:
     return ret;
 }
 
+/*
+ * Passes the block being filled to the writer thread, waiting for space
+ * in the queue to become available.
+ */
+static void
+Table_submit_block(Table *self)
+{
+    table_writer_t *w = self->writer;
+    if (w->blocks[w->fill].size > 0) {
+        Py_BEGIN_ALLOW_THREADS
+        pthread_mutex_lock(&w->mutex);
+        w->count++;
+        pthread_cond_broadcast(&w->cond);
+        while (w->count == WT_WRITE_QUEUE_BLOCKS) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        w->fill = (w->head + w->count) % WT_WRITE_QUEUE_BLOCKS;
+        pthread_mutex_unlock(&w->mutex);
+        Py_END_ALLOW_THREADS
+        w->blocks[w->fill].size = 0;
+    }
+}
 
 /*
- * Returns 0 if the table is opened in read mode. Otherwise
- * -1 is returned with the appropriate Python exception set.
+ * Copies the specified family rows and key into the queue for the writer
+ * thread. Returns 0 on success or -1 with the appropriate Python exception
+ * set if the writer has encountered an error.
  */
 static int
-Table_check_read_mode(Table *self)
+Table_queue_record(Table *self, void *key_buffer, void **rows,
+        uint32_t *lens)
 {
     int ret = -1;
-    int db_ret;
-    uint32_t flags;
-    if (self == NULL) {
-        PyErr_Format(PyExc_SystemError, "Null table.");
+    table_writer_t *w = self->writer;
+    write_block_t *block = &w->blocks[w->fill];
+    size_t lens_size = self->num_families * sizeof(uint32_t);
+    size_t size = w->key_size + lens_size;
+    uint32_t f;
+    char *v;
+    if (Table_check_writer(self) != 0) {
         goto out;
     }
-    if (self->db == NULL) {
-        PyErr_Format(WormtableError, "Table closed.");
-        goto out;
+    for (f = 0; f < self->num_families; f++) {
+        size += lens[f];
     }
-    db_ret = self->db->get_open_flags(self->db, &flags);
-    if (db_ret != 0) {
-        handle_bdb_error(flags);
-        goto out;
+    if (block->size + size > block->capacity) {
+        Table_submit_block(self);
+        block = &w->blocks[w->fill];
     }
-    if ((flags & DB_RDONLY) == 0) {
-        PyErr_Format(WormtableError, "Table must be opened WT_READ.");
-        goto out;
+    if (size > block->capacity) {
+        /* rows in tables with wide addresses may not fit in a block */
+        v = PyMem_Realloc(block->data, size);
+        if (v == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        block->data = v;
+        block->capacity = size;
+    }
+    v = block->data + block->size;
+    memcpy(v, key_buffer, w->key_size);
+    v += w->key_size;
+    memcpy(v, lens, lens_size);
+    v += lens_size;
+    for (f = 0; f < self->num_families; f++) {
+        memcpy(v, rows[f], lens[f]);
+        v += lens[f];
     }
+    block->size += size;
     ret = 0;
 out:
     return ret;
 }
 
-static PyObject *
-Table_open(Table* self, PyObject *args)
+#endif
+
+static void
+table_writer_free(table_writer_t *w)
 {
-    PyObject *ret = NULL;
-    char *db_name = NULL;
-    char *data_name = NULL;
-    char *data_mode = NULL;
-    uint32_t flags = 0;
-    Py_ssize_t gigabyte = 1024 * 1024 * 1024;
-    uint32_t gigs, bytes;
-    int db_ret, mode;
-    if (!PyArg_ParseTuple(args, "i", &mode)) {
-        goto out;
+    int j;
+    if (w != NULL) {
+        for (j = 0; j < WT_WRITE_QUEUE_BLOCKS; j++) {
+            PyMem_Free(w->blocks[j].data);
+        }
+        PyMem_Free(w);
     }
-    if (mode == WT_WRITE) {
-        flags = DB_CREATE|DB_TRUNCATE;
-        data_mode = "wb";
-    } else if (mode == WT_READ) {
-        flags = DB_RDONLY|DB_NOMMAP;
-        data_mode = "rb";
-    } else {
-        PyErr_Format(PyExc_ValueError, "mode must be WT_READ or WT_WRITE.");
-        goto out;
+}
+
+/*
+ * Writes any queued rows and stops the writer thread, if it is running.
+ * Returns -1 with the appropriate Python exception set if the writer
+ * encountered an error, and 0 otherwise.
+ */
+static int
+Table_stop_writer(Table *self)
+{
+    int ret = 0;
+    table_writer_t *w = self->writer;
+    if (w != NULL) {
+#ifdef WT_HAVE_WRITER_THREAD
+        Table_submit_block(self);
+        Py_BEGIN_ALLOW_THREADS
+        pthread_mutex_lock(&w->mutex);
+        w->shutdown = 1;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+        pthread_join(w->thread, NULL);
+        Py_END_ALLOW_THREADS
+        if (w->error_kind != 0) {
+            handle_write_error(w->error_kind, w->error);
+            ret = -1;
+        }
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->mutex);
+#endif
+        table_writer_free(w);
+        self->writer = NULL;
     }
-    if (self->db != NULL) {
-        PyErr_Format(WormtableError, "Table already open.");
-        goto out;
+    return ret;
+}
+
+
+/*
+ * Returns the hash of the k-mer at the specified position in the samples
+ * used to train a compression dictionary.
+ */
+static uint32_t
+dictionary_kmer_hash(unsigned char *v)
+{
+    uint64_t x;
+    memcpy(&x, v, WT_DICTIONARY_KMER_SIZE);
+    return (uint32_t) ((x * 0x9E3779B97F4A7C15ULL)
+            >> (64 - WT_DICTIONARY_HASH_BITS));
+}
+
+/*
+ * Returns the score of the segment of the samples starting at the
+ * specified position, which is the total count of the k-mers in it that
+ * occur more than once.
+ */
+static uint64_t
+dictionary_segment_score(unsigned char *samples, size_t start,
+        uint32_t *counts)
+{
+    uint64_t score = 0;
+    uint32_t count;
+    size_t j;
+    for (j = start; j + WT_DICTIONARY_KMER_SIZE
+            <= start + WT_DICTIONARY_SEGMENT_SIZE; j++) {
+        count = counts[dictionary_kmer_hash(samples + j)];
+        if (count > 1) {
+            score += count;
+        }
     }
-    db_name = PyBytes_AsString(self->db_filename);
-    data_name = PyBytes_AsString(self->data_filename);
-    if (db_name == NULL || data_name == NULL) {
-        goto out;
+    return score;
+}
+
+static int
+cmp_dictionary_segment(const void *a, const void *b)
+{
+    const dictionary_segment_t *ia = (const dictionary_segment_t *) a;
+    const dictionary_segment_t *ib = (const dictionary_segment_t *) b;
+    int ret = (ia->score < ib->score) - (ia->score > ib->score);
+    if (ret == 0) {
+        ret = (ia->start > ib->start) - (ia->start < ib->start);
     }
-    /* Now we create the DB handle */
-    db_ret = db_create(&self->db, NULL, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    return ret;
+}
+
+/*
+ * Trains a preset dictionary of up to WT_DICTIONARY_SIZE bytes for the
+ * specified samples, which are rows concatenated together, and sets size
+ * to its length. The segments of the samples are scored by how often
+ * their k-mers occur, and the best segments are chosen greedily, skipping
+ * those that mostly repeat the k-mers of segments already chosen. Deflate
+ * codes nearer matches more cheaply, so the best segments are placed at
+ * the end of the dictionary.
+ */
+static int
+train_dictionary(unsigned char *samples, size_t num_bytes,
+        unsigned char *dictionary, uint32_t *size)
+{
+    int ret = -1;
+    uint32_t *counts = NULL;
+    dictionary_segment_t *segments = NULL;
+    size_t j, k, start, num_segments;
+    uint32_t *count;
+    uint32_t position = WT_DICTIONARY_SIZE;
+
+    *size = 0;
+    if (num_bytes < WT_DICTIONARY_SEGMENT_SIZE) {
+        ret = 0;
         goto out;
     }
-    gigs = (uint32_t) (self->cache_size / gigabyte);
-    bytes = (uint32_t) (self->cache_size % gigabyte);
-    db_ret = self->db->set_cachesize(self->db, gigs, bytes, 1);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    num_segments = (num_bytes - WT_DICTIONARY_SEGMENT_SIZE)
+        / WT_DICTIONARY_SEGMENT_STEP + 1;
+    counts = PyMem_Malloc(sizeof(uint32_t) << WT_DICTIONARY_HASH_BITS);
+    segments = PyMem_Malloc(num_segments * sizeof(dictionary_segment_t));
+    if (counts == NULL || segments == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    /* Disable DB error messages */
-    self->db->set_errcall(self->db, NULL);
-    db_ret = self->db->open(self->db, NULL, db_name, NULL, DB_BTREE, flags,
-            WT_DB_FILE_PERMS);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        self->db->close(self->db, 0);
-        self->db = NULL;
-        goto out;
+    memset(counts, 0, sizeof(uint32_t) << WT_DICTIONARY_HASH_BITS);
+    for (j = 0; j + WT_DICTIONARY_KMER_SIZE <= num_bytes; j++) {
+        count = &counts[dictionary_kmer_hash(samples + j)];
+        if (*count < UINT32_MAX) {
+            (*count)++;
+        }
     }
-    /* Now open the data file */
-    self->data_file = fopen(data_name, data_mode);
-    if (self->data_file == NULL) {
-        handle_io_error();
-        goto out;
+    for (j = 0; j < num_segments; j++) {
+        segments[j].start = j * WT_DICTIONARY_SEGMENT_STEP;
+        segments[j].score = dictionary_segment_score(samples,
+                segments[j].start, counts);
     }
-    if (setvbuf(self->data_file, NULL, _IOFBF, 1024 * 1024) != 0) {
-        handle_io_error();
-        goto out;
+    qsort(segments, num_segments, sizeof(dictionary_segment_t),
+            cmp_dictionary_segment);
+    for (j = 0; j < num_segments && segments[j].score > 0
+            && position >= WT_DICTIONARY_SEGMENT_SIZE; j++) {
+        start = segments[j].start;
+        if (2 * dictionary_segment_score(samples, start, counts)
+                < segments[j].score) {
+            continue;
+        }
+        position -= WT_DICTIONARY_SEGMENT_SIZE;
+        memcpy(dictionary + position, samples + start,
+                WT_DICTIONARY_SEGMENT_SIZE);
+        for (k = start; k + WT_DICTIONARY_KMER_SIZE
+                <= start + WT_DICTIONARY_SEGMENT_SIZE; k++) {
+            counts[dictionary_kmer_hash(samples + k)] = 0;
+        }
     }
-
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    *size = WT_DICTIONARY_SIZE - position;
+    memmove(dictionary, dictionary + position, *size);
+    ret = 0;
 out:
+    PyMem_Free(counts);
+    PyMem_Free(segments);
     return ret;
 }
 
-
-static PyObject *
-Table_close(Table* self)
+/*
+ * Frees the compressor of this table and the dictionaries and samples of
+ * its column families.
+ */
+static void
+Table_free_compressor(Table *self)
 {
-    PyObject *ret = NULL;
-    int db_ret, io_ret;
-    DB *db = self->db;
-    if (db == NULL) {
-        PyErr_SetString(WormtableError, "table closed");
-        goto out;
+    uint32_t f;
+    row_compressor_t *c = self->compressor;
+    if (c != NULL) {
+        if (c->stream_ready) {
+            if (c->writing) {
+                deflateEnd(&c->stream);
+            } else {
+                inflateEnd(&c->stream);
+            }
+        }
+        PyMem_Free(c->buffer);
+        PyMem_Free(c);
+        self->compressor = NULL;
     }
-    db_ret = db->close(db, 0);
-    self->db = NULL;
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
+    if (self->families != NULL) {
+        for (f = 0; f < self->num_families; f++) {
+            PyMem_Free(self->families[f].dictionary);
+            PyMem_Free(self->families[f].samples);
+            self->families[f].dictionary = NULL;
+            self->families[f].dictionary_size = 0;
+            self->families[f].samples = NULL;
+            self->families[f].samples_size = 0;
+            self->families[f].samples_capacity = 0;
+        }
     }
-    if (self->data_file != NULL) {
-        io_ret = fclose(self->data_file);
-        self->data_file = NULL;
-        if (io_ret != 0) {
-            handle_io_error();
+}
+
+/*
+ * Trains the dictionary of each column family on the rows sampled so far,
+ * and frees the samples.
+ */
+static int
+Table_train_dictionaries(Table *self)
+{
+    int ret = -1;
+    uint32_t f;
+    column_family_t *family;
+    for (f = 0; f < self->num_families; f++) {
+        family = &self->families[f];
+        family->dictionary = PyMem_Malloc(WT_DICTIONARY_SIZE);
+        if (family->dictionary == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (train_dictionary(family->samples, family->samples_size,
+                    family->dictionary, &family->dictionary_size) != 0) {
             goto out;
         }
+        PyMem_Free(family->samples);
+        family->samples = NULL;
+        family->samples_size = 0;
+        family->samples_capacity = 0;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    self->compressor->trained = 1;
+    ret = 0;
 out:
     return ret;
 }
 
-
-static PyObject *
-Table_insert_elements(Table* self, PyObject *args)
+/*
+ * Reads the dictionary of each column family from the dictionary file.
+ * The file holds the number of families and whether the dictionaries have
+ * been trained, followed by the size and contents of each dictionary.
+ */
+static int
+Table_read_dictionaries(Table *self)
 {
-    PyObject *ret = NULL;
-    Column *col = NULL;
-    PyObject *elements = NULL;
-    int m, col_index, wt_ret;
-    if (!PyArg_ParseTuple(args, "iO", &col_index, &elements)) {
-        goto out;
-    }
-    if (Table_check_column_index(self, col_index) != 0) {
+    int ret = -1;
+    FILE *f = NULL;
+    uint32_t j, size;
+    int trained;
+    char *filename;
+    unsigned char header[WT_DICTIONARY_HEADER_SIZE];
+    column_family_t *family;
+
+    filename = PyBytes_AsString(self->dictionary_filename);
+    if (filename == NULL) {
         goto out;
     }
-    if (col_index == 0) {
-        PyErr_Format(WormtableError, "Cannot update ID col.");
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        handle_io_error();
         goto out;
     }
-    if (Table_check_write_mode(self) != 0) {
+    if (fread(header, WT_DICTIONARY_HEADER_SIZE, 1, f) != 1) {
+        handle_io_error();
         goto out;
     }
-    col = self->columns[col_index];
-    wt_ret = col->python_to_native(col, elements);
-    if (wt_ret < 0) {
+    if (unpack_uint(header, 4) != self->num_families) {
+        PyErr_SetString(WormtableError, "Dictionary file does not match "
+                "the column families of the table");
         goto out;
     }
-    if (wt_ret != WT_MISSING_VALUE) {
-        m = Column_update_row(col, self->row_buffer, self->current_row_size);
-        if (m < 0) {
+    trained = header[4] != 0;
+    for (j = 0; j < self->num_families; j++) {
+        family = &self->families[j];
+        if (fread(header, 4, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
+        size = (uint32_t) unpack_uint(header, 4);
+        if (size > WT_DICTIONARY_SIZE) {
+            PyErr_SetString(WormtableError, "Corrupt dictionary file");
+            goto out;
+        }
+        family->dictionary = PyMem_Malloc(WT_DICTIONARY_SIZE);
+        if (family->dictionary == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (size > 0 && fread(family->dictionary, size, 1, f) != 1) {
+            handle_io_error();
             goto out;
         }
-        self->current_row_size += m;
+        family->dictionary_size = size;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    self->compressor->trained = trained;
+    ret = 0;
 out:
+    if (f != NULL) {
+        fclose(f);
+    }
     return ret;
 }
 
-static PyObject *
-Table_insert_encoded_elements(Table* self, PyObject *args)
+/*
+ * Writes the dictionary of each column family to the dictionary file,
+ * training the dictionaries on the rows sampled so far if this has not
+ * already been done.
+ */
+static int
+Table_write_dictionaries(Table *self)
 {
-    PyObject *ret = NULL;
-    Column *column = NULL;
-    PyBytesObject *value = NULL;
-    char *v;
-    int  m, col_index;
-    if (!PyArg_ParseTuple(args, "iO!", &col_index, &PyBytes_Type,
-            &value)) {
-        goto out;
+    int ret = -1;
+    FILE *f = NULL;
+    uint32_t j;
+    char *filename;
+    unsigned char header[WT_DICTIONARY_HEADER_SIZE];
+    row_compressor_t *c = self->compressor;
+    column_family_t *family;
+
+    if (!c->trained && c->num_samples > 0) {
+        if (Table_train_dictionaries(self) != 0) {
+            goto out;
+        }
     }
-    if (Table_check_column_index(self, col_index) != 0) {
+    filename = PyBytes_AsString(self->dictionary_filename);
+    if (filename == NULL) {
         goto out;
     }
-    if (col_index == 0) {
-        PyErr_Format(WormtableError, "Cannot update ID column.");
+    f = fopen(filename, "wb");
+    if (f == NULL) {
+        handle_io_error();
         goto out;
     }
-    if (Table_check_write_mode(self) != 0) {
+    pack_uint(self->num_families, header, 4);
+    header[4] = (unsigned char) c->trained;
+    if (fwrite(header, WT_DICTIONARY_HEADER_SIZE, 1, f) != 1) {
+        handle_io_error();
         goto out;
     }
-    column = self->columns[col_index];
-    v = PyBytes_AsString((PyObject *) value);
-    if (column->string_to_native(column, v) < 0) {
-        goto out;
+    for (j = 0; j < self->num_families; j++) {
+        family = &self->families[j];
+        pack_uint(family->dictionary_size, header, 4);
+        if (fwrite(header, 4, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
+        if (family->dictionary_size > 0 && fwrite(family->dictionary,
+                    family->dictionary_size, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
     }
-    m = Column_update_row(column, self->row_buffer, self->current_row_size);
-    if (m < 0) {
+    if (fclose(f) != 0) {
+        f = NULL;
+        handle_io_error();
         goto out;
     }
-    self->current_row_size += m;
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    f = NULL;
+    ret = 0;
 out:
+    if (f != NULL) {
+        fclose(f);
+    }
     return ret;
 }
 
+/*
+ * Sets the start of the row of each column's family in the row buffer.
+ */
 static void
-Table_update_row_stats(Table *self, uint32_t row_size)
+Table_set_row_offsets(Table *self)
 {
-    self->total_row_size += row_size;
-    if (row_size < self->min_row_size) {
-        self->min_row_size = row_size;
-    }
-    if (row_size > self->max_row_size) {
-        self->max_row_size = row_size;
+    uint32_t j;
+    Column *col;
+    for (j = 0; j < self->num_columns; j++) {
+        col = self->columns[j];
+        col->row_offset = (size_t) col->family * self->row_buffer_size;
+        col->row_buffer_size = self->row_buffer_size;
     }
 }
 
-/* Retrieves the row from the data file identified by data into the
- * row buffer such that it is ready for reading. Also copy the specified
- * key into the buffer so that we can read the col_id column also.
+/*
+ * Makes room for rows of the specified size in each family's part of the
+ * row buffer, which is at least doubled when it grows so that a table
+ * only pays for the largest rows it has stored or read. The rows in the
+ * buffer are moved to the new start of each family's part.
  */
 static int
-Table_retrieve_row(Table *self, DBT *key, DBT *data)
+Table_reserve_row_buffer(Table *self, uint32_t size)
 {
     int ret = -1;
-    char *v;
-    char *rb = (char *) self->row_buffer;
-    Column *id_col = self->columns[0];
-    uint32_t key_size = id_col->element_size;
-    uint64_t offset = 0;
-    uint16_t len = 0;
-
-    if (key->size != key_size) {
-        PyErr_Format(PyExc_SystemError, "table key record size mismatch");
+    uint32_t limit = max_row_size((unsigned int) self->address_size);
+    uint32_t old_size = self->row_buffer_size;
+    uint32_t new_size = old_size;
+    uint32_t f;
+    char *rb;
+    if (size <= old_size) {
+        ret = 0;
         goto out;
     }
-    if (data->size != OFFSET_LEN_RECORD_SIZE) {
-        PyErr_Format(PyExc_SystemError, "offset/len record size mismatch");
+    if (size > limit) {
+        PyErr_SetString(PyExc_SystemError, "Row overflow");
         goto out;
     }
-    memcpy(self->row_buffer, key->data, key->size);
-    v = (char *) data->data;
-    offset = unpack_uint(v, sizeof(offset));
-    v += sizeof(offset);
-    len = unpack_uint(v, sizeof(len));
-    /* Now read this record from the file and put it in the row buffer */
-    if (fseeko(self->data_file, (off_t) offset, SEEK_SET) != 0) {
-        handle_io_error();
-        goto out;
+    while (new_size < size) {
+        new_size = new_size > limit / 2 ? limit : 2 * new_size;
     }
-    v = rb + key_size;
-    if (fread(v, len, 1, self->data_file) != 1) {
-        handle_io_error();
+    rb = PyMem_Realloc(self->row_buffer,
+            (size_t) self->num_families * new_size);
+    if (rb == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
+    /* later families move further, so they are moved first */
+    for (f = self->num_families - 1; f > 0; f--) {
+        memmove(rb + (size_t) f * new_size, rb + (size_t) f * old_size,
+                old_size);
+    }
+    self->row_buffer = rb;
+    self->row_buffer_size = new_size;
+    Table_set_row_offsets(self);
     ret = 0;
 out:
     return ret;
 }
 
+/*
+ * Makes room for the stored rows of the specified size in the compressor
+ * buffer, which is grown in the same way as the row buffer. The contents
+ * of the buffer are not kept when it grows.
+ */
 static int
-Table_retrieve_row_by_id(Table *self, uint64_t row_id)
+Table_reserve_compressor_buffer(Table *self, uint32_t size)
 {
     int ret = -1;
-    int db_ret;
-    unsigned char key_buffer[sizeof(row_id)];
-    Column *id_col = self->columns[0];
-    DBT key, data;
-
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    key.data = key_buffer;
-    key.size = id_col->element_size;
-    if (Column_set_row_id(id_col, row_id) != 0) {
+    row_compressor_t *c = self->compressor;
+    uint32_t limit = max_row_size((unsigned int) self->address_size) + 1;
+    uint32_t new_size = c->buffer_size == 0 ? MAX_ROW_SIZE + 1
+        : c->buffer_size;
+    /* stored rows are one byte longer than the row when not deflated */
+    size++;
+    if (size <= c->buffer_size) {
+        ret = 0;
         goto out;
     }
-    if (Column_update_row(id_col, key_buffer, 0) != 0) {
+    if (size > limit) {
+        PyErr_SetString(PyExc_SystemError, "Row overflow");
         goto out;
     }
-    db_ret = self->db->get(self->db, NULL, &key, &data, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    while (new_size < size) {
+        new_size = new_size > limit / 2 ? limit : 2 * new_size;
+    }
+    PyMem_Free(c->buffer);
+    c->buffer_size = 0;
+    c->buffer = PyMem_Malloc((size_t) self->num_families * new_size);
+    if (c->buffer == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    ret = Table_retrieve_row(self, &key, &data);
+    c->buffer_size = new_size;
+    ret = 0;
 out:
     return ret;
 }
 
-static PyObject *
-Table_commit_row(Table* self)
+/*
+ * Sets up the compressor for a table with compressed rows opened in the
+ * specified mode, reading the dictionaries of an existing table.
+ */
+static int
+Table_open_compressor(Table *self, int mode)
 {
-    PyObject *ret = NULL;
-    size_t io_ret;
-    int db_ret;
-    char *v;
-    char *rb = (char *) self->row_buffer;
-    uint64_t offset;
-    uint16_t len;
-    char record[OFFSET_LEN_RECORD_SIZE];
-    void *row = NULL;
-    DBT key, data;
-    Column *id_col = self->columns[0];
-    uint32_t key_size = id_col->element_size;
-    if (Table_check_write_mode(self) != 0) {
+    int ret = -1;
+    int z_ret;
+    row_compressor_t *c;
+
+    c = PyMem_Malloc(sizeof(row_compressor_t));
+    if (c == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    if (Column_set_row_id(id_col, (uint64_t) self->num_rows) != 0) {
+    memset(c, 0, sizeof(row_compressor_t));
+    self->compressor = c;
+    c->writing = mode != WT_READ;
+    if (Table_reserve_compressor_buffer(self, self->row_buffer_size) != 0) {
         goto out;
     }
-    if (Column_update_row(id_col, self->row_buffer, self->current_row_size)
-            != 0) {
-        goto out;
+    /* rows are deflated without a zlib header to save space */
+    if (c->writing) {
+        z_ret = deflateInit2(&c->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    } else {
+        z_ret = inflateInit2(&c->stream, -MAX_WBITS);
     }
-    /* write the data row */
-    offset = (uint64_t) ftello(self->data_file);
-    len = self->current_row_size - key_size;
-    row = rb + key_size;
-    io_ret = fwrite(row, len, 1, self->data_file);
-    if (io_ret != 1) {
-        handle_io_error();
+    if (z_ret != Z_OK) {
+        PyErr_SetString(WormtableError, "Cannot initialise zlib");
         goto out;
     }
-    /* pack offset|length into record */
-    v = record;
-    pack_uint(offset, v, sizeof(offset));
-    v += sizeof(offset);
-    pack_uint(len, v, sizeof(len));
-    /* Now store the offset+length in the DB */
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    key.data = self->row_buffer;
-    key.size = key_size;
-    data.data = record;
-    data.size = OFFSET_LEN_RECORD_SIZE;
-    db_ret = self->db->put(self->db, NULL, &key, &data, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
+    c->stream_ready = 1;
+    if (mode != WT_WRITE) {
+        if (Table_read_dictionaries(self) != 0) {
+            goto out;
+        }
     }
-    memset(self->row_buffer, 0, self->current_row_size);
-    self->current_row_size = self->fixed_region_size;
-    self->num_rows++;
-    Table_update_row_stats(self, len);
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    ret = 0;
 out:
     return ret;
 }
 
-static PyObject *
-Table_get_num_rows(Table* self)
+/*
+ * Copies the specified row of the specified family to the family's
+ * samples. If the samples are full, the row is not copied and full is set.
+ */
+static int
+Table_add_sample(Table *self, uint32_t f, void *row, uint32_t len,
+        int *full)
 {
-    int db_ret;
-    int wt_ret;
-    Column *id_col = self->columns[0];
-    uint64_t max_key = 0;
-    PyObject *ret = NULL;
-    DBC *cursor = NULL;
-    DBT key, data;
-    if (Table_check_read_mode(self) != 0) {
-        goto out;
-    }
-    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    int ret = -1;
+    column_family_t *family = &self->families[f];
+    size_t capacity = family->samples_capacity;
+    unsigned char *v;
+    if (family->samples_size + len > WT_COMPRESSION_SAMPLE_SIZE) {
+        *full = 1;
+        ret = 0;
         goto out;
     }
-    /* retrieve the last key from the DB */
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    db_ret = cursor->get(cursor, &key, &data, DB_LAST);
-    if (db_ret == 0) {
-        if (key.size != id_col->element_size) {
-            PyErr_Format(PyExc_SystemError, "key size mismatch");
-            goto out;
+    if (family->samples_size + len > capacity) {
+        capacity = capacity == 0 ? 64 * 1024 : 2 * capacity;
+        while (capacity < family->samples_size + len) {
+            capacity *= 2;
         }
-        wt_ret = Column_extract_elements(id_col, key.data);
-        if (wt_ret > 0) {
-            PyErr_Format(PyExc_SystemError, "Missing value in id column.");
-            goto out;
+        if (capacity > WT_COMPRESSION_SAMPLE_SIZE) {
+            capacity = WT_COMPRESSION_SAMPLE_SIZE;
         }
-        if (wt_ret < 0) {
+        v = PyMem_Realloc(family->samples, capacity);
+        if (v == NULL) {
+            PyErr_NoMemory();
             goto out;
         }
-        if (Column_get_row_id(id_col, &max_key) != 0) {
+        family->samples = v;
+        family->samples_capacity = capacity;
+    }
+    memcpy(family->samples + family->samples_size, row, len);
+    family->samples_size += len;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Stores the specified row of the specified family in dest, deflating it
+ * with the family's dictionary once the dictionaries have been trained,
+ * and returns the stored size. Rows that do not get smaller are stored
+ * as they are.
+ */
+static uint32_t
+Table_compress_row(Table *self, uint32_t f, void *row, uint32_t len,
+        unsigned char *dest)
+{
+    uint32_t ret = len + 1;
+    row_compressor_t *c = self->compressor;
+    column_family_t *family = &self->families[f];
+    z_stream *z = &c->stream;
+    if (c->trained && deflateReset(z) == Z_OK && (family->dictionary_size == 0
+                || deflateSetDictionary(z, family->dictionary,
+                    family->dictionary_size) == Z_OK)) {
+        z->next_in = (Bytef *) row;
+        z->avail_in = len;
+        z->next_out = dest + 1;
+        z->avail_out = len;
+        if (deflate(z, Z_FINISH) == Z_STREAM_END) {
+            dest[0] = WT_ROW_DEFLATED;
+            ret = (uint32_t) z->total_out + 1;
             goto out;
         }
-        max_key++;
-    } else if (db_ret != DB_NOTFOUND) {
-        handle_bdb_error(db_ret);
-        goto out;
-    }
-    /* Free the cursor */
-    db_ret = cursor->close(cursor);
-    cursor = NULL;
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
     }
-    ret = PyLong_FromUnsignedLongLong(max_key);
+    dest[0] = WT_ROW_STORED;
+    memcpy(dest + 1, row, len);
 out:
-    if (cursor != NULL) {
-        cursor->close(cursor);
-    }
     return ret;
 }
 
-static PyObject *
-Table_get_row(Table* self, PyObject *args)
+/*
+ * Sets stored_rows and stored_lens to the row of each column family as it
+ * is stored in the data files of a table with compressed rows. Until the
+ * dictionaries are trained, rows are also added to the samples, and the
+ * dictionaries are trained when compression_sample_rows rows have been
+ * sampled or the samples of a family are full.
+ */
+static int
+Table_compress_rows(Table *self, void **rows, uint32_t *lens,
+        void **stored_rows, uint32_t *stored_lens)
 {
-    PyObject *ret = NULL;
-    PyObject *t = NULL;
-    Column *col = NULL;
-    PyObject *value = NULL;
-    int wt_ret;
-    unsigned long long row_id = 0;
-    uint32_t j;
-    if (!PyArg_ParseTuple(args, "K", &row_id)) {
-        goto out;
+    int ret = -1;
+    int full = 0;
+    uint32_t f;
+    uint32_t max_len = 0;
+    unsigned char *dest;
+    row_compressor_t *c = self->compressor;
+    if (!c->trained) {
+        for (f = 0; f < self->num_families; f++) {
+            if (Table_add_sample(self, f, rows[f], lens[f], &full) != 0) {
+                goto out;
+            }
+        }
+        c->num_samples++;
+        if (full || c->num_samples >= self->compression_sample_rows) {
+            if (Table_train_dictionaries(self) != 0) {
+                goto out;
+            }
+        }
     }
-    if (Table_check_read_mode(self) != 0) {
-        goto out;
+    for (f = 0; f < self->num_families; f++) {
+        max_len = lens[f] > max_len ? lens[f] : max_len;
     }
-    if (Table_retrieve_row_by_id(self, (uint64_t) row_id) != 0) {
+    if (Table_reserve_compressor_buffer(self, max_len) != 0) {
         goto out;
     }
-    t = PyTuple_New(self->num_columns);
-    if (t == NULL) {
-        PyErr_NoMemory();
+    for (f = 0; f < self->num_families; f++) {
+        stored_rows[f] = rows[f];
+        stored_lens[f] = 0;
+        if (lens[f] > 0) {
+            dest = c->buffer + (size_t) f * c->buffer_size;
+            stored_lens[f] = Table_compress_row(self, f, rows[f], lens[f],
+                    dest);
+            stored_rows[f] = dest;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Expands the specified stored row of the specified family of a table
+ * with compressed rows into the family's row in the row buffer, after the
+ * key for family 0. The row buffer grows if the expanded row does not
+ * fit, and so src must not point into it. Expanded rows shorter than the
+ * family's fixed region are corrupt, as in Table_check_row_length.
+ */
+static int
+Table_expand_row(Table *self, uint32_t f, unsigned char *src, uint32_t len)
+{
+    int ret = -1;
+    int z_ret;
+    column_family_t *family = &self->families[f];
+    z_stream *z = &self->compressor->stream;
+    uint32_t start = f == 0 ? self->columns[0]->element_size : 0;
+    uint32_t limit = max_row_size((unsigned int) self->address_size);
+    uint32_t size = 0;
+    char *dest;
+    if (len == 0) {
+        ret = 0;
         goto out;
     }
-    for (j = 0; j < self->num_columns; j++) {
-        col = self->columns[j];
-        wt_ret = Column_extract_elements(col, self->row_buffer);
-        if (wt_ret < 0) {
-            Py_DECREF(t);
+    if (src[0] == WT_ROW_STORED) {
+        size = len - 1;
+        if (Table_reserve_row_buffer(self, start + size) != 0) {
             goto out;
         }
-        value = Column_get_python_elements(col, wt_ret == WT_MISSING_VALUE);
-        if (value == NULL) {
-            Py_DECREF(t);
+        dest = (char *) self->row_buffer + (size_t) f * self->row_buffer_size;
+        memcpy(dest + start, src + 1, size);
+    } else {
+        if (src[0] != WT_ROW_DEFLATED || inflateReset(z) != Z_OK
+                || (family->dictionary_size > 0 && inflateSetDictionary(z,
+                        family->dictionary, family->dictionary_size)
+                    != Z_OK)) {
+            PyErr_SetString(WormtableError, "Corrupt compressed row");
             goto out;
         }
-        PyTuple_SET_ITEM(t, j, value);
+        z->next_in = src + 1;
+        z->avail_in = len - 1;
+        while (1) {
+            dest = (char *) self->row_buffer
+                + (size_t) f * self->row_buffer_size + start;
+            z->next_out = (Bytef *) dest + z->total_out;
+            z->avail_out = self->row_buffer_size - start
+                - (uint32_t) z->total_out;
+            z_ret = inflate(z, Z_FINISH);
+            if ((z_ret != Z_OK && z_ret != Z_BUF_ERROR) || z->avail_out > 0
+                    || self->row_buffer_size == limit) {
+                break;
+            }
+            /* the row does not fit, so inflate the rest into a larger one */
+            if (Table_reserve_row_buffer(self, self->row_buffer_size + 1)
+                    != 0) {
+                goto out;
+            }
+        }
+        if (z_ret != Z_STREAM_END) {
+            PyErr_SetString(WormtableError, "Corrupt compressed row");
+            goto out;
+        }
+        size = (uint32_t) z->total_out;
     }
-    ret = t;
+    if (size < family->fixed_region_size - start) {
+        PyErr_Format(PyExc_SystemError, "Row underflow");
+        goto out;
+    }
+    ret = 0;
 out:
     return ret;
 }
 
+static void
+Table_dealloc(Table* self)
+{
+    uint32_t j;
+    PyObject *type, *value, *traceback;
+    if (self->writer != NULL) {
+        /* make sure the writer thread has exited; we ignore errors here. */
+        PyErr_Fetch(&type, &value, &traceback);
+        Table_stop_writer(self);
+        PyErr_Restore(type, value, traceback);
+    }
+    Py_XDECREF(self->db_filename);
+    Py_XDECREF(self->data_filename);
+    Py_XDECREF(self->dictionary_filename);
+    Table_free_compressor(self);
+    /* make sure that the DB handles are closed. We can ignore errors here. */
+    if (self->db != NULL) {
+        self->db->close(self->db, 0);
+    }
+    if (self->families != NULL) {
+        for (j = 0; j < self->num_families; j++) {
+            Py_XDECREF(self->families[j].data_filename);
+            if (self->families[j].data_file != NULL) {
+                fclose(self->families[j].data_file);
+            }
+            PyMem_Free(self->families[j].missing_row);
+        }
+        PyMem_Free(self->families);
+    }
+    if (self->row_buffer != NULL) {
+        PyMem_Free(self->row_buffer);
+    }
+    PyMem_Free(self->bulk_buffer);
+    if (self->profiles != NULL) {
+        for (j = 0; j < self->num_columns; j++) {
+            dictionary_free(&self->profiles[j].distinct);
+        }
+        PyMem_Free(self->profiles);
+    }
+    vcf_plan_free(self->vcf_plan);
+    if (self->columns != NULL) {
+        /* columns must be decref'd but may be null */
+        for (j = 0; j < self->num_columns; j++) {
+            Py_XDECREF(self->columns[j]);
+        }
+        PyMem_Free(self->columns);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
 
-
-
-static PyMethodDef Table_methods[] = {
-    {"get_num_rows", (PyCFunction) Table_get_num_rows, METH_NOARGS,
-            "Returns the number of rows in the table" },
-    {"get_row", (PyCFunction) Table_get_row, METH_VARARGS,
-            "Return the jth row as a tuple" },
-    {"open", (PyCFunction) Table_open, METH_VARARGS, "Open the table" },
-    {"close", (PyCFunction) Table_close, METH_NOARGS, "Close the table" },
-    {"commit_row", (PyCFunction) Table_commit_row, METH_NOARGS,
-            "Commit a row to the table in write mode." },
-    {"insert_elements", (PyCFunction) Table_insert_elements, METH_VARARGS,
-            "insert element values encoded as native Python objects." },
-    {"insert_encoded_elements", (PyCFunction) Table_insert_encoded_elements,
-            METH_VARARGS,
-            "insert element values encoded as comma seperated byte values." },
-    {NULL}  /* Sentinel */
-};
-
-static PyTypeObject TableType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.Table",             /* tp_name */
-    sizeof(Table),             /* tp_basicsize */
-    0,                         /* tp_itemsize */
-    (destructor)Table_dealloc, /* tp_dealloc */
-    0,                         /* tp_print */
-    0,                         /* tp_getattr */
-    0,                         /* tp_setattr */
-    0,                         /* tp_reserved */
-    0,                         /* tp_repr */
-    0,                         /* tp_as_number */
-    0,                         /* tp_as_sequence */
-    0,                         /* tp_as_mapping */
-    0,                         /* tp_hash  */
-    0,                         /* tp_call */
-    0,                         /* tp_str */
-    0,                         /* tp_getattro */
-    0,                         /* tp_setattro */
-    0,                         /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,        /* tp_flags */
-    "Table objects",           /* tp_doc */
-    0,                     /* tp_traverse */
-    0,                     /* tp_clear */
-    0,                     /* tp_richcompare */
-    0,                     /* tp_weaklistoffset */
-    0,                     /* tp_iter */
-    0,                     /* tp_iternext */
-    Table_methods,             /* tp_methods */
-    Table_members,             /* tp_members */
-    0,                         /* tp_getset */
-    0,                         /* tp_base */
-    0,                         /* tp_dict */
-    0,                         /* tp_descr_get */
-    0,                         /* tp_descr_set */
-    0,                         /* tp_dictoffset */
-    (initproc)Table_init,      /* tp_init */
-};
-
-
-
-
-/*==========================================================
- * Index object
- *==========================================================
+/*
+ * Checks the columns to ensure sanity.
  */
-
-static void
-Index_dealloc(Index* self)
+static int
+Table_verify_columns(Table *self)
 {
-    Py_XDECREF(self->table);
-    Py_XDECREF(self->db_filename);
-    /* make sure that the DB handles are closed. We can ignore errors here. */
-    if (self->db != NULL) {
-        self->db->close(self->db, 0);
+    int ret = -1;
+    Column *col;
+    uint32_t j, k;
+    char *cj, *ck;
+    if (self->num_columns < 2) {
+        PyErr_SetString(PyExc_ValueError, "Two or more columns required");
+        goto out;
     }
-    if (self->columns != NULL) {
-        PyMem_Free(self->columns);
+    for (j = 0; j < self->num_columns; j++) {
+        if (!PyObject_TypeCheck(self->columns[j], &ColumnType)) {
+            PyErr_SetString(PyExc_TypeError, "Must be Column objects");
+            goto out;
+        }
     }
-    if (self->bin_widths != NULL) {
-        PyMem_Free(self->bin_widths);
+    /* check the row_id column */
+    col = self->columns[0];
+    if (col->element_type != WT_UINT || col->num_elements != 1) {
+        PyErr_SetString(PyExc_ValueError,
+                "row_id column must be 1 element uint");
+        goto out;
     }
-    if (self->key_buffer != NULL) {
-        PyMem_Free(self->key_buffer);
+    /* check for duplicate columns */
+    /* TODO this is very slow for large numbers of columns - we should use a
+     * python dictionary to check instead
+     */
+    for (j = 0; j < self->num_columns; j++) {
+        cj = PyBytes_AsString(self->columns[j]->name);
+        for (k = j + 1; k < self->num_columns; k++) {
+            ck = PyBytes_AsString(self->columns[k]->name);
+            if (self->columns[j] == self->columns[k]) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Duplicate columns not permitted");
+                goto out;
+            }
+            /* check for duplicate names */
+            if (strcmp(cj, ck) == 0) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Duplicate column names not permitted");
+                goto out;
+            }
+        }
     }
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    ret = 0;
+out:
+    return ret;
 }
 
 static int
-Index_init(Index *self, PyObject *args, PyObject *kwds)
+Table_init(Table *self, PyObject *args, PyObject *kwds)
 {
-    int j;
-    long k;
     int ret = -1;
-    static char *kwlist[] = {"table", "db_filename", "columns", "cache_size", NULL};
-    PyObject *v;
-    Column *col;
+    static char *kwlist[] = {"db_filename", "data_filename", "columns",
+            "cache_size", "native_rows", "address_size",
+            "family_data_filenames", "dense_rows", "compressed_rows",
+            "dictionary_filename", "compression_sample_rows", NULL};
+    Column *col, *sparse_col;
+    column_family_t *family;
     PyObject *db_filename = NULL;
+    PyObject *data_filename = NULL;
     PyObject *columns = NULL;
-    Table *table = NULL;
-    uint32_t n;
-
+    PyObject *family_data_filenames = NULL;
+    PyObject *dictionary_filename = NULL;
+    PyObject *v;
+    Py_ssize_t num_filenames;
+    uint64_t max_size;
+    uint32_t j, f, start, key_size;
+    char *row;
     self->db = NULL;
-    self->table = NULL;
-    self->db_filename = NULL;
-    self->bin_widths = NULL;
-    self->key_buffer = NULL;
+    self->row_buffer = NULL;
+    self->families = NULL;
+    self->num_families = 0;
+    self->native_rows = 0;
+    self->dense_rows = 0;
+    self->compressed_rows = 0;
+    self->compression_sample_rows = 1000;
+    self->dictionary_filename = NULL;
+    self->compressor = NULL;
+    self->address_size = WT_DEFAULT_ADDRESS_SIZE;
     self->columns = NULL;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!O!K", kwlist,
-            &TableType, &table,
+    self->db_filename = NULL;
+    self->cache_size = 0;
+    self->vcf_plan = NULL;
+    self->writer = NULL;
+    self->bulk_buffer = NULL;
+    self->profiles = NULL;
+    self->num_profiled_rows = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!O!K|iiO!iiO!K", kwlist,
             &PyBytes_Type, &db_filename,
+            &PyBytes_Type, &data_filename,
             &PyList_Type,  &columns,
-            &self->cache_size)) {
+            &self->cache_size, &self->native_rows, &self->address_size,
+            &PyList_Type, &family_data_filenames, &self->dense_rows,
+            &self->compressed_rows, &PyBytes_Type, &dictionary_filename,
+            &self->compression_sample_rows)) {
+        goto out;
+    }
+    if (self->compressed_rows) {
+        if (dictionary_filename == NULL) {
+            PyErr_SetString(PyExc_ValueError,
+                    "A dictionary file is required for compressed rows");
+            goto out;
+        }
+        if (self->dense_rows) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Dense rows cannot be compressed");
+            goto out;
+        }
+        if (self->compression_sample_rows == 0) {
+            PyErr_SetString(PyExc_ValueError,
+                    "At least one row must be sampled for compression");
+            goto out;
+        }
+        self->dictionary_filename = dictionary_filename;
+        Py_INCREF(self->dictionary_filename);
+    }
+    if (self->address_size < WT_DEFAULT_ADDRESS_SIZE
+            || self->address_size > WT_MAX_ADDRESS_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "Address size must be 2, 3 or 4");
         goto out;
     }
-    self->table = table;
-    Py_INCREF(self->table);
     self->db_filename = db_filename;
     Py_INCREF(self->db_filename);
-    if (Table_check_read_mode(self->table) != 0) {
+    self->data_filename = data_filename;
+    Py_INCREF(self->data_filename);
+    self->num_columns = PyList_GET_SIZE(columns);
+    self->columns = PyMem_Malloc(self->num_columns * sizeof(Column *));
+    if (self->columns == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    self->num_columns = PyList_GET_SIZE(columns);
-    if (self->num_columns < 1) {
-        PyErr_SetString(PyExc_ValueError, "Must be 1 or more columns index.");
+    for (j = 0; j < self->num_columns; j++) {
+        col = (Column *) PyList_GET_ITEM(columns, j);
+        Py_INCREF(col);
+        self->columns[j] = col;
+    }
+    if (Table_verify_columns(self) != 0) {
         goto out;
     }
-    self->columns = PyMem_Malloc(self->num_columns * sizeof(uint32_t));
-    if (self->columns == NULL) {
-        PyErr_NoMemory();
+    for (j = 0; j < self->num_columns; j++) {
+        f = (uint32_t) self->columns[j]->family;
+        if (f >= self->num_families) {
+            self->num_families = f + 1;
+        }
+    }
+    if (self->columns[0]->family != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                "The row_id column must be in family 0");
         goto out;
     }
-    self->bin_widths = PyMem_Malloc(self->num_columns * sizeof(double));
-    if (self->bin_widths == NULL) {
+    num_filenames = 0;
+    if (family_data_filenames != NULL) {
+        num_filenames = PyList_GET_SIZE(family_data_filenames);
+    }
+    if (num_filenames != (Py_ssize_t) self->num_families - 1) {
+        PyErr_SetString(PyExc_ValueError,
+                "A data file must be given for each column family");
+        goto out;
+    }
+    self->families = PyMem_Malloc(self->num_families
+            * sizeof(column_family_t));
+    if (self->families == NULL) {
         PyErr_NoMemory();
         goto out;
     }
-    memset(self->bin_widths, 0, self->num_columns * sizeof(double));
-    self->key_buffer_size = 0;
-    for (j = 0; j < self->num_columns; j++) {
-        v = PyList_GET_ITEM(columns, j);
-        if (!PyNumber_Check(v)) {
-            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+    memset(self->families, 0, self->num_families * sizeof(column_family_t));
+    self->families[0].data_filename = data_filename;
+    Py_INCREF(data_filename);
+    for (f = 1; f < self->num_families; f++) {
+        v = PyList_GET_ITEM(family_data_filenames, f - 1);
+        if (!PyBytes_Check(v)) {
+            PyErr_SetString(PyExc_TypeError, "Data filenames must be bytes");
             goto out;
         }
-        k = PyLong_AsLong(v);
-        if (k < 0 || k >= self->table->num_columns) {
-            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+        self->families[f].data_filename = v;
+        Py_INCREF(v);
+    }
+    self->record_size = self->num_families * OFFSET_LEN_RECORD_SIZE;
+    if (self->address_size > WT_DEFAULT_ADDRESS_SIZE) {
+        self->record_size = self->num_families
+            * WT_WIDE_OFFSET_LEN_RECORD_SIZE;
+    }
+    key_size = (uint32_t) self->columns[0]->element_size;
+    for (j = 0; j < self->num_columns; j++) {
+        col = self->columns[j];
+        family = &self->families[col->family];
+        col->position = j;
+        col->address_size = self->address_size;
+        col->max_row_size = max_row_size((unsigned int) self->address_size);
+        start = col->family == 0 ? key_size : 0;
+        if (self->address_size == WT_DEFAULT_ADDRESS_SIZE
+                && col->max_row_size > WT_MAX_STORED_ROW_SIZE + start) {
+            col->max_row_size = WT_MAX_STORED_ROW_SIZE + start;
+        }
+        col->fixed_region_offset = family->fixed_region_size;
+        family->fixed_region_size += Column_get_fixed_region_size(col);
+        if (family->fixed_region_size > col->max_row_size) {
+            PyErr_SetString(WormtableError, "Columns exceed max row size");
             goto out;
         }
-        self->columns[j] = (uint32_t) k;
-        col = self->table->columns[k];
-        n = col->num_elements;
-        if (Column_is_variable(col)) {
-            /* allow space for the sentinel */
-            n = Column_get_max_num_elements(col) + 1;
-            /* allow space for the missing value indicator */
-            self->key_buffer_size += 1;
+        if (col->sparse) {
+            if (j == 0) {
+                PyErr_SetString(PyExc_ValueError,
+                        "The row_id column cannot be sparse");
+                goto out;
+            }
+            if (family->num_sparse_columns == WT_MAX_SPARSE_COLUMNS) {
+                PyErr_SetString(PyExc_ValueError, "Too many sparse columns");
+                goto out;
+            }
+            col->sparse_bit = (int) family->num_sparse_columns;
+            family->num_sparse_columns++;
+        }
+    }
+    /* The sparse header follows the fixed region of the other columns */
+    for (f = 0; f < self->num_families; f++) {
+        family = &self->families[f];
+        if (family->num_sparse_columns > 0) {
+            sparse_col = NULL;
+            for (j = 0; j < self->num_columns; j++) {
+                col = self->columns[j];
+                if (col->sparse && col->family == (int) f) {
+                    col->fixed_region_offset = family->fixed_region_size;
+                    sparse_col = col;
+                }
+            }
+            family->fixed_region_size += self->address_size
+                + (family->num_sparse_columns + 7) / 8;
+            if (family->fixed_region_size > sparse_col->max_row_size) {
+                PyErr_SetString(WormtableError, "Columns exceed max row size");
+                goto out;
+            }
         }
-        self->key_buffer_size += n * col->element_size;
     }
-    self->key_buffer = PyMem_Malloc(self->key_buffer_size);
-    if (self->key_buffer == NULL) {
+    /*
+     * The row buffer starts with room for MAX_ROW_SIZE bytes in each family
+     * and grows as larger rows are stored or read. Only the part of it that
+     * has been written is cleared.
+     */
+    self->row_buffer_size = MAX_ROW_SIZE;
+    for (f = 0; f < self->num_families; f++) {
+        if (self->families[f].fixed_region_size > self->row_buffer_size) {
+            self->row_buffer_size = self->families[f].fixed_region_size;
+        }
+    }
+    self->row_buffer = PyMem_Malloc((size_t) self->num_families
+            * self->row_buffer_size);
+    if (self->row_buffer == NULL) {
         PyErr_NoMemory();
         goto out;
     }
+    Table_set_row_offsets(self);
+    if (self->dense_rows) {
+        /* every row of each family must have the same size */
+        if (self->num_columns < 2) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Dense rows require a column other than row_id");
+            goto out;
+        }
+        for (j = 1; j < self->num_columns; j++) {
+            col = self->columns[j];
+            if (col->sparse || Column_is_variable(col)) {
+                PyErr_SetString(PyExc_ValueError, "Dense rows cannot be "
+                        "used with variable length or sparse columns");
+                goto out;
+            }
+        }
+    }
+    if (self->native_rows) {
+        /* The row_id column is the primary key, and must sort correctly */
+        for (f = 0; f < self->num_families; f++) {
+            family = &self->families[f];
+            /* allocate at least one byte for empty families */
+            family->missing_row = PyMem_Malloc(family->fixed_region_size + 1);
+            if (family->missing_row == NULL) {
+                PyErr_NoMemory();
+                goto out;
+            }
+            memset(family->missing_row, 0, family->fixed_region_size);
+        }
+        for (j = 1; j < self->num_columns; j++) {
+            col = self->columns[j];
+            if (Column_set_native(col) < 0) {
+                goto out;
+            }
+            if (!col->sparse && !Column_is_variable(col)) {
+                if (Column_pack_missing(col,
+                            (char *) self->families[col->family].missing_row
+                            + col->fixed_region_offset) < 0) {
+                    goto out;
+                }
+            }
+        }
+    } else {
+        for (j = 1; j < self->num_columns; j++) {
+            if (self->columns[j]->native) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Columns with native rows cannot be used in this table");
+                goto out;
+            }
+        }
+    }
+    self->fixed_region_size = 0;
+    for (f = 0; f < self->num_families; f++) {
+        family = &self->families[f];
+        row = (char *) self->row_buffer + (size_t) f * self->row_buffer_size;
+        memset(row, 0, family->fixed_region_size);
+        if (family->missing_row != NULL) {
+            memcpy(row, family->missing_row, family->fixed_region_size);
+        }
+        family->current_row_size = family->fixed_region_size;
+        self->fixed_region_size += family->fixed_region_size;
+    }
+    self->num_rows = 0;
+    self->max_row_size = 0;
+    max_size = (uint64_t) self->num_families
+        * max_row_size((unsigned int) self->address_size);
+    self->min_row_size = (unsigned int) (max_size > UINT_MAX ? UINT_MAX
+            : max_size);
+    self->total_row_size = 0;
     ret = 0;
 out:
-
     return ret;
 }
 
-
-static PyMemberDef Index_members[] = {
-    {"table", T_OBJECT_EX, offsetof(Index, table), READONLY, "table"},
-    {"db_filename", T_OBJECT_EX, offsetof(Index, db_filename), READONLY, "db_filename"},
-    {"cache_size", T_ULONGLONG, offsetof(Index, cache_size), READONLY, "cache_size"},
+static PyMemberDef Table_members[] = {
+    {"db_filename", T_OBJECT_EX, offsetof(Table, db_filename), READONLY, "db_filename"},
+    {"data_filename", T_OBJECT_EX, offsetof(Table, data_filename), READONLY, "data_filename"},
+    {"cache_size", T_ULONGLONG, offsetof(Table, cache_size), READONLY, "cache_size"},
+    {"num_rows", T_ULONGLONG, offsetof(Table, num_rows), READONLY, "num_rows"},
+    {"num_profiled_rows", T_ULONGLONG, offsetof(Table, num_profiled_rows),
+            READONLY, "num_profiled_rows"},
+    {"total_row_size", T_ULONGLONG, offsetof(Table, total_row_size), READONLY, "total_row_size"},
+    {"min_row_size", T_UINT, offsetof(Table, min_row_size), READONLY, "min_row_size"},
+    {"max_row_size", T_UINT, offsetof(Table, max_row_size), READONLY, "max_row_size"},
+    {"native_rows", T_INT, offsetof(Table, native_rows), READONLY,
+        "native_rows"},
+    {"dense_rows", T_INT, offsetof(Table, dense_rows), READONLY,
+        "dense_rows"},
+    {"compressed_rows", T_INT, offsetof(Table, compressed_rows), READONLY,
+        "compressed_rows"},
+    {"address_size", T_INT, offsetof(Table, address_size), READONLY,
+        "address_size"},
+    {"row_buffer_size", T_UINT, offsetof(Table, row_buffer_size), READONLY,
+        "row_buffer_size"},
+    {"num_families", T_UINT, offsetof(Table, num_families), READONLY,
+        "num_families"},
+    {"fixed_region_size", T_UINT, offsetof(Table, fixed_region_size), READONLY,
+            "fixed_region_size"},
     {NULL}  /* Sentinel */
 };
 
 
 /*
- * Returns 0 if the table is opened in write mode. Otherwise
+ * Returns 0 if the column is value. Otherwise
  * -1 is returned with the appropriate Python exception set.
  */
 static int
-Index_check_write_mode(Index *self)
+Table_check_column_index(Table *self, int col_index)
 {
     int ret = -1;
-    int db_ret;
-    uint32_t flags;
-    if (Table_check_read_mode(self->table) != 0) {
+    if (col_index < 0 || col_index >= self->num_columns) {
+        PyErr_Format(WormtableError, "Column index out of range.");
         goto out;
     }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Returns 0 if the table is opened in write mode. Otherwise
+ * -1 is returned with the appropriate Python exception set.
+ */
+static int
+Table_check_write_mode(Table *self)
+{
+    int ret = -1;
+    int db_ret;
+    uint32_t flags;
     if (self->db == NULL) {
-        PyErr_Format(WormtableError, "Index closed.");
+        PyErr_Format(WormtableError, "Table closed.");
         goto out;
     }
     db_ret = self->db->get_open_flags(self->db, &flags);
@@ -2831,7 +5206,7 @@ Index_check_write_mode(Index *self)
         goto out;
     }
     if ((flags & DB_RDONLY) != 0) {
-        PyErr_Format(WormtableError, "Index must be opened WT_WRITE.");
+        PyErr_Format(WormtableError, "Table must be opened WT_WRITE.");
         goto out;
     }
     ret = 0;
@@ -2845,16 +5220,17 @@ out:
  * -1 is returned with the appropriate Python exception set.
  */
 static int
-Index_check_read_mode(Index *self)
+Table_check_read_mode(Table *self)
 {
     int ret = -1;
     int db_ret;
     uint32_t flags;
-    if (Table_check_read_mode(self->table) != 0) {
+    if (self == NULL) {
+        PyErr_Format(PyExc_SystemError, "Null table.");
         goto out;
     }
     if (self->db == NULL) {
-        PyErr_Format(WormtableError, "Index closed.");
+        PyErr_Format(WormtableError, "Table closed.");
         goto out;
     }
     db_ret = self->db->get_open_flags(self->db, &flags);
@@ -2863,7 +5239,7 @@ Index_check_read_mode(Index *self)
         goto out;
     }
     if ((flags & DB_RDONLY) == 0) {
-        PyErr_Format(WormtableError, "Index must be opened WT_READ.");
+        PyErr_Format(WormtableError, "Table must be opened WT_READ.");
         goto out;
     }
     ret = 0;
@@ -2871,55 +5247,38 @@ out:
     return ret;
 }
 
-/* extract values from the specified row and push them into the specified
- * secondary key. This has valid memory associated with it.
+/*
+ * Returns the size of each row of the specified family in the data file
+ * of a table with dense rows, where row i is stored at i times this size.
+ * The row_id at the start of the row of family 0 is not stored.
+ */
+static uint32_t
+Table_get_dense_row_size(Table *self, uint32_t family)
+{
+    uint32_t size = self->families[family].fixed_region_size;
+    if (family == 0) {
+        size -= (uint32_t) self->columns[0]->element_size;
+    }
+    return size;
+}
+
+/*
+ * Sets row_id to the row id in the specified primary key. Returns 0 on
+ * success or EINVAL if the key is not valid.
  */
 static int
-Index_fill_key(Index *self, void *row, DBT *skey)
+Table_get_key_row_id(Table *self, DBT *key, uint64_t *row_id)
 {
-    int ret = -1;
-    int wt_ret;
-    Column *col;
-    uint32_t j, k;
-    int len;
-    unsigned char *v = skey->data;
-    skey->size = 0;
-    for (j = 0; j < self->num_columns; j++) {
-        col = self->table->columns[self->columns[j]];
-        len = 0;
-        wt_ret = Column_extract_elements(col, row);
-        if (wt_ret < 0) {
-            ret = wt_ret;
-            goto out;
-        }
-        if (Column_is_variable(col)) {
-            /* insert the missing value prefix */
-            *v = wt_ret == WT_MISSING_VALUE ? 0 : 1;
-            v++;
-            skey->size++;
-        }
-        if (self->bin_widths[j] != 0.0) {
-            if (col->truncate_elements(col, self->bin_widths[j]) < 0) {
-                goto out;
-            }
-        }
-        if (col->pack_elements(col, v) < 0) {
-            goto out;
-        }
-        len = col->num_buffered_elements * col->element_size;
-        if (len < 0) {
-            goto out;
-        }
-        v += len;
-        skey->size += len;
-        if (Column_is_variable(col)) {
-            /* insert the sentinel */
-            for (k = 0; k < col->element_size; k++) {
-                *v = 0;
-                v++;
-                skey->size++;
-            }
-        }
+    int ret = EINVAL;
+    Column *id_col = self->columns[0];
+    if (key->size != (uint32_t) id_col->element_size) {
+        goto out;
+    }
+    if (Column_extract_elements(id_col, key->data) != 0) {
+        goto out;
+    }
+    if (Column_get_row_id(id_col, row_id) != 0) {
+        goto out;
     }
     ret = 0;
 out:
@@ -2927,390 +5286,387 @@ out:
 }
 
 /*
- * Reads the arguments and sets a key in the specified buffer, returning
- * its length.
+ * Sets key and data to the primary key and offset|length record for the
+ * specified row of a table with dense rows. There are no primary records
+ * in these tables, so the record is computed from the row id and both
+ * are stored in buffers owned by the table, which are valid until the
+ * next call. Returns 0 on success, DB_NOTFOUND if the row is not in the
+ * table, or EINVAL if the key cannot be encoded.
  */
 static int
-Index_set_key(Index *self, PyObject *args, void *buffer)
+Table_get_dense_record(Table *self, uint64_t row_id, DBT *key, DBT *data)
 {
-    int ret = -1;
-    int j, m, k, wt_ret, overhead;
-    int key_size = 0;
-    Py_ssize_t n;
-    Column *col = NULL;
-    PyObject *elements = NULL;
-    PyObject *v = NULL;
-    char *key_buffer = (char *) buffer;
-    if (!PyArg_ParseTuple(args, "O!", &PyTuple_Type, &elements)) {
+    int ret = DB_NOTFOUND;
+    uint32_t f, size;
+    char *v = self->dense_record;
+    uint8_t len_size = (uint8_t) (self->record_size / self->num_families
+            - sizeof(uint64_t));
+    Column *id_col = self->columns[0];
+    if (row_id >= self->num_rows) {
         goto out;
     }
-    if (Index_check_read_mode(self) != 0) {
+    ret = EINVAL;
+    if (Column_set_row_id(id_col, row_id) != 0) {
         goto out;
     }
-    n = PyTuple_GET_SIZE(elements);
-    if (n > self->num_columns) {
-        PyErr_Format(PyExc_ValueError, "More key values than columns.");
+    if (Column_update_row(id_col, self->dense_key, 0) != 0) {
         goto out;
     }
-    for (j = 0; j < n; j++) {
-        col = self->table->columns[self->columns[j]];
-        v = PyTuple_GetItem(elements, j);
-        wt_ret = col->python_to_native(col, v);
-        if (wt_ret < 0) {
-            goto out;
-        }
-        if (col->verify_elements(col) < 0) {
-            goto out;
-        }
-        m = col->num_buffered_elements * col->element_size;
-        overhead = Column_is_variable(col) ? 1 + col->element_size: 0;
-        if (key_size + m + overhead > self->key_buffer_size) {
-            PyErr_Format(PyExc_SystemError, "Max key_size exceeded.");
-            goto out;
-        }
-        if (Column_is_variable(col)) {
-            /* insert the missing value prefix */
-            *key_buffer = wt_ret == WT_MISSING_VALUE? 0 : 1;
-            key_buffer++;
-            key_size++;
-        }
-        col->pack_elements(col, key_buffer);
-        key_buffer += m;
-        key_size += m;
-        if (Column_is_variable(col)) {
-            /* insert the sentinel */
-            for (k = 0; k < col->element_size; k++) {
-                *key_buffer = 0;
-                key_buffer++;
-                key_size++;
-            }
-        }
+    for (f = 0; f < self->num_families; f++) {
+        size = Table_get_dense_row_size(self, f);
+        pack_uint(row_id * size, v, sizeof(uint64_t));
+        v += sizeof(uint64_t);
+        pack_uint(size, v, len_size);
+        v += len_size;
     }
-    ret = key_size;
+    key->data = self->dense_key;
+    key->size = (uint32_t) id_col->element_size;
+    data->data = self->dense_record;
+    data->size = self->record_size;
+    ret = 0;
 out:
     return ret;
 }
 
 /*
- * Increment the specified key. This increments the least significant
- * byte, and then carries the result up the more signficant bytes as
- * required. Returns 1 if the key overflows, and the key is zero as
- * a result.
+ * Gets the offset|length record for the specified primary key as
+ * db->get does. Returns 0 or a DB error code.
  */
 static int
-Index_increment_key(Index *self, void *buffer, uint32_t key_size)
+Table_get_record(Table *self, DBT *key, DBT *data)
 {
-    int j;
-    int overflow = 0;
-    unsigned char *key_buffer = (unsigned char *) buffer;
-    j = key_size - 1;
-    /* add one to the buffer, making sure to carry base 256 */
-    while (j > 0 && key_buffer[j] == 255) {
-        key_buffer[j] = 0;
-        j--;
-    }
-    key_buffer[j] += 1;
-    if (j == 0 && key_buffer[0] == 0) {
-        overflow = 1;
+    int ret;
+    uint64_t row_id;
+    if (self->dense_rows) {
+        ret = Table_get_key_row_id(self, key, &row_id);
+        if (ret == 0) {
+            ret = Table_get_dense_record(self, row_id, key, data);
+        }
+    } else {
+        ret = self->db->get(self->db, NULL, key, data, 0);
     }
-    return overflow;
+    return ret;
 }
 
-
-
-static PyObject *
-Index_key_to_python(Index *self, void *key_buffer, uint32_t key_size)
+/*
+ * Moves the specified cursor over the primary DB as cursor->get does for
+ * the DB_NEXT, DB_SET and DB_SET_RANGE flags. Tables with dense rows have
+ * no primary records, so the cursor is not used and the next row id is
+ * kept in position instead, which must be 0 for a new cursor. Returns 0
+ * or a DB error code.
+ */
+static int
+Table_cursor_get(Table *self, DBC *cursor, uint64_t *position, DBT *key,
+        DBT *data, uint32_t flags)
 {
-    PyObject *ret = NULL;
-    PyObject *value;
-    uint32_t j, offset;
-    Column *col;
-    char *v;
-    int n, missing_value, wt_ret;
-    PyObject *t = PyTuple_New(self->num_columns);
-    if (t == NULL) {
-        PyErr_NoMemory();
+    int ret;
+    if (!self->dense_rows) {
+        ret = cursor->get(cursor, key, data, flags);
         goto out;
     }
-    if (Index_check_read_mode(self) != 0) {
-        goto out;
+    if (flags != DB_NEXT) {
+        ret = Table_get_key_row_id(self, key, position);
+        if (ret != 0) {
+            goto out;
+        }
     }
-    offset = 0;
-    for (j = 0; j < self->num_columns; j++) {
-        missing_value = 0;
-        col = self->table->columns[self->columns[j]];
-        n = 0;
-        if (Column_is_variable(col)) {
-            v = (char *) key_buffer;
-            v += offset;
-            missing_value = *v == 0;
-            offset++;
-            wt_ret = Column_extract_key(col, key_buffer, offset, key_size);
-            if (wt_ret < 0) {
-                Py_DECREF(t);
-                goto out;
-            }
-            /* skip the sentinel */
-            n = 1;
-        } else {
-            wt_ret = Column_extract_key(col, key_buffer, offset, key_size);
-            if (wt_ret < 0) {
-                Py_DECREF(t);
-                goto out;
-            }
-            missing_value = wt_ret == WT_MISSING_VALUE;
+    ret = Table_get_dense_record(self, *position, key, data);
+    if (ret == 0) {
+        (*position)++;
+    }
+out:
+    return ret;
+}
+
+/*
+ * Sets num_rows to the number of complete rows in the data files of a
+ * table with dense rows.
+ */
+static int
+Table_read_dense_num_rows(Table* self, uint64_t *num_rows)
+{
+    int ret = -1;
+    uint32_t f, size;
+    off_t end;
+    uint64_t n = UINT64_MAX;
+    FILE *data_file;
+    for (f = 0; f < self->num_families; f++) {
+        size = Table_get_dense_row_size(self, f);
+        if (size == 0) {
+            continue;
         }
-        n += col->num_buffered_elements;
-        offset += n * col->element_size;
-        value = Column_get_python_elements(col, missing_value);
-        if (value == NULL) {
-            Py_DECREF(t);
+        data_file = self->families[f].data_file;
+        if (fseeko(data_file, 0, SEEK_END) != 0) {
+            handle_io_error();
             goto out;
         }
-        PyTuple_SET_ITEM(t, j, value);
+        end = ftello(data_file);
+        if (end < 0) {
+            handle_io_error();
+            goto out;
+        }
+        if ((uint64_t) end / size < n) {
+            n = (uint64_t) end / size;
+        }
     }
-    ret = t;
+    *num_rows = n;
+    ret = 0;
 out:
     return ret;
 }
 
-static PyObject *
-Index_get_num_rows(Index *self, PyObject *args)
+/*
+ * Sets num_rows to one more than the largest row id in the table, or 0
+ * if the table is empty.
+ */
+static int
+Table_read_num_rows(Table* self, uint64_t *num_rows)
 {
-    PyObject *ret = NULL;
-    int db_ret, key_size;
-    db_recno_t count = 0;
-    DB *db = NULL;
+    int ret = -1;
+    int db_ret;
+    int wt_ret;
+    Column *id_col = self->columns[0];
+    uint64_t max_key = 0;
     DBC *cursor = NULL;
     DBT key, data;
-    key_size = Index_set_key(self, args, self->key_buffer);
-    if (key_size < 0) {
-        goto out;
-    }
-    if (Index_check_read_mode(self) != 0) {
-        goto out;
-    }
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    db = self->db;
-    if (db == NULL) {
-        PyErr_SetString(WormtableError, "table closed");
+    if (self->dense_rows) {
+        ret = Table_read_dense_num_rows(self, num_rows);
         goto out;
     }
-    db_ret = db->cursor(db, NULL, &cursor, 0);
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
     if (db_ret != 0) {
         handle_bdb_error(db_ret);
         goto out;
     }
-    key.data = self->key_buffer;
-    key.size = (uint32_t) key_size;
-    db_ret = cursor->get(cursor, &key, &data, DB_SET);
+    /* retrieve the last key from the DB */
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    db_ret = cursor->get(cursor, &key, &data, DB_LAST);
     if (db_ret == 0) {
-        db_ret = cursor->count(cursor, &count, 0);
-        if (db_ret != 0) {
-            handle_bdb_error(db_ret);
+        if (key.size != id_col->element_size) {
+            PyErr_Format(PyExc_SystemError, "key size mismatch");
+            goto out;
+        }
+        wt_ret = Column_extract_elements(id_col, key.data);
+        if (wt_ret > 0) {
+            PyErr_Format(PyExc_SystemError, "Missing value in id column.");
+            goto out;
+        }
+        if (wt_ret < 0) {
             goto out;
         }
+        if (Column_get_row_id(id_col, &max_key) != 0) {
+            goto out;
+        }
+        max_key++;
     } else if (db_ret != DB_NOTFOUND) {
         handle_bdb_error(db_ret);
         goto out;
     }
-    ret = PyLong_FromUnsignedLongLong((unsigned long long) count);
+    /* Free the cursor */
+    db_ret = cursor->close(cursor);
+    cursor = NULL;
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    *num_rows = max_key;
+    ret = 0;
 out:
     if (cursor != NULL) {
         cursor->close(cursor);
     }
-
     return ret;
 }
 
 static PyObject *
-Index_get_min(Index* self, PyObject *args)
+Table_open(Table* self, PyObject *args)
 {
     PyObject *ret = NULL;
-    int db_ret;
-    DBC *cursor = NULL;
-    DBT key, data;
-    int key_size = Index_set_key(self, args, self->key_buffer);
-    if (key_size < 0) {
+    char *db_name = NULL;
+    char *data_name = NULL;
+    char *data_mode = NULL;
+    uint32_t flags = 0;
+    Py_ssize_t gigabyte = 1024 * 1024 * 1024;
+    uint32_t gigs, bytes;
+    uint64_t num_rows;
+    uint32_t f;
+    column_family_t *family;
+    int db_ret, mode;
+#ifdef WT_HAVE_BULK_PUT
+    DBT bulk;
+#endif
+    if (!PyArg_ParseTuple(args, "i", &mode)) {
         goto out;
     }
-    if (Index_check_read_mode(self) != 0) {
+    if (mode == WT_WRITE) {
+        flags = DB_CREATE|DB_TRUNCATE;
+        data_mode = "wb";
+    } else if (mode == WT_READ) {
+        flags = DB_RDONLY|DB_NOMMAP;
+        data_mode = "rb";
+    } else if (mode == WT_APPEND) {
+        /* open the existing files for writing, without truncating */
+        flags = 0;
+        data_mode = "r+b";
+    } else {
+        PyErr_Format(PyExc_ValueError,
+                "mode must be WT_READ, WT_WRITE or WT_APPEND.");
         goto out;
     }
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    if (self->db != NULL) {
+        PyErr_Format(WormtableError, "Table already open.");
         goto out;
     }
-    key.data = self->key_buffer;
-    key.size = (uint32_t) key_size;
-    db_ret = cursor->get(cursor, &key, &data, DB_SET_RANGE);
-    if (db_ret == 0) {
-        if (key_size > key.size) {
-            PyErr_Format(PyExc_SystemError, "key size comparison error.");
-            goto out;
-        }
-        if (memcmp(self->key_buffer, key.data, key_size) != 0) {
-            PyErr_SetObject(PyExc_KeyError, args);
-            goto out;
-        }
-        ret = Index_key_to_python(self, key.data, key.size);
-        if (ret == NULL) {
-            goto out;
-        }
-    } else {
-        handle_bdb_error(db_ret);
+    db_name = PyBytes_AsString(self->db_filename);
+    if (db_name == NULL) {
         goto out;
     }
-out:
-    if (cursor != NULL) {
-        cursor->close(cursor);
-    }
-    return ret;
-}
-
-
-static PyObject *
-Index_get_max(Index* self, PyObject *args)
-{
-    PyObject *ret = NULL;
-    int db_ret, key_size, cmp, overflow;
-    unsigned char *search_key = NULL;
-    DBC *cursor = NULL;
-    DBT key, data;
-    key_size = Index_set_key(self, args, self->key_buffer);
-    if (key_size < 0) {
+    /* Now we create the DB handle */
+    db_ret = db_create(&self->db, NULL, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
         goto out;
     }
-    if (Index_check_read_mode(self) != 0) {
+    gigs = (uint32_t) (self->cache_size / gigabyte);
+    bytes = (uint32_t) (self->cache_size % gigabyte);
+    db_ret = self->db->set_cachesize(self->db, gigs, bytes, 1);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
         goto out;
     }
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    /* Disable DB error messages */
+    self->db->set_errcall(self->db, NULL);
+    db_ret = self->db->open(self->db, NULL, db_name, NULL, DB_BTREE, flags,
+            WT_DB_FILE_PERMS);
     if (db_ret != 0) {
         handle_bdb_error(db_ret);
+        self->db->close(self->db, 0);
+        self->db = NULL;
         goto out;
     }
-    key.data = self->key_buffer;
-    key.size = (uint32_t) key_size;
-    if (key_size == 0) {
-        /* An empty list has been passed so we want the last value */
-        db_ret = cursor->get(cursor, &key, &data, DB_LAST);
-        if (db_ret != 0) {
-            handle_bdb_error(db_ret);
+    /* Now open the data file for each family */
+    for (f = 0; f < self->num_families; f++) {
+        family = &self->families[f];
+        data_name = PyBytes_AsString(family->data_filename);
+        if (data_name == NULL) {
             goto out;
         }
-    } else {
-        search_key = PyMem_Malloc(key_size + 1);
-        if (search_key == NULL) {
-            PyErr_NoMemory();
+        family->data_file = fopen(data_name, data_mode);
+        if (family->data_file == NULL) {
+            handle_io_error();
             goto out;
         }
-        memcpy(search_key, self->key_buffer, key_size);
-        overflow = Index_increment_key(self, self->key_buffer, key_size);
-        /* Seek to the first key prefix >= to this */
-        db_ret = cursor->get(cursor, &key, &data, DB_SET_RANGE);
-        /* If this is not found, we want the last key in the index */
-        if (db_ret == DB_NOTFOUND || overflow) {
-            db_ret = cursor->get(cursor, &key, &data, DB_LAST);
-            if (db_ret != 0) {
-                handle_bdb_error(db_ret);
+        if (setvbuf(family->data_file, NULL, _IOFBF, 1024 * 1024) != 0) {
+            handle_io_error();
+            goto out;
+        }
+        /* new rows are written at the end of the data file */
+        if (mode == WT_APPEND
+                && fseeko(family->data_file, 0, SEEK_END) != 0) {
+            handle_io_error();
+            goto out;
+        }
+    }
+    if (mode == WT_APPEND || (mode == WT_READ && self->dense_rows)) {
+        /* row ids continue from the last row in the table */
+        if (Table_read_num_rows(self, &num_rows) != 0) {
+            goto out;
+        }
+        self->num_rows = num_rows;
+    }
+    if (self->compressed_rows) {
+        if (Table_open_compressor(self, mode) != 0) {
+            goto out;
+        }
+    }
+    if (mode == WT_APPEND && self->dense_rows) {
+        /* overwrite any partly written row at the end of the data files */
+        for (f = 0; f < self->num_families; f++) {
+            if (fseeko(self->families[f].data_file, (off_t) (num_rows
+                        * Table_get_dense_row_size(self, f)), SEEK_SET) != 0) {
+                handle_io_error();
                 goto out;
             }
-        } else if (db_ret == 0) {
-           /* We need to seek backwards from here until the prefix matches
-            * the provided key.
-            */
-            do {
-                db_ret = cursor->get(cursor, &key, &data, DB_PREV);
-                if (db_ret != 0) {
-                    handle_bdb_error(db_ret);
-                    goto out;
-                }
-                cmp = memcmp(search_key, key.data, key_size);
-                if (cmp > 0) {
-                    PyErr_SetObject(PyExc_KeyError, args);
-                    goto out;
-                }
-            } while (cmp != 0);
-        } else {
-            handle_bdb_error(db_ret);
+        }
+    }
+#ifdef WT_HAVE_BULK_PUT
+    if (mode != WT_READ) {
+        self->bulk_buffer = PyMem_Malloc(WT_PRIMARY_BULK_SIZE);
+        if (self->bulk_buffer == NULL) {
+            PyErr_NoMemory();
             goto out;
         }
+        memset(&bulk, 0, sizeof(DBT));
+        bulk.data = self->bulk_buffer;
+        bulk.ulen = WT_PRIMARY_BULK_SIZE;
+        DB_MULTIPLE_WRITE_INIT(self->bulk_pointer, &bulk);
+        self->num_bulk_records = 0;
     }
-    ret = Index_key_to_python(self, key.data, key.size);
+#endif
+
+    Py_INCREF(Py_None);
+    ret = Py_None;
 out:
-    if (cursor != NULL) {
-        cursor->close(cursor);
-    }
-    if (search_key != NULL) {
-        PyMem_Free(search_key);
-    }
     return ret;
 }
 
+
 static PyObject *
-Index_set_bin_widths(Index* self, PyObject *args)
+Table_close(Table* self)
 {
-    Column* col = NULL;
     PyObject *ret = NULL;
-    PyObject *w = NULL;
-    unsigned int j;
-    PyObject *bin_widths = NULL;
-    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &bin_widths)) {
+    int db_ret, io_ret, writer_ret, err;
+    int dictionary_ret = 0;
+    int error_kind = 0;
+    uint32_t f;
+    DB *db = self->db;
+    if (db == NULL) {
+        PyErr_SetString(WormtableError, "table closed");
         goto out;
     }
-    if (Table_check_read_mode(self->table) != 0) {
+    /* the queued rows must be written before we close the files */
+    writer_ret = Table_stop_writer(self);
+    if (writer_ret == 0 && self->bulk_buffer != NULL) {
+        error_kind = Table_flush_records(self, &err);
+        if (error_kind != 0) {
+            handle_write_error(error_kind, err);
+            writer_ret = -1;
+        }
+    }
+    PyMem_Free(self->bulk_buffer);
+    self->bulk_buffer = NULL;
+    db_ret = db->close(db, 0);
+    self->db = NULL;
+    io_ret = 0;
+    for (f = 0; f < self->num_families; f++) {
+        if (self->families[f].data_file != NULL) {
+            if (fclose(self->families[f].data_file) != 0 && io_ret == 0) {
+                io_ret = errno;
+            }
+            self->families[f].data_file = NULL;
+        }
+    }
+    if (self->compressor != NULL) {
+        if (writer_ret == 0 && self->compressor->writing) {
+            dictionary_ret = Table_write_dictionaries(self);
+        }
+        Table_free_compressor(self);
+    }
+    if (writer_ret != 0) {
         goto out;
     }
-    if (self->db != NULL) {
-        PyErr_Format(WormtableError, "Cannot set bin_widths after open()");
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
         goto out;
     }
-    if (PyList_GET_SIZE(bin_widths) != self->num_columns) {
-        PyErr_Format(PyExc_ValueError,
-                "Number of bins must equal to the number of columns");
+    if (io_ret != 0) {
+        errno = io_ret;
+        handle_io_error();
         goto out;
     }
-    for (j = 0; j < PyList_GET_SIZE(bin_widths); j++) {
-        w = PyList_GET_ITEM(bin_widths, j);
-        col = self->table->columns[self->columns[j]];
-        if (!PyNumber_Check(w)) {
-            PyErr_Format(PyExc_TypeError,
-                    "Bad bin width for '%s': bin widths must be numeric",
-                    PyBytes_AsString(col->name));
-            goto out;
-        }
-        self->bin_widths[j] = PyFloat_AsDouble(w);
-        if (PyErr_Occurred()) {
-            goto out;
-        }
-        if (self->bin_widths[j] < 0.0) {
-            PyErr_Format(PyExc_ValueError,
-                    "Bad bin width for '%s': bin widths must be nonnegative",
-                    PyBytes_AsString(col->name));
-            goto out;
-        }
-        if (col->element_type == WT_CHAR
-                && self->bin_widths[j] != 0.0) {
-            PyErr_Format(PyExc_ValueError,
-                    "Bad bin width for '%s': char columns do not support bins",
-                    PyBytes_AsString(col->name));
-            goto out;
-        }
-        if (col->element_type == WT_INT) {
-            if (fmod(self->bin_widths[j], 1.0) != 0.0) {
-                PyErr_Format(PyExc_ValueError,
-                        "Bad bin width for '%s': "
-                        "integer column bins must be integers",
-                        PyBytes_AsString(col->name));
-                goto out;
-            }
-        }
+    if (dictionary_ret != 0) {
+        goto out;
     }
     Py_INCREF(Py_None);
     ret = Py_None;
@@ -3318,196 +5674,5721 @@ out:
     return ret;
 }
 
+
+/*
+ * Starts a background thread to write committed rows to the data file and
+ * primary DB, so that encoding rows overlaps with I/O. Committed rows are
+ * copied into a bounded queue of approximately the specified size; errors
+ * in the writer thread are raised at the next commit or when the table is
+ * closed. Where threads are not supported rows are written synchronously.
+ */
 static PyObject *
-Index_build(Index* self, PyObject *args)
+Table_start_writer(Table* self, PyObject *args)
 {
+    PyObject *ret = NULL;
+    table_writer_t *w = NULL;
+    unsigned long long queue_size;
+    int j;
+    if (!PyArg_ParseTuple(args, "K", &queue_size)) {
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (self->writer != NULL) {
+        PyErr_Format(WormtableError, "Writer already started.");
+        goto out;
+    }
+#ifdef WT_HAVE_WRITER_THREAD
+    w = PyMem_Malloc(sizeof(table_writer_t));
+    if (w == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(w, 0, sizeof(table_writer_t));
+    w->key_size = self->columns[0]->element_size;
+    w->block_size = (size_t) (queue_size / WT_WRITE_QUEUE_BLOCKS);
+    if (w->block_size < WT_WRITE_MIN_BLOCK_SIZE) {
+        w->block_size = WT_WRITE_MIN_BLOCK_SIZE;
+    }
+    for (j = 0; j < WT_WRITE_QUEUE_BLOCKS; j++) {
+        w->blocks[j].data = PyMem_Malloc(w->block_size);
+        if (w->blocks[j].data == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        w->blocks[j].capacity = w->block_size;
+    }
+    if (pthread_mutex_init(&w->mutex, NULL) != 0) {
+        PyErr_SetString(WormtableError, "Cannot create writer mutex");
+        goto out;
+    }
+    if (pthread_cond_init(&w->cond, NULL) != 0) {
+        pthread_mutex_destroy(&w->mutex);
+        PyErr_SetString(WormtableError, "Cannot create writer condition");
+        goto out;
+    }
+    self->writer = w;
+    if (pthread_create(&w->thread, NULL, Table_writer_run, self) != 0) {
+        self->writer = NULL;
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->mutex);
+        PyErr_SetString(WormtableError, "Cannot start writer thread");
+        goto out;
+    }
+    w = NULL;
+#endif
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    table_writer_free(w);
+    return ret;
+}
+
+/*
+ * Inserts the values in the element buffer of the specified column into
+ * the row of the column's family in the row buffer. Returns 0 on success
+ * or -1 with the appropriate Python exception set.
+ */
+static int
+Table_update_column(Table *self, Column *col)
+{
+    int ret = -1;
+    column_family_t *family = &self->families[col->family];
+    uint32_t size = family->current_row_size + Column_get_update_size(col);
+    int m;
+    /* rows larger than the column's limit are rejected by Column_update_row */
+    if (size <= col->max_row_size
+            && Table_reserve_row_buffer(self, size) != 0) {
+        goto out;
+    }
+    m = Column_update_row(col, self->row_buffer, family->current_row_size);
+    if (m < 0) {
+        goto out;
+    }
+    family->current_row_size += (uint32_t) m;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Encodes the specified Python elements for the specified column into the
+ * row buffer.
+ */
+static int
+Table_insert_python_elements(Table* self, int col_index, PyObject *elements)
+{
+    int ret = -1;
+    Column *col = NULL;
+    int wt_ret;
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (col_index == 0) {
+        PyErr_Format(WormtableError, "Cannot update ID col.");
+        goto out;
+    }
+    col = self->columns[col_index];
+    wt_ret = col->python_to_native(col, elements);
+    if (wt_ret < 0) {
+        goto out;
+    }
+    if (wt_ret != WT_MISSING_VALUE) {
+        if (Table_update_column(self, col) != 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Encodes the specified bytes value for the specified column into the
+ * row buffer.
+ */
+static int
+Table_insert_string_elements(Table* self, int col_index, PyObject *value)
+{
+    int ret = -1;
+    Column *column = NULL;
+    char *v;
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (col_index == 0) {
+        PyErr_Format(WormtableError, "Cannot update ID column.");
+        goto out;
+    }
+    column = self->columns[col_index];
+    v = PyBytes_AsString(value);
+    if (v == NULL) {
+        goto out;
+    }
+    if (column->string_to_native(column, v) < 0) {
+        goto out;
+    }
+    if (Table_update_column(self, column) != 0) {
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_insert_elements(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *elements = NULL;
+    int col_index;
+    if (!PyArg_ParseTuple(args, "iO", &col_index, &elements)) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (col_index == 0) {
+        PyErr_Format(WormtableError, "Cannot update ID col.");
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_insert_python_elements(self, col_index, elements) != 0) {
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_insert_encoded_elements(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *value = NULL;
+    int col_index;
+    if (!PyArg_ParseTuple(args, "iO!", &col_index, &PyBytes_Type,
+            &value)) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (col_index == 0) {
+        PyErr_Format(WormtableError, "Cannot update ID column.");
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_insert_string_elements(self, col_index, value) != 0) {
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static void
+Table_update_row_stats(Table *self, uint32_t row_size)
+{
+    self->total_row_size += row_size;
+    if (row_size < self->min_row_size) {
+        self->min_row_size = row_size;
+    }
+    if (row_size > self->max_row_size) {
+        self->max_row_size = row_size;
+    }
+}
+
+/*
+ * Reads the offset and length of the row of the specified family from the
+ * specified primary DB record.
+ */
+static void
+Table_unpack_record(Table *self, void *record, uint32_t family,
+        uint64_t *offset, uint32_t *len)
+{
+    uint32_t entry_size = self->record_size / self->num_families;
+    char *v = (char *) record + family * entry_size;
+    *offset = unpack_uint(v, sizeof(uint64_t));
+    *len = (uint32_t) unpack_uint(v + sizeof(uint64_t),
+            (uint8_t) (entry_size - sizeof(uint64_t)));
+}
+
+/*
+ * Checks the stored length of a row of the specified family read from the
+ * primary DB. Rows of families with columns always hold at least their
+ * fixed region, so a length smaller than this (and, in particular, a
+ * length of 0) indicates a corrupt record. Compressed rows may be longer
+ * than the largest row by their marker byte, but cannot be checked against
+ * the fixed region until they are expanded.
+ */
+static int
+Table_check_row_length(Table *self, uint32_t family, uint32_t len)
+{
+    int ret = -1;
+    uint32_t start = family == 0 ? self->columns[0]->element_size : 0;
+    uint32_t min_len = self->families[family].fixed_region_size - start;
+    uint32_t max_len = max_row_size((unsigned int) self->address_size)
+        - start;
+    if (self->compressor != NULL) {
+        max_len++;
+        min_len = min_len > 0;
+    }
+    if (len > max_len) {
+        PyErr_Format(PyExc_SystemError, "Row overflow");
+        goto out;
+    }
+    if (len < min_len) {
+        PyErr_Format(PyExc_SystemError, "Row underflow");
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Returns the set of column families holding the specified columns, as a
+ * bitmap suitable for Table_retrieve_row. The row_id column is stored in
+ * the key, and so does not require any family to be read.
+ */
+static uint32_t
+Table_get_families(Table *self, uint32_t *columns, uint32_t num_columns)
+{
+    uint32_t j;
+    uint32_t families = 0;
+    for (j = 0; j < num_columns; j++) {
+        if (columns[j] != 0) {
+            families |= 1U << self->columns[columns[j]]->family;
+        }
+    }
+    return families;
+}
+
+/* Retrieves the row from the data files identified by data into the
+ * row buffer such that it is ready for reading. Also copy the specified
+ * key into the buffer so that we can read the col_id column also. Only
+ * the rows of the column families in the specified bitmap are read, and
+ * the values of columns in other families must not be used.
+ */
+static int
+Table_retrieve_row(Table *self, DBT *key, DBT *data, uint32_t families)
+{
+    int ret = -1;
+    char *v;
+    Column *id_col = self->columns[0];
+    uint32_t key_size = id_col->element_size;
+    uint32_t f, start;
+    uint64_t offset = 0;
+    uint32_t len = 0;
+    FILE *data_file;
+    unsigned char *stored;
+
+    if (key->size != key_size) {
+        PyErr_Format(PyExc_SystemError, "table key record size mismatch");
+        goto out;
+    }
+    if (data->size != self->record_size) {
+        PyErr_Format(PyExc_SystemError, "offset/len record size mismatch");
+        goto out;
+    }
+    memcpy(self->row_buffer, key->data, key->size);
+    for (f = 0; f < self->num_families; f++) {
+        if (!(families & (1U << f))) {
+            continue;
+        }
+        Table_unpack_record(self, data->data, f, &offset, &len);
+        /* the key is stored at the start of the row of family 0 */
+        start = f == 0 ? key_size : 0;
+        if (Table_check_row_length(self, f, len) != 0) {
+            goto out;
+        }
+        if (len == 0) {
+            continue;
+        }
+        /* Now read this record from the file and put it in the row buffer */
+        data_file = self->families[f].data_file;
+        if (fseeko(data_file, (off_t) offset, SEEK_SET) != 0) {
+            handle_io_error();
+            goto out;
+        }
+        if (self->compressor != NULL) {
+            if (Table_reserve_compressor_buffer(self, len - 1) != 0) {
+                goto out;
+            }
+            stored = self->compressor->buffer;
+            if (fread(stored, len, 1, data_file) != 1) {
+                handle_io_error();
+                goto out;
+            }
+            if (Table_expand_row(self, f, stored, len) != 0) {
+                goto out;
+            }
+        } else {
+            if (Table_reserve_row_buffer(self, start + len) != 0) {
+                goto out;
+            }
+            v = (char *) self->row_buffer
+                + (size_t) f * self->row_buffer_size + start;
+            if (fread(v, len, 1, data_file) != 1) {
+                handle_io_error();
+                goto out;
+            }
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static int
+Table_retrieve_row_by_id(Table *self, uint64_t row_id, uint32_t families)
+{
+    int ret = -1;
+    int db_ret;
+    unsigned char key_buffer[sizeof(row_id)];
+    Column *id_col = self->columns[0];
+    DBT key, data;
+
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    key.data = key_buffer;
+    key.size = id_col->element_size;
+    if (Column_set_row_id(id_col, row_id) != 0) {
+        goto out;
+    }
+    if (Column_update_row(id_col, key_buffer, 0) != 0) {
+        goto out;
+    }
+    db_ret = Table_get_record(self, &key, &data);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    ret = Table_retrieve_row(self, &key, &data, families);
+out:
+    return ret;
+}
+
+/*
+ * Returns a tuple containing the values of the specified columns in the
+ * row currently in the table's row buffer.
+ */
+static PyObject *
+Table_get_python_row(Table *self, uint32_t *columns, uint32_t num_columns)
+{
+    PyObject *ret = NULL;
+    PyObject *t = NULL;
+    PyObject *value;
+    Column *col;
+    uint32_t j;
+    int wt_ret;
+
+    t = PyTuple_New(num_columns);
+    if (t == NULL) {
+        goto out;
+    }
+    for (j = 0; j < num_columns; j++) {
+        col = self->columns[columns[j]];
+        wt_ret = Column_extract_elements(col, self->row_buffer);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        value = Column_get_python_elements(col, wt_ret == WT_MISSING_VALUE);
+        if (value == NULL) {
+            goto out;
+        }
+        PyTuple_SET_ITEM(t, j, value);
+    }
+    ret = t;
+    t = NULL;
+out:
+    Py_XDECREF(t);
+    return ret;
+}
+
+/*
+ * Writes the specified encoded row data for each column family (the row
+ * of family 0 without its row_id) to the table with the next row id. If
+ * the writer thread is running, the row is queued and written in the
+ * background.
+ */
+static int
+Table_store_row(Table* self, void **rows, uint32_t *lens)
+{
+    int ret = -1;
+    int error_kind;
+    int err = 0;
+    uint32_t f, len;
+    unsigned char key_buffer[sizeof(uint64_t)];
+    void *stored_rows[WT_MAX_FAMILIES];
+    uint32_t stored_lens[WT_MAX_FAMILIES];
+    void **out_rows = rows;
+    uint32_t *out_lens = lens;
+    Column *id_col = self->columns[0];
+    uint32_t key_size = id_col->element_size;
+    if (self->dense_rows) {
+        for (f = 0; f < self->num_families; f++) {
+            if (lens[f] != Table_get_dense_row_size(self, f)) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Row size does not match the dense row size");
+                goto out;
+            }
+        }
+    }
+    if (Column_set_row_id(id_col, (uint64_t) self->num_rows) != 0) {
+        goto out;
+    }
+    if (Column_update_row(id_col, key_buffer, 0) != 0) {
+        goto out;
+    }
+    if (self->compressor != NULL) {
+        if (Table_compress_rows(self, rows, lens, stored_rows, stored_lens)
+                != 0) {
+            goto out;
+        }
+        out_rows = stored_rows;
+        out_lens = stored_lens;
+    }
+    /* the stored lengths must fit in the length fields of the record */
+    for (f = 0; f < self->num_families; f++) {
+        if (self->address_size == WT_DEFAULT_ADDRESS_SIZE
+                && out_lens[f] > WT_MAX_STORED_ROW_SIZE) {
+            PyErr_SetString(PyExc_ValueError, "Row overflow");
+            goto out;
+        }
+    }
+#ifdef WT_HAVE_WRITER_THREAD
+    if (self->writer != NULL) {
+        if (Table_queue_record(self, key_buffer, out_rows, out_lens) != 0) {
+            goto out;
+        }
+    } else
+#endif
+    {
+        error_kind = Table_write_record(self, key_buffer, key_size, out_rows,
+                out_lens, &err);
+        if (error_kind != 0) {
+            handle_write_error(error_kind, err);
+            goto out;
+        }
+    }
+    len = 0;
+    for (f = 0; f < self->num_families; f++) {
+        len += lens[f];
+    }
+    self->num_rows++;
+    Table_update_row_stats(self, len);
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Discards the contents of the row buffer.
+ */
+static void
+Table_reset_row(Table* self)
+{
+    uint32_t f;
+    column_family_t *family;
+    char *row;
+    for (f = 0; f < self->num_families; f++) {
+        family = &self->families[f];
+        row = (char *) self->row_buffer + (size_t) f * self->row_buffer_size;
+        memset(row, 0, family->current_row_size);
+        if (family->missing_row != NULL) {
+            memcpy(row, family->missing_row, family->fixed_region_size);
+        }
+        family->current_row_size = family->fixed_region_size;
+    }
+}
+
+/*
+ * Sets rows and lens to the encoded row of each column family in the row
+ * buffer, leaving out the row_id at the start of family 0.
+ */
+static void
+Table_get_family_rows(Table *self, void **rows, uint32_t *lens)
+{
+    uint32_t f;
+    uint32_t key_size = self->columns[0]->element_size;
+    for (f = 0; f < self->num_families; f++) {
+        rows[f] = (char *) self->row_buffer
+            + (size_t) f * self->row_buffer_size;
+        lens[f] = self->families[f].current_row_size;
+    }
+    rows[0] = (char *) rows[0] + key_size;
+    lens[0] -= key_size;
+}
+
+/*
+ * Writes the row in the row buffer to the table with the next row id,
+ * and resets the row buffer.
+ */
+static int
+Table_write_row(Table* self)
+{
+    int ret = -1;
+    void *rows[WT_MAX_FAMILIES];
+    uint32_t lens[WT_MAX_FAMILIES];
+    Table_get_family_rows(self, rows, lens);
+    if (Table_store_row(self, rows, lens) != 0) {
+        goto out;
+    }
+    Table_reset_row(self);
+    ret = 0;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_commit_row(Table* self)
+{
+    PyObject *ret = NULL;
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_write_row(self) != 0) {
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+/*
+ * Encodes and commits each row in the specified sequence of rows. Each row
+ * is a sequence of values, one for each column starting from the row_id
+ * column; values that are None are missing. If encoded is true, values
+ * must be bytes in the format accepted by insert_encoded_elements;
+ * otherwise they are Python values as accepted by insert_elements.
+ */
+static PyObject *
+Table_append_rows(Table* self, PyObject *rows, int encoded)
+{
+    PyObject *ret = NULL;
+    PyObject *seq = NULL;
+    PyObject *row = NULL;
+    PyObject *value;
+    Py_ssize_t j, k, num_rows, num_values;
+    int err;
+
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    seq = PySequence_Fast(rows, "rows must be a sequence");
+    if (seq == NULL) {
+        goto out;
+    }
+    num_rows = PySequence_Fast_GET_SIZE(seq);
+    for (j = 0; j < num_rows; j++) {
+        row = PySequence_Fast(PySequence_Fast_GET_ITEM(seq, j),
+                "rows must be sequences");
+        if (row == NULL) {
+            goto out;
+        }
+        num_values = PySequence_Fast_GET_SIZE(row);
+        for (k = 0; k < num_values; k++) {
+            value = PySequence_Fast_GET_ITEM(row, k);
+            if (value != Py_None) {
+                if (encoded) {
+                    err = Table_insert_string_elements(self, (int) k, value);
+                } else {
+                    err = Table_insert_python_elements(self, (int) k, value);
+                }
+                if (err != 0) {
+                    /* discard the partially encoded row */
+                    Table_reset_row(self);
+                    goto out;
+                }
+            }
+        }
+        Py_DECREF(row);
+        row = NULL;
+        if (Table_write_row(self) != 0) {
+            goto out;
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    Py_XDECREF(row);
+    Py_XDECREF(seq);
+    return ret;
+}
+
+static PyObject *
+Table_append_many(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *rows = NULL;
+    if (!PyArg_ParseTuple(args, "O", &rows)) {
+        goto out;
+    }
+    ret = Table_append_rows(self, rows, 0);
+out:
+    return ret;
+}
+
+static PyObject *
+Table_append_encoded_many(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *rows = NULL;
+    if (!PyArg_ParseTuple(args, "O", &rows)) {
+        goto out;
+    }
+    ret = Table_append_rows(self, rows, 1);
+out:
+    return ret;
+}
+
+/*
+ * Buffers supplying the values for a single column in append_buffers.
+ */
+typedef struct {
+    Column *column;
+    Py_buffer values;
+    Py_buffer missing;
+    Py_buffer offsets;
+    size_t native_size;
+    Py_ssize_t num_values;
+} column_buffers_t;
+
+/*
+ * Returns 1 if the format of the specified buffer is a single native-order
+ * item with one of the specified struct codes and the specified item size,
+ * and 0 otherwise.
+ */
+static int
+buffer_format_matches(Py_buffer *view, const char *codes, Py_ssize_t itemsize)
+{
+    const char *format = view->format == NULL ? "B" : view->format;
+    if (view->itemsize != itemsize) {
+        return 0;
+    }
+    if (*format == '@' || *format == '=') {
+        format++;
+#ifdef WORDS_BIGENDIAN
+    } else if (*format == '>' || *format == '!') {
+        format++;
+#else
+    } else if (*format == '<') {
+        format++;
+#endif
+    }
+    if (itemsize == 1 && *format == '1') {
+        format++;
+    }
+    return *format != '\0' && format[1] == '\0'
+            && strchr(codes, *format) != NULL;
+}
+
+/*
+ * Acquires a C contiguous buffer with the specified format from the
+ * specified object. Returns 0 on success or -1 with the appropriate Python
+ * exception set.
+ */
+static int
+column_buffers_get(Column *col, PyObject *obj, Py_buffer *view,
+        const char *codes, Py_ssize_t itemsize, const char *what)
+{
+    int ret = -1;
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT)
+            != 0) {
+        goto out;
+    }
+    if (!buffer_format_matches(view, codes, itemsize)) {
+        PyErr_Format(PyExc_TypeError, "Bad %s buffer format for column '%s'",
+                what, PyBytes_AsString(col->name));
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Acquires the buffers specified in the (col_index, values, missing,
+ * offsets) tuple and checks them against the column. The number of rows
+ * described is stored in num_rows. Returns 0 on success or -1 with the
+ * appropriate Python exception set.
+ */
+static int
+Table_get_column_buffers(Table *self, PyObject *spec, column_buffers_t *cb,
+        Py_ssize_t *num_rows)
+{
+    int ret = -1;
+    int col_index;
+    Py_ssize_t j, n, max_elements;
+    int64_t *offsets;
+    PyObject *values = NULL;
+    PyObject *missing = NULL;
+    PyObject *offsets_obj = NULL;
+    Column *col;
+    const char *codes = NULL;
+
+    if (!PyArg_ParseTuple(spec, "iOOO", &col_index, &values, &missing,
+                &offsets_obj)) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (col_index == 0) {
+        PyErr_Format(WormtableError, "Cannot update ID column.");
+        goto out;
+    }
+    col = self->columns[col_index];
+    cb->column = col;
+    cb->native_size = sizeof(uint64_t);
+    if (col->element_type == WT_UINT) {
+        codes = "LQN";
+    } else if (col->element_type == WT_INT) {
+        codes = "lqn";
+    } else if (col->element_type == WT_FLOAT) {
+        codes = "d";
+    } else if (col->element_type == WT_DICT) {
+        PyErr_Format(PyExc_TypeError,
+                "Cannot append dictionary column '%s' from buffers",
+                PyBytes_AsString(col->name));
+        goto out;
+    } else if (col->element_type == WT_GENOTYPE) {
+        PyErr_Format(PyExc_TypeError,
+                "Cannot append genotype column '%s' from buffers",
+                PyBytes_AsString(col->name));
+        goto out;
+    } else {
+        codes = "cbBs";
+        cb->native_size = sizeof(char);
+    }
+    if (column_buffers_get(col, values, &cb->values, codes,
+                (Py_ssize_t) cb->native_size, "values") != 0) {
+        goto out;
+    }
+    cb->num_values = cb->values.len / cb->values.itemsize;
+    if (Column_is_variable(col)) {
+        if (offsets_obj == Py_None) {
+            PyErr_Format(PyExc_ValueError,
+                    "Offsets required for variable column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (column_buffers_get(col, offsets_obj, &cb->offsets, "lqn",
+                    sizeof(int64_t), "offsets") != 0) {
+            goto out;
+        }
+        n = cb->offsets.len / cb->offsets.itemsize;
+        if (n == 0) {
+            PyErr_Format(PyExc_ValueError, "Empty offsets for column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        offsets = (int64_t *) cb->offsets.buf;
+        max_elements = (Py_ssize_t) Column_get_max_num_elements(col);
+        if (offsets[0] < 0 || offsets[n - 1] > cb->num_values) {
+            PyErr_Format(PyExc_ValueError, "Offsets out of range for column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        for (j = 1; j < n; j++) {
+            if (offsets[j] < offsets[j - 1]
+                    || offsets[j] - offsets[j - 1] > max_elements) {
+                PyErr_Format(PyExc_ValueError,
+                        "Bad offsets for column '%s'",
+                        PyBytes_AsString(col->name));
+                goto out;
+            }
+        }
+        n--;
+    } else {
+        if (offsets_obj != Py_None) {
+            PyErr_Format(PyExc_ValueError,
+                    "Offsets given for fixed column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (cb->num_values % col->num_elements != 0) {
+            PyErr_Format(PyExc_ValueError,
+                    "Incorrect number of values for column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        n = cb->num_values / col->num_elements;
+    }
+    if (missing != Py_None) {
+        if (column_buffers_get(col, missing, &cb->missing, "?bB", 1,
+                    "missing") != 0) {
+            goto out;
+        }
+        if (cb->missing.len != n) {
+            PyErr_Format(PyExc_ValueError,
+                    "Incorrect missing mask length for column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+    }
+    if (*num_rows >= 0 && *num_rows != n) {
+        PyErr_Format(PyExc_ValueError,
+                "Incorrect number of rows for column '%s'",
+                PyBytes_AsString(col->name));
+        goto out;
+    }
+    *num_rows = n;
+    ret = 0;
+out:
+    return ret;
+}
+
+static void
+column_buffers_release(column_buffers_t *cb)
+{
+    if (cb->values.obj != NULL) {
+        PyBuffer_Release(&cb->values);
+    }
+    if (cb->missing.obj != NULL) {
+        PyBuffer_Release(&cb->missing);
+    }
+    if (cb->offsets.obj != NULL) {
+        PyBuffer_Release(&cb->offsets);
+    }
+}
+
+/*
+ * Copies the values of the specified row from the buffers to the element
+ * buffer of the column. Returns 0 if the column is missing in the row,
+ * and 1 otherwise.
+ */
+static int
+column_buffers_load(column_buffers_t *cb, Py_ssize_t row)
+{
+    Column *col = cb->column;
+    char *missing = (char *) cb->missing.buf;
+    int64_t *offsets;
+    Py_ssize_t start, count;
+    if (missing != NULL && missing[row] != 0) {
+        return 0;
+    }
+    if (Column_is_variable(col)) {
+        offsets = (int64_t *) cb->offsets.buf;
+        start = (Py_ssize_t) offsets[row];
+        count = (Py_ssize_t) (offsets[row + 1] - offsets[row]);
+    } else {
+        start = row * col->num_elements;
+        count = col->num_elements;
+    }
+    memcpy(col->element_buffer, (char *) cb->values.buf
+            + start * cb->native_size, count * cb->native_size);
+    col->num_buffered_elements = (int) count;
+    return 1;
+}
+
+/*
+ * Checks that the values in the specified column buffers are in range and
+ * that every row fits in the rows of its column families, so that
+ * append_buffers does not fail after some of the rows have been written.
+ */
+static int
+Table_check_column_buffers(Table *self, column_buffers_t *buffers,
+        Py_ssize_t num_columns, Py_ssize_t num_rows)
+{
+    int ret = -1;
+    uint32_t sizes[WT_MAX_FAMILIES];
+    uint32_t f;
+    Py_ssize_t j, k;
+    Column *col;
+    for (j = 0; j < num_rows; j++) {
+        for (f = 0; f < self->num_families; f++) {
+            sizes[f] = self->families[f].fixed_region_size;
+        }
+        for (k = 0; k < num_columns; k++) {
+            col = buffers[k].column;
+            if (!column_buffers_load(&buffers[k], j)) {
+                continue;
+            }
+            if (col->verify_elements(col) < 0) {
+                goto out;
+            }
+            sizes[col->family] += Column_get_update_size(col);
+            if (sizes[col->family] > col->max_row_size) {
+                PyErr_SetString(PyExc_ValueError, "Row overflow");
+                goto out;
+            }
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Appends rows taken column-wise from the buffers in the specified list of
+ * (col_index, values, missing, offsets) tuples. The values for each column
+ * must be in the column's native type (uint64, int64, double or char);
+ * missing is None or a byte mask, nonzero for rows where the column is
+ * missing; offsets is None for fixed length columns, and for variable
+ * length columns an int64 buffer of num_rows + 1 element offsets into
+ * values. The elements are packed directly from the buffers, so no Python
+ * objects are created per row. All of the rows are checked before any are
+ * written, so that out of range values leave the table unchanged.
+ */
+static PyObject *
+Table_append_buffers(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *columns = NULL;
+    PyObject *seq = NULL;
+    column_buffers_t *buffers = NULL;
+    Py_ssize_t j, k;
+    Py_ssize_t num_columns = 0;
+    Py_ssize_t num_rows = -1;
+
+    if (!PyArg_ParseTuple(args, "O", &columns)) {
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    seq = PySequence_Fast(columns, "columns must be a sequence");
+    if (seq == NULL) {
+        goto out;
+    }
+    num_columns = PySequence_Fast_GET_SIZE(seq);
+    buffers = PyMem_Malloc((num_columns + 1) * sizeof(column_buffers_t));
+    if (buffers == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(buffers, 0, (num_columns + 1) * sizeof(column_buffers_t));
+    for (k = 0; k < num_columns; k++) {
+        if (Table_get_column_buffers(self, PySequence_Fast_GET_ITEM(seq, k),
+                    &buffers[k], &num_rows) != 0) {
+            goto out;
+        }
+        for (j = 0; j < k; j++) {
+            if (buffers[j].column == buffers[k].column) {
+                PyErr_Format(PyExc_ValueError, "Duplicate column '%s'",
+                        PyBytes_AsString(buffers[k].column->name));
+                goto out;
+            }
+        }
+    }
+    if (Table_check_column_buffers(self, buffers, num_columns, num_rows)
+            != 0) {
+        goto out;
+    }
+    for (j = 0; j < num_rows; j++) {
+        for (k = 0; k < num_columns; k++) {
+            if (!column_buffers_load(&buffers[k], j)) {
+                continue;
+            }
+            if (Table_update_column(self, buffers[k].column) != 0) {
+                /* discard the partially encoded row */
+                Table_reset_row(self);
+                goto out;
+            }
+        }
+        if (Table_write_row(self) != 0) {
+            goto out;
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    if (buffers != NULL) {
+        for (k = 0; k < num_columns; k++) {
+            column_buffers_release(&buffers[k]);
+        }
+        PyMem_Free(buffers);
+    }
+    Py_XDECREF(seq);
+    return ret;
+}
+
+/*
+ * Sets the name of the specified field to the specified bytes object.
+ */
+static int
+vcf_field_set_name(vcf_field_t *field, PyObject *name)
+{
+    int ret = -1;
+    char *v;
+    Py_ssize_t length;
+    if (!PyBytes_Check(name)) {
+        PyErr_SetString(PyExc_TypeError, "VCF field names must be bytes");
+        goto out;
+    }
+    if (PyBytes_AsStringAndSize(name, &v, &length) != 0) {
+        goto out;
+    }
+    field->name = PyMem_Malloc(length + 1);
+    if (field->name == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memcpy(field->name, v, length + 1);
+    field->name_length = (size_t) length;
+    ret = 0;
+out:
+    return ret;
+}
+
+static int
+cmp_vcf_field(const void *a, const void *b)
+{
+    const vcf_field_t *fa = (const vcf_field_t *) a;
+    const vcf_field_t *fb = (const vcf_field_t *) b;
+    return compare_keys(fa->name, (uint32_t) fa->name_length, fb->name,
+            (uint32_t) fb->name_length);
+}
+
+/*
+ * Returns the field with the specified name in the sorted array of fields,
+ * or NULL if it does not exist.
+ */
+static vcf_field_t *
+vcf_field_find(vcf_field_t *fields, uint32_t num_fields, char *name,
+        size_t name_length)
+{
+    vcf_field_t search;
+    search.name = name;
+    search.name_length = name_length;
+    return (vcf_field_t *) bsearch(&search, fields, num_fields,
+            sizeof(vcf_field_t), cmp_vcf_field);
+}
+
+/*
+ * Returns the column index in the specified Python object, which must be
+ * -1 or refer to a column in the table other than the row_id.
+ */
+static int
+Table_parse_vcf_column(Table *self, PyObject *value, int *column)
+{
+    int ret = -1;
+    long v = PyLong_AsLong(value);
+    if (v == -1 && PyErr_Occurred()) {
+        goto out;
+    }
+    if (v != -1 && (v < 1 || v >= (long) self->num_columns)) {
+        PyErr_Format(WormtableError, "Column index out of range.");
+        goto out;
+    }
+    *column = (int) v;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Checks the columns for the specified FORMAT field and, if they are a
+ * genotype column, makes this the plan's genotype column. A genotype
+ * column holds the field for every sample, with sample j stored in
+ * element j.
+ */
+static int
+Table_set_vcf_genotype_column(Table *self, vcf_plan_t *plan,
+        vcf_field_t *field, uint32_t num_samples)
+{
+    int ret = -1;
+    int col = -1;
+    uint32_t k;
+    Column *column;
+
+    for (k = 0; k < num_samples; k++) {
+        if (field->columns[k] != -1 && self->columns[
+                field->columns[k]]->element_type == WT_GENOTYPE) {
+            col = field->columns[k];
+        }
+    }
+    if (col != -1) {
+        column = self->columns[col];
+        for (k = 0; k < num_samples; k++) {
+            if (field->columns[k] != col) {
+                PyErr_Format(PyExc_ValueError,
+                        "Genotype column '%s' must hold every sample",
+                        PyBytes_AsString(column->name));
+                goto out;
+            }
+        }
+        if ((uint32_t) column->num_elements != num_samples) {
+            PyErr_Format(PyExc_ValueError,
+                    "Genotype column '%s' must have one element for each "
+                    "sample", PyBytes_AsString(column->name));
+            goto out;
+        }
+        if (plan->genotype_column != -1 && plan->genotype_column != col) {
+            PyErr_SetString(PyExc_ValueError,
+                    "Only one genotype column can be read from a VCF");
+            goto out;
+        }
+        plan->genotype_column = col;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_set_vcf_plan(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *fixed = NULL;
+    PyObject *info = NULL;
+    PyObject *formats = NULL;
+    PyObject *key, *value, *v;
+    Py_ssize_t pos, num_samples;
+    uint32_t j, k;
+    int truncate;
+    vcf_plan_t *plan = NULL;
+    vcf_field_t *field;
+
+    if (!PyArg_ParseTuple(args, "O!O!O!i", &PyList_Type, &fixed,
+            &PyDict_Type, &info, &PyDict_Type, &formats, &truncate)) {
+        goto out;
+    }
+    if (PyList_GET_SIZE(fixed) != WT_VCF_NUM_FIXED_FIELDS) {
+        PyErr_Format(PyExc_ValueError, "%d fixed columns required",
+                WT_VCF_NUM_FIXED_FIELDS);
+        goto out;
+    }
+    plan = PyMem_Malloc(sizeof(vcf_plan_t));
+    if (plan == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(plan, 0, sizeof(vcf_plan_t));
+    plan->truncate = truncate;
+    plan->genotype_column = -1;
+    for (j = 0; j < WT_VCF_NUM_FIXED_FIELDS; j++) {
+        if (Table_parse_vcf_column(self, PyList_GET_ITEM(fixed, j),
+                &plan->fixed_columns[j]) != 0) {
+            goto out;
+        }
+    }
+    plan->info_fields = PyMem_Malloc((PyDict_Size(info) + 1)
+            * sizeof(vcf_field_t));
+    if (plan->info_fields == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    pos = 0;
+    while (PyDict_Next(info, &pos, &key, &value)) {
+        field = &plan->info_fields[plan->num_info_fields];
+        memset(field, 0, sizeof(vcf_field_t));
+        plan->num_info_fields++;
+        if (vcf_field_set_name(field, key) != 0) {
+            goto out;
+        }
+        field->columns = PyMem_Malloc(sizeof(int));
+        if (field->columns == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (Table_parse_vcf_column(self, value, field->columns) != 0) {
+            goto out;
+        }
+    }
+    plan->format_fields = PyMem_Malloc((PyDict_Size(formats) + 1)
+            * sizeof(vcf_field_t));
+    if (plan->format_fields == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    num_samples = -1;
+    pos = 0;
+    while (PyDict_Next(formats, &pos, &key, &value)) {
+        field = &plan->format_fields[plan->num_format_fields];
+        memset(field, 0, sizeof(vcf_field_t));
+        plan->num_format_fields++;
+        if (vcf_field_set_name(field, key) != 0) {
+            goto out;
+        }
+        if (!PyList_Check(value)) {
+            PyErr_SetString(PyExc_TypeError, "FORMAT columns must be a list");
+            goto out;
+        }
+        if (num_samples == -1) {
+            num_samples = PyList_GET_SIZE(value);
+        }
+        if (PyList_GET_SIZE(value) != num_samples) {
+            PyErr_SetString(PyExc_ValueError,
+                    "FORMAT columns must have the same number of samples");
+            goto out;
+        }
+        field->columns = PyMem_Malloc((num_samples + 1) * sizeof(int));
+        if (field->columns == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        for (k = 0; k < (uint32_t) num_samples; k++) {
+            v = PyList_GET_ITEM(value, k);
+            if (Table_parse_vcf_column(self, v, &field->columns[k]) != 0) {
+                goto out;
+            }
+        }
+        if (Table_set_vcf_genotype_column(self, plan, field,
+                    (uint32_t) num_samples) != 0) {
+            goto out;
+        }
+    }
+    plan->num_samples = num_samples == -1 ? 0 : (uint32_t) num_samples;
+    if (plan->genotype_column != -1) {
+        plan->genotype_calls = PyMem_Malloc((plan->num_samples + 1)
+                * sizeof(char *));
+        if (plan->genotype_calls == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+    }
+    qsort(plan->info_fields, plan->num_info_fields, sizeof(vcf_field_t),
+            cmp_vcf_field);
+    qsort(plan->format_fields, plan->num_format_fields, sizeof(vcf_field_t),
+            cmp_vcf_field);
+    plan->values = PyMem_Malloc(self->num_columns * sizeof(char *));
+    if (plan->values == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    vcf_plan_free(self->vcf_plan);
+    self->vcf_plan = plan;
+    plan = NULL;
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    vcf_plan_free(plan);
+    return ret;
+}
+
+/*
+ * Returns the next whitespace delimited token in the string at *s, and
+ * updates *s to point past it. The token is NUL terminated in place. If
+ * there are no more tokens NULL is returned.
+ */
+static char *
+vcf_next_token(char **s)
+{
+    char *p = *s;
+    char *token = NULL;
+    while (*p != '\0' && isspace((unsigned char) *p)) {
+        p++;
+    }
+    if (*p != '\0') {
+        token = p;
+        while (*p != '\0' && !isspace((unsigned char) *p)) {
+            p++;
+        }
+        if (*p != '\0') {
+            *p = '\0';
+            p++;
+        }
+    }
+    *s = p;
+    return token;
+}
+
+/*
+ * Returns 1 if the specified genotype value is missing.
+ */
+static int
+vcf_genotype_missing(char *s)
+{
+    return strcmp(s, ".") == 0 || strcmp(s, ".,.") == 0;
+}
+
+/*
+ * Returns the compiled plan for the specified FORMAT string, compiling it
+ * and replacing the least recently used plan in the cache if necessary.
+ * Returns NULL with an exception set on error.
+ */
+static vcf_format_plan_t *
+vcf_plan_get_format_plan(vcf_plan_t *plan, char *format)
+{
+    vcf_format_plan_t *ret = NULL;
+    vcf_format_plan_t *fp = NULL;
+    vcf_field_t *field;
+    size_t format_length = strlen(format);
+    size_t length;
+    uint32_t j, k, num_values;
+    char *s, *next;
+    int *columns;
+
+    plan->format_cache_clock++;
+    for (j = 0; j < WT_VCF_FORMAT_CACHE_SIZE; j++) {
+        fp = &plan->format_cache[j];
+        if (fp->format != NULL && fp->format_length == format_length
+                && memcmp(fp->format, format, format_length) == 0) {
+            fp->last_used = plan->format_cache_clock;
+            ret = fp;
+            goto out;
+        }
+    }
+    /* Not in the cache, so evict the least recently used plan */
+    fp = &plan->format_cache[0];
+    for (j = 1; j < WT_VCF_FORMAT_CACHE_SIZE; j++) {
+        if (plan->format_cache[j].last_used < fp->last_used) {
+            fp = &plan->format_cache[j];
+        }
+    }
+    PyMem_Free(fp->format);
+    PyMem_Free(fp->columns);
+    memset(fp, 0, sizeof(vcf_format_plan_t));
+    num_values = 1;
+    for (j = 0; j < format_length; j++) {
+        num_values += format[j] == ':';
+    }
+    fp->format = PyMem_Malloc(format_length + 1);
+    columns = PyMem_Malloc((plan->num_samples * num_values + 1)
+            * sizeof(int));
+    if (fp->format == NULL || columns == NULL) {
+        PyMem_Free(columns);
+        PyMem_Free(fp->format);
+        fp->format = NULL;
+        PyErr_NoMemory();
+        goto out;
+    }
+    s = format;
+    for (k = 0; k < num_values; k++) {
+        next = strchr(s, ':');
+        length = next == NULL ? strlen(s) : (size_t) (next - s);
+        field = vcf_field_find(plan->format_fields, plan->num_format_fields,
+                s, length);
+        for (j = 0; j < plan->num_samples; j++) {
+            columns[j * num_values + k] = field == NULL ? -1
+                    : field->columns[j];
+        }
+        if (next != NULL) {
+            s = next + 1;
+        }
+    }
+    memcpy(fp->format, format, format_length + 1);
+    fp->format_length = format_length;
+    fp->num_values = num_values;
+    fp->columns = columns;
+    fp->last_used = plan->format_cache_clock;
+    ret = fp;
+out:
+    return ret;
+}
+
+/*
+ * Parses the VCF line in the plan's line buffer and sets the values for
+ * each column in the plan.
+ */
+static int
+Table_parse_vcf_line(Table *self)
+{
+    int ret = -1;
+    static char flag_value[] = "1";
+    vcf_plan_t *plan = self->vcf_plan;
+    char *p = plan->line_buffer;
+    char *fields[WT_VCF_FORMAT_FIELD + 1];
+    char *s, *mapping, *eq, *next, *token;
+    vcf_field_t *field;
+    vcf_format_plan_t *fp;
+    uint32_t j, k, num_fields, num_tokens, sample;
+    int col;
+    int *columns;
+    size_t length;
+
+    memset(plan->values, 0, self->num_columns * sizeof(char *));
+    num_fields = 0;
+    while (num_fields <= WT_VCF_FORMAT_FIELD) {
+        fields[num_fields] = vcf_next_token(&p);
+        if (fields[num_fields] == NULL) {
+            break;
+        }
+        num_fields++;
+    }
+    if (num_fields <= WT_VCF_INFO_FIELD) {
+        PyErr_SetString(PyExc_ValueError, "VCF line has too few fields");
+        goto out;
+    }
+    /* The fixed fields are mapped directly */
+    for (j = 0; j < WT_VCF_NUM_FIXED_FIELDS; j++) {
+        col = plan->fixed_columns[j];
+        s = fields[j];
+        if (col != -1 && strcmp(s, ".") != 0) {
+            plan->values[col] = s;
+            if (plan->truncate && (j == WT_VCF_REF_FIELD
+                    || j == WT_VCF_ALT_FIELD)) {
+                length = strlen(s);
+                if (length > WT_VCF_MAX_TRUNCATED_LENGTH) {
+                    s[WT_VCF_MAX_TRUNCATED_LENGTH - 1] = '+';
+                    s[WT_VCF_MAX_TRUNCATED_LENGTH] = '\0';
+                }
+            }
+        }
+    }
+    /* INFO is a ; separated list of name=value pairs or flags */
+    mapping = fields[WT_VCF_INFO_FIELD];
+    while (mapping != NULL) {
+        next = strchr(mapping, ';');
+        if (next != NULL) {
+            *next = '\0';
+            next++;
+        }
+        eq = strchr(mapping, '=');
+        length = eq == NULL ? strlen(mapping) : (size_t) (eq - mapping);
+        field = vcf_field_find(plan->info_fields, plan->num_info_fields,
+                mapping, length);
+        if (field != NULL && field->columns[0] >= 0) {
+            if (eq != NULL && strchr(eq + 1, '=') == NULL) {
+                plan->values[field->columns[0]] = eq + 1;
+            } else {
+                plan->values[field->columns[0]] = flag_value;
+            }
+        }
+        mapping = next;
+    }
+    if (num_fields <= WT_VCF_FORMAT_FIELD || plan->num_format_fields == 0) {
+        ret = 0;
+        goto out;
+    }
+    fp = vcf_plan_get_format_plan(plan, fields[WT_VCF_FORMAT_FIELD]);
+    if (fp == NULL) {
+        goto out;
+    }
+    if (plan->genotype_calls != NULL) {
+        memset(plan->genotype_calls, 0, plan->num_samples * sizeof(char *));
+    }
+    /* Samples are : separated lists of values in the FORMAT order */
+    sample = 0;
+    while ((s = vcf_next_token(&p)) != NULL) {
+        if (sample >= plan->num_samples) {
+            PyErr_SetString(PyExc_ValueError,
+                    "VCF line has more samples than the header");
+            goto out;
+        }
+        num_tokens = 1;
+        for (j = 0; s[j] != '\0'; j++) {
+            num_tokens += s[j] == ':';
+        }
+        /* samples with a different number of values are skipped */
+        if (num_tokens == fp->num_values) {
+            columns = fp->columns + sample * fp->num_values;
+            for (k = 0; k < fp->num_values; k++) {
+                token = s;
+                next = strchr(s, ':');
+                if (next != NULL) {
+                    *next = '\0';
+                    s = next + 1;
+                }
+                col = columns[k];
+                if (col != -1 && !vcf_genotype_missing(token)) {
+                    plan->values[col] = token;
+                    if (col == plan->genotype_column) {
+                        plan->genotype_calls[sample] = token;
+                    }
+                }
+            }
+        }
+        sample++;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Copies the specified VCF line into the line buffer and splits it into
+ * the values for each column in the plan.
+ */
+static int
+Table_read_vcf_line(Table* self, PyObject *value)
+{
+    int ret = -1;
+    vcf_plan_t *plan = self->vcf_plan;
+    char *line, *buffer;
+    Py_ssize_t length;
+
+    if (plan == NULL) {
+        PyErr_SetString(WormtableError, "VCF plan not set");
+        goto out;
+    }
+    if (!PyBytes_Check(value)) {
+        PyErr_SetString(PyExc_TypeError, "VCF lines must be bytes");
+        goto out;
+    }
+    if (PyBytes_AsStringAndSize(value, &line, &length) != 0) {
+        goto out;
+    }
+    if ((size_t) length + 1 > plan->line_buffer_size) {
+        buffer = PyMem_Realloc(plan->line_buffer, length + 1);
+        if (buffer == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        plan->line_buffer = buffer;
+        plan->line_buffer_size = length + 1;
+    }
+    memcpy(plan->line_buffer, line, length);
+    plan->line_buffer[length] = '\0';
+    ret = Table_parse_vcf_line(self);
+out:
+    return ret;
+}
+
+/*
+ * Parses the calls for each sample in the last VCF line read into the
+ * element buffer of the plan's genotype column.
+ */
+static int
+Table_parse_vcf_genotypes(Table *self)
+{
+    int ret = -1;
+    vcf_plan_t *plan = self->vcf_plan;
+    Column *column = self->columns[plan->genotype_column];
+    char *call;
+    uint32_t j;
+
+    Column_clear_genotypes(column);
+    for (j = 0; j < plan->num_samples; j++) {
+        call = plan->genotype_calls[j];
+        if (call != NULL) {
+            if (Column_set_genotype(column, j, call, strlen(call)) != 0) {
+                goto out;
+            }
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Parses the specified VCF line and encodes its values into the row buffer.
+ * If an error occurs the row buffer is reset.
+ */
+static int
+Table_encode_vcf_line(Table* self, PyObject *value)
+{
+    int ret = -1;
+    vcf_plan_t *plan = self->vcf_plan;
+    Column *column;
+    uint32_t j;
+
+    if (Table_read_vcf_line(self, value) != 0) {
+        goto error;
+    }
+    for (j = 1; j < self->num_columns; j++) {
+        if (plan->values[j] != NULL) {
+            column = self->columns[j];
+            if ((int) j == plan->genotype_column) {
+                if (Table_parse_vcf_genotypes(self) != 0) {
+                    goto error;
+                }
+            } else if (column->string_to_native(column, plan->values[j]) < 0) {
+                goto error;
+            }
+            if (Table_update_column(self, column) != 0) {
+                goto error;
+            }
+        }
+    }
+    ret = 0;
+    goto out;
+error:
+    /* discard the partially encoded row */
+    Table_reset_row(self);
+out:
+    return ret;
+}
+
+static PyObject *
+Table_append_vcf_line(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *value = NULL;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyBytes_Type, &value)) {
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_encode_vcf_line(self, value) != 0) {
+        goto out;
+    }
+    if (Table_write_row(self) != 0) {
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+/*
+ * Updates the profile for the specified column with the specified VCF
+ * value. Numeric values are parsed into the column's element buffer, and
+ * char values are profiled directly so that strings of any length can be
+ * measured.
+ */
+static int
+Table_profile_value(Table *self, uint32_t col_index, char *value)
+{
+    int ret = -1;
+    Column *col = self->columns[col_index];
+    column_profile_t *p = &self->profiles[col_index];
+    uint64_t *uint_elements = (uint64_t *) col->element_buffer;
+    int64_t *int_elements = (int64_t *) col->element_buffer;
+    uint32_t j, num_elements, code;
+    size_t size;
+    char *data;
+    int wt_ret;
+
+    if (col->element_type == WT_CHAR) {
+        size = strlen(value);
+        num_elements = (uint32_t) size;
+        data = value;
+        if (!p->too_many_distinct) {
+            if (p->distinct.values == NULL) {
+                if (dictionary_init(&p->distinct,
+                            WT_PROFILE_MAX_DISTINCT) != 0) {
+                    goto out;
+                }
+            }
+            wt_ret = dictionary_get_code(&p->distinct, value, size, 1, &code);
+            if (wt_ret < 0) {
+                goto out;
+            }
+            if (wt_ret == 1) {
+                p->too_many_distinct = 1;
+                dictionary_free(&p->distinct);
+            }
+        }
+    } else {
+        if (col->string_to_native(col, value) < 0) {
+            goto out;
+        }
+        num_elements = (uint32_t) col->num_buffered_elements;
+        size = num_elements * sizeof(uint64_t);
+        data = (char *) col->element_buffer;
+    }
+    for (j = 0; j < num_elements; j++) {
+        if (col->element_type == WT_UINT) {
+            if (uint_elements[j] < p->min_uint) {
+                p->min_uint = uint_elements[j];
+            }
+            if (uint_elements[j] > p->max_uint) {
+                p->max_uint = uint_elements[j];
+            }
+        } else if (col->element_type == WT_INT) {
+            if (int_elements[j] < p->min_int) {
+                p->min_int = int_elements[j];
+            }
+            if (int_elements[j] > p->max_int) {
+                p->max_int = int_elements[j];
+            }
+        }
+    }
+    p->num_values += num_elements;
+    if (p->num_rows == 0) {
+        p->min_num_elements = num_elements;
+        p->max_num_elements = num_elements;
+        p->constant = size <= WT_PROFILE_CONSTANT_SIZE;
+        if (p->constant) {
+            memcpy(p->constant_value, data, size);
+            p->constant_size = (uint32_t) size;
+        }
+    } else {
+        if (num_elements < p->min_num_elements) {
+            p->min_num_elements = num_elements;
+        }
+        if (num_elements > p->max_num_elements) {
+            p->max_num_elements = num_elements;
+        }
+        if (p->constant && (size != p->constant_size
+                    || memcmp(p->constant_value, data, size) != 0)) {
+            p->constant = 0;
+        }
+    }
+    p->num_rows++;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Updates the profile for the plan's genotype column with the calls in
+ * the last VCF line read. The values profiled are the allele indexes.
+ */
+static int
+Table_profile_genotypes(Table *self)
+{
+    int ret = -1;
+    int col_index = self->vcf_plan->genotype_column;
+    Column *col = self->columns[col_index];
+    column_profile_t *p = &self->profiles[col_index];
+    unsigned char *v = (unsigned char *) col->element_buffer;
+    uint32_t n = (uint32_t) col->num_elements;
+    uint32_t j, code;
+
+    if (Table_parse_vcf_genotypes(self) != 0) {
+        goto out;
+    }
+    for (j = 0; j < 2 * n; j++) {
+        code = genotype_get_code(v, j, (uint32_t) col->element_size);
+        if (code != 0) {
+            if (code - 1 < p->min_uint) {
+                p->min_uint = code - 1;
+            }
+            if (code - 1 > p->max_uint) {
+                p->max_uint = code - 1;
+            }
+            p->num_values++;
+        }
+    }
+    p->min_num_elements = n;
+    p->max_num_elements = n;
+    p->num_rows++;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Parses the specified list of VCF lines and updates the profile for each
+ * column with the values found, without encoding any rows. The profiles
+ * record the values seen in each column, so that the smallest schema that
+ * can hold the data can be chosen before building the table. The table
+ * does not need to be open.
+ */
+static PyObject *
+Table_profile_vcf_lines(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *lines = NULL;
+    vcf_plan_t *plan = self->vcf_plan;
+    column_profile_t *p;
+    Py_ssize_t j;
+    uint32_t k;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &lines)) {
+        goto out;
+    }
+    if (plan == NULL) {
+        PyErr_SetString(WormtableError, "VCF plan not set");
+        goto out;
+    }
+    if (self->profiles == NULL) {
+        self->profiles = PyMem_Malloc(self->num_columns
+                * sizeof(column_profile_t));
+        if (self->profiles == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        memset(self->profiles, 0, self->num_columns
+                * sizeof(column_profile_t));
+        for (k = 0; k < self->num_columns; k++) {
+            p = &self->profiles[k];
+            p->min_uint = UINT64_MAX;
+            p->min_int = INT64_MAX;
+            p->max_int = INT64_MIN;
+        }
+    }
+    for (j = 0; j < PyList_GET_SIZE(lines); j++) {
+        if (Table_read_vcf_line(self, PyList_GET_ITEM(lines, j)) != 0) {
+            goto out;
+        }
+        for (k = 1; k < self->num_columns; k++) {
+            if (plan->values[k] == NULL) {
+                continue;
+            }
+            if ((int) k == plan->genotype_column) {
+                if (Table_profile_genotypes(self) != 0) {
+                    goto out;
+                }
+            } else if (Table_profile_value(self, k, plan->values[k]) != 0) {
+                goto out;
+            }
+        }
+        self->num_profiled_rows++;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+/*
+ * Returns the profile for the specified column as a tuple (num_rows,
+ * min_num_elements, max_num_elements, min_value, max_value, constant,
+ * num_distinct). num_rows is the number of profiled rows in which the
+ * column has a value; min_value and max_value are None unless the column
+ * is an integer or genotype column with at least one value (for genotype
+ * columns these are the smallest and largest allele indexes), and constant
+ * is True if the column has the same value in all of these rows. Genotype
+ * columns are never constant. num_distinct is the
+ * number of distinct values in a char column, or None if this is not a
+ * char column or there are more than WT_PROFILE_MAX_DISTINCT values.
+ */
+static PyObject *
+Table_get_column_profile(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *min_value = NULL;
+    PyObject *max_value = NULL;
+    PyObject *num_distinct = NULL;
+    column_profile_t *p;
+    Column *col;
+    int col_index;
+
+    if (!PyArg_ParseTuple(args, "i", &col_index)) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    if (self->profiles == NULL) {
+        PyErr_SetString(WormtableError, "No rows profiled");
+        goto out;
+    }
+    p = &self->profiles[col_index];
+    col = self->columns[col_index];
+    if (p->num_values > 0 && (col->element_type == WT_UINT
+                || col->element_type == WT_GENOTYPE)) {
+        min_value = PyLong_FromUnsignedLongLong(
+                (unsigned long long) p->min_uint);
+        max_value = PyLong_FromUnsignedLongLong(
+                (unsigned long long) p->max_uint);
+    } else if (p->num_values > 0 && col->element_type == WT_INT) {
+        min_value = PyLong_FromLongLong((long long) p->min_int);
+        max_value = PyLong_FromLongLong((long long) p->max_int);
+    } else {
+        min_value = Py_None;
+        max_value = Py_None;
+        Py_INCREF(min_value);
+        Py_INCREF(max_value);
+    }
+    if (p->distinct.values != NULL) {
+        num_distinct = PyLong_FromSsize_t(PyList_GET_SIZE(p->distinct.values));
+    } else {
+        num_distinct = Py_None;
+        Py_INCREF(num_distinct);
+    }
+    if (min_value == NULL || max_value == NULL || num_distinct == NULL) {
+        goto out;
+    }
+    ret = Py_BuildValue("KIIOOOO", (unsigned long long) p->num_rows,
+            (unsigned int) p->min_num_elements,
+            (unsigned int) p->max_num_elements, min_value, max_value,
+            p->num_rows > 0 && p->constant ? Py_True : Py_False,
+            num_distinct);
+out:
+    Py_XDECREF(min_value);
+    Py_XDECREF(max_value);
+    Py_XDECREF(num_distinct);
+    return ret;
+}
+
+/*
+ * Parses and encodes the specified list of VCF lines, returning the encoded
+ * rows as a bytes object suitable for append_encoded_rows. The table does
+ * not need to be open, so that lines can be encoded in worker processes
+ * while another process writes the table. Each row is stored as the length
+ * of the row of each column family as a native uint32_t, followed by the
+ * row data of each family.
+ */
+static PyObject *
+Table_encode_vcf_lines(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *lines = NULL;
+    char *buffer = NULL;
+    char *tmp;
+    size_t buffer_size = 0;
+    size_t size = 0;
+    size_t row_size;
+    void *rows[WT_MAX_FAMILIES];
+    uint32_t lens[WT_MAX_FAMILIES];
+    uint32_t f;
+    Py_ssize_t j;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &lines)) {
+        goto out;
+    }
+    for (j = 0; j < PyList_GET_SIZE(lines); j++) {
+        if (Table_encode_vcf_line(self, PyList_GET_ITEM(lines, j)) != 0) {
+            goto out;
+        }
+        Table_get_family_rows(self, rows, lens);
+        row_size = self->num_families * sizeof(uint32_t);
+        for (f = 0; f < self->num_families; f++) {
+            row_size += lens[f];
+        }
+        if (size + row_size > buffer_size) {
+            buffer_size = 2 * buffer_size + row_size;
+            tmp = PyMem_Realloc(buffer, buffer_size);
+            if (tmp == NULL) {
+                Table_reset_row(self);
+                PyErr_NoMemory();
+                goto out;
+            }
+            buffer = tmp;
+        }
+        memcpy(buffer + size, lens, self->num_families * sizeof(uint32_t));
+        size += self->num_families * sizeof(uint32_t);
+        for (f = 0; f < self->num_families; f++) {
+            memcpy(buffer + size, rows[f], lens[f]);
+            size += lens[f];
+        }
+        Table_reset_row(self);
+    }
+    ret = PyBytes_FromStringAndSize(buffer, (Py_ssize_t) size);
+out:
+    PyMem_Free(buffer);
+    return ret;
+}
+
+/*
+ * Appends the rows encoded by encode_vcf_lines to the table, in order.
+ */
+static PyObject *
+Table_append_encoded_rows(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *value = NULL;
+    char *data, *end;
+    Py_ssize_t size;
+    size_t lens_size = self->num_families * sizeof(uint32_t);
+    uint32_t key_size = self->columns[0]->element_size;
+    void *rows[WT_MAX_FAMILIES];
+    uint32_t lens[WT_MAX_FAMILIES];
+    uint32_t f, max_len;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyBytes_Type, &value)) {
+        goto out;
+    }
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (PyBytes_AsStringAndSize(value, &data, &size) != 0) {
+        goto out;
+    }
+    end = data + size;
+    while (data < end) {
+        if (end - data < (Py_ssize_t) lens_size) {
+            PyErr_SetString(PyExc_ValueError, "Malformed encoded rows");
+            goto out;
+        }
+        memcpy(lens, data, lens_size);
+        data += lens_size;
+        for (f = 0; f < self->num_families; f++) {
+            max_len = max_row_size((unsigned int) self->address_size)
+                - (f == 0 ? key_size : 0);
+            if (lens[f] > max_len || end - data < (Py_ssize_t) lens[f]) {
+                PyErr_SetString(PyExc_ValueError, "Malformed encoded rows");
+                goto out;
+            }
+            rows[f] = data;
+            data += lens[f];
+        }
+        if (Table_store_row(self, rows, lens) != 0) {
+            goto out;
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_get_num_rows(Table* self)
+{
+    PyObject *ret = NULL;
+    uint64_t num_rows;
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_read_num_rows(self, &num_rows) != 0) {
+        goto out;
+    }
+    ret = PyLong_FromUnsignedLongLong(num_rows);
+out:
+    return ret;
+}
+
+static PyObject *
+Table_get_row(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *t = NULL;
+    Column *col = NULL;
+    PyObject *value = NULL;
+    int wt_ret;
+    unsigned long long row_id = 0;
+    uint32_t j;
+    if (!PyArg_ParseTuple(args, "K", &row_id)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_retrieve_row_by_id(self, (uint64_t) row_id,
+            WT_ALL_FAMILIES) != 0) {
+        goto out;
+    }
+    t = PyTuple_New(self->num_columns);
+    if (t == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < self->num_columns; j++) {
+        col = self->columns[j];
+        wt_ret = Column_extract_elements(col, self->row_buffer);
+        if (wt_ret < 0) {
+            Py_DECREF(t);
+            goto out;
+        }
+        value = Column_get_python_elements(col, wt_ret == WT_MISSING_VALUE);
+        if (value == NULL) {
+            Py_DECREF(t);
+            goto out;
+        }
+        PyTuple_SET_ITEM(t, j, value);
+    }
+    ret = t;
+out:
+    return ret;
+}
+
+/*
+ * Reads the row with the specified id and extracts the packed calls in
+ * the specified genotype column into its element buffer. Returns the
+ * column, or NULL with the appropriate Python exception set.
+ */
+static Column *
+Table_extract_genotypes(Table *self, unsigned long long row_id,
+        int col_index)
+{
+    Column *ret = NULL;
+    Column *col;
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    col = self->columns[col_index];
+    if (col->element_type != WT_GENOTYPE) {
+        PyErr_Format(PyExc_TypeError, "Column '%s' is not a genotype column",
+                PyBytes_AsString(col->name));
+        goto out;
+    }
+    if (Table_retrieve_row_by_id(self, (uint64_t) row_id,
+                1U << col->family) != 0) {
+        goto out;
+    }
+    if (Column_extract_elements(col, self->row_buffer) < 0) {
+        goto out;
+    }
+    ret = col;
+out:
+    return ret;
+}
+
+static PyObject *
+Table_get_genotype(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    Column *col;
+    unsigned long long row_id = 0;
+    int col_index, sample;
+    if (!PyArg_ParseTuple(args, "Kii", &row_id, &col_index, &sample)) {
+        goto out;
+    }
+    col = Table_extract_genotypes(self, row_id, col_index);
+    if (col == NULL) {
+        goto out;
+    }
+    if (sample < 0 || sample >= col->num_elements) {
+        PyErr_SetString(PyExc_IndexError, "Sample index out of range");
+        goto out;
+    }
+    ret = col->native_to_python(col, sample);
+out:
+    return ret;
+}
+
+/*
+ * Returns a tuple giving the number of times that each allele index that
+ * can be stored in the specified genotype column is called in the
+ * specified row. Missing alleles are not counted.
+ */
+static PyObject *
+Table_count_alleles(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *t = NULL;
+    PyObject *v;
+    Column *col;
+    unsigned long long row_id = 0;
+    int col_index;
+    uint32_t j, bits, num_alleles, code;
+    uint64_t counts[256];
+    unsigned char *genotypes;
+
+    if (!PyArg_ParseTuple(args, "Ki", &row_id, &col_index)) {
+        goto out;
+    }
+    col = Table_extract_genotypes(self, row_id, col_index);
+    if (col == NULL) {
+        goto out;
+    }
+    genotypes = (unsigned char *) col->element_buffer;
+    bits = (uint32_t) col->element_size;
+    num_alleles = (1u << bits) - 1;
+    memset(counts, 0, sizeof(counts));
+    for (j = 0; j < 2 * (uint32_t) col->num_elements; j++) {
+        code = genotype_get_code(genotypes, j, bits);
+        counts[code]++;
+    }
+    t = PyTuple_New(num_alleles);
+    if (t == NULL) {
+        goto out;
+    }
+    for (j = 0; j < num_alleles; j++) {
+        v = PyLong_FromUnsignedLongLong((unsigned long long) counts[j + 1]);
+        if (v == NULL) {
+            goto out;
+        }
+        PyTuple_SET_ITEM(t, j, v);
+    }
+    ret = t;
+    t = NULL;
+out:
+    Py_XDECREF(t);
+    return ret;
+}
+
+/*
+ * Writes the allele indexes for every call in the specified genotype
+ * column into the alleles buffer, which must hold two int16 values for
+ * each sample. Missing alleles are written as -1. If phased is not None
+ * it must be a buffer of one byte for each sample, which is set to 1 if
+ * the sample's call is phased and 0 otherwise.
+ */
+static PyObject *
+Table_get_genotypes(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *alleles_obj = NULL;
+    PyObject *phased_obj = NULL;
+    Py_buffer alleles, phased;
+    int have_alleles = 0;
+    int have_phased = 0;
+    Column *col;
+    unsigned long long row_id = 0;
+    int col_index;
+    uint32_t j, n, bits;
+    int16_t *a;
+    unsigned char *ph;
+    unsigned char *genotypes;
+
+    if (!PyArg_ParseTuple(args, "KiOO", &row_id, &col_index, &alleles_obj,
+                &phased_obj)) {
+        goto out;
+    }
+    col = Table_extract_genotypes(self, row_id, col_index);
+    if (col == NULL) {
+        goto out;
+    }
+    n = (uint32_t) col->num_elements;
+    if (PyObject_GetBuffer(alleles_obj, &alleles, PyBUF_C_CONTIGUOUS
+                | PyBUF_FORMAT | PyBUF_WRITABLE) != 0) {
+        goto out;
+    }
+    have_alleles = 1;
+    if (!buffer_format_matches(&alleles, "h", sizeof(int16_t))) {
+        PyErr_Format(PyExc_TypeError, "Bad alleles buffer format for "
+                "column '%s'", PyBytes_AsString(col->name));
+        goto out;
+    }
+    if (alleles.len != (Py_ssize_t) (2 * n * sizeof(int16_t))) {
+        PyErr_Format(PyExc_ValueError, "Alleles buffer for column '%s' "
+                "must hold two values for each sample",
+                PyBytes_AsString(col->name));
+        goto out;
+    }
+    if (phased_obj != Py_None) {
+        if (PyObject_GetBuffer(phased_obj, &phased, PyBUF_C_CONTIGUOUS
+                    | PyBUF_FORMAT | PyBUF_WRITABLE) != 0) {
+            goto out;
+        }
+        have_phased = 1;
+        if (!buffer_format_matches(&phased, "?bB", 1)) {
+            PyErr_Format(PyExc_TypeError, "Bad phased buffer format for "
+                    "column '%s'", PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (phased.len != (Py_ssize_t) n) {
+            PyErr_Format(PyExc_ValueError, "Phased buffer for column '%s' "
+                    "must hold one value for each sample",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+    }
+    genotypes = (unsigned char *) col->element_buffer;
+    bits = (uint32_t) col->element_size;
+    a = (int16_t *) alleles.buf;
+    for (j = 0; j < 2 * n; j++) {
+        a[j] = (int16_t) genotype_get_code(genotypes, j, bits) - 1;
+    }
+    if (have_phased) {
+        ph = (unsigned char *) phased.buf;
+        for (j = 0; j < n; j++) {
+            ph[j] = (unsigned char) genotype_get_phased(genotypes, j, n, bits);
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    if (have_alleles) {
+        PyBuffer_Release(&alleles);
+    }
+    if (have_phased) {
+        PyBuffer_Release(&phased);
+    }
+    return ret;
+}
+
+
+static int
+cmp_row_position(const void *a, const void *b)
+{
+    const row_position_t *ia = (const row_position_t *) a;
+    const row_position_t *ib = (const row_position_t *) b;
+    return (ia->row_id > ib->row_id) - (ia->row_id < ib->row_id);
+}
+
+static int
+cmp_row_request_offset(const void *a, const void *b)
+{
+    const row_request_t *ia = *(row_request_t * const *) a;
+    const row_request_t *ib = *(row_request_t * const *) b;
+    return (ia->offset > ib->offset) - (ia->offset < ib->offset);
+}
+
+/*
+ * Looks up the offset and length of each of the specified rows in the
+ * data file of the specified family. The rows must be sorted by row id,
+ * and are found in a single forward pass over the primary DB.
+ */
+static int
+Table_resolve_row_offsets(Table *self, row_request_t *rows,
+        Py_ssize_t num_rows, uint32_t family)
+{
+    int ret = -1;
+    int db_ret;
+    uint32_t flags;
+    Py_ssize_t j;
+    unsigned char key_buffer[sizeof(uint64_t)];
+    uint64_t position = 0;
+    Column *id_col = self->columns[0];
+    DBC *cursor = NULL;
+    DBT key, data;
+
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        cursor = NULL;
+        goto out;
+    }
+    for (j = 0; j < num_rows; j++) {
+        memset(&key, 0, sizeof(DBT));
+        memset(&data, 0, sizeof(DBT));
+        flags = DB_SET;
+        if (j > 0 && rows[j].row_id == rows[j - 1].row_id + 1) {
+            /* consecutive rows are adjacent in the DB */
+            flags = DB_NEXT;
+        } else {
+            if (Column_set_row_id(id_col, rows[j].row_id) != 0) {
+                goto out;
+            }
+            if (Column_update_row(id_col, key_buffer, 0) != 0) {
+                goto out;
+            }
+            key.data = key_buffer;
+            key.size = id_col->element_size;
+        }
+        db_ret = Table_cursor_get(self, cursor, &position, &key, &data,
+                flags);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+        if (data.size != self->record_size) {
+            PyErr_Format(PyExc_SystemError, "offset/len record size mismatch");
+            goto out;
+        }
+        Table_unpack_record(self, data.data, family, &rows[j].offset,
+                &rows[j].len);
+        if (Table_check_row_length(self, family, rows[j].len) != 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+    return ret;
+}
+
+/*
+ * Reads the specified rows from the data file of the specified family in
+ * order of their offsets, coalescing rows that are contiguous in the file
+ * into single reads, and stores the values of the specified columns,
+ * which must all be in this family, in each row request.
+ */
+static int
+Table_read_rows(Table *self, row_request_t **rows, Py_ssize_t num_rows,
+        uint32_t family, uint32_t *columns, uint32_t num_columns)
+{
+    int ret = -1;
+    Py_ssize_t j, k, run_end;
+    uint64_t run_offset, run_size;
+    char *buffer = NULL;
+    char *src, *row;
+    Column *id_col = self->columns[0];
+    uint32_t key_size = id_col->element_size;
+    FILE *data_file = self->families[family].data_file;
+    /* the rows are read after the key in the row of family 0 */
+    uint32_t start = family == 0 ? key_size : 0;
+
+    buffer = PyMem_Malloc(WT_READ_BUFFER_SIZE);
+    if (buffer == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    j = 0;
+    while (j < num_rows) {
+        run_offset = rows[j]->offset;
+        run_size = rows[j]->len;
+        run_end = j + 1;
+        while (run_end < num_rows
+                && rows[run_end]->offset == run_offset + run_size
+                && run_size + rows[run_end]->len <= WT_READ_BUFFER_SIZE) {
+            run_size += rows[run_end]->len;
+            run_end++;
+        }
+        /* rows larger than the read buffer are read into the row buffer */
+        src = buffer;
+        if (run_size > WT_READ_BUFFER_SIZE && self->compressor != NULL) {
+            if (Table_reserve_compressor_buffer(self,
+                        (uint32_t) run_size - 1) != 0) {
+                goto out;
+            }
+            src = (char *) self->compressor->buffer;
+        } else if (run_size > WT_READ_BUFFER_SIZE) {
+            if (Table_reserve_row_buffer(self, start + (uint32_t) run_size)
+                    != 0) {
+                goto out;
+            }
+            src = (char *) self->row_buffer
+                + (size_t) family * self->row_buffer_size + start;
+        }
+        if (run_size > 0) {
+            if (fseeko(data_file, (off_t) run_offset, SEEK_SET) != 0) {
+                handle_io_error();
+                goto out;
+            }
+            if (fread(src, run_size, 1, data_file) != 1) {
+                handle_io_error();
+                goto out;
+            }
+        }
+        for (k = j; k < run_end; k++) {
+            if (self->compressor != NULL) {
+                if (Table_expand_row(self, family, (unsigned char *) src
+                            + (rows[k]->offset - run_offset), rows[k]->len)
+                        != 0) {
+                    goto out;
+                }
+            } else if (src == buffer) {
+                if (Table_reserve_row_buffer(self, start + rows[k]->len)
+                        != 0) {
+                    goto out;
+                }
+                row = (char *) self->row_buffer
+                    + (size_t) family * self->row_buffer_size + start;
+                memcpy(row, buffer + (rows[k]->offset - run_offset),
+                        rows[k]->len);
+            }
+            if (Column_set_row_id(id_col, rows[k]->row_id) != 0) {
+                goto out;
+            }
+            if (Column_update_row(id_col, self->row_buffer, 0) != 0) {
+                goto out;
+            }
+            rows[k]->value = Table_get_python_row(self, columns, num_columns);
+            if (rows[k]->value == NULL) {
+                goto out;
+            }
+        }
+        j = run_end;
+    }
+    ret = 0;
+out:
+    if (buffer != NULL) {
+        PyMem_Free(buffer);
+    }
+    return ret;
+}
+
+static PyObject *
+Table_get_rows(Table* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *result = NULL;
+    PyObject *row_ids = NULL;
+    PyObject *columns = NULL;
+    PyObject *v;
+    row_position_t *positions = NULL;
+    row_request_t *rows = NULL;
+    row_request_t **rows_by_offset = NULL;
+    uint32_t *cols = NULL;
+    uint32_t num_columns = 0;
+    uint32_t families, family;
+    Py_ssize_t j, n;
+    Py_ssize_t num_rows = 0;
+    long k;
+
+    if (!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &row_ids,
+            &PyList_Type, &columns)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    num_columns = PyList_GET_SIZE(columns);
+    cols = PyMem_Malloc((num_columns + 1) * sizeof(uint32_t));
+    if (cols == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < num_columns; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+            goto out;
+        }
+        k = PyLong_AsLong(v);
+        if (k < 0 || k >= self->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+            goto out;
+        }
+        cols[j] = (uint32_t) k;
+    }
+    n = PyList_GET_SIZE(row_ids);
+    positions = PyMem_Malloc((n + 1) * sizeof(row_position_t));
+    rows = PyMem_Malloc((n + 1) * sizeof(row_request_t));
+    rows_by_offset = PyMem_Malloc((n + 1) * sizeof(row_request_t *));
+    if (positions == NULL || rows == NULL || rows_by_offset == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        v = PyList_GET_ITEM(row_ids, j);
+        positions[j].row_id = (uint64_t) PyLong_AsUnsignedLongLong(v);
+        if (PyErr_Occurred()) {
+            goto out;
+        }
+        positions[j].position = j;
+    }
+    /* sort the requests by row id and remove duplicates */
+    qsort(positions, n, sizeof(row_position_t), cmp_row_position);
+    for (j = 0; j < n; j++) {
+        if (num_rows == 0 || rows[num_rows - 1].row_id
+                != positions[j].row_id) {
+            rows[num_rows].row_id = positions[j].row_id;
+            rows[num_rows].value = NULL;
+            rows_by_offset[num_rows] = &rows[num_rows];
+            num_rows++;
+        }
+        positions[j].row = num_rows - 1;
+    }
+    families = Table_get_families(self, cols, num_columns);
+    if ((families & (families - 1)) != 0) {
+        /* reads can only be coalesced within the data file of one family */
+        for (j = 0; j < num_rows; j++) {
+            if (Table_retrieve_row_by_id(self, rows[j].row_id, families)
+                    != 0) {
+                goto out;
+            }
+            rows[j].value = Table_get_python_row(self, cols, num_columns);
+            if (rows[j].value == NULL) {
+                goto out;
+            }
+        }
+    } else {
+        family = 0;
+        while (families > 1) {
+            families >>= 1;
+            family++;
+        }
+        if (Table_resolve_row_offsets(self, rows, num_rows, family) != 0) {
+            goto out;
+        }
+        qsort(rows_by_offset, num_rows, sizeof(row_request_t *),
+                cmp_row_request_offset);
+        if (Table_read_rows(self, rows_by_offset, num_rows, family, cols,
+                    num_columns) != 0) {
+            goto out;
+        }
+    }
+    result = PyList_New(n);
+    if (result == NULL) {
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        v = rows[positions[j].row].value;
+        Py_INCREF(v);
+        PyList_SET_ITEM(result, positions[j].position, v);
+    }
+    ret = result;
+out:
+    if (rows != NULL) {
+        for (j = 0; j < num_rows; j++) {
+            Py_XDECREF(rows[j].value);
+        }
+        PyMem_Free(rows);
+    }
+    if (positions != NULL) {
+        PyMem_Free(positions);
+    }
+    if (rows_by_offset != NULL) {
+        PyMem_Free(rows_by_offset);
+    }
+    if (cols != NULL) {
+        PyMem_Free(cols);
+    }
+    return ret;
+}
+
+
+/*
+ * Copies the value of the specified source column in the source table's
+ * row buffer into the specified column of this table's row buffer without
+ * decoding it. The columns must have the same type, element size and
+ * number of elements. Returns 0 on success or -1 with the appropriate
+ * Python exception set.
+ */
+static int
+Table_copy_column_bytes(Table *self, Column *dest, Table *source,
+        Column *src)
+{
+    int ret = -1;
+    char *drow = (char *) self->row_buffer + dest->row_offset;
+    char *srow = (char *) source->row_buffer + src->row_offset;
+    column_family_t *family = &self->families[dest->family];
+    uint32_t offset, num_elements, size;
+
+    if (!Column_is_variable(src)) {
+        memcpy(drow + dest->fixed_region_offset,
+                srow + src->fixed_region_offset,
+                Column_get_fixed_region_size(src));
+    } else {
+        if (Column_unpack_variable_elements_address(src,
+                    srow + src->fixed_region_offset, &offset,
+                    &num_elements) < 0) {
+            goto out;
+        }
+        if (offset != 0) {
+            size = num_elements * src->element_size;
+            if (offset + size > source->row_buffer_size
+                    || family->current_row_size + size
+                        > dest->max_row_size) {
+                PyErr_SetString(PyExc_ValueError, "Row overflow");
+                goto out;
+            }
+            if (Table_reserve_row_buffer(self, family->current_row_size
+                        + size) != 0) {
+                goto out;
+            }
+            drow = (char *) self->row_buffer + dest->row_offset;
+            if (Column_pack_variable_elements_address(dest,
+                        drow + dest->fixed_region_offset,
+                        family->current_row_size, num_elements) < 0) {
+                goto out;
+            }
+            memcpy(drow + family->current_row_size, srow + offset, size);
+            family->current_row_size += size;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Copies the value of each of this table's columns from the row in the
+ * source table's row buffer, and writes the resulting row.
+ */
+static int
+Table_copy_row(Table *self, Table *source, int *columns)
+{
+    int ret = -1;
+    int wt_ret;
+    unsigned int j;
+    Column *dest, *src;
+    PyObject *value;
+
+    for (j = 1; j < self->num_columns; j++) {
+        if (columns[j] < 0) {
+            continue;
+        }
+        dest = self->columns[j];
+        src = source->columns[columns[j]];
+        if (dest->element_type == src->element_type
+                && dest->element_size == src->element_size
+                && dest->num_elements == src->num_elements
+                && dest->element_type != WT_DICT
+                && dest->native == src->native
+                && !dest->sparse && !src->sparse) {
+            if (Table_copy_column_bytes(self, dest, source, src) != 0) {
+                goto out;
+            }
+            continue;
+        }
+        if (dest->element_type == WT_GENOTYPE
+                && src->element_type == WT_GENOTYPE
+                && dest->element_size == src->element_size
+                && dest->num_elements == src->num_elements) {
+            /* only the storage mode differs, so copy the packed calls */
+            wt_ret = Column_extract_elements(src, source->row_buffer);
+            if (wt_ret < 0) {
+                goto out;
+            }
+            if (wt_ret == WT_MISSING_VALUE) {
+                continue;
+            }
+            memcpy(dest->element_buffer, src->element_buffer,
+                    genotype_vector_size((uint32_t) src->num_elements,
+                        (uint32_t) src->element_size));
+            dest->num_buffered_elements = src->num_buffered_elements;
+            if (Table_update_column(self, dest) != 0) {
+                goto out;
+            }
+            continue;
+        }
+        if (dest->element_type == WT_GENOTYPE
+                || src->element_type == WT_GENOTYPE) {
+            PyErr_Format(PyExc_TypeError,
+                    "Genotype column '%s' can only be copied to a genotype "
+                    "column of the same size", PyBytes_AsString(dest->name));
+            goto out;
+        }
+        wt_ret = Column_extract_elements(src, source->row_buffer);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (wt_ret == WT_MISSING_VALUE && Column_is_variable(src)) {
+            continue;
+        }
+        if (dest->element_type == WT_DICT || src->element_type == WT_DICT) {
+            /* codes differ between dictionaries, so convert the values */
+            if ((dest->element_type != WT_CHAR && dest->element_type != WT_DICT)
+                    || (src->element_type != WT_CHAR
+                        && src->element_type != WT_DICT)) {
+                PyErr_Format(PyExc_TypeError,
+                        "Cannot convert column '%s' between char and numeric "
+                        "types", PyBytes_AsString(dest->name));
+                goto out;
+            }
+            if (wt_ret == WT_MISSING_VALUE) {
+                continue;
+            }
+            value = Column_get_python_elements(src, 0);
+            if (value == NULL) {
+                goto out;
+            }
+            wt_ret = dest->python_to_native(dest, value);
+            Py_DECREF(value);
+        } else {
+            wt_ret = Column_transcode_elements(dest, src);
+        }
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (wt_ret == WT_MISSING_VALUE) {
+            continue;
+        }
+        if (Table_update_column(self, dest) != 0) {
+            goto out;
+        }
+    }
+    if (Table_write_row(self) != 0) {
+        goto out;
+    }
+    ret = 0;
+out:
+    if (ret != 0) {
+        Table_reset_row(self);
+    }
+    return ret;
+}
+
+static PyObject *
+Table_copy_rows(Table* self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"source", "columns", "progress_callback",
+            "callback_interval", NULL};
+    int db_ret;
+    PyObject *ret = NULL;
+    PyObject *arglist, *result, *v;
+    PyObject *columns = NULL;
+    PyObject *progress_callback = NULL;
+    Table *source = NULL;
+    DBC *cursor = NULL;
+    DBT pkey, pdata;
+    int *cols = NULL;
+    long k;
+    unsigned int j;
+    uint32_t families = 0;
+    uint64_t callback_interval = 1000;
+    uint64_t records_processed = 0;
+    uint64_t position = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!|OK", kwlist,
+            &TableType, &source, &PyList_Type, &columns,
+            &progress_callback, &callback_interval)) {
+        source = NULL;
+        progress_callback = NULL;
+        goto out;
+    }
+    Py_INCREF(source);
+    Py_XINCREF(progress_callback);
+    if (Table_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_check_read_mode(source) != 0) {
+        goto out;
+    }
+    if (progress_callback != NULL) {
+        if (!PyCallable_Check(progress_callback)) {
+            PyErr_SetString(PyExc_TypeError, "progress_callback must be callable");
+            goto out;
+        }
+    }
+    if (callback_interval == 0) {
+        PyErr_SetString(PyExc_ValueError, "callback interval cannot be 0");
+        goto out;
+    }
+    if (PyList_GET_SIZE(columns) != self->num_columns) {
+        PyErr_SetString(PyExc_ValueError,
+                "A source column must be given for each column");
+        goto out;
+    }
+    cols = PyMem_Malloc(self->num_columns * sizeof(int));
+    if (cols == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < self->num_columns; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+            goto out;
+        }
+        k = PyLong_AsLong(v);
+        if (k < -1 || k >= (long) source->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+            goto out;
+        }
+        cols[j] = (int) k;
+        if (k > 0) {
+            families |= 1U << source->columns[k]->family;
+        }
+    }
+    db_ret = source->db->cursor(source->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        cursor = NULL;
+        goto out;
+    }
+    memset(&pkey, 0, sizeof(DBT));
+    memset(&pdata, 0, sizeof(DBT));
+    while ((db_ret = Table_cursor_get(source, cursor, &position, &pkey,
+                    &pdata, DB_NEXT)) == 0) {
+        if (Table_retrieve_row(source, &pkey, &pdata, families) != 0) {
+            goto out;
+        }
+        if (Table_copy_row(self, source, cols) != 0) {
+            goto out;
+        }
+        /* Invoke the callback if necessary */
+        records_processed++;
+        if (records_processed % callback_interval == 0) {
+            if (progress_callback != NULL) {
+                arglist = Py_BuildValue("(K)", records_processed);
+                if (arglist == NULL) {
+                    goto out;
+                }
+                result = PyObject_CallObject(progress_callback, arglist);
+                Py_DECREF(arglist);
+                if (result == NULL) {
+                    goto out;
+                }
+                Py_DECREF(result);
+                /* Anything might have happened in the mean time, so
+                 * check the state of the tables again!
+                 */
+                if (Table_check_write_mode(self) != 0) {
+                    goto out;
+                }
+                if (Table_check_read_mode(source) != 0) {
+                    goto out;
+                }
+            }
+        }
+    }
+    if (db_ret != DB_NOTFOUND) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    db_ret = cursor->close(cursor);
+    cursor = NULL;
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    if (cursor != NULL) {
+        /* ignore errors in this case, as we're already handling one */
+        if (source->db != NULL) {
+            cursor->close(cursor);
+        }
+    }
+    Py_XDECREF(progress_callback);
+    Py_XDECREF(source);
+    PyMem_Free(cols);
+    return ret;
+}
+
+
+/*==========================================================
+ * Packed integer column files
+ *==========================================================
+ */
+
+/*
+ * Packed column files hold the values of a single integer column in
+ * blocks of WT_PACKED_BLOCK_SIZE rows. Each block stores its first value,
+ * the minimum difference between consecutive values and the differences
+ * from this minimum bit-packed at the smallest width that holds them all,
+ * so that sorted coordinates need only a few bits per row. Missing values
+ * are recorded in a bitmap and take the value of the previous row within
+ * the block. All integers in the file are little-endian. The header is
+ * followed by the blocks and then the offsets of the blocks in the file.
+ */
+
+static void
+packed_put_le(unsigned char *dest, uint64_t value, int size)
+{
+    int j;
+    for (j = 0; j < size; j++) {
+        dest[j] = (unsigned char) (value >> (8 * j));
+    }
+}
+
+static uint64_t
+packed_get_le(const unsigned char *src, int size)
+{
+    int j;
+    uint64_t value = 0;
+    for (j = 0; j < size; j++) {
+        value |= ((uint64_t) src[j]) << (8 * j);
+    }
+    return value;
+}
+
+/*
+ * Returns the value of the specified width starting at the specified bit
+ * of the packed values.
+ */
+static uint64_t
+packed_get_bits(const unsigned char *v, uint64_t bit, uint32_t bits)
+{
+    const unsigned char *p = v + bit / 8;
+    uint32_t shift = (uint32_t) (bit % 8);
+    uint32_t got = 8 - shift;
+    uint64_t x = (uint64_t) (*p >> shift);
+    while (got < bits) {
+        p++;
+        x |= ((uint64_t) *p) << got;
+        got += 8;
+    }
+    if (bits < 64) {
+        x &= (((uint64_t) 1) << bits) - 1;
+    }
+    return x;
+}
+
+static size_t
+packed_block_size(uint32_t num_values, uint32_t bits, int has_missing)
+{
+    size_t size = WT_PACKED_BLOCK_HEADER_SIZE
+            + ((size_t) (num_values - 1) * bits + 7) / 8;
+    if (has_missing) {
+        size += (num_values + 7) / 8;
+    }
+    return size;
+}
+
+/*
+ * Encodes the specified values into dest, which must be large enough to
+ * hold a block of WT_PACKED_BLOCK_SIZE values, and returns the size of
+ * the encoded block.
+ */
+static size_t
+packed_encode_block(uint64_t *values, unsigned char *missing,
+        uint32_t num_values, unsigned char *dest)
+{
+    uint32_t j, k;
+    uint32_t bits = 0;
+    int has_missing = 0;
+    uint64_t previous = 0;
+    uint64_t min_delta = 0;
+    uint64_t max_residual = 0;
+    uint64_t x, bit;
+    unsigned char *v;
+
+    /* Missing values are replaced by the previous value (or the first
+     * non-missing value in the block) so they don't widen the deltas.
+     */
+    for (j = 0; j < num_values; j++) {
+        if (!missing[j]) {
+            previous = values[j];
+            break;
+        }
+    }
+    for (j = 0; j < num_values; j++) {
+        if (missing[j]) {
+            values[j] = previous;
+            has_missing = 1;
+        }
+        previous = values[j];
+    }
+    for (j = 1; j < num_values; j++) {
+        x = values[j] - values[j - 1];
+        if (j == 1 || (int64_t) x < (int64_t) min_delta) {
+            min_delta = x;
+        }
+    }
+    for (j = 1; j < num_values; j++) {
+        x = values[j] - values[j - 1] - min_delta;
+        if (x > max_residual) {
+            max_residual = x;
+        }
+    }
+    while (bits < 64 && (max_residual >> bits) != 0) {
+        bits++;
+    }
+    packed_put_le(dest, values[0], 8);
+    packed_put_le(dest + 8, min_delta, 8);
+    dest[16] = (unsigned char) bits;
+    dest[17] = (unsigned char) has_missing;
+    v = dest + WT_PACKED_BLOCK_HEADER_SIZE;
+    if (has_missing) {
+        memset(v, 0, (num_values + 7) / 8);
+        for (j = 0; j < num_values; j++) {
+            if (missing[j]) {
+                v[j / 8] |= (unsigned char) (1 << (j % 8));
+            }
+        }
+        v += (num_values + 7) / 8;
+    }
+    memset(v, 0, ((size_t) (num_values - 1) * bits + 7) / 8);
+    bit = 0;
+    for (j = 1; j < num_values; j++) {
+        x = values[j] - values[j - 1] - min_delta;
+        for (k = 0; k < bits; k++) {
+            if ((x >> k) & 1) {
+                v[(bit + k) / 8] |= (unsigned char) (1 << ((bit + k) % 8));
+            }
+        }
+        bit += bits;
+    }
+    return packed_block_size(num_values, bits, has_missing);
+}
+
+/*
+ * Decodes the block of num_values values in src, which is size bytes
+ * long, into the specified arrays. Returns 0 on success and -1 if the
+ * block is corrupt.
+ */
+static int
+packed_decode_block(const unsigned char *src, size_t size,
+        uint32_t num_values, uint64_t *values, unsigned char *missing)
+{
+    int ret = -1;
+    uint32_t j, bits;
+    int has_missing;
+    uint64_t x, min_delta, bit;
+    const unsigned char *v = src + WT_PACKED_BLOCK_HEADER_SIZE;
+
+    if (size < WT_PACKED_BLOCK_HEADER_SIZE) {
+        goto out;
+    }
+    bits = src[16];
+    has_missing = src[17];
+    if (bits > 64 || packed_block_size(num_values, bits, has_missing)
+            != size) {
+        goto out;
+    }
+    if (has_missing) {
+        for (j = 0; j < num_values; j++) {
+            missing[j] = (v[j / 8] >> (j % 8)) & 1;
+        }
+        v += (num_values + 7) / 8;
+    } else {
+        memset(missing, 0, num_values);
+    }
+    x = packed_get_le(src, 8);
+    min_delta = packed_get_le(src + 8, 8);
+    values[0] = x;
+    if (bits == 0) {
+        for (j = 1; j < num_values; j++) {
+            x += min_delta;
+            values[j] = x;
+        }
+    } else {
+        bit = 0;
+        for (j = 1; j < num_values; j++) {
+            x += min_delta + packed_get_bits(v, bit, bits);
+            values[j] = x;
+            bit += bits;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Writes the values of the specified integer column to a packed column
+ * file with the specified name.
+ */
+static PyObject *
+Table_write_packed_column(Table *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *filename = NULL;
+    FILE *f = NULL;
+    DBC *cursor = NULL;
+    DBT pkey, pdata;
+    Column *col;
+    int col_index, db_ret, wt_ret;
+    uint32_t n = 0;
+    uint64_t j, num_blocks = 0;
+    uint64_t num_rows = 0;
+    uint64_t position = 0;
+    uint64_t table_rows;
+    uint64_t offset = WT_PACKED_HEADER_SIZE;
+    uint64_t *offsets = NULL;
+    uint64_t values[WT_PACKED_BLOCK_SIZE];
+    unsigned char missing[WT_PACKED_BLOCK_SIZE];
+    unsigned char header[WT_PACKED_HEADER_SIZE];
+    unsigned char block[WT_PACKED_BLOCK_HEADER_SIZE
+            + WT_PACKED_BLOCK_SIZE / 8 + WT_PACKED_BLOCK_SIZE * 8];
+    size_t size;
+
+    if (!PyArg_ParseTuple(args, "iO!", &col_index, &PyBytes_Type,
+                &filename)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    col = self->columns[col_index];
+    if ((col->element_type != WT_UINT && col->element_type != WT_INT)
+            || col->num_elements != 1) {
+        PyErr_Format(PyExc_TypeError,
+                "Cannot pack column '%s': only integer columns with one "
+                "element are supported", PyBytes_AsString(col->name));
+        goto out;
+    }
+    if (Table_read_num_rows(self, &table_rows) != 0) {
+        goto out;
+    }
+    offsets = PyMem_Malloc((table_rows / WT_PACKED_BLOCK_SIZE + 2)
+            * sizeof(uint64_t));
+    if (offsets == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    f = fopen(PyBytes_AsString(filename), "wb");
+    if (f == NULL) {
+        handle_io_error();
+        goto out;
+    }
+    /* The header is written when we know the number of rows */
+    memset(header, 0, WT_PACKED_HEADER_SIZE);
+    if (fwrite(header, WT_PACKED_HEADER_SIZE, 1, f) != 1) {
+        handle_io_error();
+        goto out;
+    }
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        cursor = NULL;
+        goto out;
+    }
+    memset(&pkey, 0, sizeof(DBT));
+    memset(&pdata, 0, sizeof(DBT));
+    while (1) {
+        db_ret = Table_cursor_get(self, cursor, &position, &pkey, &pdata,
+                DB_NEXT);
+        if (db_ret == 0) {
+            if (Table_retrieve_row(self, &pkey, &pdata, 1U << col->family)
+                    != 0) {
+                goto out;
+            }
+            wt_ret = Column_extract_elements(col, self->row_buffer);
+            if (wt_ret < 0) {
+                goto out;
+            }
+            values[n] = ((uint64_t *) col->element_buffer)[0];
+            missing[n] = wt_ret == WT_MISSING_VALUE;
+            n++;
+            num_rows++;
+        } else if (db_ret != DB_NOTFOUND) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+        if (n == WT_PACKED_BLOCK_SIZE || (db_ret == DB_NOTFOUND && n > 0)) {
+            if (num_blocks > table_rows / WT_PACKED_BLOCK_SIZE) {
+                PyErr_SetString(PyExc_SystemError, "row count mismatch");
+                goto out;
+            }
+            size = packed_encode_block(values, missing, n, block);
+            if (fwrite(block, size, 1, f) != 1) {
+                handle_io_error();
+                goto out;
+            }
+            offsets[num_blocks] = offset;
+            offset += size;
+            num_blocks++;
+            n = 0;
+        }
+        if (db_ret == DB_NOTFOUND) {
+            break;
+        }
+    }
+    offsets[num_blocks] = offset;
+    for (j = 0; j <= num_blocks; j++) {
+        packed_put_le(block, offsets[j], 8);
+        if (fwrite(block, 8, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
+    }
+    memcpy(header, WT_PACKED_MAGIC, 8);
+    packed_put_le(header + 8, (uint64_t) col->element_type, 4);
+    packed_put_le(header + 12, WT_PACKED_BLOCK_SIZE, 4);
+    packed_put_le(header + 16, num_rows, 8);
+    packed_put_le(header + 24, offset, 8);
+    if (fseeko(f, 0, SEEK_SET) != 0) {
+        handle_io_error();
+        goto out;
+    }
+    if (fwrite(header, WT_PACKED_HEADER_SIZE, 1, f) != 1) {
+        handle_io_error();
+        goto out;
+    }
+    if (fclose(f) != 0) {
+        f = NULL;
+        handle_io_error();
+        goto out;
+    }
+    f = NULL;
+    ret = Py_BuildValue("K", (unsigned long long) num_rows);
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    PyMem_Free(offsets);
+    return ret;
+}
+
+/*
+ * Reads the values for rows start to stop - 1 from the specified packed
+ * column file into the values buffer, which must hold stop - start
+ * native integers of the column's type. If missing is not None it must
+ * be a buffer of stop - start bytes, which are set to 1 for rows in
+ * which the column is missing and 0 otherwise.
+ */
+static PyObject *
+Table_read_packed_column(Table *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *filename = NULL;
+    PyObject *values_obj = NULL;
+    PyObject *missing_obj = NULL;
+    Py_buffer values, missing;
+    int have_values = 0;
+    int have_missing = 0;
+    FILE *f = NULL;
+    Column *col;
+    int col_index;
+    unsigned long long start, stop;
+    uint64_t j, block_start, num_rows, table_rows, directory_offset;
+    uint64_t first, last, offset, end;
+    uint32_t n, k, k_start, k_end;
+    uint64_t *dest;
+    unsigned char *dest_missing = NULL;
+    uint64_t decoded[WT_PACKED_BLOCK_SIZE];
+    unsigned char decoded_missing[WT_PACKED_BLOCK_SIZE];
+    unsigned char header[WT_PACKED_HEADER_SIZE];
+    unsigned char block[WT_PACKED_BLOCK_HEADER_SIZE
+            + WT_PACKED_BLOCK_SIZE / 8 + WT_PACKED_BLOCK_SIZE * 8];
+    unsigned char offsets[16];
+
+    if (!PyArg_ParseTuple(args, "iO!KKOO", &col_index, &PyBytes_Type,
+                &filename, &start, &stop, &values_obj, &missing_obj)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self) != 0) {
+        goto out;
+    }
+    if (Table_check_column_index(self, col_index) != 0) {
+        goto out;
+    }
+    col = self->columns[col_index];
+    if (start > stop) {
+        PyErr_SetString(PyExc_ValueError, "start must be <= stop");
+        goto out;
+    }
+    if (PyObject_GetBuffer(values_obj, &values, PyBUF_C_CONTIGUOUS
+                | PyBUF_FORMAT | PyBUF_WRITABLE) != 0) {
+        goto out;
+    }
+    have_values = 1;
+    if (!buffer_format_matches(&values, col->element_type == WT_UINT
+                ? "LQN" : "lqn", sizeof(uint64_t))) {
+        PyErr_Format(PyExc_TypeError, "Bad values buffer format for "
+                "column '%s'", PyBytes_AsString(col->name));
+        goto out;
+    }
+    if (values.len != (Py_ssize_t) ((stop - start) * sizeof(uint64_t))) {
+        PyErr_Format(PyExc_ValueError, "Values buffer for column '%s' "
+                "must hold one value for each row",
+                PyBytes_AsString(col->name));
+        goto out;
+    }
+    dest = (uint64_t *) values.buf;
+    if (missing_obj != Py_None) {
+        if (PyObject_GetBuffer(missing_obj, &missing, PyBUF_C_CONTIGUOUS
+                    | PyBUF_FORMAT | PyBUF_WRITABLE) != 0) {
+            goto out;
+        }
+        have_missing = 1;
+        if (!buffer_format_matches(&missing, "?bB", 1)) {
+            PyErr_Format(PyExc_TypeError, "Bad missing buffer format for "
+                    "column '%s'", PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (missing.len != (Py_ssize_t) (stop - start)) {
+            PyErr_Format(PyExc_ValueError, "Missing buffer for column '%s' "
+                    "must hold one value for each row",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        dest_missing = (unsigned char *) missing.buf;
+    }
+    f = fopen(PyBytes_AsString(filename), "rb");
+    if (f == NULL) {
+        handle_io_error();
+        goto out;
+    }
+    if (fread(header, WT_PACKED_HEADER_SIZE, 1, f) != 1
+            || memcmp(header, WT_PACKED_MAGIC, 8) != 0
+            || packed_get_le(header + 12, 4) != WT_PACKED_BLOCK_SIZE) {
+        PyErr_Format(WormtableError, "'%s' is not a packed column file",
+                PyBytes_AsString(filename));
+        goto out;
+    }
+    if (packed_get_le(header + 8, 4) != (uint64_t) col->element_type) {
+        PyErr_Format(WormtableError, "Packed column file '%s' does not "
+                "match column '%s'", PyBytes_AsString(filename),
+                PyBytes_AsString(col->name));
+        goto out;
+    }
+    num_rows = packed_get_le(header + 16, 8);
+    directory_offset = packed_get_le(header + 24, 8);
+    if (Table_read_num_rows(self, &table_rows) != 0) {
+        goto out;
+    }
+    if (num_rows != table_rows) {
+        PyErr_Format(WormtableError, "Packed column file '%s' is out of "
+                "date; it must be rebuilt", PyBytes_AsString(filename));
+        goto out;
+    }
+    if (stop > num_rows) {
+        PyErr_SetString(PyExc_IndexError, "row index out of range");
+        goto out;
+    }
+    if (start == stop) {
+        Py_INCREF(Py_None);
+        ret = Py_None;
+        goto out;
+    }
+    first = start / WT_PACKED_BLOCK_SIZE;
+    last = (stop - 1) / WT_PACKED_BLOCK_SIZE;
+    for (j = first; j <= last; j++) {
+        if (fseeko(f, (off_t) (directory_offset + 8 * j), SEEK_SET) != 0
+                || fread(offsets, 16, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
+        offset = packed_get_le(offsets, 8);
+        end = packed_get_le(offsets + 8, 8);
+        block_start = j * WT_PACKED_BLOCK_SIZE;
+        n = (uint32_t) (num_rows - block_start < WT_PACKED_BLOCK_SIZE
+                ? num_rows - block_start : WT_PACKED_BLOCK_SIZE);
+        if (end < offset || end - offset > sizeof(block)) {
+            PyErr_Format(WormtableError, "Corrupt packed column file '%s'",
+                    PyBytes_AsString(filename));
+            goto out;
+        }
+        if (fseeko(f, (off_t) offset, SEEK_SET) != 0
+                || fread(block, end - offset, 1, f) != 1) {
+            handle_io_error();
+            goto out;
+        }
+        if (packed_decode_block(block, end - offset, n, decoded,
+                    decoded_missing) != 0) {
+            PyErr_Format(WormtableError, "Corrupt packed column file '%s'",
+                    PyBytes_AsString(filename));
+            goto out;
+        }
+        k_start = j == first ? (uint32_t) (start - block_start) : 0;
+        k_end = j == last ? (uint32_t) (stop - block_start) : n;
+        for (k = k_start; k < k_end; k++) {
+            dest[block_start + k - start] = decoded[k];
+        }
+        if (dest_missing != NULL) {
+            memcpy(dest_missing + block_start + k_start - start,
+                    decoded_missing + k_start, k_end - k_start);
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    if (f != NULL) {
+        fclose(f);
+    }
+    if (have_values) {
+        PyBuffer_Release(&values);
+    }
+    if (have_missing) {
+        PyBuffer_Release(&missing);
+    }
+    return ret;
+}
+
+
+static PyMethodDef Table_methods[] = {
+    {"get_num_rows", (PyCFunction) Table_get_num_rows, METH_NOARGS,
+            "Returns the number of rows in the table" },
+    {"get_row", (PyCFunction) Table_get_row, METH_VARARGS,
+            "Return the jth row as a tuple" },
+    {"get_rows", (PyCFunction) Table_get_rows, METH_VARARGS,
+            "Return the rows with the specified ids as a list of tuples" },
+    {"get_genotype", (PyCFunction) Table_get_genotype, METH_VARARGS,
+            "Return the call for a sample in a genotype column" },
+    {"count_alleles", (PyCFunction) Table_count_alleles, METH_VARARGS,
+            "Return the number of calls of each allele in a genotype column" },
+    {"get_genotypes", (PyCFunction) Table_get_genotypes, METH_VARARGS,
+            "Write the calls in a genotype column to buffers" },
+    {"write_packed_column", (PyCFunction) Table_write_packed_column,
+            METH_VARARGS, "Write an integer column to a packed column file" },
+    {"read_packed_column", (PyCFunction) Table_read_packed_column,
+            METH_VARARGS, "Read values from a packed column file to buffers" },
+    {"copy_rows", (PyCFunction) Table_copy_rows, METH_VARARGS|METH_KEYWORDS,
+            "Copy the rows of a table opened for reading into this table" },
+    {"open", (PyCFunction) Table_open, METH_VARARGS, "Open the table" },
+    {"close", (PyCFunction) Table_close, METH_NOARGS, "Close the table" },
+    {"start_writer", (PyCFunction) Table_start_writer, METH_VARARGS,
+            "Write committed rows on a background thread." },
+    {"commit_row", (PyCFunction) Table_commit_row, METH_NOARGS,
+            "Commit a row to the table in write mode." },
+    {"append_many", (PyCFunction) Table_append_many, METH_VARARGS,
+            "Insert and commit a sequence of rows of Python values." },
+    {"append_encoded_many", (PyCFunction) Table_append_encoded_many,
+            METH_VARARGS,
+            "Insert and commit a sequence of rows of encoded byte values." },
+    {"append_buffers", (PyCFunction) Table_append_buffers,
+            METH_VARARGS,
+            "Insert and commit rows from a sequence of column buffers." },
+    {"set_vcf_plan", (PyCFunction) Table_set_vcf_plan, METH_VARARGS,
+            "Set the mapping from VCF fields to columns for append_vcf_line." },
+    {"append_vcf_line", (PyCFunction) Table_append_vcf_line, METH_VARARGS,
+            "Parse a VCF data line and commit it as a row in write mode." },
+    {"encode_vcf_lines", (PyCFunction) Table_encode_vcf_lines, METH_VARARGS,
+            "Parse a list of VCF data lines and return the encoded rows." },
+    {"profile_vcf_lines", (PyCFunction) Table_profile_vcf_lines, METH_VARARGS,
+            "Parse a list of VCF data lines and update the column profiles." },
+    {"get_column_profile", (PyCFunction) Table_get_column_profile,
+            METH_VARARGS, "Return the profile of the specified column." },
+    {"append_encoded_rows", (PyCFunction) Table_append_encoded_rows,
+            METH_VARARGS,
+            "Commit rows returned by encode_vcf_lines in write mode." },
+    {"insert_elements", (PyCFunction) Table_insert_elements, METH_VARARGS,
+            "insert element values encoded as native Python objects." },
+    {"insert_encoded_elements", (PyCFunction) Table_insert_encoded_elements,
+            METH_VARARGS,
+            "insert element values encoded as comma seperated byte values." },
+    {NULL}  /* Sentinel */
+};
+
+static PyTypeObject TableType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_wormtable.Table",             /* tp_name */
+    sizeof(Table),             /* tp_basicsize */
+    0,                         /* tp_itemsize */
+    (destructor)Table_dealloc, /* tp_dealloc */
+    0,                         /* tp_print */
+    0,                         /* tp_getattr */
+    0,                         /* tp_setattr */
+    0,                         /* tp_reserved */
+    0,                         /* tp_repr */
+    0,                         /* tp_as_number */
+    0,                         /* tp_as_sequence */
+    0,                         /* tp_as_mapping */
+    0,                         /* tp_hash  */
+    0,                         /* tp_call */
+    0,                         /* tp_str */
+    0,                         /* tp_getattro */
+    0,                         /* tp_setattro */
+    0,                         /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,        /* tp_flags */
+    "Table objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    Table_methods,             /* tp_methods */
+    Table_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Table_init,      /* tp_init */
+};
+
+
+
+
+/*==========================================================
+ * Index object
+ *==========================================================
+ */
+
+static void
+Index_dealloc(Index* self)
+{
+    Py_XDECREF(self->table);
+    Py_XDECREF(self->db_filename);
+    /* make sure that the DB handles are closed. We can ignore errors here. */
+    if (self->db != NULL) {
+        self->db->close(self->db, 0);
+    }
+    if (self->columns != NULL) {
+        PyMem_Free(self->columns);
+    }
+    if (self->bin_widths != NULL) {
+        PyMem_Free(self->bin_widths);
+    }
+    if (self->key_buffer != NULL) {
+        PyMem_Free(self->key_buffer);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int
+Index_init(Index *self, PyObject *args, PyObject *kwds)
+{
+    int j;
+    long k;
+    int ret = -1;
+    static char *kwlist[] = {"table", "db_filename", "columns", "cache_size", NULL};
+    PyObject *v;
+    Column *col;
+    PyObject *db_filename = NULL;
+    PyObject *columns = NULL;
+    Table *table = NULL;
+    uint32_t n;
+
+    self->db = NULL;
+    self->table = NULL;
+    self->db_filename = NULL;
+    self->bin_widths = NULL;
+    self->key_buffer = NULL;
+    self->columns = NULL;
+    self->interval = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!O!K", kwlist,
+            &TableType, &table,
+            &PyBytes_Type, &db_filename,
+            &PyList_Type,  &columns,
+            &self->cache_size)) {
+        goto out;
+    }
+    self->table = table;
+    Py_INCREF(self->table);
+    self->db_filename = db_filename;
+    Py_INCREF(self->db_filename);
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    self->num_columns = PyList_GET_SIZE(columns);
+    if (self->num_columns < 1) {
+        PyErr_SetString(PyExc_ValueError, "Must be 1 or more columns index.");
+        goto out;
+    }
+    self->columns = PyMem_Malloc(self->num_columns * sizeof(uint32_t));
+    if (self->columns == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    self->bin_widths = PyMem_Malloc(self->num_columns * sizeof(double));
+    if (self->bin_widths == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(self->bin_widths, 0, self->num_columns * sizeof(double));
+    self->key_buffer_size = 0;
+    for (j = 0; j < self->num_columns; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+            goto out;
+        }
+        k = PyLong_AsLong(v);
+        if (k < 0 || k >= self->table->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+            goto out;
+        }
+        self->columns[j] = (uint32_t) k;
+        col = self->table->columns[k];
+        if (col->element_type == WT_GENOTYPE) {
+            PyErr_Format(PyExc_ValueError,
+                    "Cannot index genotype column '%s'",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        n = col->num_elements;
+        if (Column_is_variable(col)) {
+            /* allow space for the sentinel */
+            n = Column_get_max_num_elements(col) + 1;
+            /* allow space for the missing value indicator */
+            self->key_buffer_size += 1;
+        }
+        self->key_buffer_size += n * col->element_size;
+    }
+    self->key_buffer = PyMem_Malloc(self->key_buffer_size);
+    if (self->key_buffer == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    ret = 0;
+out:
+
+    return ret;
+}
+
+
+static PyMemberDef Index_members[] = {
+    {"table", T_OBJECT_EX, offsetof(Index, table), READONLY, "table"},
+    {"db_filename", T_OBJECT_EX, offsetof(Index, db_filename), READONLY, "db_filename"},
+    {"cache_size", T_ULONGLONG, offsetof(Index, cache_size), READONLY, "cache_size"},
+    {"interval", T_INT, offsetof(Index, interval), READONLY, "interval"},
+    {NULL}  /* Sentinel */
+};
+
+
+/*
+ * Returns 0 if the table is opened in write mode. Otherwise
+ * -1 is returned with the appropriate Python exception set.
+ */
+static int
+Index_check_write_mode(Index *self)
+{
+    int ret = -1;
+    int db_ret;
+    uint32_t flags;
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    if (self->db == NULL) {
+        PyErr_Format(WormtableError, "Index closed.");
+        goto out;
+    }
+    db_ret = self->db->get_open_flags(self->db, &flags);
+    if (db_ret != 0) {
+        handle_bdb_error(flags);
+        goto out;
+    }
+    if ((flags & DB_RDONLY) != 0) {
+        PyErr_Format(WormtableError, "Index must be opened WT_WRITE.");
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+/*
+ * Returns 0 if the table is opened in read mode. Otherwise
+ * -1 is returned with the appropriate Python exception set.
+ */
+static int
+Index_check_read_mode(Index *self)
+{
+    int ret = -1;
+    int db_ret;
+    uint32_t flags;
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    if (self->db == NULL) {
+        PyErr_Format(WormtableError, "Index closed.");
+        goto out;
+    }
+    db_ret = self->db->get_open_flags(self->db, &flags);
+    if (db_ret != 0) {
+        handle_bdb_error(flags);
+        goto out;
+    }
+    if ((flags & DB_RDONLY) == 0) {
+        PyErr_Format(WormtableError, "Index must be opened WT_READ.");
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static int
+cmp_key_request(const void *a, const void *b)
+{
+    const key_request_t *ia = (const key_request_t *) a;
+    const key_request_t *ib = (const key_request_t *) b;
+    return compare_keys(ia->key, ia->size, ib->key, ib->size);
+}
+
+/*
+ * Returns the smallest bin that contains the closed interval [start, end].
+ */
+static uint32_t
+interval_get_bin(uint64_t start, uint64_t end)
+{
+    uint32_t ret = 0;
+    int j;
+    uint64_t start_bin = start >> WT_INTERVAL_FIRST_SHIFT;
+    uint64_t end_bin = end >> WT_INTERVAL_FIRST_SHIFT;
+    for (j = 0; j < WT_INTERVAL_NUM_LEVELS; j++) {
+        if (start_bin == end_bin) {
+            ret = interval_bin_offsets[j] + (uint32_t) start_bin;
+            break;
+        }
+        start_bin >>= WT_INTERVAL_NEXT_SHIFT;
+        end_bin >>= WT_INTERVAL_NEXT_SHIFT;
+    }
+    return ret;
+}
+
+/*
+ * Reads the first value in the element buffer of the specified integer
+ * column as an interval coordinate. Returns WT_MISSING_VALUE if the
+ * missing value is stored, 0 if a valid coordinate was read, and -1
+ * with the appropriate Python exception set if the value cannot be
+ * used as a coordinate.
+ */
+static int
+Column_get_coordinate(Column *self, uint64_t *coordinate)
+{
+    int ret = -1;
+    uint64_t u;
+    int64_t v;
+    if (self->element_type == WT_UINT) {
+        u = ((uint64_t *) self->element_buffer)[0];
+        if (u == missing_uint(self->element_size)) {
+            ret = WT_MISSING_VALUE;
+            goto out;
+        }
+    } else {
+        v = ((int64_t *) self->element_buffer)[0];
+        if (v == missing_int(self->element_size)) {
+            ret = WT_MISSING_VALUE;
+            goto out;
+        }
+        if (v < 0) {
+            PyErr_Format(PyExc_ValueError,
+                    "Negative interval coordinate in column '%s'",
+                    PyBytes_AsString(self->name));
+            goto out;
+        }
+        u = (uint64_t) v;
+    }
+    if (u > WT_INTERVAL_MAX_COORDINATE) {
+        PyErr_Format(PyExc_ValueError,
+                "Interval coordinate too large in column '%s'",
+                PyBytes_AsString(self->name));
+        goto out;
+    }
+    *coordinate = u;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Packs the bin for the interval in the specified row into the specified
+ * destination. Intervals with a missing start or end coordinate, or
+ * an end before the start, are assigned to bin 0.
+ */
+static int
+Index_pack_interval_bin(Index *self, void *row, void *dest)
+{
+    int ret = -1;
+    int start_ret, end_ret;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint32_t bin = 0;
+    Column *start_col = self->table->columns[
+            self->columns[self->num_columns - 2]];
+    Column *end_col = self->table->columns[
+            self->columns[self->num_columns - 1]];
+
+    if (Column_extract_elements(start_col, row) < 0) {
+        goto out;
+    }
+    start_ret = Column_get_coordinate(start_col, &start);
+    if (start_ret < 0) {
+        goto out;
+    }
+    if (Column_extract_elements(end_col, row) < 0) {
+        goto out;
+    }
+    end_ret = Column_get_coordinate(end_col, &end);
+    if (end_ret < 0) {
+        goto out;
+    }
+    if (start_ret == 0 && end_ret == 0 && start <= end) {
+        bin = interval_get_bin(start, end);
+    }
+    pack_uint(bin, dest, WT_INTERVAL_BIN_SIZE);
+    ret = 0;
+out:
+    return ret;
+}
+
+/* extract values from the specified row and push them into the specified
+ * secondary key. This has valid memory associated with it.
+ */
+static int
+Index_fill_key(Index *self, void *row, DBT *skey)
+{
+    int ret = -1;
+    int wt_ret;
+    Column *col;
+    uint32_t j, k;
+    int len;
+    unsigned char *v = skey->data;
+    skey->size = 0;
+    for (j = 0; j < self->num_columns; j++) {
+        col = self->table->columns[self->columns[j]];
+        len = 0;
+        if (self->interval && j == self->num_columns - 2) {
+            /* the bin precedes the start coordinate */
+            if (Index_pack_interval_bin(self, row, v) < 0) {
+                goto out;
+            }
+            v += WT_INTERVAL_BIN_SIZE;
+            skey->size += WT_INTERVAL_BIN_SIZE;
+        }
+        wt_ret = Column_extract_elements(col, row);
+        if (wt_ret < 0) {
+            ret = wt_ret;
+            goto out;
+        }
+        if (Column_is_variable(col)) {
+            /* insert the missing value prefix */
+            *v = wt_ret == WT_MISSING_VALUE ? 0 : 1;
+            v++;
+            skey->size++;
+        }
+        if (self->bin_widths[j] != 0.0) {
+            if (col->truncate_elements(col, self->bin_widths[j]) < 0) {
+                goto out;
+            }
+        }
+        if (col->pack_key_elements(col, v) < 0) {
+            goto out;
+        }
+        len = col->num_buffered_elements * col->element_size;
+        if (len < 0) {
+            goto out;
+        }
+        v += len;
+        skey->size += len;
+        if (Column_is_variable(col)) {
+            /* insert the sentinel */
+            for (k = 0; k < col->element_size; k++) {
+                *v = 0;
+                v++;
+                skey->size++;
+            }
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Packs the bin for the interval with the specified Python start and
+ * end values into the specified destination.
+ */
+static int
+Index_set_interval_bin(Index *self, PyObject *start_value,
+        PyObject *end_value, void *dest)
+{
+    int ret = -1;
+    int start_ret, end_ret;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint32_t bin = 0;
+    Column *start_col = self->table->columns[
+            self->columns[self->num_columns - 2]];
+    Column *end_col = self->table->columns[
+            self->columns[self->num_columns - 1]];
+
+    if (start_col->python_to_native(start_col, start_value) < 0) {
+        goto out;
+    }
+    if (start_col->verify_elements(start_col) < 0) {
+        goto out;
+    }
+    start_ret = Column_get_coordinate(start_col, &start);
+    if (start_ret < 0) {
+        goto out;
+    }
+    if (end_col->python_to_native(end_col, end_value) < 0) {
+        goto out;
+    }
+    if (end_col->verify_elements(end_col) < 0) {
+        goto out;
+    }
+    end_ret = Column_get_coordinate(end_col, &end);
+    if (end_ret < 0) {
+        goto out;
+    }
+    if (start_ret == 0 && end_ret == 0 && start <= end) {
+        bin = interval_get_bin(start, end);
+    }
+    pack_uint(bin, dest, WT_INTERVAL_BIN_SIZE);
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Packs the key values in the specified tuple into the specified buffer,
+ * returning its length.
+ */
+static int
+Index_pack_key(Index *self, PyObject *elements, void *buffer)
+{
+    int ret = -1;
+    int j, m, k, wt_ret, overhead;
+    int key_size = 0;
+    Py_ssize_t n;
+    Column *col = NULL;
+    PyObject *v = NULL;
+    char *key_buffer = (char *) buffer;
+    if (!PyTuple_Check(elements)) {
+        PyErr_SetString(PyExc_TypeError, "Keys must be tuples");
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    n = PyTuple_GET_SIZE(elements);
+    if (n > self->num_columns) {
+        PyErr_Format(PyExc_ValueError, "More key values than columns.");
+        goto out;
+    }
+    if (self->interval && n == self->num_columns - 1) {
+        PyErr_Format(PyExc_ValueError,
+                "Interval index keys must include both start and end.");
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        col = self->table->columns[self->columns[j]];
+        v = PyTuple_GetItem(elements, j);
+        if (self->interval && j == self->num_columns - 2) {
+            if (key_size + WT_INTERVAL_BIN_SIZE > self->key_buffer_size) {
+                PyErr_Format(PyExc_SystemError, "Max key_size exceeded.");
+                goto out;
+            }
+            if (Index_set_interval_bin(self, v,
+                    PyTuple_GetItem(elements, j + 1), key_buffer) < 0) {
+                goto out;
+            }
+            key_buffer += WT_INTERVAL_BIN_SIZE;
+            key_size += WT_INTERVAL_BIN_SIZE;
+        }
+        wt_ret = col->python_to_native(col, v);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (col->verify_elements(col) < 0) {
+            goto out;
+        }
+        m = col->num_buffered_elements * col->element_size;
+        overhead = Column_is_variable(col) ? 1 + col->element_size: 0;
+        if (key_size + m + overhead > self->key_buffer_size) {
+            PyErr_Format(PyExc_SystemError, "Max key_size exceeded.");
+            goto out;
+        }
+        if (Column_is_variable(col)) {
+            /* insert the missing value prefix */
+            *key_buffer = wt_ret == WT_MISSING_VALUE? 0 : 1;
+            key_buffer++;
+            key_size++;
+        }
+        col->pack_key_elements(col, key_buffer);
+        key_buffer += m;
+        key_size += m;
+        if (Column_is_variable(col)) {
+            /* insert the sentinel */
+            for (k = 0; k < col->element_size; k++) {
+                *key_buffer = 0;
+                key_buffer++;
+                key_size++;
+            }
+        }
+    }
+    ret = key_size;
+out:
+    return ret;
+}
+
+/*
+ * Reads the arguments and sets a key in the specified buffer, returning
+ * its length.
+ */
+static int
+Index_set_key(Index *self, PyObject *args, void *buffer)
+{
+    int ret = -1;
+    PyObject *elements = NULL;
+    if (!PyArg_ParseTuple(args, "O!", &PyTuple_Type, &elements)) {
+        goto out;
+    }
+    ret = Index_pack_key(self, elements, buffer);
+out:
+    return ret;
+}
+
+/*
+ * Increment the specified key. This increments the least significant
+ * byte, and then carries the result up the more signficant bytes as
+ * required. Returns 1 if the key overflows, and the key is zero as
+ * a result.
+ */
+static int
+Index_increment_key(Index *self, void *buffer, uint32_t key_size)
+{
+    int j;
+    int overflow = 0;
+    unsigned char *key_buffer = (unsigned char *) buffer;
+    j = key_size - 1;
+    /* add one to the buffer, making sure to carry base 256 */
+    while (j > 0 && key_buffer[j] == 255) {
+        key_buffer[j] = 0;
+        j--;
+    }
+    key_buffer[j] += 1;
+    if (j == 0 && key_buffer[0] == 0) {
+        overflow = 1;
+    }
+    return overflow;
+}
+
+
+
+static PyObject *
+Index_key_to_python(Index *self, void *key_buffer, uint32_t key_size)
+{
+    PyObject *ret = NULL;
+    PyObject *value;
+    uint32_t j, offset;
+    Column *col;
+    char *v;
+    int n, missing_value, wt_ret;
+    PyObject *t = PyTuple_New(self->num_columns);
+    if (t == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    offset = 0;
+    for (j = 0; j < self->num_columns; j++) {
+        missing_value = 0;
+        col = self->table->columns[self->columns[j]];
+        n = 0;
+        if (self->interval && j == self->num_columns - 2) {
+            /* skip the bin */
+            offset += WT_INTERVAL_BIN_SIZE;
+        }
+        if (Column_is_variable(col)) {
+            v = (char *) key_buffer;
+            v += offset;
+            missing_value = *v == 0;
+            offset++;
+            wt_ret = Column_extract_key(col, key_buffer, offset, key_size);
+            if (wt_ret < 0) {
+                Py_DECREF(t);
+                goto out;
+            }
+            /* skip the sentinel */
+            n = 1;
+        } else {
+            wt_ret = Column_extract_key(col, key_buffer, offset, key_size);
+            if (wt_ret < 0) {
+                Py_DECREF(t);
+                goto out;
+            }
+            missing_value = wt_ret == WT_MISSING_VALUE;
+        }
+        n += col->num_buffered_elements;
+        offset += n * col->element_size;
+        value = Column_get_python_elements(col, missing_value);
+        if (value == NULL) {
+            Py_DECREF(t);
+            goto out;
+        }
+        PyTuple_SET_ITEM(t, j, value);
+    }
+    ret = t;
+out:
+    return ret;
+}
+
+static PyObject *
+Index_get_num_rows(Index *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    int db_ret, key_size;
+    db_recno_t count = 0;
+    DB *db = NULL;
+    DBC *cursor = NULL;
+    DBT key, data;
+    key_size = Index_set_key(self, args, self->key_buffer);
+    if (key_size < 0) {
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    db = self->db;
+    if (db == NULL) {
+        PyErr_SetString(WormtableError, "table closed");
+        goto out;
+    }
+    db_ret = db->cursor(db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    key.data = self->key_buffer;
+    key.size = (uint32_t) key_size;
+    db_ret = cursor->get(cursor, &key, &data, DB_SET);
+    if (db_ret == 0) {
+        db_ret = cursor->count(cursor, &count, 0);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+    } else if (db_ret != DB_NOTFOUND) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    ret = PyLong_FromUnsignedLongLong((unsigned long long) count);
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+
+    return ret;
+}
+
+/*
+ * Moves the specified cursor forward to the first key >= the specified
+ * target, given that the cursor is currently positioned at a key that
+ * is less than or equal to it. If the target is near, we step over the
+ * intervening keys; otherwise we seek to it directly. The state is 0 if
+ * the cursor is unpositioned, 1 if it is positioned at the key held in
+ * the specified DBT and -1 if it has reached the end of the index.
+ * Returns 1 if the target was found, 0 if not and -1 on error.
+ */
+static int
+Index_seek_key(Index *self, DBC *cursor, DBT *key, DBT *data, int *state,
+        void *target, uint32_t target_size)
+{
+    int ret = -1;
+    int db_ret, cmp, steps;
+
+    if (*state == -1) {
+        ret = 0;
+        goto out;
+    }
+    if (*state == 1) {
+        steps = 0;
+        cmp = compare_keys(key->data, key->size, target, target_size);
+        while (cmp < 0 && steps < WT_MAX_SEEK_STEPS) {
+            db_ret = cursor->get(cursor, key, data, DB_NEXT_NODUP);
+            if (db_ret == DB_NOTFOUND) {
+                *state = -1;
+                ret = 0;
+                goto out;
+            }
+            if (db_ret != 0) {
+                handle_bdb_error(db_ret);
+                goto out;
+            }
+            cmp = compare_keys(key->data, key->size, target, target_size);
+            steps++;
+        }
+        if (cmp >= 0) {
+            ret = cmp == 0;
+            goto out;
+        }
+    }
+    memset(key, 0, sizeof(DBT));
+    memset(data, 0, sizeof(DBT));
+    key->data = target;
+    key->size = target_size;
+    db_ret = cursor->get(cursor, key, data, DB_SET_RANGE);
+    if (db_ret == DB_NOTFOUND) {
+        *state = -1;
+        ret = 0;
+        goto out;
+    }
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    *state = 1;
+    ret = compare_keys(key->data, key->size, target, target_size) == 0;
+out:
+    return ret;
+}
+
+/*
+ * Moves the specified index cursor and gets the index key, primary key
+ * and primary record at its new position as cursor->pget does. Indexes
+ * of tables with dense rows are not associated with the primary DB, so
+ * the primary record is computed from the primary key instead. Returns
+ * 0 or a DB error code.
+ */
+static int
+Index_cursor_pget(Index *self, DBC *cursor, DBT *skey, DBT *pkey,
+        DBT *pdata, uint32_t flags)
+{
+    int ret;
+    if (self->table->dense_rows) {
+        ret = cursor->get(cursor, skey, pkey, flags);
+        if (ret == 0) {
+            ret = Table_get_record(self->table, pkey, pdata);
+        }
+    } else {
+        ret = cursor->pget(cursor, skey, pkey, pdata, flags);
+    }
+    return ret;
+}
+
+/*
+ * Returns a list of the rows in the table with the key at the current
+ * position of the specified cursor, leaving the cursor positioned at the
+ * last of these rows.
+ */
+static PyObject *
+Index_get_duplicate_rows(Index *self, DBC *cursor, DBT *key, DBT *data,
+        uint32_t *columns, uint32_t num_columns)
+{
+    PyObject *ret = NULL;
+    PyObject *rows = NULL;
+    PyObject *row = NULL;
+    int db_ret;
+    DBT pkey, pdata;
+
+    rows = PyList_New(0);
+    if (rows == NULL) {
+        goto out;
+    }
+    do {
+        memset(&pkey, 0, sizeof(DBT));
+        memset(&pdata, 0, sizeof(DBT));
+        pkey.data = data->data;
+        pkey.size = data->size;
+        db_ret = Table_get_record(self->table, &pkey, &pdata);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+        if (Table_retrieve_row(self->table, &pkey, &pdata,
+                    Table_get_families(self->table, columns, num_columns))
+                != 0) {
+            goto out;
+        }
+        row = Table_get_python_row(self->table, columns, num_columns);
+        if (row == NULL) {
+            goto out;
+        }
+        if (PyList_Append(rows, row) != 0) {
+            goto out;
+        }
+        Py_CLEAR(row);
+        db_ret = cursor->get(cursor, key, data, DB_NEXT_DUP);
+    } while (db_ret == 0);
+    if (db_ret != DB_NOTFOUND) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    ret = rows;
+    rows = NULL;
+out:
+    Py_XDECREF(row);
+    Py_XDECREF(rows);
+    return ret;
+}
+
+/*
+ * Looks up all of the keys in the specified list in a single forward
+ * pass over the index. If columns is NULL, a list of the number of rows
+ * with each key is returned. Otherwise, a list of the rows with each key
+ * is returned, each row being a tuple of the values of the specified
+ * columns.
+ */
+static PyObject *
+Index_get_many(Index *self, PyObject *keys, uint32_t *columns,
+        uint32_t num_columns)
+{
+    PyObject *ret = NULL;
+    PyObject *result = NULL;
+    PyObject *value = NULL;
+    key_request_t *requests = NULL;
+    char *key_buffer = NULL;
+    Py_ssize_t j, n;
+    int size, found, db_ret;
+    int state = 0;
+    db_recno_t count;
+    DBC *cursor = NULL;
+    DBT key, data;
+
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    n = PyList_GET_SIZE(keys);
+    key_buffer = PyMem_Malloc(n * self->key_buffer_size + 1);
+    requests = PyMem_Malloc((n + 1) * sizeof(key_request_t));
+    if (key_buffer == NULL || requests == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        requests[j].key = key_buffer + j * self->key_buffer_size;
+        size = Index_pack_key(self, PyList_GET_ITEM(keys, j),
+                requests[j].key);
+        if (size < 0) {
+            goto out;
+        }
+        requests[j].size = (uint32_t) size;
+        requests[j].position = j;
+    }
+    qsort(requests, n, sizeof(key_request_t), cmp_key_request);
+    result = PyList_New(n);
+    if (result == NULL) {
+        goto out;
+    }
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        cursor = NULL;
+        goto out;
+    }
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    for (j = 0; j < n; j++) {
+        if (j > 0 && cmp_key_request(&requests[j - 1], &requests[j]) == 0) {
+            /* duplicate keys share the same value */
+            value = PyList_GET_ITEM(result, requests[j - 1].position);
+            Py_INCREF(value);
+        } else {
+            found = Index_seek_key(self, cursor, &key, &data, &state,
+                    requests[j].key, requests[j].size);
+            if (found < 0) {
+                goto out;
+            }
+            if (columns == NULL) {
+                count = 0;
+                if (found) {
+                    db_ret = cursor->count(cursor, &count, 0);
+                    if (db_ret != 0) {
+                        handle_bdb_error(db_ret);
+                        goto out;
+                    }
+                }
+                value = PyLong_FromUnsignedLongLong(
+                        (unsigned long long) count);
+            } else if (found) {
+                value = Index_get_duplicate_rows(self, cursor, &key, &data,
+                        columns, num_columns);
+            } else {
+                value = PyList_New(0);
+            }
+            if (value == NULL) {
+                goto out;
+            }
+        }
+        PyList_SET_ITEM(result, requests[j].position, value);
+    }
+    ret = result;
+    result = NULL;
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+    Py_XDECREF(result);
+    if (key_buffer != NULL) {
+        PyMem_Free(key_buffer);
+    }
+    if (requests != NULL) {
+        PyMem_Free(requests);
+    }
+    return ret;
+}
+
+static PyObject *
+Index_count_many(Index *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *keys = NULL;
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &keys)) {
+        goto out;
+    }
+    ret = Index_get_many(self, keys, NULL, 0);
+out:
+    return ret;
+}
+
+static PyObject *
+Index_lookup_many(Index *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    PyObject *keys = NULL;
+    PyObject *columns = NULL;
+    PyObject *v;
+    uint32_t *cols = NULL;
+    uint32_t j, num_columns;
+    long k;
+    if (!PyArg_ParseTuple(args, "O!O!", &PyList_Type, &keys,
+            &PyList_Type, &columns)) {
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    num_columns = PyList_GET_SIZE(columns);
+    cols = PyMem_Malloc((num_columns + 1) * sizeof(uint32_t));
+    if (cols == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < num_columns; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+            goto out;
+        }
+        k = PyLong_AsLong(v);
+        if (k < 0 || k >= self->table->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+            goto out;
+        }
+        cols[j] = (uint32_t) k;
+    }
+    ret = Index_get_many(self, keys, cols, num_columns);
+out:
+    if (cols != NULL) {
+        PyMem_Free(cols);
+    }
+    return ret;
+}
+
+static PyObject *
+Index_get_min(Index* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    int db_ret;
+    DBC *cursor = NULL;
+    DBT key, data;
+    int key_size = Index_set_key(self, args, self->key_buffer);
+    if (key_size < 0) {
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    key.data = self->key_buffer;
+    key.size = (uint32_t) key_size;
+    db_ret = cursor->get(cursor, &key, &data, DB_SET_RANGE);
+    if (db_ret == 0) {
+        if (key_size > key.size) {
+            PyErr_Format(PyExc_SystemError, "key size comparison error.");
+            goto out;
+        }
+        if (memcmp(self->key_buffer, key.data, key_size) != 0) {
+            PyErr_SetObject(PyExc_KeyError, args);
+            goto out;
+        }
+        ret = Index_key_to_python(self, key.data, key.size);
+        if (ret == NULL) {
+            goto out;
+        }
+    } else {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+    return ret;
+}
+
+
+static PyObject *
+Index_get_max(Index* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    int db_ret, key_size, cmp, overflow;
+    unsigned char *search_key = NULL;
+    DBC *cursor = NULL;
+    DBT key, data;
+    key_size = Index_set_key(self, args, self->key_buffer);
+    if (key_size < 0) {
+        goto out;
+    }
+    if (Index_check_read_mode(self) != 0) {
+        goto out;
+    }
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    db_ret = self->db->cursor(self->db, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    key.data = self->key_buffer;
+    key.size = (uint32_t) key_size;
+    if (key_size == 0) {
+        /* An empty list has been passed so we want the last value */
+        db_ret = cursor->get(cursor, &key, &data, DB_LAST);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+    } else {
+        search_key = PyMem_Malloc(key_size + 1);
+        if (search_key == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        memcpy(search_key, self->key_buffer, key_size);
+        overflow = Index_increment_key(self, self->key_buffer, key_size);
+        /* Seek to the first key prefix >= to this */
+        db_ret = cursor->get(cursor, &key, &data, DB_SET_RANGE);
+        /* If this is not found, we want the last key in the index */
+        if (db_ret == DB_NOTFOUND || overflow) {
+            db_ret = cursor->get(cursor, &key, &data, DB_LAST);
+            if (db_ret != 0) {
+                handle_bdb_error(db_ret);
+                goto out;
+            }
+        } else if (db_ret == 0) {
+           /* We need to seek backwards from here until the prefix matches
+            * the provided key.
+            */
+            do {
+                db_ret = cursor->get(cursor, &key, &data, DB_PREV);
+                if (db_ret != 0) {
+                    handle_bdb_error(db_ret);
+                    goto out;
+                }
+                cmp = memcmp(search_key, key.data, key_size);
+                if (cmp > 0) {
+                    PyErr_SetObject(PyExc_KeyError, args);
+                    goto out;
+                }
+            } while (cmp != 0);
+        } else {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+    }
+    ret = Index_key_to_python(self, key.data, key.size);
+out:
+    if (cursor != NULL) {
+        cursor->close(cursor);
+    }
+    if (search_key != NULL) {
+        PyMem_Free(search_key);
+    }
+    return ret;
+}
+
+static PyObject *
+Index_set_bin_widths(Index* self, PyObject *args)
+{
+    Column* col = NULL;
+    PyObject *ret = NULL;
+    PyObject *w = NULL;
+    unsigned int j;
+    PyObject *bin_widths = NULL;
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &bin_widths)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    if (self->db != NULL) {
+        PyErr_Format(WormtableError, "Cannot set bin_widths after open()");
+        goto out;
+    }
+    if (PyList_GET_SIZE(bin_widths) != self->num_columns) {
+        PyErr_Format(PyExc_ValueError,
+                "Number of bins must equal to the number of columns");
+        goto out;
+    }
+    for (j = 0; j < PyList_GET_SIZE(bin_widths); j++) {
+        w = PyList_GET_ITEM(bin_widths, j);
+        col = self->table->columns[self->columns[j]];
+        if (!PyNumber_Check(w)) {
+            PyErr_Format(PyExc_TypeError,
+                    "Bad bin width for '%s': bin widths must be numeric",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        self->bin_widths[j] = PyFloat_AsDouble(w);
+        if (PyErr_Occurred()) {
+            goto out;
+        }
+        if (self->bin_widths[j] < 0.0) {
+            PyErr_Format(PyExc_ValueError,
+                    "Bad bin width for '%s': bin widths must be nonnegative",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if ((col->element_type == WT_CHAR || col->element_type == WT_DICT)
+                && self->bin_widths[j] != 0.0) {
+            PyErr_Format(PyExc_ValueError,
+                    "Bad bin width for '%s': char columns do not support bins",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (col->element_type == WT_INT) {
+            if (fmod(self->bin_widths[j], 1.0) != 0.0) {
+                PyErr_Format(PyExc_ValueError,
+                        "Bad bin width for '%s': "
+                        "integer column bins must be integers",
+                        PyBytes_AsString(col->name));
+                goto out;
+            }
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static PyObject *
+Index_set_interval(Index* self)
+{
+    Column* col = NULL;
+    PyObject *ret = NULL;
+    void *key_buffer = NULL;
+    uint32_t j;
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    if (self->db != NULL) {
+        PyErr_Format(WormtableError, "Cannot set interval after open()");
+        goto out;
+    }
+    if (self->interval) {
+        PyErr_Format(WormtableError, "Index is already an interval index");
+        goto out;
+    }
+    if (self->num_columns < 2) {
+        PyErr_Format(PyExc_ValueError,
+                "Interval indexes require start and end columns");
+        goto out;
+    }
+    for (j = self->num_columns - 2; j < self->num_columns; j++) {
+        col = self->table->columns[self->columns[j]];
+        if (col->element_type != WT_UINT && col->element_type != WT_INT) {
+            PyErr_Format(PyExc_ValueError,
+                    "Bad interval column '%s': must be an integer column",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (col->num_elements != 1) {
+            PyErr_Format(PyExc_ValueError,
+                    "Bad interval column '%s': must have one element",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+        if (self->bin_widths[j] != 0.0) {
+            PyErr_Format(PyExc_ValueError,
+                    "Bad interval column '%s': cannot have a bin width",
+                    PyBytes_AsString(col->name));
+            goto out;
+        }
+    }
+    key_buffer = PyMem_Realloc(self->key_buffer,
+            self->key_buffer_size + WT_INTERVAL_BIN_SIZE);
+    if (key_buffer == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    self->key_buffer = key_buffer;
+    self->key_buffer_size += WT_INTERVAL_BIN_SIZE;
+    self->interval = 1;
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static int
+cmp_index_record(const void *a, const void *b)
+{
+    const index_record_t *ia = (const index_record_t *) a;
+    const index_record_t *ib = (const index_record_t *) b;
+    int ret = compare_keys(ia->key, ia->key_size, ib->key, ib->key_size);
+    if (ret == 0) {
+        ret = compare_keys(ia->data, ia->data_size, ib->data, ib->data_size);
+    }
+    return ret;
+}
+
+/*
+ * Sorts the specified records and inserts them into the index DB. Inserting
+ * in key order keeps the updates to the underlying btree local, which is
+ * much faster than inserting in row order when the index already contains
+ * many keys.
+ */
+static int
+Index_insert_records(Index *self, index_record_t *records,
+        uint32_t num_records)
+{
+    int ret = -1;
+    int db_ret;
+    uint32_t j;
+    DB *sdb = self->db;
+    DBT skey, sdata;
+
+    qsort(records, num_records, sizeof(index_record_t), cmp_index_record);
+    memset(&skey, 0, sizeof(DBT));
+    memset(&sdata, 0, sizeof(DBT));
+    for (j = 0; j < num_records; j++) {
+        skey.data = records[j].key;
+        skey.size = records[j].key_size;
+        sdata.data = records[j].data;
+        sdata.size = records[j].data_size;
+        db_ret = sdb->put(sdb, NULL, &skey, &sdata, 0);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static PyObject *
+Index_build(Index* self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"progress_callback", "callback_interval",
+            "start_row", NULL};
+    int db_ret;
+    PyObject *ret = NULL;
+    PyObject *arglist, *result;
+    PyObject *progress_callback = NULL;
+    Column *id_col;
+    uint32_t primary_key_size, flags;
+    DBC *cursor = NULL;
+    DB *pdb = NULL;
+    DB *sdb = NULL;
+    DBT pkey, pdata, skey;
+    uint32_t truncate_count;
+    uint64_t callback_interval = 1000;
+    unsigned long long start_row = 0;
+    uint64_t records_processed = 0;
+    uint64_t position = 0;
+    unsigned char start_key[sizeof(uint64_t)];
+    index_record_t *records = NULL;
+    uint32_t num_records = 0;
+    uint32_t families;
+    char *batch = NULL;
+    size_t batch_used = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OKK", kwlist,
+            &progress_callback, &callback_interval, &start_row)) {
+        progress_callback = NULL;
+        goto out;
+    }
+    Py_XINCREF(progress_callback);
+    if (Index_check_write_mode(self) != 0) {
+        goto out;
+    }
+    if (progress_callback != NULL) {
+        if (!PyCallable_Check(progress_callback)) {
+            PyErr_SetString(PyExc_TypeError, "progress_callback must be callable");
+            goto out;
+        }
+    }
+    if (callback_interval == 0) {
+        PyErr_SetString(PyExc_ValueError, "callback interval cannot be 0");
+        goto out;
+    }
+    if (self->key_buffer_size + sizeof(uint64_t) > WT_INDEX_BATCH_SIZE) {
+        PyErr_SetString(WormtableError, "Index key too large");
+        goto out;
+    }
+    records = PyMem_Malloc(WT_INDEX_BATCH_RECORDS * sizeof(index_record_t));
+    batch = PyMem_Malloc(WT_INDEX_BATCH_SIZE);
+    if (records == NULL || batch == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    id_col = self->table->columns[0];
+    primary_key_size = id_col->element_size;
+    /* only the column families holding the key columns are read */
+    families = Table_get_families(self->table, self->columns,
+            self->num_columns);
+    pdb = self->table->db;
+    db_ret = pdb->cursor(pdb, NULL, &cursor, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        cursor = NULL;
+        goto out;
+    }
+    memset(&pkey, 0, sizeof(DBT));
+    memset(&pdata, 0, sizeof(DBT));
+    memset(&skey, 0, sizeof(DBT));
+    skey.data = self->key_buffer;
+    flags = DB_NEXT;
+    if (start_row > 0) {
+        /* Only index the rows from start_row onwards */
+        if (Column_set_row_id(id_col, (uint64_t) start_row) != 0) {
+            goto out;
+        }
+        if (Column_update_row(id_col, start_key, 0) != 0) {
+            goto out;
+        }
+        pkey.data = start_key;
+        pkey.size = primary_key_size;
+        flags = DB_SET_RANGE;
+    }
+    while ((db_ret = Table_cursor_get(self->table, cursor, &position, &pkey,
+                    &pdata, flags)) == 0) {
+        flags = DB_NEXT;
+        if (Table_retrieve_row(self->table, &pkey, &pdata, families) != 0) {
+            goto out;
+        }
+        if (Index_fill_key(self, self->table->row_buffer, &skey) < 0 ) {
+            goto out;
+        }
+        if (num_records == WT_INDEX_BATCH_RECORDS || batch_used + skey.size
+                + primary_key_size > WT_INDEX_BATCH_SIZE) {
+            if (Index_insert_records(self, records, num_records) != 0) {
+                goto out;
+            }
+            num_records = 0;
+            batch_used = 0;
+        }
+        records[num_records].key = batch + batch_used;
+        records[num_records].key_size = skey.size;
+        memcpy(batch + batch_used, skey.data, skey.size);
+        batch_used += skey.size;
+        records[num_records].data = batch + batch_used;
+        records[num_records].data_size = primary_key_size;
+        memcpy(batch + batch_used, self->table->row_buffer,
+                primary_key_size);
+        batch_used += primary_key_size;
+        num_records++;
+        /* Invoke the callback if necessary */
+        records_processed++;
+        if (records_processed % callback_interval == 0) {
+            if (progress_callback != NULL) {
+                arglist = Py_BuildValue("(K)", records_processed);
+                if (arglist == NULL) {
+                    goto out;
+                }
+                result = PyObject_CallObject(progress_callback, arglist);
+                Py_DECREF(arglist);
+                if (result == NULL) {
+                    goto out;
+                }
+                Py_DECREF(result);
+                /* Anything might have happened in the mean time, so
+                 * check the state of the DBs again!
+                 */
+                if (Index_check_write_mode(self) != 0) {
+                    goto out;
+                }
+            }
+        }
+    }
+    if (db_ret != DB_NOTFOUND) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    if (Index_insert_records(self, records, num_records) != 0) {
+        goto out;
+    }
+    db_ret = cursor->close(cursor);
+    cursor = NULL;
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    Py_XDECREF(progress_callback);
+    PyMem_Free(records);
+    PyMem_Free(batch);
+    if (cursor != NULL) {
+        /* ignore errors in this case, as we're already handling one */
+        if (self->table != NULL) {
+            if (self->table->db != NULL) {
+                cursor->close(cursor);
+            }
+        }
+        /* When appending we leave the existing keys in place */
+        if (self->db != NULL && start_row == 0) {
+            sdb = self->db;
+            db_ret = sdb->truncate(sdb, NULL, &truncate_count, 0);
+        }
+    }
+    return ret;
+}
+
+static PyObject *
+Index_open(Index* self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    char *db_name = NULL;
+    uint32_t flags = 0;
+    Py_ssize_t gigabyte = 1024 * 1024 * 1024;
+    uint32_t gigs, bytes;
+    int db_ret, mode;
+    DB *pdb;
+    if (!PyArg_ParseTuple(args, "i", &mode)) {
+        goto out;
+    }
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    pdb = self->table->db;
+    if (mode == WT_WRITE) {
+        flags = DB_CREATE|DB_TRUNCATE;
+    } else if (mode == WT_READ) {
+        flags = DB_RDONLY|DB_NOMMAP;
+    } else if (mode == WT_APPEND) {
+        flags = 0;
+    } else {
+        PyErr_Format(PyExc_ValueError,
+                "mode must be WT_READ, WT_WRITE or WT_APPEND.");
+        goto out;
+    }
+    if (self->db != NULL) {
+        PyErr_Format(WormtableError, "Index already open.");
+        goto out;
+    }
+    db_name = PyBytes_AsString(self->db_filename);
+    if (db_name == NULL) {
+        goto out;
+    }
+    /* Now we create the DB handle */
+    db_ret = db_create(&self->db, NULL, 0);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    gigs = (uint32_t) (self->cache_size / gigabyte);
+    bytes = (uint32_t) (self->cache_size % gigabyte);
+    db_ret = self->db->set_cachesize(self->db, gigs, bytes, 1);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    db_ret = self->db->set_flags(self->db, DB_DUPSORT);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    db_ret = self->db->set_bt_compress(self->db, NULL, NULL);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    /* Disable DB error messages */
+    self->db->set_errcall(self->db, NULL);
+    db_ret = self->db->open(self->db, NULL, db_name, NULL, DB_BTREE, flags,
+            WT_DB_FILE_PERMS);
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        self->db->close(self->db, 0);
+        self->db = NULL;
+        goto out;
+    }
+    /* the primary records of tables with dense rows are not stored */
+    if (mode == WT_READ && !self->table->dense_rows) {
+        db_ret = pdb->associate(pdb, NULL, self->db, NULL, 0);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+static PyObject *
+Index_close(Index* self)
+{
+    PyObject *ret = NULL;
     int db_ret;
+    DB *db = self->db;
+    if (db == NULL) {
+        PyErr_SetString(WormtableError, "index closed");
+        goto out;
+    }
+    db_ret = db->close(db, 0);
+    self->db = NULL;
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+out:
+    return ret;
+}
+
+
+static PyMethodDef Index_methods[] = {
+    {"build", (PyCFunction) Index_build, METH_VARARGS|METH_KEYWORDS,
+        "Build the index" },
+    {"set_bin_widths", (PyCFunction) Index_set_bin_widths, METH_VARARGS,
+        "Sets the bin widths for the columns" },
+    {"set_interval", (PyCFunction) Index_set_interval, METH_NOARGS,
+        "Use the last two columns as the start and end of an interval" },
+    {"get_min", (PyCFunction) Index_get_min, METH_VARARGS,
+        "Returns the minumum key value in this index" },
+    {"get_max", (PyCFunction) Index_get_max, METH_VARARGS,
+        "Returns the maxumum key value in this index" },
+    {"get_num_rows", (PyCFunction) Index_get_num_rows, METH_VARARGS,
+        "Returns the number of rows in the index with the specified key." },
+    {"count_many", (PyCFunction) Index_count_many, METH_VARARGS,
+        "Returns the number of rows in the index with each of the keys." },
+    {"lookup_many", (PyCFunction) Index_lookup_many, METH_VARARGS,
+        "Returns the rows in the index with each of the keys." },
+    {"open", (PyCFunction) Index_open, METH_VARARGS, "Open the index" },
+    {"close", (PyCFunction) Index_close, METH_NOARGS, "Close the index" },
+    {NULL}  /* Sentinel */
+};
+
+
+static PyTypeObject IndexType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_wormtable.Index",             /* tp_name */
+    sizeof(Index),             /* tp_basicsize */
+    0,                         /* tp_itemsize */
+    (destructor)Index_dealloc, /* tp_dealloc */
+    0,                         /* tp_print */
+    0,                         /* tp_getattr */
+    0,                         /* tp_setattr */
+    0,                         /* tp_reserved */
+    0,                         /* tp_repr */
+    0,                         /* tp_as_number */
+    0,                         /* tp_as_sequence */
+    0,                         /* tp_as_mapping */
+    0,                         /* tp_hash  */
+    0,                         /* tp_call */
+    0,                         /* tp_str */
+    0,                         /* tp_getattro */
+    0,                         /* tp_setattro */
+    0,                         /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,        /* tp_flags */
+    "Index objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    Index_methods,             /* tp_methods */
+    Index_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Index_init,      /* tp_init */
+};
+
+
+
+
+/*==========================================================
+ * Row reductions
+ *==========================================================
+ */
+
+/*
+ * Classifies the genotype call in the specified VCF string, such as
+ * "0/1" or "1|1". Calls with any missing allele are missing, calls
+ * in which every allele is the reference are homozygous reference and
+ * calls in which every allele is the same alternate are homozygous
+ * alternate. Returns 0 on success and -1 if the string is malformed.
+ */
+static int
+genotype_classify_call(const char *s, size_t length, int *call_class)
+{
+    int ret = -1;
+    size_t j = 0;
+    size_t start;
+    int num_alleles = 0;
+    int missing = 0;
+    int same = 1;
+    unsigned long allele, first = 0;
+
+    while (j <= length) {
+        start = j;
+        if (j < length && s[j] == '.') {
+            missing = 1;
+            j++;
+        } else {
+            allele = 0;
+            while (j < length && s[j] >= '0' && s[j] <= '9') {
+                allele = 10 * allele + (unsigned long) (s[j] - '0');
+                j++;
+            }
+            if (j == start) {
+                goto out;
+            }
+            if (num_alleles == 0) {
+                first = allele;
+            } else if (allele != first) {
+                same = 0;
+            }
+        }
+        num_alleles++;
+        if (j < length && s[j] != '/' && s[j] != '|') {
+            goto out;
+        }
+        j++;
+    }
+    if (missing) {
+        *call_class = WT_CALL_MISSING;
+    } else if (!same) {
+        *call_class = WT_CALL_HET;
+    } else {
+        *call_class = first == 0 ? WT_CALL_HOM_REF : WT_CALL_HOM_ALT;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Adds the classes of the genotype calls in the specified column, which
+ * has been extracted into the element buffer, to the specified counts.
+ */
+static int
+Column_count_genotype_calls(Column *self, int missing, uint64_t *counts)
+{
+    int ret = -1;
+    int call_class;
+    uint32_t j, a, b;
+    uint32_t bits = (uint32_t) self->element_size;
+    unsigned char *v = (unsigned char *) self->element_buffer;
+    const char *s = (const char *) self->element_buffer;
+    size_t length = (size_t) self->num_buffered_elements;
+    PyObject *value;
+
+    if (self->element_type == WT_GENOTYPE) {
+        for (j = 0; j < (uint32_t) self->num_elements; j++) {
+            a = genotype_get_code(v, 2 * j, bits);
+            b = genotype_get_code(v, 2 * j + 1, bits);
+            if (a == 0 || b == 0) {
+                call_class = WT_CALL_MISSING;
+            } else if (a != b) {
+                call_class = WT_CALL_HET;
+            } else {
+                call_class = a == 1 ? WT_CALL_HOM_REF : WT_CALL_HOM_ALT;
+            }
+            counts[call_class]++;
+        }
+    } else if (missing) {
+        counts[WT_CALL_MISSING]++;
+    } else {
+        if (self->element_type == WT_DICT) {
+            value = Column_native_to_python_dict(self, 0);
+            if (value == NULL) {
+                goto out;
+            }
+            /* the dictionary holds a reference to this value */
+            Py_DECREF(value);
+            s = PyBytes_AS_STRING(value);
+            length = (size_t) PyBytes_GET_SIZE(value);
+        }
+        if (genotype_classify_call(s, length, &call_class) != 0) {
+            Column_set_genotype_error(self, PyExc_ValueError,
+                    "Bad genotype", s, length);
+            goto out;
+        }
+        counts[call_class]++;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Returns -1, 0 or 1 if the first integer element is less than, equal
+ * to or greater than the second. Unsigned elements are marked by a
+ * non-zero is_unsigned flag.
+ */
+static int
+compare_integer_elements(uint64_t a, int a_unsigned, uint64_t b,
+        int b_unsigned)
+{
+    int ret;
+    if (a_unsigned == b_unsigned) {
+        if (a_unsigned) {
+            ret = a < b ? -1 : a > b;
+        } else {
+            ret = (int64_t) a < (int64_t) b ? -1 : (int64_t) a > (int64_t) b;
+        }
+    } else if (a_unsigned) {
+        ret = (int64_t) b < 0 || a > b ? 1 : (a < b ? -1 : 0);
+    } else {
+        ret = (int64_t) a < 0 || a < b ? -1 : (a > b ? 1 : 0);
+    }
+    return ret;
+}
+
+/*
+ * Computes the specified reduction over the current row and returns
+ * its value as a Python object.
+ */
+static PyObject *
+TableRowIterator_reduce(TableRowIterator *self, row_reduction_t *reduction)
+{
     PyObject *ret = NULL;
-    PyObject *arglist, *result;
-    PyObject *progress_callback = NULL;
-    Column *id_col;
-    uint32_t primary_key_size;
-    DBC *cursor = NULL;
-    DB *pdb = NULL;
-    DB *sdb = NULL;
-    DBT pkey, pdata, skey, sdata;
-    uint32_t truncate_count;
-    uint64_t callback_interval = 1000;
-    uint64_t records_processed = 0;
+    Column *col;
+    uint32_t j;
+    Py_ssize_t k;
+    int wt_ret, sign, is_unsigned;
+    int have_float = 0;
+    int have_best = 0;
+    int best_unsigned = 0;
+    uint64_t best = 0;
+    uint64_t element;
+    uint64_t num_values = 0;
+    uint64_t num_missing = 0;
+    uint64_t counts[WT_NUM_CALL_CLASSES] = {0};
+    double x;
+    double sum = 0.0;
+    double best_float = 0.0;
+
+    for (j = 0; j < reduction->num_columns; j++) {
+        col = self->table->columns[reduction->columns[j]];
+        if (col->element_type == WT_FLOAT) {
+            have_float = 1;
+        }
+    }
+    for (j = 0; j < reduction->num_columns; j++) {
+        col = self->table->columns[reduction->columns[j]];
+        wt_ret = Column_extract_elements(col, self->table->row_buffer);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (reduction->kind == WT_REDUCE_GENOTYPE_COUNTS) {
+            if (Column_count_genotype_calls(col, wt_ret == WT_MISSING_VALUE,
+                        counts) != 0) {
+                goto out;
+            }
+        } else if (reduction->kind == WT_REDUCE_MISSING) {
+            num_values++;
+            if (wt_ret == WT_MISSING_VALUE) {
+                num_missing++;
+            }
+        } else if (wt_ret != WT_MISSING_VALUE) {
+            is_unsigned = col->element_type == WT_UINT;
+            for (k = 0; k < col->num_buffered_elements; k++) {
+                if (col->element_type == WT_FLOAT) {
+                    x = ((double *) col->element_buffer)[k];
+                    if (x != x) {
+                        continue;
+                    }
+                    element = 0;
+                } else {
+                    element = ((uint64_t *) col->element_buffer)[k];
+                    x = is_unsigned ? (double) element
+                            : (double) (int64_t) element;
+                }
+                num_values++;
+                sum += x;
+                sign = reduction->kind == WT_REDUCE_MIN ? -1 : 1;
+                if (have_float) {
+                    if (!have_best || (sign < 0 ? x < best_float
+                                : x > best_float)) {
+                        best_float = x;
+                    }
+                } else if (!have_best || compare_integer_elements(element,
+                            is_unsigned, best, best_unsigned) == sign) {
+                    best = element;
+                    best_unsigned = is_unsigned;
+                }
+                have_best = 1;
+            }
+        }
+    }
+    if (reduction->kind == WT_REDUCE_GENOTYPE_COUNTS) {
+        ret = Py_BuildValue("KKKK",
+                (unsigned PY_LONG_LONG) counts[WT_CALL_HOM_REF],
+                (unsigned PY_LONG_LONG) counts[WT_CALL_HET],
+                (unsigned PY_LONG_LONG) counts[WT_CALL_HOM_ALT],
+                (unsigned PY_LONG_LONG) counts[WT_CALL_MISSING]);
+    } else if (reduction->kind == WT_REDUCE_MISSING) {
+        ret = PyFloat_FromDouble((double) num_missing / (double) num_values);
+    } else if (num_values == 0) {
+        Py_INCREF(Py_None);
+        ret = Py_None;
+    } else if (reduction->kind == WT_REDUCE_MEAN) {
+        ret = PyFloat_FromDouble(sum / (double) num_values);
+    } else if (have_float) {
+        ret = PyFloat_FromDouble(best_float);
+    } else if (best_unsigned) {
+        ret = PyLong_FromUnsignedLongLong((unsigned PY_LONG_LONG) best);
+    } else {
+        ret = PyLong_FromLongLong((PY_LONG_LONG) (int64_t) best);
+    }
+out:
+    return ret;
+}
+
+/*
+ * Parses the specified list of (kind, columns) reductions, checking that
+ * each column in a group is suitable for the reduction.
+ */
+static int
+TableRowIterator_parse_reductions(TableRowIterator *self, PyObject *reductions)
+{
+    int ret = -1;
+    Py_ssize_t j, k;
+    long kind, position;
+    PyObject *item, *columns, *v;
+    row_reduction_t *reduction;
+    Column *col;
+
+    self->num_reductions = (uint32_t) PyList_GET_SIZE(reductions);
+    if (self->num_reductions == 0) {
+        ret = 0;
+        goto out;
+    }
+    self->reductions = PyMem_Malloc(self->num_reductions
+            * sizeof(row_reduction_t));
+    if (self->reductions == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(self->reductions, 0, self->num_reductions * sizeof(row_reduction_t));
+    for (j = 0; j < (Py_ssize_t) self->num_reductions; j++) {
+        reduction = &self->reductions[j];
+        item = PyList_GET_ITEM(reductions, j);
+        if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2
+                || !PyList_Check(PyTuple_GET_ITEM(item, 1))) {
+            PyErr_SetString(PyExc_TypeError,
+                    "Reductions must be (kind, columns) tuples");
+            goto out;
+        }
+        kind = PyLong_AsLong(PyTuple_GET_ITEM(item, 0));
+        if (kind == -1 && PyErr_Occurred()) {
+            goto out;
+        }
+        if (kind < WT_REDUCE_MISSING || kind > WT_REDUCE_GENOTYPE_COUNTS) {
+            PyErr_SetString(PyExc_ValueError, "Unknown reduction");
+            goto out;
+        }
+        reduction->kind = (int) kind;
+        columns = PyTuple_GET_ITEM(item, 1);
+        reduction->num_columns = (uint32_t) PyList_GET_SIZE(columns);
+        if (reduction->num_columns < 1) {
+            PyErr_SetString(PyExc_ValueError,
+                    "At least one column required for reduction");
+            goto out;
+        }
+        reduction->columns = PyMem_Malloc(reduction->num_columns
+                * sizeof(uint32_t));
+        if (reduction->columns == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        for (k = 0; k < (Py_ssize_t) reduction->num_columns; k++) {
+            v = PyList_GET_ITEM(columns, k);
+            if (!PyNumber_Check(v)) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Column positions must be int");
+                goto out;
+            }
+            position = PyLong_AsLong(v);
+            if (position < 0 || position >= self->table->num_columns) {
+                PyErr_SetString(PyExc_ValueError,
+                        "Column positions out of bounds");
+                goto out;
+            }
+            col = self->table->columns[position];
+            if (kind == WT_REDUCE_GENOTYPE_COUNTS) {
+                if (col->element_type != WT_CHAR
+                        && col->element_type != WT_DICT
+                        && col->element_type != WT_GENOTYPE) {
+                    PyErr_Format(PyExc_TypeError,
+                            "Cannot count genotypes in column '%s'",
+                            PyBytes_AsString(col->name));
+                    goto out;
+                }
+            } else if (kind != WT_REDUCE_MISSING) {
+                if (col->element_type != WT_UINT
+                        && col->element_type != WT_INT
+                        && col->element_type != WT_FLOAT) {
+                    PyErr_Format(PyExc_TypeError,
+                            "Column '%s' is not numeric",
+                            PyBytes_AsString(col->name));
+                    goto out;
+                }
+            }
+            reduction->columns[k] = (uint32_t) position;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+/*==========================================================
+ * TableRowIterator object
+ *==========================================================
+ */
+
+static void
+TableRowIterator_dealloc(TableRowIterator* self)
+{
+    uint32_t j;
+    if (self->cursor != NULL) {
+        if (self->table != NULL) {
+            if (self->table->db != NULL) {
+                self->cursor->close(self->cursor);
+            }
+        }
+    }
+    Py_XDECREF(self->table);
+    if (self->min_key != NULL) {
+        PyMem_Free(self->min_key);
+    }
+    if (self->max_key != NULL) {
+        PyMem_Free(self->max_key);
+    }
+    if (self->read_columns != NULL) {
+        PyMem_Free(self->read_columns);
+    }
+    if (self->reductions != NULL) {
+        for (j = 0; j < self->num_reductions; j++) {
+            if (self->reductions[j].columns != NULL) {
+                PyMem_Free(self->reductions[j].columns);
+            }
+        }
+        PyMem_Free(self->reductions);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
 
-    if (!PyArg_ParseTuple(args, "|OK", &progress_callback,
-            &callback_interval)) {
-        progress_callback = NULL;
+static int
+TableRowIterator_init(TableRowIterator *self, PyObject *args, PyObject *kwds)
+{
+    int j;
+    int ret = -1;
+    long k;
+    static char *kwlist[] = {"table", "columns", "reductions", NULL};
+    PyObject *v = NULL;
+    PyObject *columns = NULL;
+    PyObject *reductions = NULL;
+    Table *table = NULL;
+    Column *id_col = NULL;
+
+    self->completed = 0;
+    self->read_columns = NULL;
+    self->reductions = NULL;
+    self->num_reductions = 0;
+    self->table = NULL;
+    self->min_key = NULL;
+    self->max_key = NULL;
+    self->cursor = NULL;
+    self->position = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!|O!", kwlist,
+            &TableType, &table,
+            &PyList_Type, &columns,
+            &PyList_Type, &reductions)) {
         goto out;
     }
-    Py_XINCREF(progress_callback);
-    if (Index_check_write_mode(self) != 0) {
+    self->table = table;
+    Py_INCREF(self->table);
+    if (Table_check_read_mode(self->table) != 0) {
         goto out;
     }
-    if (progress_callback != NULL) {
-        if (!PyCallable_Check(progress_callback)) {
-            PyErr_SetString(PyExc_TypeError, "progress_callback must be callable");
+    if (reductions != NULL) {
+        if (TableRowIterator_parse_reductions(self, reductions) != 0) {
             goto out;
         }
     }
-    if (callback_interval == 0) {
-        PyErr_SetString(PyExc_ValueError, "callback interval cannot be 0");
+    self->num_read_columns = PyList_GET_SIZE(columns);
+    if (self->num_read_columns + self->num_reductions < 1) {
+        PyErr_SetString(PyExc_ValueError, "At least one read column required");
         goto out;
     }
-    id_col = self->table->columns[0];
-    primary_key_size = id_col->element_size;
-    pdb = self->table->db;
-    sdb = self->db;
-    db_ret = pdb->cursor(pdb, NULL, &cursor, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        cursor = NULL;
+    self->read_columns = PyMem_Malloc((self->num_read_columns + 1)
+            * sizeof(uint32_t));
+    if (self->read_columns == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    memset(&pkey, 0, sizeof(DBT));
-    memset(&pdata, 0, sizeof(DBT));
-    memset(&skey, 0, sizeof(DBT));
-    memset(&sdata, 0, sizeof(DBT));
-    skey.data = self->key_buffer;
-    sdata.data = self->table->row_buffer;
-    sdata.size = primary_key_size;
-    while ((db_ret = cursor->get(cursor, &pkey, &pdata, DB_NEXT)) == 0) {
-        if (Table_retrieve_row(self->table, &pkey, &pdata) != 0) {
+    for (j = 0; j < self->num_read_columns; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column positions must be int");
             goto out;
         }
-        if (Index_fill_key(self, self->table->row_buffer, &skey) < 0 ) {
+        k = PyLong_AsLong(v);
+        if (k < 0 || k >= self->table->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column positions out of bounds");
             goto out;
         }
-        db_ret = sdb->put(sdb, NULL, &skey, &sdata, 0);
+        self->read_columns[j] = (uint32_t) k;
+    }
+    self->families = Table_get_families(self->table, self->read_columns,
+            self->num_read_columns);
+    for (j = 0; j < (int) self->num_reductions; j++) {
+        self->families |= Table_get_families(self->table,
+                self->reductions[j].columns, self->reductions[j].num_columns);
+    }
+    id_col = self->table->columns[0];
+    self->min_key = PyMem_Malloc(id_col->element_size);
+    self->max_key = PyMem_Malloc(id_col->element_size);
+    if (self->min_key == NULL || self->max_key == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+
+
+static PyMemberDef TableRowIterator_members[] = {
+    {NULL}  /* Sentinel */
+};
+
+
+static PyObject *
+TableRowIterator_next_iter(TableRowIterator *self)
+{
+    PyObject *ret = NULL;
+    PyObject *t = NULL;
+    PyObject *value;
+    Column *col;
+    int db_ret, j, wt_ret;
+    DB *db;
+    DBT key, data;
+    uint32_t flags;
+    int max_exceeded = 0;
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    flags = DB_NEXT;
+    if (self->cursor == NULL) {
+        /* it's the first time through the loop, so set up the cursor */
+        db = self->table->db;
+        db_ret = db->cursor(db, NULL, &self->cursor, 0);
         if (db_ret != 0) {
             handle_bdb_error(db_ret);
             goto out;
         }
-        /* Invoke the callback if necessary */
-        records_processed++;
-        if (records_processed % callback_interval == 0) {
-            if (progress_callback != NULL) {
-                arglist = Py_BuildValue("(K)", records_processed);
-                if (arglist == NULL) {
+        if (self->min_key_size != 0) {
+            key.data = self->min_key;
+            key.size = self->min_key_size;
+            flags = DB_SET_RANGE;
+        }
+    }
+    db_ret = Table_cursor_get(self->table, self->cursor, &self->position,
+            &key, &data, flags);
+    if (db_ret == 0) {
+        if (Table_retrieve_row(self->table, &key, &data, self->families)
+                != 0) {
+            goto out;
+        }
+        /* Now, check if we've hit or gone past max_key */
+        if (self->max_key_size > 0) {
+            if (key.size != self->max_key_size) {
+                PyErr_Format(PyExc_SystemError, "key size mismatch.");
+                goto out;
+            }
+            max_exceeded = memcmp(self->max_key, key.data, key.size) <= 0;
+        }
+        if (!max_exceeded) {
+            t = PyTuple_New(self->num_read_columns + self->num_reductions);
+            if (t == NULL) {
+                PyErr_NoMemory();
+                goto out;
+            }
+            for (j = 0; j < self->num_read_columns; j++) {
+                col = self->table->columns[self->read_columns[j]];
+                wt_ret = Column_extract_elements(col, self->table->row_buffer);
+                if (wt_ret < 0) {
+                    Py_DECREF(t);
                     goto out;
                 }
-                result = PyObject_CallObject(progress_callback, arglist);
-                Py_DECREF(arglist);
-                if (result == NULL) {
+                value = Column_get_python_elements(col,
+                        wt_ret == WT_MISSING_VALUE);
+                if (value == NULL) {
+                    Py_DECREF(t);
                     goto out;
                 }
-                Py_DECREF(result);
-                /* Anything might have happened in the mean time, so
-                 * check the state of the DBs again!
-                 */
-                if (Index_check_write_mode(self) != 0) {
+                PyTuple_SET_ITEM(t, j, value);
+            }
+            for (j = 0; j < self->num_reductions; j++) {
+                value = TableRowIterator_reduce(self, &self->reductions[j]);
+                if (value == NULL) {
+                    Py_DECREF(t);
                     goto out;
                 }
+                PyTuple_SET_ITEM(t, self->num_read_columns + j, value);
             }
+            ret = t;
         }
-    }
-    if (db_ret != DB_NOTFOUND) {
+    } else if (db_ret != DB_NOTFOUND) {
         handle_bdb_error(db_ret);
         goto out;
     }
-    db_ret = cursor->close(cursor);
-    cursor = NULL;
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
+    if (ret == NULL) {
+        /* Iteration is finished - free the cursor */
+        self->cursor->close(self->cursor);
+        self->cursor = NULL;
+        self->completed = 1;
     }
-    Py_INCREF(Py_None);
-    ret = Py_None;
 out:
-    Py_XDECREF(progress_callback);
-    if (cursor != NULL) {
-        /* ignore errors in this case, as we're already handling one */
-        if (self->table != NULL) {
-            if (self->table->db != NULL) {
-                cursor->close(cursor);
-            }
-        }
-        if (self->db != NULL) {
-            sdb = self->db;
-            db_ret = sdb->truncate(sdb, NULL, &truncate_count, 0);
-        }
+    return ret;
+}
+
+static PyObject *
+TableRowIterator_next(TableRowIterator *self)
+{
+    PyObject *ret = NULL;
+    if (!self->completed) {
+        ret = TableRowIterator_next_iter(self);
     }
     return ret;
 }
 
 static PyObject *
-Index_open(Index* self, PyObject *args)
+TableRowIterator_set_min(TableRowIterator *self, PyObject *args)
 {
     PyObject *ret = NULL;
-    char *db_name = NULL;
-    uint32_t flags = 0;
-    Py_ssize_t gigabyte = 1024 * 1024 * 1024;
-    uint32_t gigs, bytes;
-    int db_ret, mode;
-    DB *pdb;
-    if (!PyArg_ParseTuple(args, "i", &mode)) {
+    Column *id_col = NULL;
+    unsigned PY_LONG_LONG row_id = 0;
+    /* TODO: This is unsatisfactory as it doesn't check for overflow;
+     * -1 is accepted as a valid index value.
+     */
+    if (!PyArg_ParseTuple(args, "K", &row_id)) {
         goto out;
     }
     if (Table_check_read_mode(self->table) != 0) {
         goto out;
     }
-    pdb = self->table->db;
-    if (mode == WT_WRITE) {
-        flags = DB_CREATE|DB_TRUNCATE;
-    } else if (mode == WT_READ) {
-        flags = DB_RDONLY|DB_NOMMAP;
-    } else {
-        PyErr_Format(PyExc_ValueError, "mode must be WT_READ or WT_WRITE.");
-        goto out;
-    }
-    if (self->db != NULL) {
-        PyErr_Format(WormtableError, "Index already open.");
-        goto out;
-    }
-    db_name = PyBytes_AsString(self->db_filename);
-    if (db_name == NULL) {
-        goto out;
-    }
-    /* Now we create the DB handle */
-    db_ret = db_create(&self->db, NULL, 0);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
-    }
-    gigs = (uint32_t) (self->cache_size / gigabyte);
-    bytes = (uint32_t) (self->cache_size % gigabyte);
-    db_ret = self->db->set_cachesize(self->db, gigs, bytes, 1);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
-    }
-    db_ret = self->db->set_flags(self->db, DB_DUPSORT);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
-    }
-    db_ret = self->db->set_bt_compress(self->db, NULL, NULL);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        goto out;
-    }
-    /* Disable DB error messages */
-    self->db->set_errcall(self->db, NULL);
-    db_ret = self->db->open(self->db, NULL, db_name, NULL, DB_BTREE, flags,
-            WT_DB_FILE_PERMS);
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
-        self->db->close(self->db, 0);
-        self->db = NULL;
+    id_col = self->table->columns[0];
+    if (Column_set_row_id(id_col, (uint64_t) row_id) != 0) {
         goto out;
     }
-    if (mode == WT_READ) {
-        db_ret = pdb->associate(pdb, NULL, self->db, NULL, 0);
-        if (db_ret != 0) {
-            handle_bdb_error(db_ret);
-            goto out;
-        }
+    /* this is safe because this column must be at offset 0 */
+    if (Column_update_row(id_col, self->min_key, 0) != 0) {
+        goto out;
     }
+    self->min_key_size = id_col->element_size;
     Py_INCREF(Py_None);
     ret = Py_None;
 out:
@@ -3515,21 +11396,29 @@ out:
 }
 
 static PyObject *
-Index_close(Index* self)
+TableRowIterator_set_max(TableRowIterator *self, PyObject *args)
 {
     PyObject *ret = NULL;
-    int db_ret;
-    DB *db = self->db;
-    if (db == NULL) {
-        PyErr_SetString(WormtableError, "index closed");
+    Column *id_col = NULL;
+    unsigned PY_LONG_LONG row_id = 0;
+    /* TODO: This is unsatisfactory as it doesn't check for overflow;
+     * -1 is accepted as a valid index value.
+     */
+    if (!PyArg_ParseTuple(args, "K", &row_id)) {
         goto out;
     }
-    db_ret = db->close(db, 0);
-    self->db = NULL;
-    if (db_ret != 0) {
-        handle_bdb_error(db_ret);
+    if (Table_check_read_mode(self->table) != 0) {
+        goto out;
+    }
+    id_col = self->table->columns[0];
+    if (Column_set_row_id(id_col, (uint64_t) row_id) != 0) {
         goto out;
     }
+    /* this is safe because this column must be at offset 0 */
+    if (Column_update_row(id_col, self->max_key, 0) != 0) {
+        goto out;
+    }
+    self->max_key_size = id_col->element_size;
     Py_INCREF(Py_None);
     ret = Py_None;
 out:
@@ -3537,28 +11426,19 @@ out:
 }
 
 
-static PyMethodDef Index_methods[] = {
-    {"build", (PyCFunction) Index_build, METH_VARARGS, "Build the index" },
-    {"set_bin_widths", (PyCFunction) Index_set_bin_widths, METH_VARARGS,
-        "Sets the bin widths for the columns" },
-    {"get_min", (PyCFunction) Index_get_min, METH_VARARGS,
-        "Returns the minumum key value in this index" },
-    {"get_max", (PyCFunction) Index_get_max, METH_VARARGS,
-        "Returns the maxumum key value in this index" },
-    {"get_num_rows", (PyCFunction) Index_get_num_rows, METH_VARARGS,
-        "Returns the number of rows in the index with the specified key." },
-    {"open", (PyCFunction) Index_open, METH_VARARGS, "Open the index" },
-    {"close", (PyCFunction) Index_close, METH_NOARGS, "Close the index" },
+static PyMethodDef TableRowIterator_methods[] = {
+    {"set_min", (PyCFunction) TableRowIterator_set_min, METH_VARARGS, "Set the minimum key" },
+    {"set_max", (PyCFunction) TableRowIterator_set_max, METH_VARARGS, "Set the maximum key" },
     {NULL}  /* Sentinel */
 };
 
 
-static PyTypeObject IndexType = {
+static PyTypeObject TableRowIteratorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.Index",             /* tp_name */
-    sizeof(Index),             /* tp_basicsize */
+    "_wormtable.TableRowIterator",             /* tp_name */
+    sizeof(TableRowIterator),             /* tp_basicsize */
     0,                         /* tp_itemsize */
-    (destructor)Index_dealloc, /* tp_dealloc */
+    (destructor)TableRowIterator_dealloc, /* tp_dealloc */
     0,                         /* tp_print */
     0,                         /* tp_getattr */
     0,                         /* tp_setattr */
@@ -3574,43 +11454,42 @@ static PyTypeObject IndexType = {
     0,                         /* tp_setattro */
     0,                         /* tp_as_buffer */
     Py_TPFLAGS_DEFAULT,        /* tp_flags */
-    "Index objects",           /* tp_doc */
+    "TableRowIterator objects",           /* tp_doc */
     0,                     /* tp_traverse */
     0,                     /* tp_clear */
     0,                     /* tp_richcompare */
     0,                     /* tp_weaklistoffset */
-    0,                     /* tp_iter */
-    0,                     /* tp_iternext */
-    Index_methods,             /* tp_methods */
-    Index_members,             /* tp_members */
+    PyObject_SelfIter,               /* tp_iter */
+    (iternextfunc) TableRowIterator_next, /* tp_iternext */
+    TableRowIterator_methods,             /* tp_methods */
+    TableRowIterator_members,             /* tp_members */
     0,                         /* tp_getset */
     0,                         /* tp_base */
     0,                         /* tp_dict */
     0,                         /* tp_descr_get */
     0,                         /* tp_descr_set */
     0,                         /* tp_dictoffset */
-    (initproc)Index_init,      /* tp_init */
+    (initproc)TableRowIterator_init,      /* tp_init */
 };
 
 
 
-
 /*==========================================================
- * TableRowIterator object
+ * IndexRowIterator object
  *==========================================================
  */
 
 static void
-TableRowIterator_dealloc(TableRowIterator* self)
+IndexRowIterator_dealloc(IndexRowIterator* self)
 {
     if (self->cursor != NULL) {
-        if (self->table != NULL) {
-            if (self->table->db != NULL) {
+        if (self->index != NULL) {
+            if (self->index->db != NULL) {
                 self->cursor->close(self->cursor);
             }
         }
     }
-    Py_XDECREF(self->table);
+    Py_XDECREF(self->index);
     if (self->min_key != NULL) {
         PyMem_Free(self->min_key);
     }
@@ -3621,34 +11500,32 @@ TableRowIterator_dealloc(TableRowIterator* self)
         PyMem_Free(self->read_columns);
     }
     Py_TYPE(self)->tp_free((PyObject*)self);
+
 }
 
 static int
-TableRowIterator_init(TableRowIterator *self, PyObject *args, PyObject *kwds)
+IndexRowIterator_init(IndexRowIterator *self, PyObject *args, PyObject *kwds)
 {
     int j;
     int ret = -1;
     long k;
-    static char *kwlist[] = {"table", "columns", NULL};
+    static char *kwlist[] = {"index", "columns", NULL};
     PyObject *v = NULL;
     PyObject *columns = NULL;
-    Table *table = NULL;
-    Column *id_col = NULL;
+    Index *index = NULL;
 
     self->completed = 0;
     self->read_columns = NULL;
-    self->table = NULL;
-    self->min_key = NULL;
-    self->max_key = NULL;
+    self->index = NULL;
     self->cursor = NULL;
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!", kwlist,
-            &TableType, &table,
+            &IndexType, &index,
             &PyList_Type, &columns)) {
         goto out;
     }
-    self->table = table;
-    Py_INCREF(self->table);
-    if (Table_check_read_mode(self->table) != 0) {
+    self->index = index;
+    Py_INCREF(self->index);
+    if (Index_check_read_mode(self->index) != 0) {
         goto out;
     }
     self->num_read_columns = PyList_GET_SIZE(columns);
@@ -3665,79 +11542,91 @@ TableRowIterator_init(TableRowIterator *self, PyObject *args, PyObject *kwds)
     for (j = 0; j < self->num_read_columns; j++) {
         v = PyList_GET_ITEM(columns, j);
         if (!PyNumber_Check(v)) {
-            PyErr_SetString(PyExc_ValueError, "Column positions must be int");
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
             goto out;
         }
         k = PyLong_AsLong(v);
-        if (k < 0 || k >= self->table->num_columns) {
-            PyErr_SetString(PyExc_ValueError, "Column positions out of bounds");
+        if (k < 0 || k >= self->index->table->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
             goto out;
         }
         self->read_columns[j] = (uint32_t) k;
     }
-    id_col = self->table->columns[0];
-    self->min_key = PyMem_Malloc(id_col->element_size);
-    self->max_key = PyMem_Malloc(id_col->element_size);
+    self->families = Table_get_families(self->index->table,
+            self->read_columns, self->num_read_columns);
+    self->min_key = PyMem_Malloc(self->index->key_buffer_size);
+    self->max_key = PyMem_Malloc(self->index->key_buffer_size);
     if (self->min_key == NULL || self->max_key == NULL) {
         PyErr_NoMemory();
         goto out;
     }
+    self->min_key_size = 0;
+    self->max_key_size = 0;
     ret = 0;
 out:
+
     return ret;
 }
 
 
 
-static PyMemberDef TableRowIterator_members[] = {
+static PyMemberDef IndexRowIterator_members[] = {
     {NULL}  /* Sentinel */
 };
 
 
 static PyObject *
-TableRowIterator_next_iter(TableRowIterator *self)
+IndexRowIterator_next_iter(IndexRowIterator *self)
 {
     PyObject *ret = NULL;
     PyObject *t = NULL;
     PyObject *value;
     Column *col;
-    int db_ret, j, wt_ret;
+    int db_ret, j, cmp, wt_ret;
     DB *db;
-    DBT key, data;
-    uint32_t flags;
+    DBT primary_key, primary_data, secondary_key;
+    uint32_t flags, cmp_size;
     int max_exceeded = 0;
-    if (Table_check_read_mode(self->table) != 0) {
+
+    if (Index_check_read_mode(self->index) != 0) {
         goto out;
     }
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
+    memset(&primary_key, 0, sizeof(DBT));
+    memset(&primary_data, 0, sizeof(DBT));
+    memset(&secondary_key, 0, sizeof(DBT));
     flags = DB_NEXT;
     if (self->cursor == NULL) {
         /* it's the first time through the loop, so set up the cursor */
-        db = self->table->db;
+        db = self->index->db;
         db_ret = db->cursor(db, NULL, &self->cursor, 0);
         if (db_ret != 0) {
             handle_bdb_error(db_ret);
             goto out;
         }
         if (self->min_key_size != 0) {
-            key.data = self->min_key;
-            key.size = self->min_key_size;
+            secondary_key.data = self->min_key;
+            secondary_key.size = self->min_key_size;
             flags = DB_SET_RANGE;
         }
     }
-    db_ret = self->cursor->get(self->cursor, &key, &data, flags);
+    db_ret = Index_cursor_pget(self->index, self->cursor, &secondary_key,
+            &primary_key, &primary_data, flags);
     if (db_ret == 0) {
-        if (Table_retrieve_row(self->table, &key, &data) != 0) {
+        if (Table_retrieve_row(self->index->table, &primary_key,
+                    &primary_data, self->families) != 0) {
             goto out;
         }
         /* Now, check if we've hit or gone past max_key */
         if (self->max_key_size > 0) {
-            if (key.size != self->max_key_size) {
-                PyErr_Format(PyExc_SystemError, "key size mismatch.");
-                goto out;
+            cmp_size = self->max_key_size;
+            if (secondary_key.size < cmp_size) {
+                cmp_size = secondary_key.size;
+            }
+            cmp = memcmp(self->max_key, secondary_key.data, cmp_size);
+            max_exceeded = cmp <= 0;
+            if (secondary_key.size < self->max_key_size) {
+                max_exceeded = cmp < 0;
             }
-            max_exceeded = memcmp(self->max_key, key.data, key.size) <= 0;
         }
         if (!max_exceeded) {
             t = PyTuple_New(self->num_read_columns);
@@ -3746,8 +11635,9 @@ TableRowIterator_next_iter(TableRowIterator *self)
                 goto out;
             }
             for (j = 0; j < self->num_read_columns; j++) {
-                col = self->table->columns[self->read_columns[j]];
-                wt_ret = Column_extract_elements(col, self->table->row_buffer);
+                col = self->index->table->columns[self->read_columns[j]];
+                wt_ret = Column_extract_elements(col,
+                        self->index->table->row_buffer);
                 if (wt_ret < 0) {
                     Py_DECREF(t);
                     goto out;
@@ -3777,89 +11667,188 @@ out:
 }
 
 static PyObject *
-TableRowIterator_next(TableRowIterator *self)
+IndexRowIterator_next(IndexRowIterator *self)
+{
+    PyObject *ret = NULL;
+    if (!self->completed) {
+        ret = IndexRowIterator_next_iter(self);
+    }
+    return ret;
+}
+
+
+static PyObject *
+IndexRowIterator_set_min(IndexRowIterator *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    int size = Index_set_key(self->index, args, self->min_key);
+    if (size < 0) {
+        goto out;
+    }
+    self->min_key_size = size;
+    ret = Py_BuildValue("");
+out:
+    return ret;
+}
+
+static PyObject *
+IndexRowIterator_set_max(IndexRowIterator *self, PyObject *args)
+{
+    PyObject *ret = NULL;
+    int size = Index_set_key(self->index, args, self->max_key);
+    if (size < 0) {
+        goto out;
+    }
+    self->max_key_size = size;
+    ret = Py_BuildValue("");
+out:
+    return ret;
+}
+
+
+static PyMethodDef IndexRowIterator_methods[] = {
+    {"set_min", (PyCFunction) IndexRowIterator_set_min, METH_VARARGS, "Set the minimum key" },
+    {"set_max", (PyCFunction) IndexRowIterator_set_max, METH_VARARGS, "Set the maximum key" },
+    {NULL}  /* Sentinel */
+};
+
+
+static PyTypeObject IndexRowIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_wormtable.IndexRowIterator",             /* tp_name */
+    sizeof(IndexRowIterator),             /* tp_basicsize */
+    0,                         /* tp_itemsize */
+    (destructor)IndexRowIterator_dealloc, /* tp_dealloc */
+    0,                         /* tp_print */
+    0,                         /* tp_getattr */
+    0,                         /* tp_setattr */
+    0,                         /* tp_reserved */
+    0,                         /* tp_repr */
+    0,                         /* tp_as_number */
+    0,                         /* tp_as_sequence */
+    0,                         /* tp_as_mapping */
+    0,                         /* tp_hash  */
+    0,                         /* tp_call */
+    0,                         /* tp_str */
+    0,                         /* tp_getattro */
+    0,                         /* tp_setattro */
+    0,                         /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,        /* tp_flags */
+    "IndexRowIterator objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    PyObject_SelfIter,               /* tp_iter */
+    (iternextfunc) IndexRowIterator_next, /* tp_iternext */
+    IndexRowIterator_methods,             /* tp_methods */
+    IndexRowIterator_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)IndexRowIterator_init,      /* tp_init */
+};
+
+/*==========================================================
+ * IndexKeyIterator object
+ *==========================================================
+ */
+
+static void
+IndexKeyIterator_dealloc(IndexKeyIterator* self)
 {
-    PyObject *ret = NULL;
-    if (!self->completed) {
-        ret = TableRowIterator_next_iter(self);
+    if (self->cursor != NULL) {
+        if (self->index != NULL) {
+            if (self->index->db != NULL) {
+                self->cursor->close(self->cursor);
+            }
+        }
     }
-    return ret;
+    Py_XDECREF(self->index);
+    Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
-static PyObject *
-TableRowIterator_set_min(TableRowIterator *self, PyObject *args)
+static int
+IndexKeyIterator_init(IndexKeyIterator *self, PyObject *args, PyObject *kwds)
 {
-    PyObject *ret = NULL;
-    Column *id_col = NULL;
-    unsigned PY_LONG_LONG row_id = 0;
-    /* TODO: This is unsatisfactory as it doesn't check for overflow;
-     * -1 is accepted as a valid index value.
-     */
-    if (!PyArg_ParseTuple(args, "K", &row_id)) {
-        goto out;
-    }
-    if (Table_check_read_mode(self->table) != 0) {
-        goto out;
-    }
-    id_col = self->table->columns[0];
-    if (Column_set_row_id(id_col, (uint64_t) row_id) != 0) {
+    int ret = -1;
+    static char *kwlist[] = {"index", NULL};
+    Index *index = NULL;
+    self->index = NULL;
+    self->cursor = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist,
+            &IndexType, &index)) {
         goto out;
     }
-    /* this is safe because this column must be at offset 0 */
-    if (Column_update_row(id_col, self->min_key, 0) != 0) {
+    self->index = index;
+    Py_INCREF(self->index);
+    if (Index_check_read_mode(self->index) != 0) {
         goto out;
     }
-    self->min_key_size = id_col->element_size;
-    Py_INCREF(Py_None);
-    ret = Py_None;
+    ret = 0;
 out:
     return ret;
 }
 
+static PyMemberDef IndexKeyIterator_members[] = {
+    {NULL}  /* Sentinel */
+};
+
+
 static PyObject *
-TableRowIterator_set_max(TableRowIterator *self, PyObject *args)
+IndexKeyIterator_next(IndexKeyIterator *self)
 {
     PyObject *ret = NULL;
-    Column *id_col = NULL;
-    unsigned PY_LONG_LONG row_id = 0;
-    /* TODO: This is unsatisfactory as it doesn't check for overflow;
-     * -1 is accepted as a valid index value.
-     */
-    if (!PyArg_ParseTuple(args, "K", &row_id)) {
+    int db_ret;
+    DB *db;
+    DBT key, data;
+    if (Index_check_read_mode(self->index) != 0) {
         goto out;
     }
-    if (Table_check_read_mode(self->table) != 0) {
-        goto out;
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    if (self->cursor == NULL) {
+        /* it's the first time through the loop, so set up the cursor */
+        db = self->index->db;
+        db_ret = db->cursor(db, NULL, &self->cursor, 0);
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
+            goto out;
+        }
     }
-    id_col = self->table->columns[0];
-    if (Column_set_row_id(id_col, (uint64_t) row_id) != 0) {
+    db_ret = self->cursor->get(self->cursor, &key, &data, DB_NEXT_NODUP);
+    if (db_ret == 0) {
+        ret = Index_key_to_python(self->index, key.data, key.size);
+        if (ret == NULL) {
+            goto out;
+        }
+    } else if (db_ret != DB_NOTFOUND) {
+        handle_bdb_error(db_ret);
         goto out;
     }
-    /* this is safe because this column must be at offset 0 */
-    if (Column_update_row(id_col, self->max_key, 0) != 0) {
-        goto out;
+    if (ret == NULL) {
+        /* Iteration is finished - free the cursor */
+        self->cursor->close(self->cursor);
+        self->cursor = NULL;
     }
-    self->max_key_size = id_col->element_size;
-    Py_INCREF(Py_None);
-    ret = Py_None;
 out:
     return ret;
 }
 
-
-static PyMethodDef TableRowIterator_methods[] = {
-    {"set_min", (PyCFunction) TableRowIterator_set_min, METH_VARARGS, "Set the minimum key" },
-    {"set_max", (PyCFunction) TableRowIterator_set_max, METH_VARARGS, "Set the maximum key" },
+static PyMethodDef IndexKeyIterator_methods[] = {
     {NULL}  /* Sentinel */
 };
 
 
-static PyTypeObject TableRowIteratorType = {
+static PyTypeObject IndexKeyIteratorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.TableRowIterator",             /* tp_name */
-    sizeof(TableRowIterator),             /* tp_basicsize */
+    "_wormtable.IndexKeyIterator",             /* tp_name */
+    sizeof(IndexKeyIterator),             /* tp_basicsize */
     0,                         /* tp_itemsize */
-    (destructor)TableRowIterator_dealloc, /* tp_dealloc */
+    (destructor)IndexKeyIterator_dealloc, /* tp_dealloc */
     0,                         /* tp_print */
     0,                         /* tp_getattr */
     0,                         /* tp_setattr */
@@ -3875,33 +11864,31 @@ static PyTypeObject TableRowIteratorType = {
     0,                         /* tp_setattro */
     0,                         /* tp_as_buffer */
     Py_TPFLAGS_DEFAULT,        /* tp_flags */
-    "TableRowIterator objects",           /* tp_doc */
+    "IndexKeyIterator objects",           /* tp_doc */
     0,                     /* tp_traverse */
     0,                     /* tp_clear */
     0,                     /* tp_richcompare */
     0,                     /* tp_weaklistoffset */
     PyObject_SelfIter,               /* tp_iter */
-    (iternextfunc) TableRowIterator_next, /* tp_iternext */
-    TableRowIterator_methods,             /* tp_methods */
-    TableRowIterator_members,             /* tp_members */
+    (iternextfunc) IndexKeyIterator_next, /* tp_iternext */
+    IndexKeyIterator_methods,             /* tp_methods */
+    IndexKeyIterator_members,             /* tp_members */
     0,                         /* tp_getset */
     0,                         /* tp_base */
     0,                         /* tp_dict */
     0,                         /* tp_descr_get */
     0,                         /* tp_descr_set */
     0,                         /* tp_dictoffset */
-    (initproc)TableRowIterator_init,      /* tp_init */
+    (initproc)IndexKeyIterator_init,      /* tp_init */
 };
 
-
-
 /*==========================================================
- * IndexRowIterator object
+ * IndexIntervalIterator object
  *==========================================================
  */
 
 static void
-IndexRowIterator_dealloc(IndexRowIterator* self)
+IndexIntervalIterator_dealloc(IndexIntervalIterator* self)
 {
     if (self->cursor != NULL) {
         if (self->index != NULL) {
@@ -3911,21 +11898,18 @@ IndexRowIterator_dealloc(IndexRowIterator* self)
         }
     }
     Py_XDECREF(self->index);
-    if (self->min_key != NULL) {
-        PyMem_Free(self->min_key);
-    }
-    if (self->max_key != NULL) {
-        PyMem_Free(self->max_key);
+    if (self->key != NULL) {
+        PyMem_Free(self->key);
     }
     if (self->read_columns != NULL) {
         PyMem_Free(self->read_columns);
     }
     Py_TYPE(self)->tp_free((PyObject*)self);
-
 }
 
 static int
-IndexRowIterator_init(IndexRowIterator *self, PyObject *args, PyObject *kwds)
+IndexIntervalIterator_init(IndexIntervalIterator *self, PyObject *args,
+        PyObject *kwds)
 {
     int j;
     int ret = -1;
@@ -3936,7 +11920,9 @@ IndexRowIterator_init(IndexRowIterator *self, PyObject *args, PyObject *kwds)
     Index *index = NULL;
 
     self->completed = 0;
+    self->query_set = 0;
     self->read_columns = NULL;
+    self->key = NULL;
     self->index = NULL;
     self->cursor = NULL;
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!", kwlist,
@@ -3949,6 +11935,10 @@ IndexRowIterator_init(IndexRowIterator *self, PyObject *args, PyObject *kwds)
     if (Index_check_read_mode(self->index) != 0) {
         goto out;
     }
+    if (!self->index->interval) {
+        PyErr_SetString(WormtableError, "Not an interval index");
+        goto out;
+    }
     self->num_read_columns = PyList_GET_SIZE(columns);
     if (self->num_read_columns < 1) {
         PyErr_SetString(PyExc_ValueError, "At least one read column required");
@@ -3973,108 +11963,174 @@ IndexRowIterator_init(IndexRowIterator *self, PyObject *args, PyObject *kwds)
         }
         self->read_columns[j] = (uint32_t) k;
     }
-    self->min_key = PyMem_Malloc(self->index->key_buffer_size);
-    self->max_key = PyMem_Malloc(self->index->key_buffer_size);
-    if (self->min_key == NULL || self->max_key == NULL) {
+    self->families = Table_get_families(self->index->table,
+            self->read_columns, self->num_read_columns);
+    self->key = PyMem_Malloc(self->index->key_buffer_size);
+    if (self->key == NULL) {
         PyErr_NoMemory();
         goto out;
     }
-    self->min_key_size = 0;
-    self->max_key_size = 0;
     ret = 0;
 out:
 
     return ret;
 }
 
-
-
-static PyMemberDef IndexRowIterator_members[] = {
+static PyMemberDef IndexIntervalIterator_members[] = {
     {NULL}  /* Sentinel */
 };
 
+/*
+ * Moves on to the next bin that may contain intervals overlapping the
+ * query, starting with the smallest bins. Returns 0 when all candidate
+ * bins have been visited.
+ */
+static int
+IndexIntervalIterator_next_bin(IndexIntervalIterator *self)
+{
+    int ret = 1;
+    int shift;
+    if (self->bin < self->last_bin) {
+        self->bin++;
+    } else {
+        self->level++;
+        if (self->level == WT_INTERVAL_NUM_LEVELS) {
+            ret = 0;
+        } else {
+            shift = WT_INTERVAL_FIRST_SHIFT
+                    + self->level * WT_INTERVAL_NEXT_SHIFT;
+            self->bin = interval_bin_offsets[self->level]
+                    + (self->start >> shift);
+            self->last_bin = interval_bin_offsets[self->level]
+                    + (self->end >> shift);
+        }
+    }
+    return ret;
+}
 
 static PyObject *
-IndexRowIterator_next_iter(IndexRowIterator *self)
+IndexIntervalIterator_next_iter(IndexIntervalIterator *self)
 {
     PyObject *ret = NULL;
     PyObject *t = NULL;
     PyObject *value;
-    Column *col;
-    int db_ret, j, cmp, wt_ret;
+    Index *index = self->index;
+    Column *col, *start_col, *end_col;
+    int db_ret, j, wt_ret;
     DB *db;
     DBT primary_key, primary_data, secondary_key;
-    uint32_t flags, cmp_size;
-    int max_exceeded = 0;
+    uint32_t flags, bin_key_size, offset;
+    uint64_t start, end;
 
-    if (Index_check_read_mode(self->index) != 0) {
+    if (Index_check_read_mode(index) != 0) {
         goto out;
     }
-    memset(&primary_key, 0, sizeof(DBT));
-    memset(&primary_data, 0, sizeof(DBT));
-    memset(&secondary_key, 0, sizeof(DBT));
-    flags = DB_NEXT;
+    if (!self->query_set) {
+        PyErr_SetString(WormtableError, "Interval not set");
+        goto out;
+    }
+    start_col = index->table->columns[index->columns[index->num_columns - 2]];
+    end_col = index->table->columns[index->columns[index->num_columns - 1]];
     if (self->cursor == NULL) {
         /* it's the first time through the loop, so set up the cursor */
-        db = self->index->db;
+        db = index->db;
         db_ret = db->cursor(db, NULL, &self->cursor, 0);
         if (db_ret != 0) {
             handle_bdb_error(db_ret);
             goto out;
         }
-        if (self->min_key_size != 0) {
-            secondary_key.data = self->min_key;
-            secondary_key.size = self->min_key_size;
+    }
+    bin_key_size = self->prefix_size + WT_INTERVAL_BIN_SIZE;
+    while (t == NULL && !self->completed) {
+        memset(&primary_key, 0, sizeof(DBT));
+        memset(&primary_data, 0, sizeof(DBT));
+        memset(&secondary_key, 0, sizeof(DBT));
+        flags = DB_NEXT;
+        if (!self->bin_active) {
+            if (!IndexIntervalIterator_next_bin(self)) {
+                self->completed = 1;
+                break;
+            }
+            pack_uint(self->bin, (char *) self->key + self->prefix_size,
+                    WT_INTERVAL_BIN_SIZE);
+            secondary_key.data = self->key;
+            secondary_key.size = bin_key_size;
             flags = DB_SET_RANGE;
+            self->bin_active = 1;
         }
-    }
-    db_ret = self->cursor->pget(self->cursor, &secondary_key, &primary_key,
-            &primary_data, flags);
-    if (db_ret == 0) {
-        if (Table_retrieve_row(self->index->table, &primary_key,
-                    &primary_data) != 0) {
+        db_ret = Index_cursor_pget(self->index, self->cursor,
+                &secondary_key, &primary_key, &primary_data, flags);
+        if (db_ret == DB_NOTFOUND) {
+            self->bin_active = 0;
+            continue;
+        }
+        if (db_ret != 0) {
+            handle_bdb_error(db_ret);
             goto out;
         }
-        /* Now, check if we've hit or gone past max_key */
-        if (self->max_key_size > 0) {
-            cmp_size = self->max_key_size;
-            if (secondary_key.size < cmp_size) {
-                cmp_size = secondary_key.size;
-            }
-            cmp = memcmp(self->max_key, secondary_key.data, cmp_size);
-            max_exceeded = cmp <= 0;
-            if (secondary_key.size < self->max_key_size) {
-                max_exceeded = cmp < 0;
-            }
+        if (secondary_key.size < bin_key_size || memcmp(self->key,
+                    secondary_key.data, bin_key_size) != 0) {
+            /* we've gone past the end of this bin */
+            self->bin_active = 0;
+            continue;
         }
-        if (!max_exceeded) {
-            t = PyTuple_New(self->num_read_columns);
-            if (t == NULL) {
-                PyErr_NoMemory();
+        /* keys within a bin are sorted by start coordinate */
+        offset = bin_key_size;
+        wt_ret = Column_extract_key(start_col, secondary_key.data, offset,
+                secondary_key.size);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        wt_ret = Column_get_coordinate(start_col, &start);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (wt_ret == WT_MISSING_VALUE) {
+            continue;
+        }
+        if (start > self->end) {
+            self->bin_active = 0;
+            continue;
+        }
+        offset += start_col->element_size;
+        wt_ret = Column_extract_key(end_col, secondary_key.data, offset,
+                secondary_key.size);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        wt_ret = Column_get_coordinate(end_col, &end);
+        if (wt_ret < 0) {
+            goto out;
+        }
+        if (wt_ret == WT_MISSING_VALUE || end < self->start || end < start) {
+            continue;
+        }
+        if (Table_retrieve_row(index->table, &primary_key,
+                    &primary_data, self->families) != 0) {
+            goto out;
+        }
+        t = PyTuple_New(self->num_read_columns);
+        if (t == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        for (j = 0; j < self->num_read_columns; j++) {
+            col = index->table->columns[self->read_columns[j]];
+            wt_ret = Column_extract_elements(col, index->table->row_buffer);
+            if (wt_ret < 0) {
+                Py_DECREF(t);
                 goto out;
             }
-            for (j = 0; j < self->num_read_columns; j++) {
-                col = self->index->table->columns[self->read_columns[j]];
-                wt_ret = Column_extract_elements(col,
-                        self->index->table->row_buffer);
-                if (wt_ret < 0) {
-                    Py_DECREF(t);
-                    goto out;
-                }
-                value = Column_get_python_elements(col,
-                        wt_ret == WT_MISSING_VALUE);
-                if (value == NULL) {
-                    Py_DECREF(t);
-                    goto out;
-                }
-                PyTuple_SET_ITEM(t, j, value);
+            value = Column_get_python_elements(col,
+                    wt_ret == WT_MISSING_VALUE);
+            if (value == NULL) {
+                Py_DECREF(t);
+                goto out;
             }
-            ret = t;
+            PyTuple_SET_ITEM(t, j, value);
         }
-    } else if (db_ret != DB_NOTFOUND) {
-        handle_bdb_error(db_ret);
-        goto out;
     }
+    ret = t;
     if (ret == NULL) {
         /* Iteration is finished - free the cursor */
         self->cursor->close(self->cursor);
@@ -4086,58 +12142,70 @@ out:
 }
 
 static PyObject *
-IndexRowIterator_next(IndexRowIterator *self)
+IndexIntervalIterator_next(IndexIntervalIterator *self)
 {
     PyObject *ret = NULL;
     if (!self->completed) {
-        ret = IndexRowIterator_next_iter(self);
+        ret = IndexIntervalIterator_next_iter(self);
     }
     return ret;
 }
 
-
 static PyObject *
-IndexRowIterator_set_min(IndexRowIterator *self, PyObject *args)
+IndexIntervalIterator_set_interval(IndexIntervalIterator *self,
+        PyObject *args)
 {
     PyObject *ret = NULL;
-    int size = Index_set_key(self->index, args, self->min_key);
-    if (size < 0) {
+    PyObject *prefix = NULL;
+    long long start, end;
+    int size;
+    if (!PyArg_ParseTuple(args, "O!LL", &PyTuple_Type, &prefix, &start,
+            &end)) {
         goto out;
     }
-    self->min_key_size = size;
-    ret = Py_BuildValue("");
-out:
-    return ret;
-}
-
-static PyObject *
-IndexRowIterator_set_max(IndexRowIterator *self, PyObject *args)
-{
-    PyObject *ret = NULL;
-    int size = Index_set_key(self->index, args, self->max_key);
+    if (self->cursor != NULL || self->completed) {
+        PyErr_SetString(WormtableError, "Iteration already started");
+        goto out;
+    }
+    if (PyTuple_GET_SIZE(prefix) != self->index->num_columns - 2) {
+        PyErr_Format(PyExc_ValueError,
+                "A value must be provided for each prefix column");
+        goto out;
+    }
+    if (start < 0 || start > end || end > WT_INTERVAL_MAX_COORDINATE) {
+        PyErr_Format(PyExc_ValueError, "Invalid interval");
+        goto out;
+    }
+    size = Index_pack_key(self->index, prefix, self->key);
     if (size < 0) {
         goto out;
     }
-    self->max_key_size = size;
+    self->prefix_size = size;
+    self->start = start;
+    self->end = end;
+    self->level = -1;
+    self->bin = 0;
+    self->last_bin = 0;
+    self->bin_active = 0;
+    self->query_set = 1;
     ret = Py_BuildValue("");
 out:
     return ret;
 }
 
-
-static PyMethodDef IndexRowIterator_methods[] = {
-    {"set_min", (PyCFunction) IndexRowIterator_set_min, METH_VARARGS, "Set the minimum key" },
-    {"set_max", (PyCFunction) IndexRowIterator_set_max, METH_VARARGS, "Set the maximum key" },
+static PyMethodDef IndexIntervalIterator_methods[] = {
+    {"set_interval", (PyCFunction) IndexIntervalIterator_set_interval,
+        METH_VARARGS, "Set the key prefix and the interval to query" },
     {NULL}  /* Sentinel */
 };
 
 
-static PyTypeObject IndexRowIteratorType = {
+static PyTypeObject IndexIntervalIteratorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.IndexRowIterator",             /* tp_name */
-    sizeof(IndexRowIterator),             /* tp_basicsize */
+    "_wormtable.IndexIntervalIterator",             /* tp_name */
+    sizeof(IndexIntervalIterator),             /* tp_basicsize */
     0,                         /* tp_itemsize */
-    (destructor)IndexRowIterator_dealloc, /* tp_dealloc */
+    (destructor)IndexIntervalIterator_dealloc, /* tp_dealloc */
     0,                         /* tp_print */
     0,                         /* tp_getattr */
     0,                         /* tp_setattr */
@@ -4153,121 +12221,524 @@ static PyTypeObject IndexRowIteratorType = {
     0,                         /* tp_setattro */
     0,                         /* tp_as_buffer */
     Py_TPFLAGS_DEFAULT,        /* tp_flags */
-    "IndexRowIterator objects",           /* tp_doc */
+    "IndexIntervalIterator objects",           /* tp_doc */
     0,                     /* tp_traverse */
     0,                     /* tp_clear */
     0,                     /* tp_richcompare */
     0,                     /* tp_weaklistoffset */
     PyObject_SelfIter,               /* tp_iter */
-    (iternextfunc) IndexRowIterator_next, /* tp_iternext */
-    IndexRowIterator_methods,             /* tp_methods */
-    IndexRowIterator_members,             /* tp_members */
+    (iternextfunc) IndexIntervalIterator_next, /* tp_iternext */
+    IndexIntervalIterator_methods,             /* tp_methods */
+    IndexIntervalIterator_members,             /* tp_members */
     0,                         /* tp_getset */
     0,                         /* tp_base */
     0,                         /* tp_dict */
     0,                         /* tp_descr_get */
     0,                         /* tp_descr_set */
     0,                         /* tp_dictoffset */
-    (initproc)IndexRowIterator_init,      /* tp_init */
+    (initproc)IndexIntervalIterator_init,      /* tp_init */
 };
 
 /*==========================================================
- * IndexKeyIterator object
+ * IndexJoinIterator object
  *==========================================================
  */
 
 static void
-IndexKeyIterator_dealloc(IndexKeyIterator* self)
+IndexJoinIterator_dealloc(IndexJoinIterator* self)
 {
-    if (self->cursor != NULL) {
-        if (self->index != NULL) {
-            if (self->index->db != NULL) {
-                self->cursor->close(self->cursor);
+    if (self->left_cursor != NULL) {
+        if (self->left != NULL) {
+            if (self->left->db != NULL) {
+                self->left_cursor->close(self->left_cursor);
             }
         }
     }
-    Py_XDECREF(self->index);
+    if (self->right_cursor != NULL) {
+        if (self->right != NULL) {
+            if (self->right->db != NULL) {
+                self->right_cursor->close(self->right_cursor);
+            }
+        }
+    }
+    Py_XDECREF(self->left);
+    Py_XDECREF(self->right);
+    Py_XDECREF(self->left_row);
+    Py_XDECREF(self->group);
+    Py_XDECREF(self->missing_right_row);
+    if (self->left_columns != NULL) {
+        PyMem_Free(self->left_columns);
+    }
+    if (self->right_columns != NULL) {
+        PyMem_Free(self->right_columns);
+    }
+    if (self->left_key != NULL) {
+        PyMem_Free(self->left_key);
+    }
+    if (self->group_key != NULL) {
+        PyMem_Free(self->group_key);
+    }
+    if (self->lookahead_key != NULL) {
+        PyMem_Free(self->lookahead_key);
+    }
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+/*
+ * Parses the specified list of column positions for the specified table
+ * into a newly allocated array.
+ */
+static uint32_t *
+IndexJoinIterator_parse_columns(Table *table, PyObject *columns,
+        uint32_t *num_columns)
+{
+    uint32_t *ret = NULL;
+    uint32_t *cols = NULL;
+    uint32_t j, n;
+    long k;
+    PyObject *v;
+
+    n = PyList_GET_SIZE(columns);
+    if (n < 1) {
+        PyErr_SetString(PyExc_ValueError, "At least one read column required");
+        goto out;
+    }
+    cols = PyMem_Malloc(n * sizeof(uint32_t));
+    if (cols == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        v = PyList_GET_ITEM(columns, j);
+        if (!PyNumber_Check(v)) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes must be int");
+            goto out;
+        }
+        k = PyLong_AsLong(v);
+        if (k < 0 || k >= table->num_columns) {
+            PyErr_SetString(PyExc_ValueError, "Column indexes out of bounds");
+            goto out;
+        }
+        cols[j] = (uint32_t) k;
+    }
+    *num_columns = n;
+    ret = cols;
+    cols = NULL;
+out:
+    if (cols != NULL) {
+        PyMem_Free(cols);
+    }
+    return ret;
+}
+
+/*
+ * Returns 0 if the first num_key_columns key columns of the left and
+ * right indexes are encoded in the same way, so that keys can be compared
+ * bytewise. Otherwise -1 is returned with the appropriate Python
+ * exception set.
+ */
 static int
-IndexKeyIterator_init(IndexKeyIterator *self, PyObject *args, PyObject *kwds)
+IndexJoinIterator_check_key_columns(IndexJoinIterator *self)
 {
     int ret = -1;
-    static char *kwlist[] = {"index", NULL};
-    Index *index = NULL;
-    self->index = NULL;
-    self->cursor = NULL;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist,
-            &IndexType, &index)) {
+    uint32_t j;
+    Column *lc, *rc;
+    Index *left = self->left;
+    Index *right = self->right;
+    uint32_t n = self->num_key_columns;
+
+    if (n < 1 || n > left->num_columns || n > right->num_columns) {
+        PyErr_SetString(PyExc_ValueError, "Bad number of key columns");
         goto out;
     }
-    self->index = index;
-    Py_INCREF(self->index);
-    if (Index_check_read_mode(self->index) != 0) {
+    if ((left->interval && n > left->num_columns - 2)
+            || (right->interval && n > right->num_columns - 2)) {
+        PyErr_SetString(PyExc_ValueError,
+                "Cannot join on the interval columns of an interval index");
         goto out;
     }
+    for (j = 0; j < n; j++) {
+        lc = left->table->columns[left->columns[j]];
+        rc = right->table->columns[right->columns[j]];
+        if (lc->element_type != rc->element_type
+                || lc->element_size != rc->element_size
+                || Column_is_variable(lc) != Column_is_variable(rc)
+                || (!Column_is_variable(lc)
+                    && lc->num_elements != rc->num_elements)
+                || left->bin_widths[j] != right->bin_widths[j]) {
+            PyErr_Format(PyExc_ValueError,
+                    "Incompatible key columns '%s' and '%s'",
+                    PyBytes_AsString(lc->name), PyBytes_AsString(rc->name));
+            goto out;
+        }
+    }
     ret = 0;
 out:
     return ret;
 }
 
-static PyMemberDef IndexKeyIterator_members[] = {
+static int
+IndexJoinIterator_init(IndexJoinIterator *self, PyObject *args,
+        PyObject *kwds)
+{
+    int ret = -1;
+    uint32_t j;
+    static char *kwlist[] = {"left", "left_columns", "right",
+        "right_columns", "num_key_columns", "outer", NULL};
+    PyObject *left_columns = NULL;
+    PyObject *right_columns = NULL;
+    Index *left = NULL;
+    Index *right = NULL;
+
+    self->left = NULL;
+    self->right = NULL;
+    self->left_cursor = NULL;
+    self->right_cursor = NULL;
+    self->completed = 0;
+    self->outer = 0;
+    self->left_columns = NULL;
+    self->right_columns = NULL;
+    self->left_row = NULL;
+    self->left_key = NULL;
+    self->group = NULL;
+    self->group_position = 0;
+    self->group_valid = 0;
+    self->group_key = NULL;
+    self->lookahead_valid = 0;
+    self->lookahead_key = NULL;
+    self->missing_right_row = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!O!O!I|i", kwlist,
+            &IndexType, &left,
+            &PyList_Type, &left_columns,
+            &IndexType, &right,
+            &PyList_Type, &right_columns,
+            &self->num_key_columns, &self->outer)) {
+        goto out;
+    }
+    self->left = left;
+    Py_INCREF(self->left);
+    self->right = right;
+    Py_INCREF(self->right);
+    if (Index_check_read_mode(self->left) != 0) {
+        goto out;
+    }
+    if (Index_check_read_mode(self->right) != 0) {
+        goto out;
+    }
+    if (IndexJoinIterator_check_key_columns(self) != 0) {
+        goto out;
+    }
+    self->left_columns = IndexJoinIterator_parse_columns(self->left->table,
+            left_columns, &self->num_left_columns);
+    if (self->left_columns == NULL) {
+        goto out;
+    }
+    self->right_columns = IndexJoinIterator_parse_columns(self->right->table,
+            right_columns, &self->num_right_columns);
+    if (self->right_columns == NULL) {
+        goto out;
+    }
+    self->left_key = PyMem_Malloc(self->left->key_buffer_size);
+    self->group_key = PyMem_Malloc(self->left->key_buffer_size);
+    self->lookahead_key = PyMem_Malloc(self->right->key_buffer_size);
+    if (self->left_key == NULL || self->group_key == NULL
+            || self->lookahead_key == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    self->group = PyList_New(0);
+    if (self->group == NULL) {
+        goto out;
+    }
+    self->missing_right_row = PyTuple_New(self->num_right_columns);
+    if (self->missing_right_row == NULL) {
+        goto out;
+    }
+    for (j = 0; j < self->num_right_columns; j++) {
+        Py_INCREF(Py_None);
+        PyTuple_SET_ITEM(self->missing_right_row, j, Py_None);
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
+static PyMemberDef IndexJoinIterator_members[] = {
     {NULL}  /* Sentinel */
 };
 
+/*
+ * Returns the number of bytes occupied by the first num_columns columns
+ * in the specified key, or -1 with a Python exception set if the key is
+ * malformed.
+ */
+static int
+Index_get_key_prefix_size(Index *self, void *key, uint32_t key_size,
+        uint32_t num_columns)
+{
+    int ret = -1;
+    unsigned char *v = (unsigned char *) key;
+    uint32_t j, k, size;
+    int not_done;
+    unsigned char s;
+    Column *col;
 
-static PyObject *
-IndexKeyIterator_next(IndexKeyIterator *self)
+    size = 0;
+    for (j = 0; j < num_columns; j++) {
+        col = self->table->columns[self->columns[j]];
+        if (Column_is_variable(col)) {
+            /* skip the missing value prefix and scan for the sentinel */
+            size++;
+            not_done = 1;
+            while (not_done) {
+                if (size + col->element_size > key_size) {
+                    PyErr_SetString(PyExc_SystemError, "Key buffer overflow");
+                    goto out;
+                }
+                s = 0;
+                for (k = 0; k < col->element_size; k++) {
+                    s |= v[size + k];
+                }
+                size += col->element_size;
+                not_done = s != 0;
+            }
+        } else {
+            size += col->num_elements * col->element_size;
+        }
+    }
+    if (size > key_size) {
+        PyErr_SetString(PyExc_SystemError, "Key buffer overflow");
+        goto out;
+    }
+    ret = (int) size;
+out:
+    return ret;
+}
+
+/*
+ * Advances the specified index cursor to the next entry, storing the key
+ * prefix used for the join in the specified buffer. The row is not read,
+ * so that entries with keys that do not match can be skipped without
+ * retrieving and decoding their rows. Returns 0 if an entry was read, 1
+ * if the end of the index has been reached and -1 if an error occured.
+ */
+static int
+IndexJoinIterator_read_key(IndexJoinIterator *self, Index *index,
+        DBC **cursor, void *key_buffer, uint32_t *key_size)
 {
-    PyObject *ret = NULL;
-    int db_ret;
-    DB *db;
+    int ret = -1;
+    int db_ret, size;
     DBT key, data;
-    if (Index_check_read_mode(self->index) != 0) {
+
+    if (Index_check_read_mode(index) != 0) {
         goto out;
     }
-    memset(&key, 0, sizeof(DBT));
-    memset(&data, 0, sizeof(DBT));
-    if (self->cursor == NULL) {
-        /* it's the first time through the loop, so set up the cursor */
-        db = self->index->db;
-        db_ret = db->cursor(db, NULL, &self->cursor, 0);
+    if (*cursor == NULL) {
+        db_ret = index->db->cursor(index->db, NULL, cursor, 0);
         if (db_ret != 0) {
+            *cursor = NULL;
             handle_bdb_error(db_ret);
             goto out;
         }
     }
-    db_ret = self->cursor->get(self->cursor, &key, &data, DB_NEXT_NODUP);
+    memset(&key, 0, sizeof(DBT));
+    memset(&data, 0, sizeof(DBT));
+    db_ret = (*cursor)->get(*cursor, &key, &data, DB_NEXT);
+    if (db_ret == DB_NOTFOUND) {
+        ret = 1;
+        goto out;
+    }
+    if (db_ret != 0) {
+        handle_bdb_error(db_ret);
+        goto out;
+    }
+    size = Index_get_key_prefix_size(index, key.data, key.size,
+            self->num_key_columns);
+    if (size < 0) {
+        goto out;
+    }
+    memcpy(key_buffer, key.data, size);
+    *key_size = (uint32_t) size;
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Returns the values of the specified columns in the row of the entry at
+ * the current position of the specified index cursor, or NULL if an error
+ * occured.
+ */
+static PyObject *
+IndexJoinIterator_read_row(IndexJoinIterator *self, Index *index,
+        DBC *cursor, uint32_t *columns, uint32_t num_columns)
+{
+    PyObject *ret = NULL;
+    int db_ret;
+    DBT key, primary_key, primary_data;
+
+    memset(&key, 0, sizeof(DBT));
+    memset(&primary_key, 0, sizeof(DBT));
+    memset(&primary_data, 0, sizeof(DBT));
+    db_ret = cursor->get(cursor, &key, &primary_key, DB_CURRENT);
     if (db_ret == 0) {
-        ret = Index_key_to_python(self->index, key.data, key.size);
-        if (ret == NULL) {
-            goto out;
-        }
-    } else if (db_ret != DB_NOTFOUND) {
+        db_ret = Table_get_record(index->table, &primary_key, &primary_data);
+    }
+    if (db_ret != 0) {
         handle_bdb_error(db_ret);
         goto out;
     }
-    if (ret == NULL) {
-        /* Iteration is finished - free the cursor */
-        self->cursor->close(self->cursor);
-        self->cursor = NULL;
+    if (Table_retrieve_row(index->table, &primary_key, &primary_data,
+                Table_get_families(index->table, columns, num_columns)) != 0) {
+        goto out;
     }
+    ret = Table_get_python_row(index->table, columns, num_columns);
 out:
     return ret;
 }
 
-static PyMethodDef IndexKeyIterator_methods[] = {
+/*
+ * Advances the right cursor past all rows with keys less than the current
+ * left key, and collects the right rows with keys equal to the left key
+ * into the group. Only the rows in the group are read.
+ */
+static int
+IndexJoinIterator_fill_group(IndexJoinIterator *self)
+{
+    int ret = -1;
+    int cmp, read_ret;
+    PyObject *row = NULL;
+
+    Py_DECREF(self->group);
+    self->group = PyList_New(0);
+    if (self->group == NULL) {
+        goto out;
+    }
+    memcpy(self->group_key, self->left_key, self->left_key_size);
+    self->group_key_size = self->left_key_size;
+    self->group_valid = 1;
+    if (self->right_cursor == NULL) {
+        /* read the first key on the right */
+        read_ret = IndexJoinIterator_read_key(self, self->right,
+                &self->right_cursor, self->lookahead_key,
+                &self->lookahead_key_size);
+        if (read_ret < 0) {
+            goto out;
+        }
+        self->lookahead_valid = read_ret == 0;
+    }
+    while (self->lookahead_valid) {
+        cmp = compare_keys(self->lookahead_key, self->lookahead_key_size,
+                self->group_key, self->group_key_size);
+        if (cmp > 0) {
+            break;
+        }
+        if (cmp == 0) {
+            row = IndexJoinIterator_read_row(self, self->right,
+                    self->right_cursor, self->right_columns,
+                    self->num_right_columns);
+            if (row == NULL) {
+                goto out;
+            }
+            if (PyList_Append(self->group, row) != 0) {
+                goto out;
+            }
+            Py_CLEAR(row);
+        }
+        read_ret = IndexJoinIterator_read_key(self, self->right,
+                &self->right_cursor, self->lookahead_key,
+                &self->lookahead_key_size);
+        if (read_ret < 0) {
+            goto out;
+        }
+        self->lookahead_valid = read_ret == 0;
+    }
+    ret = 0;
+out:
+    Py_XDECREF(row);
+    return ret;
+}
+
+static PyObject *
+IndexJoinIterator_next(IndexJoinIterator *self)
+{
+    PyObject *ret = NULL;
+    PyObject *right_row;
+    int read_ret;
+
+    while (ret == NULL && !self->completed) {
+        if (self->left_row != NULL
+                && self->group_position < PyList_GET_SIZE(self->group)) {
+            right_row = PyList_GET_ITEM(self->group, self->group_position);
+            self->group_position++;
+            ret = PySequence_Concat(self->left_row, right_row);
+            break;
+        }
+        Py_CLEAR(self->left_row);
+        if (!self->outer && self->right_cursor != NULL
+                && !self->lookahead_valid
+                && PyList_GET_SIZE(self->group) == 0) {
+            /* the right index is exhausted, so there are no more matches */
+            self->completed = 1;
+            break;
+        }
+        read_ret = IndexJoinIterator_read_key(self, self->left,
+                &self->left_cursor, self->left_key, &self->left_key_size);
+        if (read_ret < 0) {
+            goto out;
+        }
+        if (read_ret == 1) {
+            self->completed = 1;
+            break;
+        }
+        if (!self->group_valid || compare_keys(self->left_key,
+                    self->left_key_size, self->group_key,
+                    self->group_key_size) != 0) {
+            if (IndexJoinIterator_fill_group(self) != 0) {
+                goto out;
+            }
+        }
+        self->group_position = 0;
+        if (PyList_GET_SIZE(self->group) == 0 && !self->outer) {
+            /* the left row has no matches, so it is not read */
+            continue;
+        }
+        self->left_row = IndexJoinIterator_read_row(self, self->left,
+                self->left_cursor, self->left_columns,
+                self->num_left_columns);
+        if (self->left_row == NULL) {
+            goto out;
+        }
+        if (self->outer && PyList_GET_SIZE(self->group) == 0) {
+            ret = PySequence_Concat(self->left_row, self->missing_right_row);
+        }
+    }
+    if (self->completed) {
+        /* Iteration is finished - free the cursors */
+        if (self->left_cursor != NULL) {
+            self->left_cursor->close(self->left_cursor);
+            self->left_cursor = NULL;
+        }
+        if (self->right_cursor != NULL) {
+            self->right_cursor->close(self->right_cursor);
+            self->right_cursor = NULL;
+        }
+    }
+out:
+    return ret;
+}
+
+static PyMethodDef IndexJoinIterator_methods[] = {
     {NULL}  /* Sentinel */
 };
 
 
-static PyTypeObject IndexKeyIteratorType = {
+static PyTypeObject IndexJoinIteratorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    "_wormtable.IndexKeyIterator",             /* tp_name */
-    sizeof(IndexKeyIterator),             /* tp_basicsize */
+    "_wormtable.IndexJoinIterator",             /* tp_name */
+    sizeof(IndexJoinIterator),             /* tp_basicsize */
     0,                         /* tp_itemsize */
-    (destructor)IndexKeyIterator_dealloc, /* tp_dealloc */
+    (destructor)IndexJoinIterator_dealloc, /* tp_dealloc */
     0,                         /* tp_print */
     0,                         /* tp_getattr */
     0,                         /* tp_setattr */
@@ -4283,22 +12754,22 @@ static PyTypeObject IndexKeyIteratorType = {
     0,                         /* tp_setattro */
     0,                         /* tp_as_buffer */
     Py_TPFLAGS_DEFAULT,        /* tp_flags */
-    "IndexKeyIterator objects",           /* tp_doc */
+    "IndexJoinIterator objects",           /* tp_doc */
     0,                     /* tp_traverse */
     0,                     /* tp_clear */
     0,                     /* tp_richcompare */
     0,                     /* tp_weaklistoffset */
     PyObject_SelfIter,               /* tp_iter */
-    (iternextfunc) IndexKeyIterator_next, /* tp_iternext */
-    IndexKeyIterator_methods,             /* tp_methods */
-    IndexKeyIterator_members,             /* tp_members */
+    (iternextfunc) IndexJoinIterator_next, /* tp_iternext */
+    IndexJoinIterator_methods,             /* tp_methods */
+    IndexJoinIterator_members,             /* tp_members */
     0,                         /* tp_getset */
     0,                         /* tp_base */
     0,                         /* tp_dict */
     0,                         /* tp_descr_get */
     0,                         /* tp_descr_set */
     0,                         /* tp_dictoffset */
-    (initproc)IndexKeyIterator_init,      /* tp_init */
+    (initproc)IndexJoinIterator_init,      /* tp_init */
 };
 
 /*==========================================================
@@ -4417,6 +12888,22 @@ init_wormtable(void)
     Py_INCREF(&IndexKeyIteratorType);
     PyModule_AddObject(module, "IndexKeyIterator",
             (PyObject *) &IndexKeyIteratorType);
+    /* IndexIntervalIterator */
+    IndexIntervalIteratorType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&IndexIntervalIteratorType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&IndexIntervalIteratorType);
+    PyModule_AddObject(module, "IndexIntervalIterator",
+            (PyObject *) &IndexIntervalIteratorType);
+    /* IndexJoinIterator */
+    IndexJoinIteratorType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&IndexJoinIteratorType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&IndexJoinIteratorType);
+    PyModule_AddObject(module, "IndexJoinIterator",
+            (PyObject *) &IndexJoinIteratorType);
 
     WormtableError = PyErr_NewException("_wormtable.WormtableError",
             NULL, NULL);
@@ -4426,12 +12913,22 @@ init_wormtable(void)
     PyModule_AddIntConstant(module, "WT_VAR_1", WT_VAR_1);
     PyModule_AddIntConstant(module, "WT_VAR_2", WT_VAR_2);
     PyModule_AddIntConstant(module, "WT_CHAR", WT_CHAR);
+    PyModule_AddIntConstant(module, "WT_DICT", WT_DICT);
+    PyModule_AddIntConstant(module, "WT_GENOTYPE", WT_GENOTYPE);
     PyModule_AddIntConstant(module, "WT_UINT", WT_UINT);
     PyModule_AddIntConstant(module, "WT_INT", WT_INT);
     PyModule_AddIntConstant(module, "WT_FLOAT", WT_FLOAT);
 
+    PyModule_AddIntConstant(module, "WT_REDUCE_MISSING", WT_REDUCE_MISSING);
+    PyModule_AddIntConstant(module, "WT_REDUCE_MEAN", WT_REDUCE_MEAN);
+    PyModule_AddIntConstant(module, "WT_REDUCE_MIN", WT_REDUCE_MIN);
+    PyModule_AddIntConstant(module, "WT_REDUCE_MAX", WT_REDUCE_MAX);
+    PyModule_AddIntConstant(module, "WT_REDUCE_GENOTYPE_COUNTS",
+            WT_REDUCE_GENOTYPE_COUNTS);
+
     PyModule_AddIntConstant(module, "WT_READ", WT_READ);
     PyModule_AddIntConstant(module, "WT_WRITE", WT_WRITE);
+    PyModule_AddIntConstant(module, "WT_APPEND", WT_APPEND);
 
     PyModule_AddIntConstant(module, "WT_VAR_1_MAX_ELEMENTS",
             WT_VAR_1_MAX_ELEMENTS);
@@ -47,13 +47,21 @@ _dump_command()
 
 }
 
+_pack_command()
+{
+    local cur="${COMP_WORDS[COMP_CWORD]}"
+    __wt_get_columns
+    COMPREPLY=( $(compgen -W "--quiet ${WT_COLUMNS}" -- ${cur}) )
+    return 0
+}
+
 _wtadmin() 
 {
     local cur prev commands cmd 
     COMPREPLY=()
     cur="${COMP_WORDS[COMP_CWORD]}"
     prev="${COMP_WORDS[COMP_CWORD-1]}"
-    commands="help show ls hist rm add dump"
+    commands="help show ls hist rm add dump pack"
     if [ $COMP_CWORD -eq 1 ]; then 
         COMPREPLY=($(compgen -W "${commands}" -- ${cur}))  
         return 0;
@@ -73,6 +81,10 @@ _wtadmin()
             _dump_command
             return 0
             ;;
+        pack)
+            _pack_command
+            return 0
+            ;;
         *)
             ;;
     esac
@@ -27,7 +27,7 @@ wormtable_version = parse_version("wormtable/__init__.py")
 
 _wormtable_module = Extension('_wormtable',
     sources = ["_wormtablemodule.c", "halffloat.c"],
-    libraries = ["db"])
+    libraries = ["db", "z"])
 
 requirements = []
 v = sys.version_info[:2]
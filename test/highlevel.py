@@ -21,12 +21,15 @@ from __future__ import print_function
 from __future__ import division
 
 import wormtable as wt
+import _wormtable
 
 import os
 import sys
 import math
+import array
 import random
 import shutil
+import struct
 import os.path
 import unittest
 import tempfile
@@ -267,6 +270,1956 @@ class TableBuildTest(WormtableTest):
 
 
 
+class TableAppendManyTest(WormtableTest):
+    """
+    Tests for appending many rows in a single call.
+    """
+    def make_table(self, homedir):
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_uint_column("uint")
+        t.add_int_column("int", num_elements=2)
+        t.add_float_column("float", size=4)
+        t.add_char_column("char", num_elements=wt.WT_VAR_1)
+        t.add_uint_column("uintv", num_elements=wt.WT_VAR_2)
+        return t
+
+    def random_rows(self, encoded):
+        rows = []
+        for j in range(num_random_test_rows):
+            u = random.choice([None, random.randint(0, 100)])
+            i = random.choice([None, (random.randint(-10, 10), 0)])
+            f = random.choice([None, 0.5])
+            c = random.choice([None, b"", b"ACGT"])
+            v = [random.randint(0, 10) for k in range(random.randint(0, 10))]
+            row = [None, u, i, f, c, v]
+            if encoded:
+                row = [None, None if u is None else str(u).encode(),
+                    None if i is None else "{0},{1}".format(*i).encode(),
+                    None if f is None else str(f).encode(), c,
+                    ",".join(str(x) for x in v).encode() if len(v) > 0
+                        else None]
+            rows.append(row[:random.randint(1, len(row))])
+        return rows
+
+    def verify(self, encoded):
+        rows = self.random_rows(encoded)
+        t1 = self.make_table(self._homedir)
+        t1.open("w")
+        for r in rows:
+            if encoded:
+                t1.append_encoded(r)
+            else:
+                t1.append(r)
+        t1.close()
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            t2 = self.make_table(other_homedir)
+            t2.open("w")
+            if encoded:
+                t2.append_encoded_many(rows)
+            else:
+                t2.append_many(rows)
+            self.assertEqual(len(t2), len(rows))
+            t2.close()
+            t1.open("r")
+            t2.open("r")
+            self.assertEqual(list(t1), list(t2))
+            self.assertEqual(t1.get_total_row_size(), t2.get_total_row_size())
+            t1.close()
+            t2.close()
+        finally:
+            shutil.rmtree(other_homedir)
+
+    def test_append_many(self):
+        self.verify(False)
+
+    def test_append_encoded_many(self):
+        self.verify(True)
+
+    def test_errors(self):
+        t = self.make_table(self._homedir)
+        t.open("w")
+        self.assertRaises(TypeError, t.append_many, None)
+        self.assertRaises(TypeError, t.append_many, [None])
+        self.assertRaises(TypeError, t.append_encoded_many, [[None, 1]])
+        # Rows before an error are committed, and the bad row is discarded.
+        self.assertRaises(Exception, t.append_many, [[None, 1], [None, 2, -1]])
+        self.assertRaises(Exception, t.append_many, [[0]])
+        self.assertRaises(Exception, t.append_many, [[None] * 6 + [1]])
+        t.append_many([[None, 3]])
+        self.assertEqual(len(t), 2)
+        t.close()
+        t.open("r")
+        self.assertEqual(list(t), [(0, 1, None, None, None, None),
+            (1, 3, None, None, None, None)])
+        t.close()
+
+
+class TableAppendColumnsTest(WormtableTest):
+    """
+    Tests for appending rows from column-wise buffers.
+    """
+    def make_table(self, homedir):
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_uint_column("uint")
+        t.add_int_column("int", num_elements=2)
+        t.add_float_column("float", size=4)
+        t.add_char_column("char", num_elements=wt.WT_VAR_1)
+        t.add_uint_column("uintv", num_elements=wt.WT_VAR_2)
+        return t
+
+    def random_columns(self, n):
+        rows = [[None, None, None, None, None, None] for j in range(n)]
+        u = array.array("Q", [random.randint(0, 100) for j in range(n)])
+        i = array.array("q", [random.randint(-10, 10) for j in range(2 * n)])
+        f = array.array("d", [0.5 * j for j in range(n)])
+        u_missing = bytearray(random.randint(0, 1) for j in range(n))
+        c, c_offsets = b"", array.array("q", [0])
+        v, v_offsets = array.array("Q"), array.array("q", [0])
+        for j in range(n):
+            s = random.choice([b"", b"ACGT", b"T"])
+            c += s
+            c_offsets.append(len(c))
+            l = [random.randint(0, 10) for k in range(random.randint(0, 10))]
+            v.extend(l)
+            v_offsets.append(len(v))
+            if not u_missing[j]:
+                rows[j][1] = u[j]
+            rows[j][2] = tuple(i[2 * j: 2 * j + 2])
+            rows[j][3] = f[j]
+            rows[j][4] = s
+            rows[j][5] = l
+        values = {"uint": u, 2: i, "float": f, "char": c, "uintv": v}
+        missing = {"uint": u_missing}
+        offsets = {"char": c_offsets, "uintv": v_offsets}
+        return rows, values, missing, offsets
+
+    def test_append_columns(self):
+        n = num_random_test_rows
+        rows, values, missing, offsets = self.random_columns(n)
+        t1 = self.make_table(self._homedir)
+        t1.open("w")
+        t1.append_many(rows)
+        t1.close()
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            t2 = self.make_table(other_homedir)
+            t2.open("w")
+            t2.append_columns(values, missing, offsets)
+            t2.append_columns({})
+            self.assertEqual(len(t2), n)
+            t2.close()
+            t1.open("r")
+            t2.open("r")
+            self.assertEqual(list(t1), list(t2))
+            self.assertEqual(t1.get_total_row_size(), t2.get_total_row_size())
+            t1.close()
+            t2.close()
+        finally:
+            shutil.rmtree(other_homedir)
+
+    def test_column_errors(self):
+        t = self.make_table(self._homedir)
+        t.open("w")
+        u = array.array("Q", [1, 2])
+        q = array.array("q", [0, 1, 2])
+        self.assertRaises(TypeError, t.append_columns, {"uint": [1, 2]})
+        self.assertRaises(TypeError, t.append_columns,
+                {"uint": array.array("i", [1, 2])})
+        self.assertRaises(TypeError, t.append_columns,
+                {"float": array.array("f", [1, 2])})
+        self.assertRaises(TypeError, t.append_columns, {"int": u})
+        self.assertRaises(KeyError, t.append_columns, {"nonexistent": u})
+        self.assertRaises(ValueError, t.append_columns,
+                {"uint": u, "float": array.array("d", [1])})
+        self.assertRaises(ValueError, t.append_columns,
+                {"int": array.array("q", [1, 2, 3])})
+        self.assertRaises(ValueError, t.append_columns,
+                {"uint": u}, missing={"uint": b"\0"})
+        self.assertRaises(ValueError, t.append_columns, {"char": b"AB"})
+        self.assertRaises(ValueError, t.append_columns, {"uint": u},
+                offsets={"uint": q})
+        self.assertRaises(ValueError, t.append_columns, {"char": b"AB"},
+                offsets={"char": array.array("q", [0, 3])})
+        self.assertRaises(ValueError, t.append_columns, {"char": b"AB"},
+                offsets={"char": array.array("q", [0, 2, 1])})
+        self.assertRaises(TypeError, t.append_columns, {"char": b"AB"},
+                offsets={"char": array.array("d", [0, 2])})
+        self.assertEqual(len(t), 0)
+        # No rows are committed when any row is out of range.
+        self.assertRaises(Exception, t.append_columns,
+                {"uint": u, "uintv": array.array("Q", [2 ** 63, 1])},
+                offsets={"uintv": array.array("q", [0, 1, 2])})
+        self.assertEqual(len(t), 0)
+        self.assertRaises(Exception, t.append_columns,
+                {"uint": u, "uintv": array.array("Q", [1, 2 ** 63])},
+                offsets={"uintv": array.array("q", [0, 1, 2])})
+        self.assertEqual(len(t), 0)
+        self.assertRaises(ValueError, t.append_columns,
+                {"uintv": array.array("Q", [1] * 80000)},
+                offsets={"uintv": array.array("q", [0, 40000, 80000])})
+        self.assertEqual(len(t), 0)
+        t.append_columns({"uint": u, "uintv": array.array("Q", [1])},
+                offsets={"uintv": array.array("q", [0, 1, 1])})
+        t.close()
+        t.open("r")
+        self.assertEqual(list(t), [(0, 1, None, None, None, (1,)),
+                (1, 2, None, None, None, ())])
+        t.close()
+
+
+class TableAppendTest(WormtableTest):
+    """
+    Tests for appending rows to an existing table.
+    """
+    def make_rows(self, num_rows):
+        rows = []
+        for j in range(num_rows):
+            chrom = random.choice([b"1", b"2", b"X", None])
+            pos = random.choice([None, random.randint(0, 100)])
+            rows.append((None, chrom, pos, [0] * random.randint(0, 10)))
+        return rows
+
+    def make_table(self, homedir, rows):
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_char_column("CHROM")
+        t.add_uint_column("POS", size=5)
+        t.add_uint_column("v", num_elements=wt.WT_VAR_1)
+        t.open("w")
+        for r in rows:
+            t.append(r)
+        t.close()
+        t.open("r")
+        i = wt.Index(t, "CHROM+POS")
+        i.add_key_column(t.get_column("CHROM"))
+        i.add_key_column(t.get_column("POS"))
+        i.open("w")
+        i.build()
+        i.close()
+        t.close()
+        return t
+
+    def test_append(self):
+        n = num_random_test_rows
+        rows = self.make_rows(n)
+        new_rows = self.make_rows(2 * n)
+        t = self.make_table(self._homedir, rows)
+        t.open("a")
+        self.assertEqual(t.get_open_mode(), wt.WT_APPEND)
+        self.assertEqual(len(t), n)
+        for r in new_rows:
+            t.append(r)
+        self.assertEqual(len(t), 3 * n)
+        t.close()
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            other = self.make_table(other_homedir, rows + new_rows)
+            t.open("r")
+            other.open("r")
+            self.assertEqual(len(t), 3 * n)
+            self.assertEqual(list(t.cursor(t.columns())),
+                    list(other.cursor(other.columns())))
+            self.assertEqual(t.get_total_row_size(),
+                    other.get_total_row_size())
+            self.assertEqual(t.get_min_row_size(), other.get_min_row_size())
+            self.assertEqual(t.get_max_row_size(), other.get_max_row_size())
+            i = t.open_index("CHROM+POS")
+            oi = other.open_index("CHROM+POS")
+            self.assertEqual(list(i.keys()), list(oi.keys()))
+            self.assertEqual(list(i.counter().items()),
+                    list(oi.counter().items()))
+            self.assertEqual(list(i.cursor(["row_id"])),
+                    list(oi.cursor(["row_id"])))
+            i.close()
+            oi.close()
+            other.close()
+            t.close()
+        finally:
+            shutil.rmtree(other_homedir)
+
+    def test_failed_index_update(self):
+        # indexes that are not updated after rows are appended are stale,
+        # and cannot be opened until they are rebuilt.
+        n = num_random_test_rows
+        t = self.make_table(self._homedir, self.make_rows(n))
+        build = wt.Index.build
+        def fail(index, *args, **kwargs):
+            raise IOError("index update failed")
+        wt.Index.build = fail
+        try:
+            t.open("a")
+            t.append_many(self.make_rows(n))
+            self.assertRaises(IOError, t.close)
+        finally:
+            wt.Index.build = build
+        t.open("r")
+        self.assertEqual(len(t), 2 * n)
+        self.assertEqual(t.get_stale_indexes(), ["CHROM+POS"])
+        self.assertRaises(ValueError, t.open_index, "CHROM+POS")
+        t.close()
+        # later appends do not update stale indexes
+        t.open("a")
+        t.append_many(self.make_rows(n))
+        t.close()
+        t.open("r")
+        self.assertEqual(t.get_stale_indexes(), ["CHROM+POS"])
+        i = wt.Index(t, "CHROM+POS")
+        i.add_key_column(t.get_column("CHROM"))
+        i.add_key_column(t.get_column("POS"))
+        i.open("w")
+        i.build()
+        i.close()
+        self.assertEqual(t.get_stale_indexes(), [])
+        t.close()
+        t.open("r")
+        self.assertEqual(t.get_stale_indexes(), [])
+        i = t.open_index("CHROM+POS")
+        self.assertEqual(sum(i.counter().values()), 3 * n)
+        i.close()
+        t.close()
+
+    def test_empty_append(self):
+        rows = self.make_rows(num_random_test_rows)
+        t = self.make_table(self._homedir, rows)
+        t.open("r")
+        total_row_size = t.get_total_row_size()
+        t.close()
+        t.open("a")
+        t.close()
+        t.open("r")
+        self.assertEqual(len(t), len(rows))
+        self.assertEqual(t.get_total_row_size(), total_row_size)
+        t.close()
+
+    def test_errors(self):
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        self.assertRaises(Exception, t.open, "a")
+
+
+class TableWriterTest(WormtableTest):
+    """
+    Tests for writing rows on a background thread.
+    """
+    def make_table(self, homedir):
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_uint_column("u")
+        t.add_char_column("s", num_elements=wt.WT_VAR_2)
+        return t
+
+    def make_rows(self, num_rows):
+        rows = []
+        for j in range(num_rows):
+            u = random.choice([None, j])
+            s = random.choice([None, b"x" * random.randint(0, 4000)])
+            rows.append((None, u, s))
+        return rows
+
+    def verify(self, rows, write_queue_size):
+        t1 = self.make_table(self._homedir)
+        t1.open("w")
+        t1.append_many(rows)
+        t1.close()
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            t2 = self.make_table(other_homedir)
+            t2.open("w", write_queue_size=write_queue_size)
+            half = len(rows) // 2
+            for r in rows[:half]:
+                t2.append(r)
+            t2.append_many(rows[half:])
+            self.assertEqual(len(t2), len(rows))
+            t2.close()
+            t1.open("r")
+            t2.open("r")
+            self.assertEqual(list(t1), list(t2))
+            self.assertEqual(t1.get_total_row_size(), t2.get_total_row_size())
+            self.assertEqual(t1.get_min_row_size(), t2.get_min_row_size())
+            self.assertEqual(t1.get_max_row_size(), t2.get_max_row_size())
+            t2.close()
+            # Append more rows using the writer.
+            t2.open("a", write_queue_size=write_queue_size)
+            t2.append_many(rows)
+            t2.close()
+            t2.open("r")
+            self.assertEqual(list(t2)[len(rows):],
+                    [(j + len(rows),) + tuple(r[1:]) for j, r in
+                        enumerate(t1)])
+            t1.close()
+            t2.close()
+        finally:
+            shutil.rmtree(other_homedir)
+
+    def test_small_queue(self):
+        self.verify(self.make_rows(500), 1)
+
+    def test_large_queue(self):
+        self.verify(self.make_rows(500), 2**24)
+
+    def test_empty(self):
+        self.verify([], 1)
+
+    def test_errors(self):
+        t = self.make_table(self._homedir)
+        t.open("w", write_queue_size=1)
+        self.assertRaises(_wormtable.WormtableError,
+                t.get_ll_object().start_writer, 1)
+        t.close()
+        t.open("r", write_queue_size=1)
+        self.assertRaises(_wormtable.WormtableError,
+                t.get_ll_object().start_writer, 1)
+        t.close()
+
+
+class TableRewriteTest(WormtableTest):
+    """
+    Tests for rewriting a table into a new schema.
+    """
+    def setUp(self):
+        super(TableRewriteTest, self).setUp()
+        self._other_homedir = tempfile.mkdtemp(prefix="wthl_")
+
+    def tearDown(self):
+        shutil.rmtree(self._other_homedir)
+        super(TableRewriteTest, self).tearDown()
+
+    def make_source(self, rows):
+        t = wt.Table(self._homedir)
+        t.add_id_column(5)
+        t.add_uint_column("uint", size=8)
+        t.add_int_column("int", size=8, num_elements=2)
+        t.add_float_column("float", size=8)
+        t.add_char_column("char", num_elements=wt.WT_VAR_1)
+        t.add_uint_column("uintv", num_elements=wt.WT_VAR_2)
+        t.add_char_column("fixed", num_elements=4)
+        t.add_int_column("unused", size=4)
+        t.open("w")
+        t.append_many(rows)
+        t.close()
+        self._table = t
+        t.open("r")
+        return t
+
+    def random_rows(self, n):
+        rows = []
+        for j in range(n):
+            u = None if j % 3 == 0 else random.randint(0, 255)
+            i = (random.randint(-100, 100), random.randint(0, 100))
+            f = None if j % 4 == 0 else 0.5 * j
+            s = random.choice([None, b"ACGT", b"GATT"])
+            v = [random.randint(0, 100) for k in range(random.randint(0, 5))]
+            c = random.choice([None, b"ABCD", b"WXYZ"])
+            rows.append([None, u, None if j % 5 == 0 else i, f, s, v, c])
+        return rows
+
+    def test_same_schema(self):
+        t1 = self.make_source(self.random_rows(num_random_test_rows))
+        t2 = wt.Table(self._other_homedir)
+        for c in t1.columns():
+            t2.add_column(c.get_name(), c.get_description(), c.get_type(),
+                    c.get_element_size(), c.get_num_elements())
+        t1.rewrite(t2)
+        t2.open("r")
+        self.assertEqual(list(t1), list(t2))
+        self.assertEqual(t1.get_total_row_size(), t2.get_total_row_size())
+        t2.close()
+
+    def test_narrow_schema(self):
+        rows = self.random_rows(num_random_test_rows)
+        t1 = self.make_source(rows)
+        t2 = wt.Table(self._other_homedir)
+        t2.add_id_column(4)
+        t2.add_char_column("char", num_elements=4)
+        t2.add_uint_column("uint", size=1)
+        t2.add_int_column("int", size=1, num_elements=2)
+        t2.add_float_column("float", size=4)
+        t2.add_int_column("uintv", size=1, num_elements=wt.WT_VAR_1)
+        t2.add_char_column("fixed", num_elements=wt.WT_VAR_1)
+        t2.add_uint_column("new")
+        callbacks = []
+        t1.rewrite(t2, callbacks.append, 10)
+        self.assertEqual(len(callbacks), len(rows) // 10)
+        t2.open("r")
+        self.assertEqual(len(t2), len(rows))
+        self.assertLess(t2.get_total_row_size(), t1.get_total_row_size())
+        for j, (r, s) in enumerate(zip(rows, t2)):
+            expected = (j, r[4], r[1], r[2], r[3], tuple(r[5]), r[6], None)
+            self.assertEqual(s, expected)
+        t2.close()
+
+    def test_errors(self):
+        t1 = self.make_source([[None, 256, (-1, 0), None, b"ACGT", [1, 2]]])
+        def rewrite(*columns):
+            t2 = wt.Table(self._other_homedir)
+            t2.add_id_column(4)
+            for c in columns:
+                t2.add_column(*c)
+            return t1.rewrite(t2)
+        self.assertRaises(OverflowError, rewrite,
+                ("uint", "", wt.WT_UINT, 1, 1))
+        self.assertRaises(OverflowError, rewrite,
+                ("int", "", wt.WT_UINT, 1, 2))
+        self.assertRaises(ValueError, rewrite,
+                ("int", "", wt.WT_INT, 1, 3))
+        self.assertRaises(ValueError, rewrite,
+                ("uintv", "", wt.WT_UINT, 1, 1))
+        self.assertRaises(ValueError, rewrite,
+                ("char", "", wt.WT_CHAR, 1, 2))
+        self.assertRaises(TypeError, rewrite,
+                ("char", "", wt.WT_UINT, 1, 4))
+        self.assertRaises(TypeError, rewrite,
+                ("float", "", wt.WT_INT, 1, 1))
+        t2 = wt.Table(self._other_homedir)
+        t2.add_id_column(4)
+        t2.add_uint_column("uint", size=2)
+        t2.open("w")
+        self.assertRaises(ValueError, t1.rewrite, t2)
+        t2.close()
+        t1.close()
+        self.assertRaises(ValueError, t1.rewrite, t2)
+        t1.open("r")
+
+    def test_failed_rewrite(self):
+        rows = [[None, 1], [None, 2], [None, 300], [None, 4]]
+        t1 = self.make_source(rows)
+        t2 = wt.Table(self._other_homedir)
+        t2.add_id_column(4)
+        t2.add_uint_column("uint", size=1)
+        t2.add_char_column("char", family=1)
+        t2.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY)
+        self.assertRaises(OverflowError, t1.rewrite, t2)
+        # no partial table is left behind
+        self.assertEqual(os.listdir(self._other_homedir), [])
+        self.assertRaises(IOError, wt.open_table, self._other_homedir)
+
+
+class DictColumnTest(WormtableTest):
+    """
+    Tests for dictionary encoded char columns.
+    """
+    def make_table(self, size=1):
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.add_dict_column("dict", size=size)
+        t.add_char_column("char")
+        return t
+
+    def test_round_trip(self):
+        t = self.make_table()
+        values = [None, b"", b"PASS", b"q10", b"q10;s50"]
+        rows = [random.choice(values) for j in range(num_random_test_rows)]
+        t.open("w")
+        for v in rows:
+            t.append([None, v, v])
+        t.close()
+        t = wt.open_table(self._homedir)
+        c = t.get_column("dict")
+        self.assertEqual(c.get_type(), wt.WT_DICT)
+        self.assertEqual(c.get_element_size(), 1)
+        self.assertEqual(c.get_num_elements(), 1)
+        self.assertEqual(sorted(c.get_dictionary()),
+                sorted(set(v for v in rows if v is not None)))
+        previous = {}
+        for j, (v, w) in enumerate(t.cursor(["dict", "char"])):
+            self.assertEqual(v, rows[j])
+            self.assertEqual(w, rows[j])
+            # Values are shared between rows.
+            if v is not None:
+                self.assertIs(previous.setdefault(v, v), v)
+        t.close()
+        # Appending extends the dictionary.
+        t.open("a")
+        t.append([None, b"new", None])
+        t.close()
+        t = wt.open_table(self._homedir)
+        self._table = t
+        self.assertIn(b"new", t.get_column("dict").get_dictionary())
+        self.assertEqual(t[len(t) - 1][1], b"new")
+
+    def test_too_many_values(self):
+        t = self.make_table()
+        t.open("w")
+        for j in range(255):
+            t.append([None, str(j).encode()])
+        self.assertRaises(ValueError, t.append, [None, b"one too many"])
+        t.append([None, b"0"])
+        t.close()
+        t = self.make_table(2)
+        t.open("w")
+        for j in range(256):
+            t.append([None, str(j).encode()])
+        t.close()
+        t = wt.open_table(self._homedir)
+        self._table = t
+        self.assertEqual([r[0] for r in t.cursor(["dict"])],
+                [str(j).encode() for j in range(256)])
+
+    def test_errors(self):
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        self.assertRaises(ValueError, t.add_dict_column, "d", size=3)
+        self.assertRaises(ValueError, t.add_column, "d", "", wt.WT_DICT, 1, 2)
+        self.assertRaises(ValueError, t.add_column, "d", "", wt.WT_DICT, 1,
+                wt.WT_VAR_1)
+        t = self.make_table()
+        t.open("w")
+        self.assertRaises(TypeError, t.append, [None, 1])
+        self.assertRaises(TypeError, t.append, [None, [b"A"]])
+        t.close()
+
+    def test_index(self):
+        t = self.make_table()
+        values = [b"C", b"A", b"B"]
+        rows = [random.choice(values) for j in range(num_random_test_rows)]
+        t.open("w")
+        t.append_many([[None, v] for v in rows])
+        t.close()
+        t = wt.open_table(self._homedir)
+        self._table = t
+        i = wt.Index(t, "dict")
+        i.add_key_column(t.get_column("dict"))
+        i.open("w")
+        i.build()
+        i.close()
+        i.open("r")
+        counter = i.counter()
+        for v in values:
+            self.assertEqual(counter[v], rows.count(v))
+        # Keys are sorted by code, i.e. in the order values were first seen.
+        first_seen = []
+        for v in rows:
+            if v not in first_seen:
+                first_seen.append(v)
+        self.assertEqual(list(i.keys()), first_seen)
+        i.close()
+
+    def test_rewrite(self):
+        t = self.make_table()
+        rows = [[None, random.choice([None, b"X", b"YY"]),
+                random.choice([None, b"Z", b"WWW"])]
+                for j in range(num_random_test_rows)]
+        t.open("w")
+        t.append_many(rows)
+        t.close()
+        t = wt.open_table(self._homedir)
+        self._table = t
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            t2 = wt.Table(other_homedir)
+            t2.add_id_column(4)
+            t2.add_char_column("dict")
+            t2.add_dict_column("char")
+            t.rewrite(t2)
+            t2.open("r")
+            self.assertEqual(list(t), list(t2))
+            self.assertEqual(sorted(t2.get_column("char").get_dictionary()),
+                    [b"WWW", b"Z"])
+            t2.close()
+        finally:
+            shutil.rmtree(other_homedir)
+
+
+class GenotypeColumnTest(WormtableTest):
+    """
+    Tests for packed genotype columns.
+    """
+    def make_table(self, num_samples, size=2):
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.add_genotype_column("GT", size=size, num_elements=num_samples)
+        t.add_uint_column("uint")
+        return t
+
+    def random_call(self, max_allele):
+        alleles = [random.choice([None] + list(range(max_allele + 1)))
+                for j in range(2)]
+        if alleles == [None, None]:
+            return None
+        s = [b"." if a is None else str(a).encode() for a in alleles]
+        return s[0] + random.choice([b"/", b"|"]) + s[1]
+
+    def test_round_trip(self):
+        for size, max_allele in [(2, 2), (4, 14), (8, 254)]:
+            n = random.randint(1, 50)
+            t = self.make_table(n, size)
+            rows = []
+            for j in range(num_random_test_rows):
+                calls = tuple(self.random_call(max_allele) for k in range(n))
+                if all(c is None for c in calls):
+                    calls = None
+                if n == 1 and calls is not None:
+                    calls = calls[0]
+                rows.append([None, calls, j])
+            t.open("w")
+            t.append_many(rows)
+            t.close()
+            t.open("r")
+            for j, row in enumerate(rows):
+                row[0] = j
+            gt = t.get_column("GT")
+            self.assertEqual(gt.get_type(), wt.WT_GENOTYPE)
+            self.assertEqual(gt.get_type_name(), "genotype")
+            self.assertEqual(t.get_fixed_region_size(),
+                    4 + (2 * n * size + 7) // 8 + (n + 7) // 8 + 2)
+            for j, row in enumerate(t.cursor(["row_id", "GT", "uint"])):
+                self.assertEqual(row, tuple(rows[j]))
+            t.close()
+
+    def test_missing_calls(self):
+        t = self.make_table(3)
+        t.open("w")
+        t.append([None, (b"./.", b".", None)])
+        t.append([None, (b"./.", b".|.", b"0/.")])
+        t.append_encoded([None, b"./.,1|0,."])
+        t.close()
+        t.open("r")
+        self.assertEqual(list(t.cursor(["GT"])), [(None,),
+                ((None, b".|.", b"0/."),), ((None, b"1|0", None),)])
+        t.close()
+
+    def test_native_access(self):
+        n = 20
+        t = self.make_table(n)
+        rows = [[None, tuple(self.random_call(2) for k in range(n))]
+                for j in range(10)]
+        t.open("w")
+        t.append_many(rows)
+        t.close()
+        t.open("r")
+        phased = bytearray(n)
+        for j in range(len(rows)):
+            calls = t[j][1]
+            counts = [0, 0, 0]
+            alleles = []
+            for k, c in enumerate(calls):
+                self.assertEqual(t.get_genotype(j, "GT", k), c)
+                if c is None:
+                    c = b"./."
+                for a in [c[:1], c[2:]]:
+                    if a == b".":
+                        alleles.append(-1)
+                    else:
+                        alleles.append(int(a))
+                        counts[int(a)] += 1
+            self.assertEqual(t.count_alleles(j, "GT"), tuple(counts))
+            self.assertEqual(list(t.get_genotypes(j, 1, phased=phased)),
+                    alleles)
+            self.assertEqual(list(phased), [int(c is not None and
+                    c[1:2] == b"|") for c in calls])
+            out = array.array("h", [0]) * (2 * n)
+            self.assertIs(t.get_genotypes(j, "GT", out), out)
+            self.assertEqual(list(out), alleles)
+        self.assertEqual(t.get_genotype(-1, "GT", 0), rows[-1][1][0])
+        self.assertRaises(IndexError, t.get_genotype, len(rows), "GT", 0)
+        self.assertRaises(IndexError, t.get_genotype, 0, "GT", n)
+        self.assertRaises(TypeError, t.get_genotype, 0, "uint", 0)
+        self.assertRaises(TypeError, t.count_alleles, 0, "uint")
+        self.assertRaises(ValueError, t.get_genotypes, 0, "GT",
+                array.array("h", [0]) * n)
+        self.assertRaises(TypeError, t.get_genotypes, 0, "GT",
+                array.array("i", [0]) * (2 * n))
+        self.assertRaises(ValueError, t.get_genotypes, 0, "GT", None,
+                bytearray(n + 1))
+        t.close()
+
+    def test_errors(self):
+        t = wt.Table(self._homedir)
+        self.assertRaises(ValueError, t.add_genotype_column, "GT", size=3)
+        self.assertRaises(ValueError, t.add_genotype_column, "GT",
+                num_elements=wt.WT_VAR_1)
+        t = self.make_table(2)
+        t.open("w")
+        for calls in [(b"0", b"0/0"), (b"0/1/1", None), (b"a/0", None),
+                (b"0/", None), (b"/0", None), (b"", None)]:
+            self.assertRaises(ValueError, t.append, [None, calls])
+        self.assertRaises(ValueError, t.append, [None, (b"0/0",)])
+        self.assertRaises(OverflowError, t.append, [None, (b"0/3", None)])
+        self.assertRaises(TypeError, t.append, [None, (0, None)])
+        self.assertRaises(ValueError, t.append_encoded, [None, b"0/0"])
+        t.append([None, (b"2/2", None)])
+        t.close()
+        t.open("r")
+        self.assertEqual(len(t), 1)
+        i = wt.Index(t, "GT")
+        i.add_key_column(t.get_column("GT"))
+        self.assertRaises(ValueError, i.open, "w")
+        t.close()
+
+    def test_rewrite(self):
+        t = self.make_table(5)
+        rows = [[None, tuple(self.random_call(2) for k in range(5)), j]
+                for j in range(10)]
+        t.open("w")
+        t.append_many(rows)
+        t.close()
+        t.open("r")
+        self._table = t
+        other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        try:
+            t2 = wt.Table(other_homedir)
+            t2.add_id_column(4)
+            t2.add_genotype_column("GT", size=2, num_elements=5)
+            t.rewrite(t2)
+            t2.open("r")
+            self.assertEqual([r[1] for r in t2], [r[1] for r in rows])
+            t2.close()
+            t2 = wt.Table(other_homedir)
+            t2.add_id_column(4)
+            t2.add_genotype_column("GT", size=4, num_elements=5)
+            self.assertRaises(TypeError, t.rewrite, t2)
+        finally:
+            shutil.rmtree(other_homedir)
+
+
+class RowReductionTest(WormtableTest):
+    """
+    Tests for the per-row reductions computed by cursors.
+    """
+    num_samples = 5
+
+    def setUp(self):
+        super(RowReductionTest, self).setUp()
+        n = self.num_samples
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        for k in range(n):
+            t.add_char_column("S{0}.GT".format(k))
+            t.add_uint_column("S{0}.DP".format(k))
+            t.add_int_column("S{0}.AD".format(k), num_elements=2)
+            t.add_float_column("S{0}.GQ".format(k), size=4)
+        t.add_genotype_column("GT", num_elements=n)
+        t.add_dict_column("DGT")
+        calls = [b"0/0", b"0|1", b"1/1", b"./.", b"1/2", b"0", b"2|2", b"./1"]
+        self._rows = []
+        for j in range(num_random_test_rows):
+            row = [None]
+            for k in range(n):
+                row.append(random.choice(calls + [None]))
+                row.append(random.choice([None, random.randint(0, 100)]))
+                row.append(random.choice([None,
+                        (random.randint(-5, 5), random.randint(-5, 5))]))
+                row.append(random.choice([None, random.randint(0, 99) / 2]))
+            row.append(tuple(random.choice([None, b"0/1", b"1|1", b"0/0"])
+                    for k in range(n)))
+            row.append(random.choice(calls))
+            self._rows.append(row)
+        t.open("w")
+        t.append_many(self._rows)
+        t.close()
+        self._table = wt.open_table(self._homedir)
+
+    def classify(self, call):
+        if call is None:
+            return 3
+        alleles = call.replace(b"|", b"/").split(b"/")
+        if b"." in alleles:
+            return 3
+        if len(set(alleles)) > 1:
+            return 1
+        return 0 if alleles[0] == b"0" else 2
+
+    def genotype_counts(self, calls):
+        counts = [0, 0, 0, 0]
+        for c in calls:
+            counts[self.classify(c)] += 1
+        return tuple(counts)
+
+    def values(self, row, field):
+        t = self._table
+        return [row[t.get_column("S{0}.{1}".format(k, field)).get_position()]
+                for k in range(self.num_samples)]
+
+    def test_genotype_counts(self):
+        t = self._table
+        c = t.cursor([], reductions=[("genotype_counts", "S*.GT"),
+                ("genotype_counts", ["GT"]), ("genotype_counts", ["DGT"])])
+        rows = list(c)
+        self.assertEqual(len(rows), len(self._rows))
+        for row, r in zip(self._rows, rows):
+            self.assertEqual(r[0], self.genotype_counts(self.values(row, "GT")))
+            self.assertEqual(r[1], self.genotype_counts(row[-2]))
+            self.assertEqual(r[2], self.genotype_counts([row[-1]]))
+
+    def test_numeric(self):
+        t = self._table
+        reductions = []
+        for field in ["DP", "AD", "GQ"]:
+            for kind in ["mean", "min", "max"]:
+                reductions.append((kind, "S*." + field))
+        reductions.append(("max", ["S0.DP", "S0.AD", "S1.GQ"]))
+        c = t.cursor(["row_id"], start=1, stop=len(self._rows) - 1,
+                reductions=reductions)
+        for r in c:
+            row = self._rows[r[0]]
+            k = 1
+            for field in ["DP", "AD", "GQ"]:
+                v = [x for x in self.values(row, field) if x is not None]
+                if field == "AD":
+                    v = [y for x in v for y in x]
+                if len(v) == 0:
+                    self.assertEqual(r[k: k + 3], (None, None, None))
+                else:
+                    self.assertAlmostEqual(r[k], sum(v) / len(v))
+                    self.assertEqual(r[k + 1], min(v))
+                    self.assertEqual(r[k + 2], max(v))
+                    self.assertIsInstance(r[k + 1],
+                            float if field == "GQ" else int)
+                k += 3
+            v = [row[t.get_column(name).get_position()]
+                    for name in ["S0.DP", "S0.AD", "S1.GQ"]]
+            v = [y for x in v if x is not None
+                    for y in (x if isinstance(x, tuple) else [x])]
+            self.assertEqual(r[k], max(v) if len(v) > 0 else None)
+
+    def test_missing(self):
+        t = self._table
+        c = t.cursor(["row_id", "S0.DP"], reductions=[("missing", "S*.DP"),
+                ("missing", "S*")])
+        for r in c:
+            row = self._rows[r[0]]
+            self.assertEqual(r[1], row[2])
+            v = self.values(row, "DP")
+            self.assertAlmostEqual(r[2], v.count(None) / len(v))
+            v = row[1: 1 + 4 * self.num_samples]
+            self.assertAlmostEqual(r[3], v.count(None) / len(v))
+
+    def test_errors(self):
+        t = self._table
+        self.assertRaises(ValueError, t.cursor, [], reductions=[
+                ("median", ["S0.DP"])])
+        self.assertRaises(KeyError, t.cursor, [], reductions=[
+                ("missing", "X*")])
+        self.assertRaises(KeyError, t.cursor, [], reductions=[
+                ("missing", ["X"])])
+        self.assertRaises(ValueError, t.cursor, [], reductions=[
+                ("missing", [])])
+        self.assertRaises(ValueError, t.cursor, [], reductions=[])
+        self.assertRaises(TypeError, t.cursor, [], reductions=[
+                ("mean", "S*.GT")])
+        self.assertRaises(TypeError, t.cursor, [], reductions=[
+                ("genotype_counts", "S*.DP")])
+        t.close()
+        self._table = None
+        t = wt.Table(self._homedir)
+        t.open("a")
+        t.append([None, b"x/y"])
+        t.close()
+        self._table = wt.open_table(self._homedir)
+        c = self._table.cursor([], start=len(self._rows), reductions=[
+                ("genotype_counts", ["S0.GT"])])
+        self.assertRaises(ValueError, list, c)
+
+
+class PackedColumnTest(WormtableTest):
+    """
+    Tests for packed integer column files.
+    """
+    def make_table(self, rows):
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.add_uint_column("pos", size=8)
+        t.add_int_column("int", size=8)
+        t.add_int_column("small", size=1)
+        t.add_float_column("float", size=4)
+        t.add_uint_column("uintv", num_elements=2)
+        t.open("w")
+        t.append_many(rows)
+        t.close()
+        self._table = wt.open_table(self._homedir)
+        return self._table
+
+    def random_rows(self, n):
+        rows = []
+        pos = random.randint(0, 2**40)
+        for j in range(n):
+            pos += random.randint(0, 100)
+            if random.random() < 0.01:
+                pos = random.randint(0, 2**40)
+            x = random.choice([random.randint(-2**63 + 1, 2**63 - 1),
+                    random.randint(-10, 10)])
+            rows.append([None, None if random.random() < 0.05 else pos,
+                    None if random.random() < 0.05 else x,
+                    random.randint(-127, 127), None, None])
+        return rows
+
+    def verify_column(self, t, rows, name, start=0, stop=None):
+        k = t.get_column(name).get_position()
+        if stop is None:
+            stop = len(rows)
+        missing = bytearray(stop - start)
+        values = t.read_packed_column(name, start, stop, missing=missing)
+        self.assertEqual(len(values), stop - start)
+        for j in range(start, stop):
+            v = rows[j][k]
+            self.assertEqual(missing[j - start], int(v is None))
+            if v is not None:
+                self.assertEqual(values[j - start], v)
+
+    def test_round_trip(self):
+        for n in [1, 127, 128, 129, 1000]:
+            if self._table is not None:
+                self._table.close()
+                shutil.rmtree(self._homedir)
+                os.mkdir(self._homedir)
+            rows = self.random_rows(n)
+            t = self.make_table(rows)
+            for name in ["pos", "int", "small"]:
+                t.pack_column(name)
+            self.assertEqual(sorted(t.packed_columns()),
+                    ["int", "pos", "small"])
+            for name in ["pos", "int", "small"]:
+                self.verify_column(t, rows, name)
+                for k in range(10):
+                    start = random.randint(0, n)
+                    stop = random.randint(start, n)
+                    self.verify_column(t, rows, name, start, stop)
+
+    def test_extremes(self):
+        rows = [[None, v, -v if v < 2**63 else None, 0, None, None]
+                for v in [0, 2**64 - 2, 0, 2**63, 1, 2**62]]
+        rows += [[None, None, None, 0, None, None] for j in range(200)]
+        t = self.make_table(rows)
+        t.pack_column("pos")
+        t.pack_column("int")
+        self.verify_column(t, rows, "pos")
+        self.verify_column(t, rows, "int")
+
+    def test_sorted_size(self):
+        rows = [[None, 10**9 + 3 * j, None, 0, None, None]
+                for j in range(1000)]
+        t = self.make_table(rows)
+        t.pack_column("pos")
+        # constant deltas need no bits at all
+        self.assertLess(os.path.getsize(t.get_packed_column_path("pos")),
+                400)
+        self.assertEqual(list(t.read_packed_column("pos")),
+                [r[1] for r in rows])
+
+    def test_buffers(self):
+        rows = self.random_rows(300)
+        t = self.make_table(rows)
+        t.pack_column("int")
+        values = wt.int64_array(False, 100)
+        self.assertIs(t.read_packed_column("int", 10, 110, values), values)
+        self.assertRaises(ValueError, t.read_packed_column, "int", 0, 10,
+                values)
+        self.assertRaises(TypeError, t.read_packed_column, "int", 0, 100,
+                wt.int64_array(True, 100))
+        self.assertRaises(TypeError, t.read_packed_column, "int", 0, 100,
+                None, array.array("i", [0]) * 100)
+        self.assertRaises(ValueError, t.read_packed_column, "int", 0, 100,
+                None, bytearray(10))
+        self.assertRaises(IndexError, t.read_packed_column, "int", 0, 301)
+        self.assertRaises(ValueError, t.read_packed_column, "int", 10, 5)
+        self.assertEqual(len(t.read_packed_column("int", 5, 5)), 0)
+
+    def test_errors(self):
+        rows = self.random_rows(10)
+        t = self.make_table(rows)
+        for name in ["float", "uintv"]:
+            self.assertRaises(TypeError, t.pack_column, name)
+        self.assertEqual(list(t.packed_columns()), [])
+        self.assertRaises(_wormtable.WormtableError, t.read_packed_column, "pos")
+        t.pack_column("pos")
+        self.assertRaises(_wormtable.WormtableError, t.read_packed_column, "small")
+        t.close()
+        self._table = None
+        t = wt.Table(self._homedir)
+        t.open("a")
+        t.append([None, 1])
+        t.close()
+        self._table = wt.open_table(self._homedir)
+        self.assertRaises(_wormtable.WormtableError,
+                self._table.read_packed_column, "pos")
+        self._table.pack_column("pos")
+        self.verify_column(self._table, rows + [[None, 1]], "pos")
+
+
+class SparseColumnTest(WormtableTest):
+    """
+    Tests for sparse columns.
+    """
+    def add_columns(self, t, sparse):
+        t.add_id_column(4)
+        t.add_uint_column("uint", sparse=sparse)
+        t.add_int_column("int", size=4, num_elements=3, sparse=sparse)
+        t.add_float_column("float", size=8, sparse=sparse)
+        t.add_float_column("floatv", size=4, num_elements=wt.WT_VAR_1,
+                sparse=sparse)
+        t.add_char_column("char", num_elements=2, sparse=sparse)
+        t.add_char_column("charv", sparse=sparse)
+        t.add_char_column("charv2", num_elements=wt.WT_VAR_2, sparse=sparse)
+        t.add_dict_column("dict", sparse=sparse)
+        t.add_genotype_column("GT", num_elements=3, sparse=sparse)
+        t.add_uint_column("dense")
+
+    def random_rows(self, n, p=0.2):
+        def g():
+            return random.random() < p
+        rows = []
+        for j in range(n):
+            rows.append([None,
+                random.randint(0, 100) if g() else None,
+                tuple(random.randint(-9, 9) for k in range(3)) if g() else None,
+                random.uniform(-1, 1) if g() else None,
+                tuple(float(random.randint(0, 9))
+                    for k in range(random.randint(0, 4))) if g() else None,
+                random.choice([b"AB", b"CD"]) if g() else None,
+                b"x" * random.randint(0, 10) if g() else None,
+                b"y" * random.randint(0, 300) if g() else None,
+                random.choice([b"PASS", b"q10"]) if g() else None,
+                (b"0/1", None, b"1|1") if g() else None,
+                j])
+        return rows
+
+    def make_tables(self, rows):
+        tables = []
+        for sparse in [False, True]:
+            homedir = os.path.join(self._homedir, str(sparse))
+            os.mkdir(homedir)
+            t = wt.Table(homedir)
+            self.add_columns(t, sparse)
+            t.open("w")
+            t.append_many(rows)
+            t.close()
+            tables.append(wt.open_table(homedir))
+        return tables
+
+    def test_round_trip(self):
+        rows = self.random_rows(num_random_test_rows)
+        dense, sparse = self.make_tables(rows)
+        try:
+            self.assertTrue(sparse.get_column("uint").is_sparse())
+            self.assertFalse(sparse.get_column("dense").is_sparse())
+            self.assertFalse(dense.get_column("uint").is_sparse())
+            # 4 byte row_id + 2 byte dense + 2 byte header + 2 byte bitmap
+            self.assertEqual(sparse.get_fixed_region_size(), 10)
+            self.assertLess(sparse.get_total_row_size(),
+                    dense.get_total_row_size())
+            for j, (r1, r2) in enumerate(zip(dense, sparse)):
+                self.assertEqual(r1, r2)
+                row = list(rows[j])
+                row[0] = j
+                self.assertEqual(r2, tuple(row))
+            self.assertEqual(len(sparse), len(rows))
+        finally:
+            dense.close()
+            sparse.close()
+
+    def test_missing_rows(self):
+        rows = self.random_rows(100, 0)
+        dense, sparse = self.make_tables(rows)
+        try:
+            self.assertEqual(list(dense), list(sparse))
+            self.assertEqual(sparse.get_max_row_size(),
+                    sparse.get_fixed_region_size() - 4)
+        finally:
+            dense.close()
+            sparse.close()
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t, True)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual([c.is_sparse() for c in t.columns()],
+                [False] + [True] * 9 + [False])
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.add_uint_column("uint")
+        xml = ElementTree.tostring(t.get_column("uint").get_xml())
+        self.assertNotIn(b"sparse", xml)
+        t = wt.Table(self._homedir)
+        t.add_column("row_id", "", wt.WT_UINT, 4, 1, sparse=True)
+        t.add_uint_column("uint")
+        self.assertRaises(ValueError, t.open, "w")
+
+    def test_index(self):
+        rows = self.random_rows(num_random_test_rows, 0.5)
+        dense, sparse = self.make_tables(rows)
+        try:
+            for t in [dense, sparse]:
+                for name in ["uint", "charv", "int"]:
+                    i = wt.Index(t, name)
+                    i.add_key_column(t.get_column(name))
+                    i.open("w")
+                    i.build()
+                    i.close()
+            for name in ["uint", "charv", "int"]:
+                with dense.open_index(name) as i1:
+                    with sparse.open_index(name) as i2:
+                        self.assertEqual(list(i1.counter().items()),
+                                list(i2.counter().items()))
+                        self.assertEqual(list(i1.cursor(["row_id"])),
+                                list(i2.cursor(["row_id"])))
+        finally:
+            dense.close()
+            sparse.close()
+
+    def test_rewrite(self):
+        rows = self.random_rows(num_random_test_rows)
+        dense, sparse = self.make_tables(rows)
+        try:
+            for source, make_sparse in [(dense, True), (sparse, False),
+                    (sparse, True)]:
+                homedir = os.path.join(self._homedir, "rewrite")
+                os.mkdir(homedir)
+                t = wt.Table(homedir)
+                self.add_columns(t, make_sparse)
+                source.rewrite(t)
+                with wt.open_table(homedir) as t:
+                    self.assertEqual(list(t), list(dense))
+                shutil.rmtree(homedir)
+        finally:
+            dense.close()
+            sparse.close()
+
+    def test_reductions(self):
+        rows = self.random_rows(num_random_test_rows, 0.5)
+        dense, sparse = self.make_tables(rows)
+        try:
+            r = [("missing", "*"), ("mean", ["uint", "int", "float"]),
+                    ("genotype_counts", ["GT"])]
+            self.assertEqual(list(dense.cursor(["row_id"], reductions=r)),
+                    list(sparse.cursor(["row_id"], reductions=r)))
+        finally:
+            dense.close()
+            sparse.close()
+
+
+class RowStorageTest(object):
+    """
+    Tests common to the ways of storing rows. Subclasses add the columns
+    and generate random rows for their tables, and make the storage
+    specific assertions about each table written in verify_storage.
+    """
+    num_rows = 20
+    index_column = "uint"
+    # The (row_format, address_size, write_queue_size) of the tables
+    # written in the round trip test.
+    round_trip_options = [(wt.ROW_FORMAT_SORTABLE, 2, 0),
+            (wt.ROW_FORMAT_NATIVE, 2, 1)]
+
+    def set_row_storage(self, t):
+        """
+        Sets the storage options other than the row format and address
+        size on the specified table.
+        """
+        pass
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        """
+        Verifies the storage of the specified table holding the specified
+        rows.
+        """
+        self.assertEqual(t.get_row_format(), row_format)
+        self.assertEqual(t.get_address_size(), address_size)
+
+    def write_table(self, homedir, rows, row_format=wt.ROW_FORMAT_SORTABLE,
+            address_size=2, write_queue_size=0):
+        """
+        Writes the specified rows to a new table in homedir, and returns
+        the table opened for reading.
+        """
+        t = wt.Table(homedir)
+        self.add_columns(t)
+        t.set_row_format(row_format)
+        t.set_address_size(address_size)
+        self.set_row_storage(t)
+        t.open("w", write_queue_size)
+        t.append_many(rows)
+        t.close()
+        return wt.open_table(homedir)
+
+    def make_table(self, rows, *args):
+        self._table = self.write_table(self._homedir, rows, *args)
+        return self._table
+
+    def append_rows(self, rows):
+        """
+        Appends the specified rows to the closed table in the home
+        directory and reopens it for reading.
+        """
+        t = wt.Table(self._homedir)
+        t.open("a")
+        t.append_many(rows)
+        t.close()
+        self._table = wt.open_table(self._homedir)
+        return self._table
+
+    def verify_rows(self, t, rows):
+        self.assertEqual(len(t), len(rows))
+        for j, r in enumerate(t):
+            row = list(rows[j])
+            row[0] = j
+            self.assertEqual(r, tuple(row))
+
+    def test_round_trip(self):
+        for options in self.round_trip_options:
+            rows = self.random_rows(self.num_rows)
+            t = self.make_table(rows, *options)
+            self.verify_storage(t, rows, *options[:2])
+            self.verify_rows(t, rows)
+            n = len(rows)
+            self.assertEqual(t.get_rows([n - 1, 1, 2]),
+                    [t[n - 1], t[1], t[2]])
+            t.close()
+            self._table = None
+            shutil.rmtree(self._homedir)
+            os.mkdir(self._homedir)
+
+    def test_index(self):
+        rows = self.random_rows(self.num_rows)
+        t = self.make_table(rows, *self.round_trip_options[0])
+        name = self.index_column
+        k = t.get_column(name).get_position()
+        i = wt.Index(t, name)
+        i.add_key_column(t.get_column(name))
+        i.open("w")
+        i.build()
+        i.close()
+        # missing values sort first, and rows with equal keys are in
+        # row order.
+        values = [r[k] for r in rows]
+        key = lambda v: (v is not None, v)
+        expected = [(values[j], j) for j in sorted(range(len(rows)),
+                key=lambda j: key(values[j]))]
+        with t.open_index(name) as i:
+            self.assertEqual(sorted(set(values), key=key), list(i.keys()))
+            self.assertEqual(expected, list(i.cursor([name, "row_id"])))
+            counter = i.counter()
+            for v in set(values) - set([None]):
+                self.assertEqual(counter[v], values.count(v))
+
+    def test_append(self):
+        options = self.round_trip_options[-1]
+        rows = self.random_rows(self.num_rows)
+        t = self.make_table(rows[:self.num_rows // 2], *options)
+        t.close()
+        t = self.append_rows(rows[self.num_rows // 2:])
+        self.verify_storage(t, rows, *options[:2])
+        self.verify_rows(t, rows)
+
+    def test_rewrite(self):
+        rows = self.random_rows(self.num_rows)
+        homedir = os.path.join(self._homedir, "rewrite")
+        for options in self.round_trip_options:
+            t = self.make_table(rows, *options)
+            for row_format, address_size, _ in self.round_trip_options:
+                os.mkdir(homedir)
+                dest = wt.Table(homedir)
+                self.add_columns(dest)
+                dest.set_row_format(row_format)
+                dest.set_address_size(address_size)
+                self.set_row_storage(dest)
+                t.rewrite(dest)
+                with wt.open_table(homedir) as dest:
+                    self.verify_storage(dest, rows, row_format,
+                            address_size)
+                    self.assertEqual(list(dest), list(t))
+                shutil.rmtree(homedir)
+            t.close()
+            self._table = None
+            shutil.rmtree(self._homedir)
+            os.mkdir(self._homedir)
+
+
+class NativeRowTest(RowStorageTest, WormtableTest):
+    """
+    Tests for tables with native rows.
+    """
+    index_column = "uint_3"
+
+    def add_columns(self, t):
+        t.add_id_column(4)
+        for size in range(1, 9):
+            t.add_uint_column("uint_{0}".format(size), size=size)
+            t.add_int_column("int_{0}".format(size), size=size)
+        for size in [2, 4, 8]:
+            t.add_float_column("float_{0}".format(size), size=size)
+        t.add_int_column("intv", size=3, num_elements=wt.WT_VAR_1)
+        t.add_float_column("floatv", size=4, num_elements=3)
+        t.add_uint_column("sparse", size=3, sparse=True)
+        t.add_char_column("char", num_elements=2)
+        t.add_dict_column("dict")
+        t.add_genotype_column("GT", num_elements=2)
+
+    def random_rows(self, n):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        columns = t.columns()[1:]
+        def g():
+            return random.random() < 0.2
+        def value(c):
+            size = c.get_element_size()
+            if c.get_name().startswith("uint") or c.get_name() == "sparse":
+                return random.choice([0, 1, 2**(8 * size) - 2,
+                    random.randint(0, 2**(8 * size) - 2)])
+            elif c.get_name().startswith("int"):
+                m = 2**(8 * size - 1) - 1
+                v = random.choice([0, -1, m, -m, random.randint(-m, m)])
+                if c.get_name() == "intv":
+                    v = tuple(v for j in range(random.randint(0, 3)))
+                return v
+            elif c.get_name().startswith("float"):
+                v = random.choice([0.0, -0.0, 0.5, -1.5, 100.25])
+                if c.get_name() == "floatv":
+                    v = (v, -v, 1.0)
+                return v
+            elif c.get_name() == "char":
+                return random.choice([b"AB", b"CD"])
+            elif c.get_name() == "dict":
+                return random.choice([b"PASS", b"q10"])
+            return (b"0/1", random.choice([None, b"1|1"]))
+        rows = []
+        for j in range(n):
+            rows.append([None] + [None if g() else value(c) for c in columns])
+        return rows
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        super(NativeRowTest, self).verify_storage(t, rows, row_format,
+                address_size)
+        native = int(row_format == wt.ROW_FORMAT_NATIVE)
+        self.assertEqual(t.get_ll_object().native_rows, native)
+        self.assertEqual([c.get_ll_object().native for c in t.columns()],
+                [0] + [native] * (len(t.columns()) - 1))
+
+    def make_tables(self, rows):
+        tables = []
+        for row_format in [wt.ROW_FORMAT_SORTABLE, wt.ROW_FORMAT_NATIVE]:
+            homedir = os.path.join(self._homedir, row_format)
+            os.mkdir(homedir)
+            tables.append(self.write_table(homedir, rows, row_format))
+        return tables
+
+    def test_missing_rows(self):
+        rows = [[None] * 26 for j in range(10)]
+        sortable, native = self.make_tables(rows)
+        try:
+            self.assertEqual(list(sortable), list(native))
+            self.assertEqual(list(native)[5], tuple([5] + [None] * 25))
+        finally:
+            sortable.close()
+            native.close()
+
+    def test_index_order(self):
+        # native values are decoded into keys that sort as sortable rows
+        rows = self.random_rows(self.num_rows)
+        sortable, native = self.make_tables(rows)
+        names = ["uint_3", "int_2", "int_8", "float_2", "float_8", "intv",
+                "sparse", "dict"]
+        try:
+            self.assertEqual(sortable.get_total_row_size(),
+                    native.get_total_row_size())
+            for t in [sortable, native]:
+                for name in names:
+                    i = wt.Index(t, name)
+                    i.add_key_column(t.get_column(name))
+                    i.open("w")
+                    i.build()
+                    i.close()
+            for name in names:
+                with sortable.open_index(name) as i1:
+                    with native.open_index(name) as i2:
+                        self.assertEqual(list(i1.counter().items()),
+                                list(i2.counter().items()))
+                        self.assertEqual(i1.min_key(), i2.min_key())
+                        self.assertEqual(i1.max_key(), i2.max_key())
+                        self.assertEqual(list(i1.cursor(["row_id", name])),
+                                list(i2.cursor(["row_id", name])))
+        finally:
+            sortable.close()
+            native.close()
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        self.assertEqual(t.get_row_format(), wt.ROW_FORMAT_SORTABLE)
+        self.assertNotIn("row_format", t._generate_schema_xml().attrib)
+        self.assertRaises(ValueError, t.set_row_format, "big")
+        t.set_row_format(wt.ROW_FORMAT_NATIVE)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual(t.get_row_format(), wt.ROW_FORMAT_NATIVE)
+        t.open("w")
+        self.assertRaises(ValueError, t.set_row_format, "sortable")
+        t.close()
+
+
+class WideRowTest(RowStorageTest, WormtableTest):
+    """
+    Tests for tables with wide addresses.
+    """
+    num_rows = 10
+    index_column = "charv"
+    num_wide_columns = 3
+    round_trip_options = [(wt.ROW_FORMAT_SORTABLE, 3, 0),
+            (wt.ROW_FORMAT_NATIVE, 4, 1)]
+
+    def add_columns(self, t):
+        t.add_id_column(4)
+        t.add_uint_column("uint", size=4)
+        t.add_char_column("charv")
+        for j in range(self.num_wide_columns):
+            t.add_char_column("wide_{0}".format(j),
+                    num_elements=wt.WT_VAR_2)
+        t.add_uint_column("sparse", num_elements=wt.WT_VAR_2, sparse=True)
+
+    def random_rows(self, n, length=60000):
+        rows = []
+        for j in range(n):
+            row = [None, j, b"x" * random.randint(0, 10)]
+            for k in range(self.num_wide_columns):
+                c = random.choice([b"A", b"C", b"G", b"T"])
+                row.append(c * random.randint(length // 2, length))
+            row.append(tuple(range(random.randint(0, 1000)))
+                    if random.random() < 0.5 else None)
+            rows.append(row)
+        return rows
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        super(WideRowTest, self).verify_storage(t, rows, row_format,
+                address_size)
+        self.assertEqual(t.get_ll_object().address_size, address_size)
+        # the var(1) column, 3 var(2) columns and the sparse header
+        # use one extra byte each for every extra address byte.
+        extra = address_size - 2
+        self.assertEqual(t.get_fixed_region_size(),
+                4 + 4 + 3 + 3 * 4 + 2 + 5 * extra + 1)
+        self.assertGreater(t.get_max_row_size(), 2**16)
+
+    def test_large_rows(self):
+        # rows larger than the read buffer and the writer's blocks
+        self.num_wide_columns = 40
+        rows = self.random_rows(4, 65534)
+        t = self.make_table(rows, wt.ROW_FORMAT_SORTABLE, 4, 1)
+        self.assertGreater(t.get_max_row_size(), 2**20)
+        self.verify_rows(t, rows)
+        self.assertEqual(t.get_rows([3, 0, 1]), [t[3], t[0], t[1]])
+
+    def test_row_overflow(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        t.open("w")
+        rows = self.random_rows(1)
+        self.assertRaises(ValueError, t.append, rows[0])
+        t.close()
+        t = wt.Table(self._homedir)
+        self.assertRaises(ValueError, t.set_address_size, 1)
+        self.assertRaises(ValueError, t.set_address_size, 5)
+        self.assertEqual(t.get_address_size(), 2)
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        t.set_address_size(4)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual(t.get_address_size(), 4)
+        with open(schema) as f:
+            s = f.read()
+        with open(schema, "w") as f:
+            f.write(s.replace('address_size="4"', 'address_size="8"'))
+        t = wt.Table(self._homedir)
+        self.assertRaises(ValueError, t.read_schema, schema)
+
+    def test_rewrite_narrow(self):
+        # rows that fit are rewritten into tables with 2 byte addresses
+        rows = self.random_rows(5, length=10000)
+        t = self.make_table(rows, wt.ROW_FORMAT_SORTABLE, 3)
+        homedir = os.path.join(self._homedir, "rewrite")
+        os.mkdir(homedir)
+        dest = wt.Table(homedir)
+        self.add_columns(dest)
+        t.rewrite(dest)
+        with wt.open_table(homedir) as dest:
+            self.assertEqual(dest.get_address_size(), 2)
+            self.assertEqual(list(dest), list(t))
+
+
+class ColumnFamilyTest(RowStorageTest, WormtableTest):
+    """
+    Tests for tables with more than one column family.
+    """
+    index_column = "float"
+    round_trip_options = [(wt.ROW_FORMAT_SORTABLE, 2, 0),
+            (wt.ROW_FORMAT_NATIVE, 3, 1)]
+
+    def add_columns(self, t):
+        t.add_id_column(4)
+        t.add_uint_column("uint", size=4)
+        t.add_char_column("charv")
+        t.add_float_column("float", family=1)
+        t.add_int_column("intv", num_elements=wt.WT_VAR_1, family=1)
+        t.add_char_column("sparse", sparse=True, family=1)
+        t.add_uint_column("uint2", size=2, num_elements=3, family=2)
+        t.add_char_column("charv2", family=2)
+
+    def random_rows(self, n):
+        rows = []
+        for j in range(n):
+            row = [None, j, b"x" * random.randint(0, 10),
+                    random.choice([0.5, -2.0, 1.25]),
+                    tuple(range(random.randint(0, 5))),
+                    random.choice([None, b"ABC"]),
+                    random.choice([None, (j, j + 1, 2)]),
+                    b"y" * random.randint(0, 20)]
+            rows.append(row)
+        return rows
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        super(ColumnFamilyTest, self).verify_storage(t, rows, row_format,
+                address_size)
+        self.assertEqual(t.get_num_families(), 3)
+        self.assertEqual(t.get_ll_object().num_families, 3)
+        for family in range(3):
+            self.assertTrue(os.path.exists(t.get_data_path(family)))
+        self.assertEqual([c.get_family() for c in t.columns()],
+                [0, 0, 0, 1, 1, 1, 2, 2])
+        self.assertEqual(list(t.cursor(["row_id", "float"])),
+                [(j, r[3]) for j, r in enumerate(rows)])
+        self.assertEqual(list(t.cursor(["charv2", "uint"], 5, 10)),
+                [(r[7], r[1]) for r in rows[5:10]])
+        # batch reads within a single family and across families
+        self.assertEqual(t.get_rows([9, 1, 2], ["intv", "sparse"]),
+                [(rows[j][4], rows[j][5]) for j in [9, 1, 2]])
+
+    def test_partial_reads(self):
+        rows = self.random_rows(10)
+        t = self.make_table(rows)
+        t.close()
+        # cursors only read the families holding the requested columns
+        with open(t.get_data_path(2), "w"):
+            pass
+        t.open("r")
+        self.assertEqual(list(t.cursor(["charv", "intv"])),
+                [(r[2], r[4]) for r in rows])
+        self.assertEqual(list(t.cursor(["row_id"])),
+                [(j,) for j in range(len(rows))])
+        with self.assertRaises(_wormtable.WormtableError):
+            list(t.cursor(["charv", "charv2"]))
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual(t.get_num_families(), 3)
+        self.assertEqual([c.get_family() for c in t.columns()],
+                [0, 0, 0, 1, 1, 1, 2, 2])
+        t = wt.Table(self._homedir)
+        self.assertRaises(ValueError, t.add_uint_column, "u", family=-1)
+        self.assertRaises(ValueError, t.add_uint_column, "u", family=32)
+        t = wt.Table(self._homedir)
+        t.add_uint_column("row_id", size=4, family=1)
+        t.add_uint_column("u")
+        self.assertRaises(ValueError, t.open, "w")
+
+    def test_max_row_size(self):
+        # rows of families other than 0 do not include the row_id, and
+        # must fit in the 2 byte length of the record.
+        for address_size in [2, 3]:
+            t = wt.Table(self._homedir)
+            t.add_id_column(4)
+            t.add_char_column("big", num_elements=wt.WT_VAR_2, family=1)
+            t.set_address_size(address_size)
+            t.open("w")
+            rows = [(None, b"x" * 65530), (None, b"y")]
+            if address_size == 2:
+                self.assertRaises(ValueError, t.append, [None, b"z" * 65531])
+            else:
+                rows.append((None, b"z" * 65532))
+            t.append_many(rows)
+            t.close()
+            self._table = wt.open_table(self._homedir)
+            self.verify_rows(self._table, rows)
+            self._table.close()
+            self._table = None
+            shutil.rmtree(self._homedir)
+            os.mkdir(self._homedir)
+
+    def test_wide_row_buffer(self):
+        # the row buffer of a table with wide addresses starts small and
+        # grows to hold the largest row stored or read
+        for compression in [None, "dictionary"]:
+            t = wt.Table(self._homedir)
+            t.add_id_column(4)
+            for f in range(1, 8):
+                for k in range(3):
+                    t.add_char_column("c{0}_{1}".format(f, k),
+                            num_elements=wt.WT_VAR_2, family=f)
+            t.set_address_size(4)
+            if compression is not None:
+                t.set_row_compression(compression)
+            t.open("w")
+            self.assertEqual(t.get_ll_object().row_buffer_size, 2**16)
+            rows = []
+            for j in range(4):
+                row = [None] + [b""] * 21
+                for k in range(3):
+                    row[1 + 3 * (j + 2) + k] = (b"ACGT"[j:j + 1]
+                            * random.randint(50000, 65534))
+                rows.append(row)
+            t.append_many(rows)
+            self.assertEqual(t.get_ll_object().row_buffer_size, 2**18)
+            t.close()
+            self._table = wt.open_table(self._homedir)
+            ll = self._table.get_ll_object()
+            self.assertEqual(ll.row_buffer_size, 2**16)
+            self.assertEqual(self._table.get_rows([3, 1]),
+                    [(3,) + tuple(rows[3][1:]), (1,) + tuple(rows[1][1:])])
+            self.assertEqual(ll.row_buffer_size, 2**18)
+            self.verify_rows(self._table, rows)
+            self._table.close()
+            self._table = None
+            shutil.rmtree(self._homedir)
+            os.mkdir(self._homedir)
+
+    def test_rewrite_single_family(self):
+        rows = self.random_rows(10)
+        t = self.make_table(rows)
+        homedir = os.path.join(self._homedir, "rewrite")
+        os.mkdir(homedir)
+        dest = wt.Table(homedir)
+        for c in t.columns():
+            dest.add_column(c.get_name(), c.get_description(), c.get_type(),
+                    c.get_element_size(), c.get_num_elements(),
+                    c.is_sparse())
+        t.rewrite(dest)
+        with wt.open_table(homedir) as dest:
+            self.assertEqual(dest.get_num_families(), 1)
+            self.assertEqual(list(dest), list(t))
+
+
+class DenseRowTest(RowStorageTest, WormtableTest):
+    """
+    Tests for tables storing rows at fixed strides in the data files.
+    """
+    num_rows = 50
+
+    def add_columns(self, t):
+        t.add_id_column(4)
+        t.add_uint_column("uint", size=4)
+        t.add_int_column("int", size=2, num_elements=3)
+        t.add_float_column("float", family=1)
+        t.add_char_column("char", num_elements=5, family=1)
+
+    def random_rows(self, n):
+        rows = []
+        for j in range(n):
+            row = [None, random.choice([None, 1, 2, 3]),
+                    random.choice([None, (j, -j, 7)]),
+                    random.choice([None, 0.5, -2.0]),
+                    random.choice([None, b"ABCDE", b"xxxxx"])]
+            rows.append(row)
+        return rows
+
+    def set_row_storage(self, t):
+        t.set_row_storage(wt.ROW_STORAGE_DENSE)
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        super(DenseRowTest, self).verify_storage(t, rows, row_format,
+                address_size)
+        n = len(rows)
+        self.assertEqual(t.get_row_storage(), wt.ROW_STORAGE_DENSE)
+        self.assertEqual(t.get_ll_object().dense_rows, 1)
+        self.assertEqual(t.get_ll_object().get_num_rows(), n)
+        # rows are stored without their row_id at fixed strides
+        self.assertEqual(os.path.getsize(t.get_data_path(0)), n * 10)
+        self.assertEqual(os.path.getsize(t.get_data_path(1)), n * 9)
+        self.assertEqual(t[n - 1], tuple([n - 1] + rows[n - 1][1:]))
+        self.assertEqual(list(t.cursor(["char", "row_id"], 10, 15)),
+                [(r[4], j + 10) for j, r in enumerate(rows[10:15])])
+        self.assertEqual(list(t.cursor(["uint"], n - 5)),
+                [(r[1],) for r in rows[n - 5:]])
+        self.assertEqual(t.get_rows([9, 1, 2, 3], ["float"]),
+                [(rows[j][3],) for j in [9, 1, 2, 3]])
+        self.assertRaises(IndexError, t.get_rows, [n])
+
+    def test_append_partial_row(self):
+        rows = self.random_rows(20)
+        t = self.make_table(rows[:10])
+        t.close()
+        # a partly written row at the end of a data file is overwritten
+        with open(t.get_data_path(1), "ab") as f:
+            f.write(b"xyz")
+        t = self.append_rows(rows[10:])
+        self.verify_rows(t, rows)
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        self.assertEqual(t.get_row_storage(), wt.ROW_STORAGE_INDEXED)
+        self.assertRaises(ValueError, t.set_row_storage, "packed")
+        t.set_row_storage(wt.ROW_STORAGE_DENSE)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual(t.get_row_storage(), wt.ROW_STORAGE_DENSE)
+        for kwargs in [{"num_elements": wt.WT_VAR_1}, {"sparse": True}]:
+            t = wt.Table(self._homedir)
+            t.add_id_column(4)
+            t.add_uint_column("u", **kwargs)
+            t.set_row_storage(wt.ROW_STORAGE_DENSE)
+            self.assertRaises(ValueError, t.open, "w")
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.set_row_storage(wt.ROW_STORAGE_DENSE)
+        self.assertRaises(ValueError, t.open, "w")
+
+    def test_rewrite_indexed(self):
+        rows = self.random_rows(20)
+        t = self.make_table(rows)
+        homedir = os.path.join(self._homedir, "indexed")
+        os.mkdir(homedir)
+        dest = wt.Table(homedir)
+        self.add_columns(dest)
+        t.rewrite(dest)
+        with wt.open_table(homedir) as dest:
+            self.assertEqual(dest.get_row_storage(), wt.ROW_STORAGE_INDEXED)
+            self.assertEqual(list(dest), list(t))
+
+
+class CompressedRowTest(RowStorageTest, WormtableTest):
+    """
+    Tests for tables with rows compressed using trained dictionaries.
+    """
+    num_rows = 200
+    index_column = "float"
+    sample_rows = 20
+
+    def add_columns(self, t):
+        t.add_id_column(4)
+        t.add_uint_column("uint", size=4)
+        t.add_char_column("charv")
+        t.add_float_column("float", family=1)
+        t.add_int_column("intv", num_elements=wt.WT_VAR_1, family=1)
+        t.add_char_column("sparse", sparse=True, family=1)
+        t.add_char_column("empty", family=2)
+
+    def random_rows(self, n):
+        rows = []
+        for j in range(n):
+            row = [None, j, random.choice([b"GT:AD:DP:GQ:PL", b"GT:DP"]) * 4,
+                    random.choice([0.5, -2.0, 1.25]),
+                    tuple(range(random.randint(0, 5))),
+                    random.choice([None, b"AC=1;AF=0.5;AN=2;DP=10"]), None]
+            rows.append(row)
+        return rows
+
+    def set_row_storage(self, t):
+        t.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY,
+                self.sample_rows)
+
+    def verify_storage(self, t, rows, row_format, address_size):
+        super(CompressedRowTest, self).verify_storage(t, rows, row_format,
+                address_size)
+        self.assertEqual(t.get_row_compression(),
+                wt.ROW_COMPRESSION_DICTIONARY)
+        self.assertEqual(t.get_ll_object().compressed_rows, 1)
+        self.assertTrue(os.path.exists(t.get_dictionary_path()))
+        # the rows are smaller than they are uncompressed
+        self.assertLess(t.get_data_file_size(), t.get_total_row_size())
+        self.assertEqual(list(t.cursor(["charv", "intv"], 10, 30)),
+                [(r[2], r[4]) for r in rows[10:30]])
+        self.assertEqual(t.get_rows([150, 1, 2, 3], ["sparse", "uint"]),
+                [(rows[j][5], j) for j in [150, 1, 2, 3]])
+
+    def test_small_table(self):
+        # dictionaries are trained when the table is closed, and are used
+        # for rows that are appended later
+        self.sample_rows = 1000
+        rows = self.random_rows(60)
+        t = self.make_table(rows[:5])
+        t.close()
+        t = self.append_rows(rows[5:])
+        self.verify_rows(t, rows)
+        self.assertLess(t.get_data_file_size(), t.get_total_row_size())
+
+    def test_empty_table(self):
+        rows = self.random_rows(10)
+        t = self.make_table([])
+        self.assertEqual(len(t), 0)
+        t.close()
+        t = self.append_rows(rows)
+        self.verify_rows(t, rows)
+
+    def test_delete(self):
+        t = self.make_table(self.random_rows(50))
+        t.close()
+        t.delete()
+        self.assertFalse(os.path.exists(t.get_dictionary_path()))
+        self._table = None
+
+    def test_schema(self):
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        self.assertEqual(t.get_row_compression(), wt.ROW_COMPRESSION_NONE)
+        self.assertRaises(ValueError, t.set_row_compression, "zstd")
+        self.assertRaises(ValueError, t.set_row_compression,
+                wt.ROW_COMPRESSION_DICTIONARY, 0)
+        t.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY)
+        schema = os.path.join(self._homedir, "schema.xml")
+        t.write_schema(schema)
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertEqual(t.get_row_compression(),
+                wt.ROW_COMPRESSION_DICTIONARY)
+        t = wt.Table(self._homedir)
+        t.add_id_column(4)
+        t.add_uint_column("u")
+        t.set_row_storage(wt.ROW_STORAGE_DENSE)
+        t.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY)
+        self.assertRaises(ValueError, t.open, "w")
+
+    def test_short_rows(self):
+        # expanded rows shorter than the fixed region of their family are
+        # corrupt, whether they were stored or deflated
+        t = wt.Table(self._homedir)
+        self.add_columns(t)
+        t.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY, 1)
+        t.open("w")
+        t.append_many(self.random_rows(2))
+        for row in [b"\1\2", b"\0" * 9]:
+            t.get_ll_object().append_encoded_rows(struct.pack("=3I", 7,
+                len(row), 3) + b"\0" * 7 + row + b"\0" * 3)
+        t.close()
+        self._table = wt.open_table(self._homedir)
+        self.assertEqual(len(self._table), 4)
+        self.assertEqual(len(self._table.get_rows([1], ["float"])), 1)
+        for j in [2, 3]:
+            self.assertRaises(SystemError, list,
+                    self._table.cursor(["float"], j, j + 1))
+            self.assertRaises(SystemError, self._table.get_rows, [j],
+                    ["float"])
+
+    def test_corrupt_dictionary(self):
+        rows = self.random_rows(50)
+        t = self.make_table(rows)
+        t.close()
+        self._table = None
+        with open(t.get_dictionary_path(), "r+b") as f:
+            f.write(b"\0\0\0\7")
+        t = wt.Table(self._homedir)
+        self.assertRaises(_wormtable.WormtableError, t.open, "r")
+        os.unlink(t.get_dictionary_path())
+        t = wt.Table(self._homedir)
+        self.assertRaises(_wormtable.WormtableError, t.open, "r")
+
+
 class IndexBuildTest(WormtableTest):
     """
     Tests for the build process in indexes.
@@ -474,6 +2427,33 @@ class IndexIntegrityTest(WormtableTest):
                 self.assertRaises(StopIteration, next, cursor)
             i.close()
 
+    def test_many(self):
+        read_cols = [0, 1]
+        for i in self._indexes:
+            i.open("r")
+            keys = list(i.keys())
+            rows = []
+            for j, k in enumerate(keys):
+                if j == len(keys) - 1:
+                    rows.append(list(i.cursor(read_cols, k)))
+                else:
+                    rows.append(list(i.cursor(read_cols, k, keys[j + 1])))
+            query = keys + random.sample(keys, len(keys) // 2)
+            random.shuffle(query)
+            expected = [rows[keys.index(k)] for k in query]
+            self.assertEqual(i.lookup_many(query, read_cols), expected)
+            c = i.counter()
+            self.assertEqual(c.count_many(query), [len(r) for r in expected])
+            self.assertEqual(i.lookup_many([], read_cols), [])
+            cols = i.key_columns()
+            if len(cols) == 1 and cols[0].get_type() == wt.WT_UINT \
+                    and cols[0].get_num_elements() == 1:
+                # values in the table are all less than 1000
+                k = 1000
+                self.assertEqual(i.lookup_many([k], read_cols), [[]])
+                self.assertEqual(c.count_many([k, k]), [0, 0])
+            i.close()
+
 
 class BinnedIndexIntegrityTest(WormtableTest):
     """
@@ -525,6 +2505,261 @@ class BinnedIndexIntegrityTest(WormtableTest):
             i.close()
 
 
+class IntervalIndexTest(WormtableTest):
+    """
+    Tests the interval index by comparing overlap queries against a
+    brute force search of the table.
+    """
+    def setUp(self):
+        super(IntervalIndexTest, self).setUp()
+        t = wt.Table(self._homedir)
+        self._table = t
+        t.add_id_column(4)
+        t.add_char_column("seqname")
+        t.add_uint_column("start", size=5)
+        t.add_int_column("end", size=5)
+        t.open("w")
+        self._seqnames = [b"chr1", b"chr2", b"chrX"]
+        for j in range(10 * num_random_test_rows):
+            seqname = random.choice(self._seqnames)
+            start = random.randint(0, 2**32 - 2)
+            if random.random() < 0.75:
+                start = random.randint(0, 10**6)
+            # lengths over all the bin levels.
+            length = int(2**random.uniform(0, 31))
+            end = min(start + length, 2**32 - 1)
+            if random.random() < 0.05:
+                start = None
+            if random.random() < 0.05:
+                end = None
+            t.append([None, seqname, start, end])
+        t.append([None, b"chr1", 100, 10])
+        t.append([None, b"chr1", 0, 2**32 - 1])
+        t.close()
+        t.open("r")
+        self._index = wt.Index(t, "interval")
+        for name in ["seqname", "start", "end"]:
+            self._index.add_key_column(t.get_column(name))
+        self._index.set_interval()
+        self._index.open("w")
+        self._index.build()
+        self._index.close()
+        self._index.open("r")
+
+    def tearDown(self):
+        self._index.close()
+        super(IntervalIndexTest, self).tearDown()
+
+    def brute_force(self, seqname, start, end):
+        return sorted(r[0] for r in self._table.cursor(
+            ["row_id", "seqname", "start", "end"]) if r[1] == seqname
+            and r[2] is not None and r[3] is not None and r[2] <= r[3]
+            and r[2] <= end and r[3] >= start)
+
+    def verify_query(self, seqname, start, end):
+        i = self._index
+        v = sorted(r[0] for r in i.overlapping(["row_id"], start, end,
+            seqname))
+        self.assertEqual(v, self.brute_force(seqname, start, end))
+
+    def test_metadata(self):
+        self.assertTrue(self._index.is_interval())
+        i = self._table.open_index("interval")
+        self.assertTrue(i.is_interval())
+        self.assertTrue(i.get_colspec().endswith("(interval)"))
+        i.close()
+
+    def test_queries(self):
+        for seqname in self._seqnames + [b"chr3"]:
+            self.verify_query(seqname, 0, 2**32 - 1)
+            for j in range(20):
+                start = random.randint(0, 10**6)
+                self.verify_query(seqname, start, start)
+                end = start + int(2**random.uniform(0, 31))
+                self.verify_query(seqname, start, min(end, 2**32 - 1))
+        self.verify_query(b"chr1", 10, 100)
+        v = [r[0] for r in self._index.overlapping(["row_id"], 10, 100, "chr1")]
+        self.assertEqual(len(v), len(self.brute_force(b"chr1", 10, 100)))
+
+    def test_rows(self):
+        cols = ["row_id", "seqname", "start", "end"]
+        for r in self._index.overlapping(cols, 0, 10**6, b"chr2"):
+            self.assertEqual(r, self._table[r[0]])
+
+    def test_counter(self):
+        c = self._index.counter()
+        n = 0
+        for k, v in c.items():
+            self.assertTrue(v > 0)
+            n += v
+        self.assertEqual(n, len(self._table))
+
+    def test_errors(self):
+        i = self._index
+        self.assertRaises(ValueError, i.overlapping, ["row_id"], 10, 9, "chr1")
+        self.assertRaises(ValueError, i.overlapping, ["row_id"], 1, 2)
+        self.assertRaises(ValueError, i.overlapping, ["row_id"], -1, 2,
+                "chr1")
+        self.assertRaises(ValueError, i.overlapping, ["row_id"], 0, 2**32,
+                "chr1")
+        i2 = wt.Index(self._table, "not_interval")
+        i2.add_key_column(self._table.get_column("start"))
+        i2.open("w")
+        i2.build()
+        i2.close()
+        i2.open("r")
+        self.assertRaises(ValueError, i2.overlapping, ["row_id"], 1, 2)
+        i2.close()
+        for names in [["start"], ["seqname", "end"], ["start", "seqname"]]:
+            i2 = wt.Index(self._table, "bad")
+            for name in names:
+                i2.add_key_column(self._table.get_column(name))
+            i2.set_interval()
+            self.assertRaises(ValueError, i2.open, "w")
+
+
+class IndexJoinTest(WormtableTest):
+    """
+    Tests the merge join of two indexes by comparing against a
+    brute force join.
+    """
+    def make_table(self, homedir, num_rows):
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_char_column("CHROM")
+        t.add_uint_column("POS", size=5)
+        t.add_float_column("value")
+        t.open("w")
+        for j in range(num_rows):
+            chrom = random.choice([b"1", b"2", b"10", b"X", None])
+            pos = random.choice([None, random.randint(0, 20)])
+            t.append([None, chrom, pos, random.random()])
+        t.close()
+        t.open("r")
+        i = wt.Index(t, "CHROM+POS")
+        i.add_key_column(t.get_column("CHROM"))
+        i.add_key_column(t.get_column("POS"))
+        i.open("w")
+        i.build()
+        i.close()
+        i.open("r")
+        return t, i
+
+    def setUp(self):
+        super(IndexJoinTest, self).setUp()
+        n = 5 * num_random_test_rows
+        self._table, self._index = self.make_table(self._homedir, n)
+        self._other_homedir = tempfile.mkdtemp(prefix="wthl_")
+        self._other_table, self._other_index = self.make_table(
+                self._other_homedir, n)
+
+    def tearDown(self):
+        self._index.close()
+        self._other_index.close()
+        self._other_table.close()
+        shutil.rmtree(self._other_homedir)
+        super(IndexJoinTest, self).tearDown()
+
+    def brute_force(self, num_key_columns, outer):
+        cols = ["CHROM", "POS"][:num_key_columns]
+        right = {}
+        for r in self._other_table.cursor(cols + ["row_id"]):
+            k = r[:num_key_columns]
+            right.setdefault(k, []).append(r[num_key_columns])
+        ret = []
+        for r in self._table.cursor(cols + ["row_id"]):
+            k = r[:num_key_columns]
+            if k in right:
+                ret.extend((r[-1], v) for v in right[k])
+            elif outer:
+                ret.append((r[-1], None))
+        return sorted(ret, key=lambda x: (x[0], -1 if x[1] is None else x[1]))
+
+    def verify_join(self, num_key_columns, outer):
+        i = self._index
+        v = list(i.join(self._other_index, ["row_id"], ["row_id"], outer,
+            num_key_columns))
+        self.assertEqual(sorted(v, key=lambda x: (x[0],
+            -1 if x[1] is None else x[1])),
+            self.brute_force(num_key_columns, outer))
+        # rows are returned in index order.
+        rank = {}
+        for k in i.keys():
+            rank.setdefault(k[:num_key_columns], len(rank))
+        ranks = [rank[self._table[r[0]][1:3][:num_key_columns]] for r in v]
+        self.assertEqual(ranks, sorted(ranks))
+
+    def test_inner(self):
+        self.verify_join(2, False)
+        self.verify_join(1, False)
+
+    def test_outer(self):
+        self.verify_join(2, True)
+        self.verify_join(1, True)
+
+    def test_self_join(self):
+        v = list(self._index.join(self._index, ["row_id", "value"],
+            ["value", "POS"]))
+        n = sum(c * c for c in self._index.counter().values())
+        self.assertEqual(len(v), n)
+        for r in v:
+            self.assertEqual(r[:2], self._table[r[0]][::3])
+
+    def test_columns(self):
+        cols = ["row_id", "CHROM", "POS", "value"]
+        for r in self._index.join(self._other_index, cols, cols, True):
+            self.assertEqual(r[:4], self._table[r[0]])
+            if r[4] is None:
+                self.assertEqual(r[4:], (None, None, None, None))
+            else:
+                self.assertEqual(r[4:], self._other_table[r[4]])
+                self.assertEqual(r[1:3], r[5:7])
+
+    def test_unmatched_rows(self):
+        # rows with keys that are not matched are not read
+        homedir = os.path.join(self._homedir, "unmatched")
+        os.mkdir(homedir)
+        t = wt.Table(homedir)
+        t.add_id_column(4)
+        t.add_char_column("CHROM")
+        t.add_uint_column("POS", size=5)
+        t.open("w")
+        for j in range(10):
+            t.append([None, b"Y", j])
+        t.close()
+        t.open("r")
+        i = wt.Index(t, "CHROM+POS")
+        i.add_key_column(t.get_column("CHROM"))
+        i.add_key_column(t.get_column("POS"))
+        i.open("w")
+        i.build()
+        i.close()
+        t.close()
+        with open(t.get_data_path(), "w"):
+            pass
+        with wt.open_table(homedir) as t:
+            with t.open_index("CHROM+POS") as i:
+                self.assertEqual(list(self._index.join(i, ["row_id"],
+                        ["POS"])), [])
+                self.assertEqual(list(i.join(self._index, ["POS"],
+                        ["row_id"])), [])
+
+    def test_errors(self):
+        i = self._index
+        for n in [0, 3]:
+            self.assertRaises(ValueError, i.join, self._other_index,
+                    ["row_id"], ["row_id"], False, n)
+        i2 = wt.Index(self._other_table, "POS+CHROM")
+        i2.add_key_column(self._other_table.get_column("POS"))
+        i2.add_key_column(self._other_table.get_column("CHROM"))
+        i2.open("w")
+        i2.build()
+        i2.close()
+        i2.open("r")
+        self.assertRaises(ValueError, i.join, i2, ["row_id"], ["row_id"])
+        i2.close()
+
+
 class MultivalueColumnTest(IndexIntegrityTest):
     """
     Tests specific to the properties of multivalue columns.
@@ -1067,6 +3302,43 @@ class TableCursorTest(WormtableTest):
         self.assertRaises(StopIteration, next, cursor)
 
 
+class TableGetRowsTest(WormtableTest):
+    """
+    Tests the batch retrieval of rows from a table.
+    """
+    def setUp(self):
+        super(TableGetRowsTest, self).setUp()
+        self.make_random_table()
+
+    def test_get_rows(self):
+        t = self._table
+        n = len(t)
+        rows = [t[j] for j in range(n)]
+        self.assertEqual(t.get_rows(range(n)), rows)
+        self.assertEqual(t.get_rows([]), [])
+        for j in range(10):
+            ids = [random.randint(-n, n - 1) for k in range(2 * n)]
+            self.assertEqual(t.get_rows(ids), [rows[k] for k in ids])
+            self.assertEqual(t[ids], [rows[k] for k in ids])
+            cols = random.sample(range(len(t.columns())), 3)
+            v = t.get_rows(ids, cols)
+            self.assertEqual(v, [tuple(rows[k][c] for c in cols) for k in ids])
+        self.assertRaises(IndexError, t.get_rows, [n])
+        self.assertRaises(IndexError, t.get_rows, [0, -n - 1])
+
+    def test_slices(self):
+        t = self._table
+        n = len(t)
+        rows = [t[j] for j in range(n)]
+        for j in range(20):
+            start = random.randint(-n, 2 * n)
+            stop = random.randint(-n, 2 * n)
+            step = random.choice([None, 1, 2, 3, -1, -2])
+            self.assertEqual(t[start:stop:step], rows[start:stop:step])
+        self.assertEqual(t[:], rows)
+        self.assertEqual(t[::-1], rows[::-1])
+
+
 class FloatTest(WormtableTest):
     """
     Tests the limits of the floating point types to see if they are correct
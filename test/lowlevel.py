@@ -31,6 +31,7 @@ import _wormtable
 
 from _wormtable import WT_READ
 from _wormtable import WT_WRITE
+from _wormtable import WT_APPEND
 from _wormtable import MAX_ROW_SIZE
 from _wormtable import WT_VAR_1_MAX_ELEMENTS
 from _wormtable import WT_VAR_2_MAX_ELEMENTS
@@ -1345,7 +1346,7 @@ class TestTableInitialisation(TestTable):
         self.assertEqual(2, t.fixed_region_size)
         # Try bad mode values.
         for j in range(-10, 10):
-            if j not in [WT_READ, WT_WRITE]:
+            if j not in [WT_READ, WT_WRITE, WT_APPEND]:
                 self.assertRaises(ValueError, t.open, j)
         # Try to open table WT_READ that does not exist.
         self.assertRaises(_wormtable.WormtableError, t.open, WT_READ)
@@ -1475,7 +1476,7 @@ class TestIndexInitialisation(TestIndex):
         index = _wormtable.Index(self._table, f, [1],  8192)
         # Try bad mode values.
         for j in range(-10, 10):
-            if j not in [WT_READ, WT_WRITE]:
+            if j not in [WT_READ, WT_WRITE, WT_APPEND]:
                 self.assertRaises(ValueError, index.open, j)
         self.assertRaises(WormtableError, index.open, WT_READ)
         self._table.close()
@@ -21,6 +21,8 @@ from __future__ import print_function
 from __future__ import division
 
 import wormtable as wt
+import wormtable.vcf2wt as vcf2wt
+from wormtable.vcf2wt import VCFReader
 
 import unittest
 import random
@@ -30,6 +32,8 @@ import os.path
 import gzip
 import sys
 import io
+import zlib
+import struct
 from xml.etree import ElementTree
 
 EXAMPLE_VCF ="test/data/example.vcf"
@@ -110,6 +114,7 @@ class TestInputMethods(object):
         with open(input_file, "rb") as f:
             z.write(f.read())
         z.close()
+        self.assertFalse(wt.cli.is_bgzf(zgtf))
         self.run_command([zgtf, zipped, "-qf"])
         with wt.open_table(original) as t1:
             with wt.open_table(zipped) as t2:
@@ -117,6 +122,49 @@ class TestInputMethods(object):
         shutil.rmtree(self._homedir)
         os.mkdir(self._homedir)
 
+    def _write_bgzf(self, data, filename, block_size):
+        """
+        Writes the specified data to filename in BGZF format, using blocks
+        containing block_size bytes of uncompressed data.
+        """
+        with open(filename, "wb") as f:
+            chunks = [data[j:j + block_size]
+                    for j in range(0, len(data), block_size)]
+            # BGZF files end with an empty block.
+            for chunk in chunks + [b""]:
+                c = zlib.compressobj(6, zlib.DEFLATED, -15)
+                cdata = c.compress(chunk) + c.flush()
+                extra = struct.pack("<BBHH", 66, 67, 2, 25 + len(cdata))
+                f.write(struct.pack("<BBBBIBBH", 0x1f, 0x8b, 8, 4, 0, 0, 255,
+                    len(extra)))
+                f.write(extra)
+                f.write(cdata)
+                f.write(struct.pack("<II", zlib.crc32(chunk) & 0xffffffff,
+                    len(chunk)))
+
+    def _test_bgzf_input(self, input_file):
+        original = os.path.join(self._homedir, "original")
+        blocked = os.path.join(self._homedir, "blocked")
+        self.run_command([input_file, original, "-q"])
+        bgz = os.path.join(self._homedir, "input.gz")
+        with open(input_file, "rb") as f:
+            data = f.read()
+        # Use small blocks so that lines span several blocks and batches.
+        self._write_bgzf(data, bgz, 97)
+        self.assertTrue(wt.cli.is_bgzf(bgz))
+        batch_blocks = wt.cli.BGZF_BATCH_BLOCKS
+        wt.cli.BGZF_BATCH_BLOCKS = 3
+        try:
+            self.run_command([bgz, blocked, "-qf"])
+        finally:
+            wt.cli.BGZF_BATCH_BLOCKS = batch_blocks
+        with wt.open_table(original) as t1:
+            with wt.open_table(blocked) as t2:
+                self.assertEqual(len(t1), len(t2))
+                self.assert_tables_equal(t1, t2)
+        shutil.rmtree(self._homedir)
+        os.mkdir(self._homedir)
+
     def _test_stdin_input(self, input_file):
         to = os.path.join(self._homedir, "original")
         ts = os.path.join(self._homedir, "stdin")
@@ -181,6 +229,265 @@ class VcfBuildTest(object):
                 t_info_cols += 1
         self.assertEqual(t_info_cols, self._info_cols)
 
+    def test_parallel(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        chunk_lines = vcf2wt.PARALLEL_CHUNK_LINES
+        vcf2wt.PARALLEL_CHUNK_LINES = 7
+        try:
+            self.run_command([self.get_vcf(), homedir, "-qf", "-p", "3"])
+            t = wt.open_table(homedir)
+            self.assertEqual(len(t), len(self._table))
+            self.assert_tables_equal(t, self._table)
+            self.assertEqual(t.get_total_row_size(),
+                    self._table.get_total_row_size())
+            self.assertEqual(t.get_min_row_size(),
+                    self._table.get_min_row_size())
+            self.assertEqual(t.get_max_row_size(),
+                    self._table.get_max_row_size())
+            t.close()
+        finally:
+            vcf2wt.PARALLEL_CHUNK_LINES = chunk_lines
+            shutil.rmtree(homedir)
+
+    def test_python_parser(self):
+        # The native parser used by vcf2wt must give the same rows as
+        # VCFReader.rows.
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            reader = VCFReader(self.get_vcf())
+            t = wt.Table(homedir)
+            reader.generate_schema(t)
+            t.open("w")
+            column_map = {}
+            for c in t.columns():
+                column_map[c.get_name().encode()] = c.get_position()
+            for r in reader.rows(column_map):
+                t.append_encoded(r)
+            reader.close()
+            t.close()
+            t.open("r")
+            self.assertEqual(len(t), len(self._table))
+            self.assert_tables_equal(t, self._table)
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_optimise_schema(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            self.run_command([self.get_vcf(), homedir, "-qf", "-O"])
+            t = wt.open_table(homedir)
+            self.assertEqual(len(t), len(self._table))
+            self.assertLessEqual(len(t.columns()), len(self._table.columns()))
+            self.assertLess(t.get_total_row_size(),
+                    self._table.get_total_row_size())
+            columns = [c.get_name() for c in t.columns()]
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            # The dropped columns have no information.
+            dropped = [c.get_name() for c in self._table.columns()
+                    if c.get_name() not in columns]
+            if len(dropped) > 0:
+                values = set(self._table.cursor(dropped))
+                self.assertEqual(len(values), 1)
+            for c in t.columns():
+                c2 = self._table.get_column(c.get_name())
+                if c2.get_type() == wt.WT_INT:
+                    self.assertIn(c.get_type(), [wt.WT_INT, wt.WT_UINT])
+                else:
+                    self.assertEqual(c.get_type(), c2.get_type())
+                self.assertLessEqual(c.get_element_size(),
+                        c2.get_element_size())
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_genotype_matrix(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            self.run_command([self.get_vcf(), homedir, "-qf", "-G"])
+            t = wt.open_table(homedir)
+            gt = t.get_column("FORMAT.GT")
+            self.assertEqual(gt.get_type(), wt.WT_GENOTYPE)
+            samples = [c.get_name() for c in self._table.columns()
+                    if c.get_name().endswith(".GT")]
+            self.assertEqual(gt.get_num_elements(), len(samples))
+            self.assertLess(t.get_total_row_size(),
+                    self._table.get_total_row_size())
+            expected = []
+            for row in self._table.cursor(samples):
+                expected.append(tuple(None if v == b"./." else v
+                        for v in row))
+            values = []
+            for row in t.cursor(["FORMAT.GT"]):
+                v = row[0]
+                if v is None:
+                    v = tuple(None for s in samples)
+                values.append(v)
+            self.assertEqual(values, expected)
+            # VCFReader.rows gives the same values.
+            reader = VCFReader(self.get_vcf())
+            t2 = wt.Table(os.path.join(homedir, "python"))
+            os.mkdir(t2.get_homedir())
+            reader.generate_schema(t2, True)
+            t2.open("w")
+            column_map = {}
+            for c in t2.columns():
+                column_map[c.get_name().encode()] = c.get_position()
+            for r in reader.rows(column_map):
+                t2.append_encoded(r)
+            reader.close()
+            t2.close()
+            t2.open("r")
+            self.assert_tables_equal(t, t2)
+            t2.close()
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_dictionary_schema(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            self.run_command([self.get_vcf(), homedir, "-qf", "-O", "-D",
+                    "-p", "2"])
+            t = wt.open_table(homedir)
+            self.assertEqual(len(t), len(self._table))
+            columns = [c.get_name() for c in t.columns()]
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            num_dict = 0
+            for c in t.columns():
+                c2 = self._table.get_column(c.get_name())
+                if c.get_type() == wt.WT_DICT:
+                    self.assertEqual(c2.get_type(), wt.WT_CHAR)
+                    self.assertEqual(c.get_element_size(), 1)
+                    self.assertEqual(c.get_num_elements(), 1)
+                    self.assertLessEqual(len(c.get_dictionary()), 255)
+                    num_dict += 1
+            self.assertGreater(num_dict, 0)
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_sparse_info(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            columns = [c.get_name() for c in self._table.columns()]
+            self.run_command([self.get_vcf(), homedir, "-qf", "-S", "-p", "2"])
+            t = wt.open_table(homedir)
+            for c in t.columns():
+                self.assertEqual(c.is_sparse(),
+                        c.get_name().startswith("INFO."))
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            t.close()
+            self.run_command([self.get_vcf(), homedir, "-qf", "-S", "-O"])
+            t = wt.open_table(homedir)
+            columns = [c.get_name() for c in t.columns()]
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            for c in t.columns():
+                if c.is_sparse():
+                    self.assertTrue(c.get_name().startswith("INFO."))
+                    n = sum(r[0] is not None for r in t.cursor([c]))
+                    self.assertLess(2 * n, len(t))
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_native_rows(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            columns = [c.get_name() for c in self._table.columns()]
+            self.run_command([self.get_vcf(), homedir, "-qf", "-N"])
+            t = wt.open_table(homedir)
+            self.assertEqual(t.get_row_format(), wt.ROW_FORMAT_NATIVE)
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_schema_options_parallel(self):
+        # Rows encoded by worker processes must use the options given on
+        # the command line, and not just those in the schema.
+        schema = os.path.join(self._homedir, "schema.xml")
+        self.run_command([self.get_vcf(), schema, "-g"])
+        options = ["-N", "-A", "3"]
+        columns = [c.get_name() for c in self._table.columns()]
+        chunk_lines = vcf2wt.PARALLEL_CHUNK_LINES
+        vcf2wt.PARALLEL_CHUNK_LINES = 7
+        homedirs = []
+        try:
+            for processes in ["1", "2"]:
+                homedir = tempfile.mkdtemp(prefix="wtutil_")
+                homedirs.append(homedir)
+                self.run_command([self.get_vcf(), homedir, "-qf", "-s",
+                        schema, "-p", processes] + options)
+                t = wt.open_table(homedir)
+                self.assertEqual(t.get_row_format(), wt.ROW_FORMAT_NATIVE)
+                self.assertEqual(t.get_address_size(), 3)
+                self.assertEqual(list(t.cursor(columns)),
+                        list(self._table.cursor(columns)))
+                t.close()
+        finally:
+            vcf2wt.PARALLEL_CHUNK_LINES = chunk_lines
+            for homedir in homedirs:
+                shutil.rmtree(homedir)
+
+    def test_address_size(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            columns = [c.get_name() for c in self._table.columns()]
+            self.run_command([self.get_vcf(), homedir, "-qf", "-A", "3"])
+            t = wt.open_table(homedir)
+            self.assertEqual(t.get_address_size(), 3)
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_column_families(self):
+        families = set()
+        for c in self._table.columns():
+            family = 0
+            if c.get_name().startswith("INFO."):
+                family = 1
+            elif "." in c.get_name():
+                family = self._table.get_num_families() - 1
+            self.assertEqual(c.get_family(), family)
+            families.add(family)
+        self.assertEqual(len(families), self._table.get_num_families())
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            columns = [c.get_name() for c in self._table.columns()]
+            self.run_command([self.get_vcf(), homedir, "-qf",
+                    "--single-family"])
+            t = wt.open_table(homedir)
+            self.assertEqual(t.get_num_families(), 1)
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
+    def test_compress_rows(self):
+        homedir = tempfile.mkdtemp(prefix="wtutil_")
+        try:
+            columns = [c.get_name() for c in self._table.columns()]
+            self.run_command([self.get_vcf(), homedir, "-qf",
+                    "--compress-rows"])
+            t = wt.open_table(homedir)
+            self.assertEqual(t.get_row_compression(),
+                    wt.ROW_COMPRESSION_DICTIONARY)
+            self.assertTrue(os.path.exists(t.get_dictionary_path()))
+            self.assertEqual(list(t.cursor(columns)),
+                    list(self._table.cursor(columns)))
+            t.close()
+        finally:
+            shutil.rmtree(homedir)
+
 
 class BuildExampleVCFTest(VcfBuildTest, Vcf2wtTest):
     def get_vcf(self):
@@ -200,6 +507,10 @@ class Vcf2wtTestInputMethods(Vcf2wtTest, TestInputMethods):
         self._test_gzipped_input(EXAMPLE_VCF)
         self._test_gzipped_input(SAMPLE_VCF)
 
+    def test_bgzf(self):
+        self._test_bgzf_input(EXAMPLE_VCF)
+        self._test_bgzf_input(SAMPLE_VCF)
+
     def test_stdin(self):
         self._test_stdin_input(EXAMPLE_VCF)
         self._test_stdin_input(SAMPLE_VCF)
@@ -226,6 +537,51 @@ class TestSchemaGeneration(Vcf2wtTest):
         self.__test_schema_generator(EXAMPLE_VCF)
         self.__test_schema_generator(SAMPLE_VCF)
 
+    def test_optimised_generator(self):
+        schema = os.path.join(self._homedir, "schema.xml")
+        self.run_command([SAMPLE_VCF, schema, "-g", "-O",
+                "--profile-rows", "2"])
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        # The row_id column is not shrunk and variable length columns are
+        # not made fixed length for a partial profile
+        self.assertEqual(t.get_column(0).get_element_size(), 5)
+        self.assertEqual(t.get_column("POS").get_element_size(), 2)
+        self.assertEqual(t.get_column("NA00001.GT").get_num_elements(),
+                wt.WT_VAR_1)
+
+    def test_optimised_partial_profile(self):
+        # Columns that only have values after the profiled rows are kept.
+        vcf = os.path.join(self._homedir, "partial.vcf")
+        with open(vcf, "w") as f:
+            f.write("##fileformat=VCFv4.1\n")
+            f.write("##INFO=<ID=XX,Number=1,Type=Integer,Description=\"X\">\n")
+            f.write("##FILTER=<ID=q10,Description=\"Quality below 10\">\n")
+            f.write("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n")
+            f.write("20\t1\t.\tG\tA\t29\tPASS\t.\n")
+            f.write("20\t2\t.\tG\tA\t29\tPASS\t.\n")
+            f.write("20\t3\t.\tG\tA\t29\tq10\tXX=99\n")
+        homedir = os.path.join(self._homedir, "table")
+        self.run_command([vcf, homedir, "-q", "-O", "--profile-rows", "2"])
+        with wt.open_table(homedir) as t:
+            self.assertEqual(list(t.cursor(["POS", "FILTER", "INFO.XX"])),
+                    [(1, b"PASS", None), (2, b"PASS", None),
+                    (3, b"q10", 99)])
+
+    def test_dictionary_requires_optimise(self):
+        schema = os.path.join(self._homedir, "schema.xml")
+        self.assertRaises(SystemExit, self.run_command,
+                [SAMPLE_VCF, schema, "-g", "-D"])
+
+    def test_sparse_info_schema(self):
+        schema = os.path.join(self._homedir, "schema.xml")
+        self.run_command([SAMPLE_VCF, schema, "-g", "-S"])
+        t = wt.Table(self._homedir)
+        t.read_schema(schema)
+        self.assertTrue(any(c.is_sparse() for c in t.columns()))
+        self.assertRaises(SystemExit, self.run_command,
+                [SAMPLE_VCF, self._homedir, "-S", "-s", schema])
+
 class WtadminTest(UtilityTest):
     """
     Class for testing wtadmin
@@ -382,6 +738,56 @@ class WtadminTest(UtilityTest):
                     d2[k] = v
             self.assertEqual(d1, d2)
 
+    def test_compact(self):
+        dest = os.path.join(self._homedir, "compact")
+        schema = os.path.join(self._homedir, "schema.xml")
+        t = wt.Table(dest)
+        for c in self._table.columns():
+            n = c.get_num_elements()
+            size = c.get_element_size()
+            if c.get_name() == "POS":
+                size = 4
+            if c.get_name() != "QUAL":
+                t.add_column(c.get_name(), c.get_description(), c.get_type(),
+                        size, n)
+        t.write_schema(schema)
+        s = self.run_command(["compact", self._homedir, dest, schema, "-q"])
+        self.assertEqual(s, "")
+        self.assertRaises(SystemExit, self.run_command,
+                ["compact", self._homedir, dest, schema, "-q"])
+        self.run_command(["compact", self._homedir, dest, schema, "-qf"])
+        cols = [c.get_name() for c in t.columns()]
+        with wt.open_table(dest) as t:
+            self.assertEqual(len(t), len(self._table))
+            self.assertEqual(t.get_column("POS").get_element_size(), 4)
+            self.assertEqual(list(t.cursor(cols)),
+                    list(self._table.cursor(cols)))
+
+    def test_compact_overflow(self):
+        dest = os.path.join(self._homedir, "compact")
+        schema = os.path.join(self._homedir, "schema.xml")
+        t = wt.Table(dest)
+        t.add_id_column(4)
+        t.add_uint_column("POS", size=1)
+        t.write_schema(schema)
+        self.assertRaises(OverflowError, self.run_command,
+                ["compact", self._homedir, dest, schema, "-q"])
+        self.assertFalse(os.path.exists(dest))
+
+    def test_pack(self):
+        s = self.run_command(["pack", self._homedir, "POS", "-q"])
+        self.assertEqual(s, "")
+        self.assertEqual(list(self._table.packed_columns()), ["POS"])
+        values = self._table.read_packed_column("POS")
+        self.assertEqual(list(values),
+                [r[0] for r in self._table.cursor(["POS"])])
+        s = self.run_command(["pack", self._homedir, "POS"])
+        self.assertTrue(s.startswith("POS"))
+        self.assertRaises(SystemExit, self.run_command,
+                ["pack", self._homedir, "REF"])
+        self.assertRaises(SystemExit, self.run_command,
+                ["pack", self._homedir, "NOT_A_COLUMN"])
+
 
 class Gtf2wtTest(UtilityTest):
     """
@@ -470,6 +876,10 @@ class Gtf2wtTestInputMethods(Gtf2wtTest, TestInputMethods):
         self._test_gzipped_input(EXAMPLE_GTF)
         self._test_gzipped_input(SAMPLE_GTF)
 
+    def test_bgzf(self):
+        self._test_bgzf_input(EXAMPLE_GTF)
+        self._test_bgzf_input(SAMPLE_GTF)
+
     def test_stdin(self):
         self._test_stdin_input(EXAMPLE_GTF)
         self._test_stdin_input(SAMPLE_GTF)
@@ -22,10 +22,15 @@ Command line interface utilities for wormtable.
 from __future__ import print_function
 from __future__ import division
 
+import io
 import gzip
 import os
 import sys
 import time
+import zlib
+import struct
+import multiprocessing
+import multiprocessing.pool
 
 import wormtable as wt
 
@@ -74,6 +79,160 @@ class ProgressMonitor(object):
         """
         print()
 
+# The BGZF block header: the gzip magic, deflate compression method, the
+# FEXTRA flag, mtime, xfl, os and the length of the extra field.
+BGZF_HEADER = struct.Struct("<BBBBIBBH")
+BGZF_MAGIC = (0x1f, 0x8b, 8, 4)
+# The number of BGZF blocks decompressed in each batch.
+BGZF_BATCH_BLOCKS = 64
+
+
+def is_bgzf(filename):
+    """
+    Returns True if the specified file is in the blocked gzip format (BGZF)
+    used by bgzip and tabix.
+    """
+    with open(filename, "rb") as f:
+        header = f.read(BGZF_HEADER.size)
+        if len(header) < BGZF_HEADER.size:
+            return False
+        fields = BGZF_HEADER.unpack(header)
+        if fields[:4] != BGZF_MAGIC:
+            return False
+        return bgzf_block_size(f.read(fields[-1])) is not None
+
+
+def bgzf_block_size(extra):
+    """
+    Returns the total size of the BGZF block with the specified gzip extra
+    field, or None if this is not a BGZF block.
+    """
+    j = 0
+    while j + 4 <= len(extra):
+        si1, si2, slen = struct.unpack("<BBH", extra[j:j + 4])
+        if si1 == 66 and si2 == 67 and slen == 2:
+            return struct.unpack("<H", extra[j + 4:j + 6])[0] + 1
+        j += 4 + slen
+    return None
+
+
+def decompress_bgzf_block(block):
+    """
+    Returns the decompressed data in the specified BGZF block, checking
+    its CRC and length.
+    """
+    xlen = BGZF_HEADER.unpack(block[:BGZF_HEADER.size])[-1]
+    crc, isize = struct.unpack("<II", block[-8:])
+    data = zlib.decompress(block[BGZF_HEADER.size + xlen:-8], -15)
+    if len(data) != isize or zlib.crc32(data) & 0xffffffff != crc:
+        raise IOError("Corrupt BGZF block")
+    return data
+
+
+class BGZFReader(object):
+    """
+    A file-like object for reading lines from a BGZF file. BGZF files
+    consist of independent gzip blocks, so we read blocks in batches and
+    decompress them on a pool of threads; zlib releases the GIL while
+    decompressing. The next batch is decompressed while the lines from the
+    current batch are consumed.
+    """
+    def __init__(self, f, num_threads=None):
+        if num_threads is None:
+            num_threads = multiprocessing.cpu_count()
+        self.__file = f
+        self.__pool = multiprocessing.pool.ThreadPool(num_threads)
+        self.__lines = []
+        self.__line_index = 0
+        self.__remainder = b""
+        self.__pending = self.__read_batch()
+
+    def __read_block(self):
+        """
+        Returns the next raw block from the file, or None at EOF.
+        """
+        header = self.__file.read(BGZF_HEADER.size)
+        if len(header) == 0:
+            return None
+        if len(header) < BGZF_HEADER.size:
+            raise IOError("Truncated BGZF file")
+        fields = BGZF_HEADER.unpack(header)
+        if fields[:4] != BGZF_MAGIC:
+            raise IOError("Not a BGZF block")
+        extra = self.__file.read(fields[-1])
+        size = bgzf_block_size(extra)
+        if size is None:
+            raise IOError("Not a BGZF block")
+        body = self.__file.read(size - len(header) - len(extra))
+        if len(body) != size - len(header) - len(extra):
+            raise IOError("Truncated BGZF file")
+        return header + extra + body
+
+    def __read_batch(self):
+        """
+        Reads the next batch of blocks and starts decompressing them,
+        returning the AsyncResult, or None at EOF.
+        """
+        blocks = []
+        while len(blocks) < BGZF_BATCH_BLOCKS:
+            block = self.__read_block()
+            if block is None:
+                break
+            blocks.append(block)
+        ret = None
+        if len(blocks) > 0:
+            ret = self.__pool.map_async(decompress_bgzf_block, blocks)
+        return ret
+
+    def __fill_lines(self):
+        """
+        Fills the buffer of lines from the next decompressed batch.
+        Returns False if there are no more lines.
+        """
+        while self.__line_index == len(self.__lines):
+            if self.__pending is None:
+                self.__lines = []
+                self.__line_index = 0
+                if len(self.__remainder) > 0:
+                    self.__lines = [self.__remainder]
+                    self.__remainder = b""
+                    return True
+                return False
+            data = self.__remainder + b"".join(self.__pending.get())
+            self.__pending = self.__read_batch()
+            self.__lines = io.BytesIO(data).readlines()
+            self.__line_index = 0
+            self.__remainder = b""
+            if len(self.__lines) > 0 and not self.__lines[-1].endswith(b"\n"):
+                self.__remainder = self.__lines.pop()
+        return True
+
+    def readline(self):
+        """
+        Returns the next line, or the empty string at EOF.
+        """
+        ret = b""
+        if self.__fill_lines():
+            ret = self.__lines[self.__line_index]
+            self.__line_index += 1
+        return ret
+
+    def __iter__(self):
+        while self.__fill_lines():
+            j = self.__line_index
+            self.__line_index = len(self.__lines)
+            for line in self.__lines[j:]:
+                yield line
+
+    def close(self):
+        """
+        Shuts down the thread pool and closes the underlying file.
+        """
+        self.__pool.terminate()
+        self.__pool.join()
+        self.__file.close()
+
+
 BROKEN_GZIP_MESSAGE = """
 An error occurred reading the input gzip file. This is probably due to a
 bug in recent versions of Python, resulting in an error when trying
@@ -102,7 +261,11 @@ class FileReader(object):
             self.__input_file_size = None
             self.__progress_file = None
         else:
-            if in_file.endswith(".gz"):
+            if in_file.endswith(".gz") and is_bgzf(in_file):
+                # BGZF files are decompressed in parallel.
+                self.__progress_file = open(in_file, "rb")
+                self.__input_file = BGZFReader(self.__progress_file)
+            elif in_file.endswith(".gz"):
                 # Detect broken GZIP handling in 2.7/3.2 and others and abort
                 # TODO this has been fixed upstream and can be removed at
                 # some point.
@@ -76,6 +76,11 @@ GTF_ATTRIBUTE_COLUMNS = [GENE_ID, TRANSCRIPT_ID]
 # Special values in GTF
 MISSING_VALUE = b"."
 
+# The number of rows we append to the table in each call
+APPEND_BATCH_ROWS = 1024
+# The size of the queue of rows written to the table by a background thread
+WRITE_QUEUE_SIZE = 8 * 1024 * 1024
+
 class GTFReader(cli.FileReader):
     """
     Parse GTF files.
@@ -163,10 +168,15 @@ class ProgramRunner(object):
         self.__table = wt.Table(self.__destination)
         self.__define_schema()
         self.__table.set_db_cache_size(self.__db_cache_size)
-        self.__table.open("w")
+        self.__table.open("w", write_queue_size=WRITE_QUEUE_SIZE)
         self.__reader.set_progress(self.__progress)
+        batch = []
         for r in self.__reader.rows():
-            self.__table.append_encoded([None] + r)
+            batch.append([None] + r)
+            if len(batch) == APPEND_BATCH_ROWS:
+                self.__table.append_encoded_many(batch)
+                batch = []
+        self.__table.append_encoded_many(batch)
         self.__table.close()
 
     def run(self):
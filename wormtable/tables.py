@@ -29,7 +29,9 @@ from __future__ import division
 
 import os
 import glob
+import array
 import shutil
+import fnmatch
 import collections
 from xml.dom import minidom
 from xml.etree import ElementTree
@@ -38,22 +40,68 @@ import _wormtable
 
 TABLE_METADATA_VERSION = "0.3"
 INDEX_METADATA_VERSION = "0.4"
+# Interval indexes cannot be read by older versions, so we only write
+# this version for them.
+INTERVAL_INDEX_METADATA_VERSION = "0.5"
 
 DEFAULT_CACHE_SIZE = 16 * 2**20  # 16M
 DEFAULT_CACHE_SIZE_STR = "16M"
 
+ROW_FORMAT_SORTABLE = "sortable"
+ROW_FORMAT_NATIVE = "native"
+
+ROW_STORAGE_INDEXED = "indexed"
+ROW_STORAGE_DENSE = "dense"
+
+ROW_COMPRESSION_NONE = "none"
+ROW_COMPRESSION_DICTIONARY = "dictionary"
+DEFAULT_COMPRESSION_SAMPLE_ROWS = 1000
+
+DEFAULT_ADDRESS_SIZE = 2
+ADDRESS_SIZES = [2, 3, 4]
+
 WT_INT = _wormtable.WT_INT
 WT_UINT = _wormtable.WT_UINT
 WT_FLOAT = _wormtable.WT_FLOAT
 WT_CHAR = _wormtable.WT_CHAR
+WT_DICT = _wormtable.WT_DICT
+WT_GENOTYPE = _wormtable.WT_GENOTYPE
 
 WT_READ = _wormtable.WT_READ
 WT_WRITE = _wormtable.WT_WRITE
+WT_APPEND = _wormtable.WT_APPEND
 WT_VAR_1 = _wormtable.WT_VAR_1
 WT_VAR_2 = _wormtable.WT_VAR_2
 
 KEY_UNSET = "KEY_UNSET"
 
+REDUCTION_KIND_MAP = {
+    "missing": _wormtable.WT_REDUCE_MISSING,
+    "mean": _wormtable.WT_REDUCE_MEAN,
+    "min": _wormtable.WT_REDUCE_MIN,
+    "max": _wormtable.WT_REDUCE_MAX,
+    "genotype_counts": _wormtable.WT_REDUCE_GENOTYPE_COUNTS,
+}
+
+
+def int64_array(unsigned, n):
+    """
+    Returns an array of n zero-valued 64 bit integers, which are unsigned
+    if the specified flag is true.
+    """
+    # The q and Q codes are not available in the array module for Python 2.
+    codes = ["q", "l"]
+    if unsigned:
+        codes = ["Q", "L"]
+    for code in codes:
+        try:
+            a = array.array(code, [0])
+        except ValueError:
+            continue
+        if a.itemsize == 8:
+            return a * n
+    raise ValueError("64 bit integer arrays not supported")
+
 
 def open_table(homedir, db_cache_size=DEFAULT_CACHE_SIZE_STR):
     """
@@ -89,6 +137,8 @@ class Column(object):
         WT_UINT: "uint",
         WT_CHAR: "char",
         WT_FLOAT: "float",
+        WT_DICT: "dict",
+        WT_GENOTYPE: "genotype",
     }
 
     def __init__(self, ll_object):
@@ -130,7 +180,7 @@ class Column(object):
     def get_type(self):
         """
         Returns the type code for this column. This is
-        one of WT_INT,  WT_UINT, WT_FLOAT or  WT_CHAR.
+        one of WT_INT,  WT_UINT, WT_FLOAT, WT_CHAR, WT_DICT or WT_GENOTYPE.
         """
         return self.__ll_object.element_type
 
@@ -155,6 +205,28 @@ class Column(object):
         """
         return self.__ll_object.num_elements
 
+    def is_sparse(self):
+        """
+        Returns True if this is a sparse column, in which values are
+        stored only in the rows in which they are present.
+        """
+        return bool(self.__ll_object.sparse)
+
+    def get_family(self):
+        """
+        Returns the column family that this column is stored in. The
+        columns in each family are stored in a separate data file, so that
+        reading a column does not require the other families to be read.
+        """
+        return self.__ll_object.family
+
+    def get_dictionary(self):
+        """
+        Returns the list of distinct values in this dictionary column, in
+        the order of their codes.
+        """
+        return self.__ll_object.get_dictionary()
+
     def format_value(self, v):
         """
         Formats the specified value from this column for printing.
@@ -163,8 +235,12 @@ class Column(object):
             s = "NA"
         else:
             n = self.get_num_elements()
-            if self.get_type() == WT_CHAR:
+            if self.get_type() in (WT_CHAR, WT_DICT):
                 s = v.decode()
+            elif self.get_type() == WT_GENOTYPE:
+                if n == 1:
+                    v = (v,)
+                s = ",".join("." if u is None else u.decode() for u in v)
             elif n == 1:
                 s = str(v)
             else:
@@ -190,7 +266,19 @@ class Column(object):
             "num_elements":num_elements,
             "element_type":self.get_type_name()
         }
-        return ElementTree.Element("column", d)
+        if self.is_sparse():
+            d["sparse"] = "1"
+        if self.get_family() != 0:
+            d["family"] = str(self.get_family())
+        element = ElementTree.Element("column", d)
+        if self.get_type() == WT_DICT:
+            # Values are stored as latin-1 so that any bytes can be
+            # recovered exactly.
+            for v in self.get_dictionary():
+                value = ElementTree.Element("value")
+                value.text = v.decode("latin-1")
+                element.append(value)
+        return element
 
     @classmethod
     def parse_xml(theclass, xmlcol):
@@ -215,8 +303,16 @@ class Column(object):
         else:
             num_elements = int(s)
         element_type = reverse[xmlcol.get("element_type")]
+        sparse = int(xmlcol.get("sparse", "0"))
+        family = int(xmlcol.get("family", "0"))
         col = _wormtable.Column(name, description, element_type, element_size,
-                num_elements)
+                num_elements, sparse, family)
+        if element_type == WT_DICT:
+            values = []
+            for value in xmlcol.findall("value"):
+                text = value.text if value.text is not None else ""
+                values.append(text.encode("latin-1"))
+            col.set_dictionary(values)
         return theclass(col)
 
 
@@ -396,22 +492,23 @@ class Database(object):
 
     def get_open_mode(self):
         """
-        Returns the mode that this database is opened in, WT_READ or
-        WT_WRITE. If the database is not open, return None.
+        Returns the mode that this database is opened in, WT_READ,
+        WT_WRITE or WT_APPEND. If the database is not open, return None.
         """
         return self.__open_mode
 
     def open(self, mode):
         """
         Opens this table in the specified mode. Mode must be one of
-        'r' or 'w'.
+        'r', 'w' or 'a'.
 
         :param: mode: The mode to open the table in.
         :type: mode: str
         """
-        modes = {'r': _wormtable.WT_READ, 'w': _wormtable.WT_WRITE}
+        modes = {'r': _wormtable.WT_READ, 'w': _wormtable.WT_WRITE,
+                'a': _wormtable.WT_APPEND}
         if mode not in modes:
-            raise ValueError("mode string must be one of 'r' or 'w'")
+            raise ValueError("mode string must be one of 'r', 'w' or 'a'")
         m = modes[mode]
         self.__open_mode = None
         self.__ll_object = None
@@ -433,9 +530,32 @@ class Database(object):
             self.__ll_object.close()
             if self.__open_mode == WT_WRITE:
                 self.finalise_build()
+            elif self.__open_mode == WT_APPEND:
+                self.write_metadata(self.get_metadata_path())
+        finally:
+            self.__open_mode = None
+            self.__ll_object = None
+
+    def abort(self):
+        """
+        Closes this database, which must be open for writing, without
+        finalising the build, and removes the files used to build it.
+        """
+        self.verify_open(WT_WRITE)
+        try:
+            self.__ll_object.close()
         finally:
             self.__open_mode = None
             self.__ll_object = None
+            self.remove_build_files()
+
+    def remove_build_files(self):
+        """
+        Removes the files used to build this database, if they exist.
+        """
+        path = self.get_db_build_path()
+        if os.path.exists(path):
+            os.unlink(path)
 
     def delete(self):
         """
@@ -461,7 +581,7 @@ class Database(object):
                 raise ValueError("Database must be opened")
         else:
             if self.__open_mode != mode or not self.is_open():
-                m = {WT_WRITE: "write", WT_READ: "read"}
+                m = {WT_WRITE: "write", WT_READ: "read", WT_APPEND: "append"}
                 s = "Database must be opened in {0} mode".format(m[mode])
                 raise ValueError(s)
 
@@ -472,6 +592,8 @@ class Table(Database):
     """
     DB_NAME = "table"
     DATA_SUFFIX = ".dat"
+    DICTIONARY_SUFFIX = ".dict"
+    PACKED_PREFIX = "packed_"
     PRIMARY_KEY_NAME = "row_id"
 
     def __init__(self, homedir):
@@ -482,28 +604,65 @@ class Table(Database):
         self.__total_row_size = 0
         self.__min_row_size = 0
         self.__max_row_size = 0
+        self.__append_start_row = 0
+        self.__stale_indexes = []
+        self.__row_format = ROW_FORMAT_SORTABLE
+        self.__row_storage = ROW_STORAGE_INDEXED
+        self.__row_compression = ROW_COMPRESSION_NONE
+        self.__compression_sample_rows = DEFAULT_COMPRESSION_SAMPLE_ROWS
+        self.__address_size = DEFAULT_ADDRESS_SIZE
 
-    def get_data_path(self):
+    def get_num_families(self):
         """
-        Returns the path of the permanent data file.
+        Returns the number of column families in this table. The rows of
+        each family are stored in a separate data file.
         """
-        return os.path.join(self.get_homedir(), self.get_db_name() +
-                self.DATA_SUFFIX)
+        return max([c.get_family() for c in self.__columns] + [0]) + 1
 
-    def get_data_build_path(self):
+    def get_data_path(self, family=0):
         """
-        Returns the path of the file used to build the database.
+        Returns the path of the permanent data file for the specified column
+        family.
         """
-        s = "_build_{0}_{1}{2}".format(os.getpid(), self.get_db_name(),
-                self.DATA_SUFFIX)
+        name = self.get_db_name()
+        if family != 0:
+            name += "_{0}".format(family)
+        return os.path.join(self.get_homedir(), name + self.DATA_SUFFIX)
+
+    def get_data_build_path(self, family=0):
+        """
+        Returns the path of the file used to build the data file for the
+        specified column family.
+        """
+        s = "_build_{0}_{1}".format(os.getpid(),
+                os.path.basename(self.get_data_path(family)))
+        return os.path.join(self.get_homedir(), s)
+
+    def get_dictionary_path(self):
+        """
+        Returns the path of the file holding the compression dictionaries
+        for the rows of this table.
+        """
+        name = self.get_db_name() + self.DICTIONARY_SUFFIX
+        return os.path.join(self.get_homedir(), name)
+
+    def get_dictionary_build_path(self):
+        """
+        Returns the path of the file used to build the dictionary file.
+        """
+        s = "_build_{0}_{1}".format(os.getpid(),
+                os.path.basename(self.get_dictionary_path()))
         return os.path.join(self.get_homedir(), s)
 
     def get_data_file_size(self):
         """
-        Returns the size of the data file in bytes.
+        Returns the total size of the data files in bytes.
         """
-        statinfo = os.stat(self.get_data_path())
-        return statinfo.st_size
+        size = 0
+        for family in range(self.get_num_families()):
+            statinfo = os.stat(self.get_data_path(family))
+            size += statinfo.st_size
+        return size
 
     def finalise_build(self):
         """
@@ -511,16 +670,35 @@ class Table(Database):
         permanent values.
         """
         super(Table, self).finalise_build()
-        new = self.get_data_path()
-        old = self.get_data_build_path()
-        shutil.move(old, new)
+        for family in range(self.get_num_families()):
+            new = self.get_data_path(family)
+            old = self.get_data_build_path(family)
+            shutil.move(old, new)
+        if self.__row_compression != ROW_COMPRESSION_NONE:
+            shutil.move(self.get_dictionary_build_path(),
+                    self.get_dictionary_path())
+
+    def remove_build_files(self):
+        """
+        Removes the files used to build this table, if they exist.
+        """
+        super(Table, self).remove_build_files()
+        paths = [self.get_data_build_path(family)
+                for family in range(self.get_num_families())]
+        paths.append(self.get_dictionary_build_path())
+        for path in paths:
+            if os.path.exists(path):
+                os.unlink(path)
 
     def delete(self):
         """
         Deletes this table.
         """
         super(Table, self).delete()
-        os.unlink(self.get_data_path())
+        for family in range(self.get_num_families()):
+            os.unlink(self.get_data_path(family))
+        if self.__row_compression != ROW_COMPRESSION_NONE:
+            os.unlink(self.get_dictionary_path())
 
     def get_total_row_size(self):
         """
@@ -545,17 +723,147 @@ class Table(Database):
         Returns a new instance of _wormtable.Table using either the build
         or permanent locations for the db and data files.
         """
+        data_path = self.get_data_path
+        dictionary_file = self.get_dictionary_path().encode()
         if build:
             db_file = self.get_db_build_path().encode()
-            data_file = self.get_data_build_path().encode()
+            data_path = self.get_data_build_path
+            dictionary_file = self.get_dictionary_build_path().encode()
         else:
             db_file = self.get_db_path().encode()
-            data_file = self.get_data_path().encode()
+        data_files = [data_path(family).encode()
+                for family in range(self.get_num_families())]
         ll_cols = [c.get_ll_object() for c in self.__columns]
-        t = _wormtable.Table(db_file, data_file, ll_cols,
-                self.get_db_cache_size())
+        native_rows = int(self.__row_format == ROW_FORMAT_NATIVE)
+        dense_rows = int(self.__row_storage == ROW_STORAGE_DENSE)
+        compressed_rows = int(self.__row_compression != ROW_COMPRESSION_NONE)
+        t = _wormtable.Table(db_file, data_files[0], ll_cols,
+                self.get_db_cache_size(), native_rows, self.__address_size,
+                data_files[1:], dense_rows, compressed_rows, dictionary_file,
+                self.__compression_sample_rows)
         return t
 
+    def get_address_size(self):
+        """
+        Returns the number of bytes used for addresses within the rows of
+        this table.
+        """
+        return self.__address_size
+
+    def set_address_size(self, address_size):
+        """
+        Sets the number of bytes used for addresses within the rows of this
+        table, which determines the maximum size of a row. With the default
+        2 byte addresses rows can be up to 64KiB; with 3 byte addresses
+        they can be up to 16MiB, and with 4 byte addresses up to 1GiB. The
+        row buffer grows as larger rows are stored or read, and variable
+        length columns use an extra byte for each additional address byte.
+        The address size must be set before the table is opened for
+        writing.
+
+        :param address_size: the number of bytes in each address
+        :type address_size: int
+        """
+        if self.is_open():
+            raise ValueError("Cannot change the address size of an open table")
+        if address_size not in ADDRESS_SIZES:
+            raise ValueError("Address size must be 2, 3 or 4")
+        self.__address_size = address_size
+
+    def get_row_format(self):
+        """
+        Returns the format used to store values in the rows of this table,
+        which is either "sortable" or "native".
+        """
+        return self.__row_format
+
+    def set_row_format(self, row_format):
+        """
+        Sets the format used to store values in the rows of this table.
+        In the default "sortable" format, values are stored in the same
+        order preserving big-endian format that is used for index keys.
+        In the "native" format, integers and floating point values are
+        stored in little-endian two's complement and IEEE formats, which
+        can be read directly on most machines. Index keys are stored in
+        the sortable format in both cases. The row format must be set
+        before the table is opened for writing.
+
+        :param row_format: the row format
+        :type row_format: str
+        """
+        if self.is_open():
+            raise ValueError("Cannot change the row format of an open table")
+        if row_format not in [ROW_FORMAT_SORTABLE, ROW_FORMAT_NATIVE]:
+            raise ValueError("Unknown row format: " + str(row_format))
+        self.__row_format = row_format
+
+    def get_row_storage(self):
+        """
+        Returns the way that the rows of this table are located in the
+        data files, which is either "indexed" or "dense".
+        """
+        return self.__row_storage
+
+    def set_row_storage(self, row_storage):
+        """
+        Sets the way that the rows of this table are located in the data
+        files. In the default "indexed" storage, the offset and length of
+        each row are stored in the primary DB. In "dense" storage, every
+        row has the same size and row i is stored at i times this size in
+        the data file, so that no primary DB entries are needed and rows
+        are read directly from their positions. Dense storage can only be
+        used when none of the columns have a variable number of elements
+        or are sparse. The row storage must be set before the table is
+        opened for writing.
+
+        :param row_storage: the row storage
+        :type row_storage: str
+        """
+        if self.is_open():
+            raise ValueError("Cannot change the row storage of an open table")
+        if row_storage not in [ROW_STORAGE_INDEXED, ROW_STORAGE_DENSE]:
+            raise ValueError("Unknown row storage: " + str(row_storage))
+        self.__row_storage = row_storage
+
+    def get_row_compression(self):
+        """
+        Returns the compression used for the rows of this table, which is
+        either "none" or "dictionary".
+        """
+        return self.__row_compression
+
+    def set_row_compression(self, row_compression,
+            sample_rows=DEFAULT_COMPRESSION_SAMPLE_ROWS):
+        """
+        Sets the compression used for the rows of this table. By default
+        ("none"), rows are stored as they are. With "dictionary"
+        compression, a dictionary of the byte strings that occur most
+        often in the rows of each column family is built from the first
+        sample_rows rows written to the table, and each later row is
+        compressed individually using this dictionary, so that single
+        rows can still be read directly. The dictionaries are stored
+        alongside the data files. The sampled rows themselves are stored
+        uncompressed, and the row compression must be set before the table
+        is opened for writing.
+
+        :param row_compression: the row compression
+        :type row_compression: str
+        :param sample_rows: the number of rows used to build the
+            dictionaries
+        :type sample_rows: int
+        """
+        if self.is_open():
+            raise ValueError(
+                    "Cannot change the row compression of an open table")
+        if row_compression not in [ROW_COMPRESSION_NONE,
+                ROW_COMPRESSION_DICTIONARY]:
+            raise ValueError("Unknown row compression: "
+                    + str(row_compression))
+        if sample_rows < 1:
+            raise ValueError("At least one row must be sampled")
+        self.__row_compression = row_compression
+        self.__compression_sample_rows = sample_rows
+
     def get_fixed_region_size(self):
         """
         Returns the size of the fixed region in rows. This is the minimum
@@ -574,23 +882,28 @@ class Table(Database):
         desc = 'Primary key column'
         self.add_uint_column(name, desc, size, 1)
 
-    def add_uint_column(self, name, description="", size=2, num_elements=1):
+    def add_uint_column(self, name, description="", size=2, num_elements=1,
+            sparse=False, family=0):
         """
         Creates a new unsigned integer column with the specified name,
         element size (in bytes) and number of elements. If num_elements=0
         then the column can hold a variable number of elements.
         """
-        self.add_column(name, description, WT_UINT, size, num_elements)
+        self.add_column(name, description, WT_UINT, size, num_elements,
+                sparse, family)
 
-    def add_int_column(self, name, description="", size=2, num_elements=1):
+    def add_int_column(self, name, description="", size=2, num_elements=1,
+            sparse=False, family=0):
         """
         Creates a new integer column with the specified name,
         element size (in bytes) and number of elements. If num_elements=0
         then the column can hold a variable number of elements.
         """
-        self.add_column(name, description, WT_INT, size, num_elements)
+        self.add_column(name, description, WT_INT, size, num_elements,
+                sparse, family)
 
-    def add_float_column(self, name, description="", size=4, num_elements=1):
+    def add_float_column(self, name, description="", size=4, num_elements=1,
+            sparse=False, family=0):
         """
         Creates a new float column with the specified name,
         element size (in bytes) and number of elements. If num_elements=0
@@ -598,21 +911,63 @@ class Table(Database):
         8 byte floats are supported by wormtable; these correspond to the
         usual float and double types.
         """
-        self.add_column(name, description, WT_FLOAT, size, num_elements)
+        self.add_column(name, description, WT_FLOAT, size, num_elements,
+                sparse, family)
 
-    def add_char_column(self, name, description="", num_elements=0):
+    def add_char_column(self, name, description="", num_elements=0,
+            sparse=False, family=0):
         """
         Creates a new character column with the specified name, description
         and number of elements. If num_elements=0 then the column can hold
         variable length strings; otherwise, it can contain strings of a fixed
         length only.
         """
-        self.add_column(name, description, WT_CHAR, 1, num_elements)
+        self.add_column(name, description, WT_CHAR, 1, num_elements, sparse,
+                family)
 
-    def add_column(self, name, description, element_type, size, num_elements):
+    def add_dict_column(self, name, description="", size=1, sparse=False,
+            family=0):
+        """
+        Creates a new dictionary encoded character column with the
+        specified name and description. Values are strings, as for
+        variable length char columns, but each distinct value is stored
+        once in the table's metadata and rows store a code of the specified
+        size (1 or 2 bytes) for their value. A column with size 1 can
+        hold 255 distinct values, and a column of size 2 can hold 65535.
+        This is much smaller than a char column when there are few distinct
+        values. Indexes on dictionary columns are sorted by code, which is
+        the order in which the values were first added to the table.
+        """
+        self.add_column(name, description, WT_DICT, size, 1, sparse, family)
+
+    def add_genotype_column(self, name, description="", size=2,
+            num_elements=1, sparse=False, family=0):
+        """
+        Creates a new genotype column with the specified name and
+        description, holding a diploid call for each of num_elements
+        samples. Values are tuples of calls in VCF notation, such as
+        b"0/1" or b"1|1", with None for missing calls. The calls are
+        packed into a vector in which each allele is stored in the
+        specified number of bits (2, 4 or 8), with one more bit for each
+        sample recording whether the call is phased. With 2 bits per allele
+        allele indexes 0 to 2 can be stored, with 4 bits 0 to 14, and with
+        8 bits 0 to 254. Genotype columns cannot be indexed.
+        """
+        self.add_column(name, description, WT_GENOTYPE, size, num_elements,
+                sparse, family)
+
+    def add_column(self, name, description, element_type, size, num_elements,
+            sparse=False, family=0):
         """
         Creates a new column with the specified name, description, element type,
-        element size and number of elements.
+        element size and number of elements. If sparse is True, the column
+        does not occupy any space in rows in which it is missing: its
+        presence is recorded in a bitmap shared by all sparse columns, and
+        values are stored in the variable region of the rows in which they
+        are present. Sparse columns suit columns that are missing in most
+        rows, such as most INFO fields in a VCF, but take a few more bytes
+        than ordinary columns when present. The column is stored in the
+        specified column family; see :ref:`column-families`.
         """
         if self.is_open():
             raise ValueError("Cannot add columns to open table")
@@ -622,8 +977,10 @@ class Table(Database):
         db = description
         if isinstance(description, str):
             db = description.encode()
-        col = _wormtable.Column(nb, db, element_type, size, num_elements)
-        self.__columns.append(Column(col))
+        col = Column(_wormtable.Column(nb, db, element_type, size,
+                num_elements, int(sparse), family))
+        self.__column_name_map[col.get_name()] = len(self.__columns)
+        self.__columns.append(col)
 
     # Methods for accessing the columns
     def columns(self):
@@ -665,6 +1022,17 @@ class Table(Database):
                 cols.append(self.get_column(col_id))
         return cols
 
+    def match_columns(self, pattern):
+        """
+        Returns the list of columns whose names match the specified
+        shell-style pattern, such as ``"*.GT"``, in table order.
+
+        :param pattern: the pattern to match column names against
+        :type pattern: str
+        """
+        return [c for c in self.__columns
+                if fnmatch.fnmatchcase(c.get_name(), pattern)]
+
     def read_schema(self, filename):
         """
         Reads the schema from the specified file and sets up the columns
@@ -680,11 +1048,8 @@ class Table(Database):
         supported_versions = [TABLE_METADATA_VERSION]
         if version not in supported_versions:
             raise ValueError("Unsupported schema version.")
-        address_size = root.get("address_size")
-        if address_size is None:
+        if root.get("address_size") is None:
             raise ValueError("invalid xml: schema address_size missing")
-        if address_size != "2":
-            raise ValueError("Unsupported address size.")
         self._parse_schema_xml(root)
 
     def write_schema(self, filename):
@@ -707,7 +1072,13 @@ class Table(Database):
         Generates the XML representing the schema for this table.
         """
         schema = ElementTree.Element("schema")
-        schema.set("address_size", "2")
+        schema.set("address_size", str(self.__address_size))
+        if self.__row_format != ROW_FORMAT_SORTABLE:
+            schema.set("row_format", self.__row_format)
+        if self.__row_storage != ROW_STORAGE_INDEXED:
+            schema.set("row_storage", self.__row_storage)
+        if self.__row_compression != ROW_COMPRESSION_NONE:
+            schema.set("row_compression", self.__row_compression)
         columns = ElementTree.Element("columns")
         schema.append(columns)
         for c in self.__columns:
@@ -740,12 +1111,25 @@ class Table(Database):
         root = ElementTree.Element("table", d)
         root.append(self._generate_schema_xml())
         root.append(self._generate_stats_xml())
+        if len(self.__stale_indexes) > 0:
+            stale = ElementTree.Element("stale_indexes")
+            for name in self.__stale_indexes:
+                stale.append(ElementTree.Element("index", {"name":name}))
+            root.append(stale)
         return ElementTree.ElementTree(root)
 
     def _parse_schema_xml(self, schema):
         """
         Parses the schema xml and updates the state of this table.
         """
+        address_size = schema.get("address_size", str(DEFAULT_ADDRESS_SIZE))
+        if address_size not in [str(k) for k in ADDRESS_SIZES]:
+            raise ValueError("Unsupported address size.")
+        self.set_address_size(int(address_size))
+        self.set_row_format(schema.get("row_format", ROW_FORMAT_SORTABLE))
+        self.set_row_storage(schema.get("row_storage", ROW_STORAGE_INDEXED))
+        self.set_row_compression(schema.get("row_compression",
+                ROW_COMPRESSION_NONE))
         xml_columns = schema.find("columns")
         for xmlcol in xml_columns.getchildren():
             col = Column.parse_xml(xmlcol)
@@ -796,6 +1180,10 @@ class Table(Database):
         self._parse_schema_xml(schema)
         stats = root.find("stats")
         self._parse_stats_xml(stats)
+        stale = root.find("stale_indexes")
+        self.__stale_indexes = []
+        if stale is not None:
+            self.__stale_indexes = [e.get("name") for e in stale]
 
 
     def append(self, row):
@@ -824,6 +1212,107 @@ class Table(Database):
         t.commit_row()
         self.__num_rows += 1
 
+    def append_many(self, rows):
+        """
+        Appends each of the specified rows to this table. This is
+        equivalent to calling append for each row, but the values for
+        all rows are encoded and committed in a single call to the
+        underlying C module, which is much faster for tables with many
+        columns.
+        """
+        t = self.get_ll_object()
+        n = t.num_rows
+        try:
+            t.append_many(rows)
+        finally:
+            self.__num_rows += t.num_rows - n
+
+    def append_encoded_many(self, rows):
+        """
+        Appends each of the specified rows of encoded values to this
+        table. This is equivalent to calling append_encoded for each row.
+        """
+        t = self.get_ll_object()
+        n = t.num_rows
+        try:
+            t.append_encoded_many(rows)
+        finally:
+            self.__num_rows += t.num_rows - n
+
+    def append_columns(self, values, missing=None, offsets=None):
+        """
+        Appends rows to this table from column-wise arrays. The values
+        argument is a dictionary mapping column identifiers to objects
+        supporting the buffer protocol (such as NumPy arrays) holding the
+        values for that column in its native type: uint64 for uint
+        columns, int64 for int columns, float64 for float columns and
+        single bytes for char columns. For fixed length columns the buffer
+        holds num_elements values for each row. For variable length columns
+        the offsets dictionary must map the column to an int64 array of
+        N + 1 element offsets, so that the values for row j are
+        values[offsets[j]:offsets[j + 1]]. The optional missing dictionary
+        maps columns to boolean masks of length N, where a true value
+        indicates that the column is missing in that row. Columns not
+        included in values are missing in all rows. All columns must
+        describe the same number of rows N. Every row is checked before
+        any are appended, so that if a value is out of range or a row is
+        too large no rows are appended.
+        """
+        if missing is None:
+            missing = {}
+        if offsets is None:
+            offsets = {}
+        specs = []
+        for col_id, v in values.items():
+            col = self.get_column(col_id)
+            specs.append((col.get_position(), v, missing.get(col_id),
+                    offsets.get(col_id)))
+        t = self.get_ll_object()
+        n = t.num_rows
+        try:
+            t.append_buffers(specs)
+        finally:
+            self.__num_rows += t.num_rows - n
+
+    def rewrite(self, dest, progress_callback=None, callback_rows=100):
+        """
+        Copies the rows of this table, which must be open for reading,
+        into the specified new table. The columns of dest must already
+        have been defined (for example, using :meth:`.read_schema`), and
+        it must not be open. The value of each column in dest is taken
+        from the column in this table with the same name, and columns not
+        in this table are missing in all rows. Values are converted to the
+        type and size of the new column, and an OverflowError or
+        ValueError is raised if a value cannot be stored, in which case
+        no table is left in the home directory of dest. Columns with the
+        same type, size and number of elements in both tables are copied
+        without decoding their values. Rows are renumbered from 0 in the
+        new table, and indexes are not copied.
+
+        If progress_callback is not None, invoke this callback after
+        every callback_rows have been copied.
+
+        :param dest: the table to write the rows to
+        :type dest: :class:`Table`
+        """
+        self.verify_open(WT_READ)
+        dest.verify_closed()
+        columns = [-1]
+        for col in dest.columns()[1:]:
+            columns.append(self.__column_name_map.get(col.get_name(), -1))
+        dest.open("w")
+        try:
+            llo = dest.get_ll_object()
+            if progress_callback is not None:
+                llo.copy_rows(self.get_ll_object(), columns,
+                        progress_callback, callback_rows)
+            else:
+                llo.copy_rows(self.get_ll_object(), columns)
+        except:
+            dest.abort()
+            raise
+        dest.close()
+
 
     def __len__(self):
         """
@@ -845,7 +1334,13 @@ class Table(Database):
         ret = None
         n = len(self)
         if isinstance(key, slice):
-            ret = [self[j] for j in range(*key.indices(n))]
+            start, stop, step = key.indices(n)
+            if step == 1:
+                ret = list(self.cursor(self.columns(), start, max(start, stop)))
+            else:
+                ret = self.get_rows(range(start, stop, step))
+        elif isinstance(key, list):
+            ret = self.get_rows(key)
         elif isinstance(key, int):
             k = key
             if k < 0:
@@ -857,15 +1352,194 @@ class Table(Database):
             raise TypeError("table positions must be integers")
         return ret
 
+    def get_rows(self, row_ids, columns=None):
+        """
+        Returns a list of the rows with the specified ids, retrieving only
+        the specified columns (or all columns if *columns* is None). Rows are
+        returned in the same order as *row_ids*, and negative ids count from
+        the end of the table as for list indexes. This is much more efficient
+        than retrieving the rows one at a time, as each distinct row is read
+        once and rows are read in the order in which they are stored.
+
+        :param row_ids: the ids of the rows to retrieve
+        :type row_ids: sequence of int
+        :param columns: columns to retrieve from the table
+        :type columns: sequence of column identifiers
+        """
+        self.verify_open(WT_READ)
+        if columns is None:
+            columns = self.columns()
+        col_pos = [c.get_position() for c in self.translate_columns(columns)]
+        n = len(self)
+        ids = []
+        for k in row_ids:
+            if k < 0:
+                k = n + k
+            if k < 0 or k >= n:
+                raise IndexError("table position out of range")
+            ids.append(k)
+        return self.get_ll_object().get_rows(ids, col_pos)
+
+    def __get_genotype_position(self, row_id, column):
+        """
+        Returns the (row_id, position) pair for the specified row and
+        genotype column, with negative row ids counting from the end of
+        the table.
+        """
+        self.verify_open(WT_READ)
+        n = len(self)
+        if row_id < 0:
+            row_id = n + row_id
+        if row_id < 0 or row_id >= n:
+            raise IndexError("table position out of range")
+        return row_id, self.get_column(column).get_position()
+
+    def get_genotype(self, row_id, column, sample):
+        """
+        Returns the call for the specified sample in the specified
+        genotype column of the row with the specified id, in VCF notation
+        (such as b"0/1"), or None if the call is missing. Only this call
+        is decoded.
+
+        :param row_id: the id of the row
+        :type row_id: int
+        :param column: the genotype column
+        :type column: str or int
+        :param sample: the index of the sample within the column
+        :type sample: int
+        """
+        row_id, position = self.__get_genotype_position(row_id, column)
+        return self.get_ll_object().get_genotype(row_id, position, sample)
+
+    def count_alleles(self, row_id, column):
+        """
+        Returns a tuple giving the number of times that each allele is
+        called across all samples in the specified genotype column of the
+        row with the specified id, so that the count for allele index k is
+        at position k. The tuple has an entry for every allele index that
+        can be stored in the column, and missing alleles are not counted.
+
+        :param row_id: the id of the row
+        :type row_id: int
+        :param column: the genotype column
+        :type column: str or int
+        """
+        row_id, position = self.__get_genotype_position(row_id, column)
+        return self.get_ll_object().count_alleles(row_id, position)
+
+    def get_genotypes(self, row_id, column, alleles=None, phased=None):
+        """
+        Writes the calls in the specified genotype column of the row with
+        the specified id to arrays without creating Python objects for
+        each call, and returns the alleles array. The allele indexes for
+        sample j are written to alleles[2 * j] and alleles[2 * j + 1],
+        with -1 for missing alleles. If alleles is None, a new
+        array.array of type "h" is allocated; otherwise, it must be a
+        writable buffer of int16 values (such as a NumPy array) with two
+        values for each sample. If phased is not None it must be a
+        writable buffer of one byte for each sample, such as a NumPy bool
+        array, which is set to indicate whether each call is phased.
+
+        :param row_id: the id of the row
+        :type row_id: int
+        :param column: the genotype column
+        :type column: str or int
+        """
+        row_id, position = self.__get_genotype_position(row_id, column)
+        if alleles is None:
+            n = self.get_column(position).get_num_elements()
+            alleles = array.array("h", [0]) * (2 * n)
+        self.get_ll_object().get_genotypes(row_id, position, alleles, phased)
+        return alleles
+
     def __update_stats(self):
         """
         Updates the statistics about the underlying database.
         """
         t = self.get_ll_object()
-        self.__total_row_size = t.total_row_size
+        if self.get_open_mode() == WT_APPEND:
+            # The low-level table only knows about the rows appended in
+            # this session, so merge these with the existing statistics.
+            if t.num_rows > self.__append_start_row:
+                if self.__append_start_row == 0:
+                    self.__min_row_size = t.min_row_size
+                    self.__max_row_size = t.max_row_size
+                else:
+                    self.__min_row_size = min(self.__min_row_size,
+                            t.min_row_size)
+                    self.__max_row_size = max(self.__max_row_size,
+                            t.max_row_size)
+                self.__total_row_size += t.total_row_size
+        else:
+            self.__total_row_size = t.total_row_size
+            self.__min_row_size = t.min_row_size
+            self.__max_row_size = t.max_row_size
         self.__num_rows = t.num_rows
-        self.__min_row_size = t.min_row_size
-        self.__max_row_size = t.max_row_size
+
+    def __update_indexes(self, start_row, names):
+        """
+        Adds the rows from start_row onwards to each of the specified
+        indexes of this table, and marks each index as up to date in the
+        metadata once it has been updated.
+        """
+        self.open("r")
+        try:
+            for name in names:
+                index = Index(self, name)
+                index.open("a", allow_stale=True)
+                try:
+                    index.build(start_row=start_row)
+                finally:
+                    index.close()
+                self._clear_stale_index(name)
+        finally:
+            self.close()
+
+    def _clear_stale_index(self, name):
+        """
+        Marks the specified index as up to date with the rows of this
+        table, which must be open for reading, in the metadata.
+        """
+        if name in self.__stale_indexes:
+            self.__stale_indexes.remove(name)
+            self.write_metadata(self.get_metadata_path())
+
+    def get_stale_indexes(self):
+        """
+        Returns the names of the indexes of this table that do not hold
+        all of its rows, because updating them failed after rows were
+        appended. Stale indexes cannot be opened, and must be rebuilt.
+        """
+        return list(self.__stale_indexes)
+
+    def open(self, mode, write_queue_size=0):
+        """
+        Opens this table in the specified mode. Mode must be one of
+        'r', 'w' or 'a'. In append mode, the table must already exist and
+        new rows are added after the existing rows; when the table is
+        closed, the new rows are added to each of its indexes. The
+        indexes are marked as stale in the metadata until they have been
+        updated, so that an index is never read without the new rows.
+
+        If write_queue_size is greater than zero and the table is opened
+        for writing, committed rows are placed in a queue of approximately
+        this many bytes and written to disk by a background thread, so
+        that preparing the next rows overlaps with I/O. Errors in writing
+        rows are raised by a subsequent append or by :meth:`.close`.
+
+        :param: mode: The mode to open the table in.
+        :type: mode: str
+        :param write_queue_size: the size of the background write queue
+            in bytes, or 0 to write rows synchronously.
+        :type write_queue_size: int
+        """
+        Database.open(self, mode)
+        m = self.get_open_mode()
+        if m == WT_APPEND:
+            self.__append_start_row = self.get_ll_object().num_rows
+            self.__num_rows = self.__append_start_row
+        if m in (WT_WRITE, WT_APPEND) and write_queue_size > 0:
+            self.get_ll_object().start_writer(write_queue_size)
 
     def close(self):
         """
@@ -873,17 +1547,43 @@ class Table(Database):
         """
         self.verify_open()
         mode = self.get_open_mode()
-        if mode == WT_WRITE:
+        if mode in (WT_WRITE, WT_APPEND):
             self.__update_stats()
+        start_row = self.__append_start_row
+        appended = mode == WT_APPEND and self.__num_rows > start_row
+        names = []
+        if appended:
+            # indexes that are already stale cannot be updated
+            names = [name for name in self.__index_names()
+                    if name not in self.__stale_indexes]
+            self.__stale_indexes.extend(names)
         try:
             Database.close(self)
         finally:
             self.__num_rows = 0
+            self.__append_start_row = 0
+            self.__stale_indexes = []
+            self.__columns = []
+            self.__column_name_map = {}
+        if appended:
+            self.__update_indexes(start_row, names)
+
+    def abort(self):
+        """
+        Closes this table, which must be open for writing, discarding the
+        rows written and the files used to build it.
+        """
+        try:
+            Database.abort(self)
+        finally:
+            self.__num_rows = 0
+            self.__append_start_row = 0
+            self.__stale_indexes = []
             self.__columns = []
             self.__column_name_map = {}
 
 
-    def cursor(self, columns, start=0, stop=None):
+    def cursor(self, columns, start=0, stop=None, reductions=None):
         """
         Returns a cursor over the rows in this table, retrieving only
         the specified columns. Rows are returned as Tuple objects, with the
@@ -900,26 +1600,144 @@ class Table(Database):
         the *start* <= row_id < stop. Note that *start* is inclusive, and
         *stop* is exclusive.
 
+        The optional *reductions* are computed over a group of columns in
+        each row without creating Python values for the individual columns.
+        Each reduction is a (kind, columns) tuple, where columns is either
+        a sequence of column identifiers or a pattern such as ``"*.GT"``
+        (see :meth:`.match_columns`). The value of each reduction follows
+        the column values in the returned rows. The supported kinds are:
+
+        ``"missing"``
+            the fraction of columns in the group with missing values.
+        ``"mean"``, ``"min"``, ``"max"``
+            the mean, minimum and maximum of the non-missing elements in a
+            group of numeric columns, or None if there are none.
+        ``"genotype_counts"``
+            a tuple (hom_ref, het, hom_alt, missing) counting the classes of
+            the genotype calls in a group of char, dict or genotype columns.
+
         :param columns: columns to retrieve from the table
         :type columns: sequence of column identifiers
         :param start: the row id of the first row returned
         :type start: int
         :param stop: the row id of the last row returned, minus 1.
         :type stop: int
+        :param reductions: reductions to compute over each row
+        :type reductions: sequence of (str, columns) tuples
         """
         self.verify_open(WT_READ)
         col_pos = [c.get_position() for c in self.translate_columns(columns)]
-        tri = _wormtable.TableRowIterator(self.get_ll_object(), col_pos)
+        ll_reductions = []
+        if reductions is not None:
+            for kind, group in reductions:
+                if kind not in REDUCTION_KIND_MAP:
+                    raise ValueError("Unknown reduction '{0}'".format(kind))
+                if isinstance(group, str):
+                    cols = self.match_columns(group)
+                    if len(cols) == 0:
+                        raise KeyError(group)
+                else:
+                    cols = self.translate_columns(group)
+                ll_reductions.append((REDUCTION_KIND_MAP[kind],
+                        [c.get_position() for c in cols]))
+        tri = _wormtable.TableRowIterator(self.get_ll_object(), col_pos,
+                ll_reductions)
         tri.set_min(start)
         if stop is not None:
             tri.set_max(stop)
         return tri
 
+    def get_packed_column_path(self, column):
+        """
+        Returns the path of the packed column file for the specified column.
+        """
+        col = self.translate_columns([column])[0]
+        return os.path.join(self.get_homedir(), self.PACKED_PREFIX +
+                col.get_name() + self.DATA_SUFFIX)
+
+    def pack_column(self, column):
+        """
+        Writes the values of the specified integer column to a packed
+        column file in the table's home directory. Packed column files
+        store the differences between the values in consecutive rows
+        bit-packed in blocks, so that a column of sorted coordinates such
+        as POS takes only a few bits per row and can be read by
+        :meth:`.read_packed_column` without reading the rest of the
+        table. The column must be a uint or int column with a single
+        element. The file must be rebuilt if rows are appended to the
+        table.
+
+        :param column: the column to pack
+        :type column: column identifier
+        """
+        self.verify_open(WT_READ)
+        col = self.translate_columns([column])[0]
+        path = self.get_packed_column_path(col)
+        build_path = os.path.join(self.get_homedir(),
+                "_build_{0}_{1}".format(os.getpid(), os.path.basename(path)))
+        try:
+            self.get_ll_object().write_packed_column(col.get_position(),
+                    build_path.encode())
+            os.rename(build_path, path)
+        finally:
+            if os.path.exists(build_path):
+                os.unlink(build_path)
+
+    def packed_columns(self):
+        """
+        Returns an iterator over the names of the columns in this table
+        that have packed column files.
+        """
+        self.verify_open(WT_READ)
+        prefix = os.path.join(self.get_homedir(), self.PACKED_PREFIX)
+        for g in glob.glob(prefix + "*" + self.DATA_SUFFIX):
+            yield g[len(prefix):-len(self.DATA_SUFFIX)]
+
+    def read_packed_column(self, column, start=0, stop=None, values=None,
+            missing=None):
+        """
+        Reads the values of the specified column in the rows with ids from
+        *start* to *stop* - 1 from its packed column file, which must have
+        been created using :meth:`.pack_column`. The values are written to
+        *values*, which must be a writable buffer (such as an
+        ``array.array`` or NumPy array) of stop - start uint64 values for
+        uint columns and int64 values for int columns. If *values* is None
+        a new array of the appropriate type is allocated. If *missing* is
+        not None it must be a writable buffer of stop - start bytes, which
+        are set to 1 for rows in which the column is missing and 0
+        otherwise; the values for these rows are undefined. Returns the
+        values buffer.
+
+        :param column: the packed column to read
+        :type column: column identifier
+        :param start: the row id of the first row read
+        :type start: int
+        :param stop: the row id of the last row read, minus 1.
+        :type stop: int
+        """
+        self.verify_open(WT_READ)
+        col = self.translate_columns([column])[0]
+        if stop is None:
+            stop = len(self)
+        if values is None:
+            values = int64_array(col.get_type() == WT_UINT, stop - start)
+        self.get_ll_object().read_packed_column(col.get_position(),
+                self.get_packed_column_path(col).encode(), start, stop,
+                values, missing)
+        return values
+
     def indexes(self):
         """
         Returns an interator over the names of the indexes in this table.
         """
         self.verify_open(WT_READ)
+        return self.__index_names()
+
+    def __index_names(self):
+        """
+        Returns an iterator over the names of the index files in the home
+        directory of this table.
+        """
         prefix = os.path.join(self.get_homedir(), Index.DB_PREFIX)
         suffix = Index.DB_SUFFIX
         for g in glob.glob(prefix + "*" + suffix):
@@ -962,6 +1780,7 @@ class Index(Database):
         self.__table = table
         self.__key_columns = []
         self.__bin_widths = []
+        self.__interval = False
 
     def get_name(self):
         """
@@ -969,6 +1788,31 @@ class Index(Database):
         """
         return self.__name
 
+    def get_table(self):
+        """
+        Returns the table that this index is defined on.
+        """
+        return self.__table
+
+    def is_interval(self):
+        """
+        Returns True if this is an interval index.
+        """
+        return self.__interval
+
+    def set_interval(self, interval=True):
+        """
+        Sets whether this index is an interval index. In an interval
+        index, the last two key columns are the start and end coordinates
+        of a closed interval, and the preceding key columns (if any) form a
+        prefix, such as a chromosome name. Interval indexes support
+        efficient overlap queries using the :meth:`.overlapping` method.
+        The start and end columns must be integer columns with a single
+        element and no bin width, and coordinates must be between 0 and
+        2**32 - 1.
+        """
+        self.__interval = interval
+
     def get_colspec(self):
         """
         Returns the column specification for this index.
@@ -979,7 +1823,10 @@ class Index(Database):
             if w != 0.0:
                 s += "[{0}]".format(w)
             s += "+"
-        return s[:-1]
+        s = s[:-1]
+        if self.__interval:
+            s += " (interval)"
+        return s
 
     # Methods for accessing the key_columns
     def key_columns(self):
@@ -1013,6 +1860,8 @@ class Index(Database):
         i = _wormtable.Index(self.__table.get_ll_object(), filename,
                 cols, self.get_db_cache_size())
         i.set_bin_widths(self.__bin_widths)
+        if self.__interval:
+            i.set_interval()
         return i
 
     def get_metadata(self):
@@ -1021,6 +1870,8 @@ class Index(Database):
         Index.
         """
         d = {"version":INDEX_METADATA_VERSION}
+        if self.__interval:
+            d = {"version":INTERVAL_INDEX_METADATA_VERSION, "type":"interval"}
         root = ElementTree.Element("index", d)
         key_columns = ElementTree.Element("key_columns")
         root.append(key_columns)
@@ -1050,9 +1901,11 @@ class Index(Database):
         if version is None:
             # Should have a custom error for this.
             raise ValueError("invalid xml")
-        supported_versions = ["0.1-alpha", INDEX_METADATA_VERSION]
+        supported_versions = ["0.1-alpha", INDEX_METADATA_VERSION,
+                INTERVAL_INDEX_METADATA_VERSION]
         if version not in supported_versions:
             raise ValueError("Unsupported index metadata version - rebuild required.")
+        self.__interval = root.get("type") == "interval"
         xml_key_columns = root.find("key_columns")
         for xmlcol in xml_key_columns.getchildren():
             if xmlcol.tag != "key_column":
@@ -1063,37 +1916,58 @@ class Index(Database):
             self.__key_columns.append(col)
             self.__bin_widths.append(bin_width)
 
-    def build(self, progress_callback=None, callback_rows=100):
+    def build(self, progress_callback=None, callback_rows=100, start_row=0):
         """
         Builds this index. If progress_callback is not None, invoke this
-        calback after every callback_rows have been processed.
+        calback after every callback_rows have been processed. If start_row
+        is greater than zero, only rows with ids from start_row onwards are
+        added to the index; this is used to update an index opened in
+        append mode after rows have been appended to the table.
         """
         llo = self.get_ll_object()
         if progress_callback is not None:
-            llo.build(progress_callback, callback_rows)
+            llo.build(progress_callback, callback_rows, start_row)
         else:
-            llo.build()
+            llo.build(start_row=start_row)
 
-    def open(self, mode):
+    def open(self, mode, allow_stale=False):
         """
         Opens this index in the specified mode. Mode must be one of
-        'r' or 'w'.
+        'r', 'w' or 'a'. An index that is stale (see
+        :meth:`Table.get_stale_indexes`) can only be opened in 'w' mode to
+        rebuild it, unless allow_stale is True.
 
         :param: mode: The mode to open the index in.
         :type: mode: str
         """
         self.__table.verify_open(WT_READ)
+        stale = self.__name in self.__table.get_stale_indexes()
+        if stale and mode != "w" and not allow_stale:
+            raise ValueError("index '" + self.__name
+                    + "' is stale and must be rebuilt")
         Database.open(self, mode)
 
     def close(self):
         """
-        Closes this Index.
+        Closes this Index. An index that has been rebuilt is no longer
+        stale.
         """
+        mode = self.get_open_mode()
         try:
             Database.close(self)
         finally:
             self.__key_columns = []
             self.__bin_widths = []
+            self.__interval = False
+        if mode == WT_WRITE:
+            self.__table._clear_stale_index(self.__name)
+
+    def delete(self):
+        """
+        Deletes this index.
+        """
+        Database.delete(self)
+        self.__table._clear_stale_index(self.__name)
 
     def keys(self):
         """
@@ -1179,6 +2053,108 @@ class Index(Database):
             iri.set_max(key)
         return iri
 
+    def overlapping(self, columns, start, end, prefix=()):
+        """
+        Returns a cursor over the rows in the table whose intervals overlap
+        the closed interval [*start*, *end*], retrieving only the specified
+        columns. This index must be an interval index (see
+        :meth:`.set_interval`). Columns are specified in the same way as for
+        :meth:`.cursor`; include the ``row_id`` column to retrieve the ids of
+        the overlapping rows.
+
+        If the index has columns before the start and end columns, *prefix*
+        must provide a value for each of them. As for :meth:`.cursor`, a
+        single value is considered to be the same as a singleton tuple. Rows
+        are returned in no particular order. Rows in which the start or end
+        coordinate is missing, or the end is less than the start, do not
+        overlap any interval.
+
+        :param columns: columns to retrieve from the table
+        :type columns: sequence of column identifiers
+        :param start: the first coordinate in the query interval
+        :type start: int
+        :param end: the last coordinate in the query interval
+        :type end: int
+        :param prefix: the values of the prefix columns
+        """
+        self.verify_open(WT_READ)
+        if not self.__interval:
+            raise ValueError("Not an interval index")
+        col_pos = [c.get_position() for c in
+                self.__table.translate_columns(columns)]
+        iii = _wormtable.IndexIntervalIterator(self.get_ll_object(), col_pos)
+        if not isinstance(prefix, tuple):
+            prefix = (prefix,)
+        key = tuple(v.encode() if isinstance(v, str) else v for v in prefix)
+        iii.set_interval(key, start, end)
+        return iii
+
+    def lookup_many(self, keys, columns):
+        """
+        Returns a list containing the rows in the table with each of the
+        specified keys, retrieving only the specified columns. The result
+        for each key is a list of the rows in which the key occurs, in index
+        order; this list is empty if the key does not occur in the index.
+        Keys and columns are specified in the same way as for
+        :meth:`.cursor`, except that keys must include a value for every key
+        column. The keys are sorted and looked up in a single forward pass
+        over the index, which is much faster than looking up each key
+        individually.
+
+        :param keys: the keys to look up
+        :type keys: sequence of keys
+        :param columns: columns to retrieve from the table
+        :type columns: sequence of column identifiers
+        """
+        self.verify_open(WT_READ)
+        col_pos = [c.get_position() for c in
+                self.__table.translate_columns(columns)]
+        ll_keys = [self.key_to_ll(k) for k in keys]
+        return self.get_ll_object().lookup_many(ll_keys, col_pos)
+
+    def join(self, other, columns, other_columns, outer=False,
+            num_key_columns=None):
+        """
+        Returns an iterator over the rows obtained by joining the table of
+        this index with the table of the index *other* on their keys. The
+        rows of both indexes are read in a single sequential pass over each
+        index, in the order defined by this index. Each row returned is a
+        tuple consisting of the values of *columns* from this table followed
+        by the values of *other_columns* from the other table; columns are
+        specified in the same way as for :meth:`.cursor`.
+
+        Rows are joined when the values of the first *num_key_columns* key
+        columns of both indexes are equal; by default all of the key columns
+        of this index are used. These key columns must have the same types,
+        sizes, numbers of elements and bin widths in both indexes. Missing
+        values are considered equal to each other. If *outer* is True, a left
+        outer join is performed: rows in this table with no matching row in
+        the other table are returned with None for each of *other_columns*.
+
+        :param other: the index to join with
+        :type other: :class:`Index`
+        :param columns: columns to retrieve from this table
+        :type columns: sequence of column identifiers
+        :param other_columns: columns to retrieve from the other table
+        :type other_columns: sequence of column identifiers
+        :param outer: if True, perform a left outer join
+        :type outer: bool
+        :param num_key_columns: the number of key columns to join on
+        :type num_key_columns: int
+        """
+        self.verify_open(WT_READ)
+        other.verify_open(WT_READ)
+        if num_key_columns is None:
+            num_key_columns = len(self.__key_columns)
+        col_pos = [c.get_position() for c in
+                self.__table.translate_columns(columns)]
+        other_table = other.get_table()
+        other_col_pos = [c.get_position() for c in
+                other_table.translate_columns(other_columns)]
+        iji = _wormtable.IndexJoinIterator(self.get_ll_object(), col_pos,
+                other.get_ll_object(), other_col_pos, num_key_columns,
+                int(outer))
+        return iji
 
     def key_to_ll(self, v):
         """
@@ -1222,6 +2198,15 @@ class IndexCounter(collections.Mapping):
         k = self.__index.key_to_ll(key)
         return self.__index.get_ll_object().get_num_rows(k)
 
+    def count_many(self, keys):
+        """
+        Returns a list of the number of rows in the index with each of the
+        specified keys. The keys are sorted and counted in a single forward
+        pass over the index.
+        """
+        ll_keys = [self.__index.key_to_ll(k) for k in keys]
+        return self.__index.get_ll_object().count_many(ll_keys)
+
     def __iter__(self):
         dvi = _wormtable.IndexKeyIterator(self.__index.get_ll_object())
         for v in dvi:
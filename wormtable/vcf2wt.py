@@ -35,6 +35,8 @@ import sys
 import shutil
 import argparse
 import tempfile
+import collections
+import multiprocessing
 
 import wormtable as wt
 import wormtable.cli as cli
@@ -49,6 +51,8 @@ ALT_NAME = b"ALT"
 QUAL_NAME = b"QUAL"
 FILTER_NAME = b"FILTER"
 INFO_NAME = b"INFO"
+FORMAT_NAME = b"FORMAT"
+GT_NAME = b"GT"
 
 VCF_FIXED_COLUMNS = [CHROM_NAME, POS_NAME, ID_NAME, REF_NAME, ALT_NAME,
         QUAL_NAME, FILTER_NAME]
@@ -74,6 +78,14 @@ filters, a semicolon-separated list of codes for filters that fail. """
 # char used to seperate VCF columns from their prefix, e.g INFO.AF
 COLUMN_SEPARATOR = b"."
 
+# The number of distinct FORMAT strings we keep compiled plans for
+FORMAT_CACHE_SIZE = 64
+# The size of the queue of rows written to the table by a background thread
+WRITE_QUEUE_SIZE = 8 * 1024 * 1024
+
+# The number of lines encoded by a worker process in a parallel build
+PARALLEL_CHUNK_LINES = 4096
+
 # Special values in VCF
 MISSING_VALUE = b"."
 
@@ -126,11 +138,22 @@ class VCFReader(cli.FileReader):
         self.__genotypes = [
             sample.strip() for sample in s.split(b"\t")[9:]]
 
-    def add_column(self, table, prefix, line):
+    def add_column(self, table, prefix, line, sparse=False, family=0):
         """
         Adds a VCF column using the specified metadata line with the specified
         name prefix to the specified table.
         """
+        name, description, element_type, element_size, num_elements = (
+                self.parse_column(line))
+        table.add_column(prefix + COLUMN_SEPARATOR + name,  description,
+                element_type, element_size, num_elements, sparse, family)
+
+    def parse_column(self, line):
+        """
+        Returns the (name, description, element_type, element_size,
+        num_elements) tuple for the column described by the specified
+        INFO or FORMAT metadata line.
+        """
         d = {}
         s = line[line.find(b"<") + 1: line.find(b">")]
         for j in range(3):
@@ -173,14 +196,18 @@ class VCFReader(cli.FileReader):
             element_size = 1
         else:
             raise ValueError("Unknown VCF type:", st)
+        return name, description, element_type, element_size, num_elements
 
-        table.add_column(prefix + COLUMN_SEPARATOR + name,  description,
-                element_type, element_size, num_elements)
-
-    def generate_schema(self, table):
+    def generate_schema(self, table, genotype_matrix=False, sparse_info=False,
+            column_families=True):
         """
         Reads the header from the specified VCF file and returns a Table
-        with the correct columns.
+        with the correct columns. If genotype_matrix is True, the GT values
+        for all samples are stored in a single genotype column called
+        FORMAT.GT rather than a char column for each sample. If sparse_info
+        is True, the INFO columns are sparse columns. If column_families is
+        True, the fixed columns, the INFO columns and the sample columns
+        are stored in separate column families.
         """
         info_descriptions = []
         genotype_descriptions = []
@@ -204,11 +231,25 @@ class VCFReader(cli.FileReader):
         table.add_float_column(QUAL_NAME, QUAL_DESCRIPTION, 4)
         table.add_char_column(FILTER_NAME, FILTER_DESCRIPTION)
 
+        family = 0
+        if column_families and info_descriptions:
+            family += 1
         for s in info_descriptions:
-            self.add_column(table, INFO_NAME, s)
+            self.add_column(table, INFO_NAME, s, sparse_info, family)
+        if column_families and genotype_descriptions and self.__genotypes:
+            family += 1
+        sample_descriptions = []
+        for s in genotype_descriptions:
+            name, description = self.parse_column(s)[:2]
+            if genotype_matrix and name == GT_NAME and self.__genotypes:
+                table.add_genotype_column(
+                        FORMAT_NAME + COLUMN_SEPARATOR + name, description,
+                        2, len(self.__genotypes), family=family)
+            else:
+                sample_descriptions.append(s)
         for genotype in self.__genotypes:
-            for s in genotype_descriptions:
-                self.add_column(table, genotype, s)
+            for s in sample_descriptions:
+                self.add_column(table, genotype, s, family=family)
 
     def read_header(self):
         """
@@ -222,14 +263,18 @@ class VCFReader(cli.FileReader):
         self.parse_header_line(self.__header.pop())
 
 
-    def rows(self, table_columns):
+    def get_column_mappings(self, table_columns):
         """
-        Returns an iterator over the rows in this VCF file. Each row is a
-        dictionary mapping column positions to their encoded string values.
+        Returns the mappings from the various parts of a VCF row to the
+        corresponding column index in the wormtable. This is a tuple
+        (fixed_columns, info_columns, genotype_columns, matrix_columns),
+        where fixed_columns is a list of (VCF field index, column index)
+        pairs, info_columns maps INFO names to column indexes and
+        genotype_columns is a list giving the mapping from FORMAT names to
+        column indexes for each sample. FORMAT columns (such as FORMAT.GT)
+        hold a field for every sample, and their indexes are in the set
+        matrix_columns.
         """
-        # First we construct the mappings from the various parts of the
-        # VCF row to the corresponding column index in the wormtable
-        num_columns = len(table_columns)
         all_fixed_columns = VCF_FIXED_COLUMNS
         fixed_columns = []
         # weed out the columns that are not in the table
@@ -239,23 +284,80 @@ class VCFReader(cli.FileReader):
                 fixed_columns.append((j, table_columns[name]))
         info_columns = {}
         genotype_columns = [{} for g in self.__genotypes]
+        matrix_columns = set()
         for k, v in table_columns.items():
             if COLUMN_SEPARATOR in k and v != 0:
                 split = k.split(COLUMN_SEPARATOR)
                 if split[0] == INFO:
                     name = COLUMN_SEPARATOR.join(split[1:])
                     info_columns[name] = v
+                elif split[0] == FORMAT_NAME:
+                    name = COLUMN_SEPARATOR.join(split[1:])
+                    for mapping in genotype_columns:
+                        mapping[name] = v
+                    matrix_columns.add(v)
                 else:
                     g = COLUMN_SEPARATOR.join(split[:-1])
                     name = split[-1]
                     index = self.__genotypes.index(g)
                     genotype_columns[index][name] = v
-        ref_index = 3
-        alt_index = 4
-        # Now we are ready to process the file.
+        return fixed_columns, info_columns, genotype_columns, matrix_columns
+
+    def get_plan(self, table_columns):
+        """
+        Returns the mapping from VCF fields to the columns in the table in the
+        form used by the native VCF parser in VCFWriter.append_line.
+        """
+        fixed_columns, info_columns, genotype_columns, matrix_columns = (
+                self.get_column_mappings(table_columns))
+        fixed = [-1 for name in VCF_FIXED_COLUMNS]
+        for vcf_index, wt_index in fixed_columns:
+            fixed[vcf_index] = wt_index
+        formats = {}
+        n = len(genotype_columns)
+        for j, mapping in enumerate(genotype_columns):
+            for name, col in mapping.items():
+                if name not in formats:
+                    formats[name] = [-1 for k in range(n)]
+                formats[name][j] = col
+        return fixed, info_columns, formats
+
+    def lines(self):
+        """
+        Returns an iterator over the data lines in this VCF file, updating
+        the progress monitor as we go.
+        """
         update_rows = self.get_progress_update_rows()
         num_rows = 0
         for s in self.get_input_file():
+            yield s
+            num_rows += 1
+            if num_rows % update_rows == 0:
+                self.update_progress()
+        self.finish_progress()
+
+    def compile_format(self, fmt, genotype_columns):
+        """
+        Returns the plan for the specified FORMAT string, which gives the
+        list of columns for the values of each sample in order. Values
+        that are not stored in the table have a column of None.
+        """
+        names = fmt.split(b":")
+        return [[mapping.get(name) for name in names]
+                for mapping in genotype_columns]
+
+    def rows(self, table_columns):
+        """
+        Returns an iterator over the rows in this VCF file. Each row is a
+        dictionary mapping column positions to their encoded string values.
+        """
+        num_columns = len(table_columns)
+        fixed_columns, info_columns, genotype_columns, matrix_columns = (
+                self.get_column_mappings(table_columns))
+        ref_index = 3
+        alt_index = 4
+        format_plans = {}
+        for s in self.lines():
             row = [None for j in range(num_columns)]
             l = s.split()
             # Read in the fixed columns
@@ -281,27 +383,132 @@ class VCFReader(cli.FileReader):
                         row[col] = b"1"
             # Process the genotype columns, if they exist
             if len(l) > 8:
+                plan = format_plans.get(l[8])
+                if plan is None:
+                    plan = self.compile_format(l[8], genotype_columns)
+                    if len(format_plans) >= FORMAT_CACHE_SIZE:
+                        format_plans.clear()
+                    format_plans[l[8]] = plan
+                # The values for FORMAT columns are lists of the values
+                # for every sample, encoded as comma separated strings.
+                matrix_values = {}
+                for col in matrix_columns:
+                    matrix_values[col] = [MISSING_VALUE for g in plan]
                 j = 0
-                fmt = l[8].split(b":")
                 for genotype_values in l[9:]:
                     tokens = genotype_values.split(b":")
-                    if len(tokens) == len(fmt):
-                        for k in range(len(fmt)):
-                            if fmt[k] in genotype_columns[j]:
-                                col = genotype_columns[j][fmt[k]]
-                                tok = tokens[k]
-                                # FIXME this is a hack to detect missing values
-                                # in genotype columns. I'm not sure why anybody
-                                # would do this, but we need it to parse the
-                                # example VCF from the 1000genomes site.
-                                if tok != MISSING_VALUE and tok != b".,.":
+                    columns = plan[j]
+                    if len(tokens) == len(columns):
+                        for col, tok in zip(columns, tokens):
+                            # FIXME this is a hack to detect missing values
+                            # in genotype columns. I'm not sure why anybody
+                            # would do this, but we need it to parse the
+                            # example VCF from the 1000genomes site.
+                            if col is not None and tok != MISSING_VALUE \
+                                    and tok != b".,.":
+                                if col in matrix_values:
+                                    matrix_values[col][j] = tok
+                                else:
                                     row[col] = tok
                     j += 1
+                for col, values in matrix_values.items():
+                    row[col] = b",".join(values)
             yield row
-            num_rows += 1
-            if num_rows % update_rows == 0:
-                self.update_progress()
-        self.finish_progress()
+
+
+def profiling_column(column):
+    """
+    Returns the (element_type, element_size, num_elements) for the column
+    used to profile the values for the specified column. Profiling columns
+    are as wide as possible, so that the profile records the values that
+    would not fit in the specified column.
+    """
+    element_type = column.get_type()
+    element_size = column.get_element_size()
+    num_elements = column.get_num_elements()
+    if element_type in (wt.WT_INT, wt.WT_UINT):
+        element_size = 8
+    if element_type == wt.WT_DICT:
+        element_type = wt.WT_CHAR
+        element_size = 1
+        num_elements = wt.WT_VAR_2
+    if element_type == wt.WT_GENOTYPE:
+        element_size = 8
+    if num_elements in (wt.WT_VAR_1, wt.WT_VAR_2):
+        num_elements = wt.WT_VAR_2
+    return element_type, element_size, num_elements
+
+def optimised_column(column, position, profile, num_rows, complete,
+        dictionary=False):
+    """
+    Returns the (element_type, element_size, num_elements) for the smallest
+    column that can hold the values in the specified profile of the column
+    at the specified position, as returned by get_column_profile, or None
+    if the column can be dropped. Columns that are missing in every row
+    are dropped, as is the FILTER column if it has the same value in every
+    row. Integer columns with no negative values are stored as unsigned
+    integers, and genotype columns use the fewest bits per allele that can
+    hold the largest allele index. Variable length columns whose values
+    all have the same length are made fixed length. If dictionary is True,
+    char columns with few distinct values are made dictionary columns.
+    Columns are only dropped or made fixed length, and the row_id column
+    only shrunk, if the profile is complete, i.e. covers every row;
+    otherwise, columns missing from the profiled rows are kept unchanged.
+    """
+    element_type = column.get_type()
+    element_size = column.get_element_size()
+    num_elements = column.get_num_elements()
+    (present, min_elements, max_elements, min_value, max_value, constant,
+            num_distinct) = profile
+    if position == 0:
+        if complete:
+            element_size = 1
+            while max(num_rows - 1, 0) > 2**(8 * element_size) - 2:
+                element_size += 1
+        return element_type, element_size, num_elements
+    if present == 0:
+        if not complete:
+            return element_type, element_size, num_elements
+        return None
+    name = column.get_name().encode()
+    if name == FILTER_NAME and constant and present == num_rows \
+            and complete:
+        return None
+    if element_type == wt.WT_DICT:
+        element_size = 1 if num_distinct is not None else 2
+        return element_type, element_size, num_elements
+    if element_type == wt.WT_GENOTYPE:
+        # The profile holds the allele indexes for genotype columns.
+        element_size = 2
+        while max_value > 2**element_size - 2:
+            element_size *= 2
+        return element_type, element_size, num_elements
+    if min_value is not None:
+        element_size = 1
+        if min_value >= 0:
+            element_type = wt.WT_UINT
+        if element_type == wt.WT_UINT:
+            while max_value > 2**(8 * element_size) - 2:
+                element_size += 1
+        else:
+            while min_value < -2**(8 * element_size - 1) + 1 or \
+                    max_value > 2**(8 * element_size - 1) - 1:
+                element_size += 1
+    if num_elements in (wt.WT_VAR_1, wt.WT_VAR_2):
+        # Values in a numeric column with a single element are returned as
+        # scalars rather than tuples, so these must stay variable length.
+        fixed_min = 1 if element_type == wt.WT_CHAR else 2
+        if min_elements == max_elements and min_elements >= fixed_min \
+                and complete:
+            num_elements = min_elements
+        elif max_elements > 254:
+            num_elements = wt.WT_VAR_2
+        else:
+            num_elements = wt.WT_VAR_1
+    if dictionary and num_distinct is not None and num_elements != 1:
+        # A one byte code is smaller than any other char column.
+        element_type, element_size, num_elements = wt.WT_DICT, 1, 1
+    return element_type, element_size, num_elements
 
 
 class VCFWriter(object):
@@ -311,15 +518,66 @@ class VCFWriter(object):
     def __init__(self, table):
         self.__table = table
         self.__table.read_metadata()
-        self.__table.open("w")
+        self.__table.open("w", write_queue_size=WRITE_QUEUE_SIZE)
 
     def append(self, row):
         self.__table.append_encoded(row)
 
+    def set_plan(self, plan, truncate=False):
+        """
+        Sets the mapping from VCF fields to columns used by append_line.
+        The plan is a tuple (fixed, info, formats) as returned by
+        VCFReader.get_plan.
+        """
+        fixed, info, formats = plan
+        llo = self.__table.get_ll_object()
+        llo.set_vcf_plan(fixed, info, formats, int(truncate))
+
+    def append_line(self, line):
+        """
+        Parses the specified VCF data line and appends it to the table.
+        The line is parsed and encoded within the C module, and so this is
+        much faster than appending the rows returned by VCFReader.rows.
+        """
+        self.__table.get_ll_object().append_vcf_line(line)
+
+    def append_rows(self, rows):
+        """
+        Appends rows encoded by the native VCF parser in another process.
+        """
+        self.__table.get_ll_object().append_encoded_rows(rows)
+
     def close(self):
         self.__table.close()
 
 
+# The table used to encode rows in worker processes.
+_encoder = None
+
+def _init_encoder(homedir, schema, plan, truncate, row_format,
+        address_size):
+    """
+    Initialises a worker process for a parallel build, creating a low level
+    table with the columns in the specified schema to encode rows with.
+    Rows must be encoded with the row format and address size of the
+    destination table, which may differ from those in the schema.
+    """
+    global _encoder
+    table = wt.Table(homedir)
+    table.read_schema(schema)
+    table.set_row_format(row_format)
+    table.set_address_size(address_size)
+    _encoder = table._create_ll_object(False)
+    fixed, info, formats = plan
+    _encoder.set_vcf_plan(fixed, info, formats, int(truncate))
+
+def _encode_lines(lines):
+    """
+    Returns the encoded rows for the specified list of VCF lines.
+    """
+    return _encoder.encode_vcf_lines(lines)
+
+
 class ProgramRunner(object):
     """
     Class responsible for running the vcf2wt program.
@@ -333,6 +591,17 @@ class ProgramRunner(object):
         self.__quiet = args.quiet
         self.__schema = args.schema
         self.__truncate = args.truncate
+        self.__processes = args.processes
+        self.__source = args.SOURCE
+        self.__optimise_schema = args.optimise_schema
+        self.__profile_rows = args.profile_rows
+        self.__dictionary = args.dictionary
+        self.__genotype_matrix = args.genotype_matrix
+        self.__sparse_info = args.sparse_info
+        self.__column_families = not args.single_family
+        self.__native_rows = args.native_rows
+        self.__compress_rows = args.compress_rows
+        self.__address_size = args.address_size
         self.__tmp_dirs = []
         self.__tmp_files = []
         self.__table = None
@@ -357,10 +626,82 @@ class ProgramRunner(object):
         tmpdir = tempfile.mkdtemp(suffix=".wt", prefix="vcf2wt_")
         self.__tmp_dirs.append(tmpdir)
         table = wt.Table(tmpdir)
-        self.__reader.generate_schema(table)
+        self.__reader.generate_schema(table, self.__genotype_matrix,
+                self.__sparse_info, self.__column_families)
+        if self.__native_rows:
+            table.set_row_format(wt.ROW_FORMAT_NATIVE)
+        if self.__compress_rows:
+            table.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY)
+        if self.__address_size is not None:
+            table.set_address_size(self.__address_size)
         table.write_schema(schema_file)
         self.__schema = schema_file
 
+    def profile(self, table):
+        """
+        Reads the input VCF and returns the ll table holding the profile of
+        the values for each column in the specified table.
+        """
+        tmpdir = tempfile.mkdtemp(suffix=".wt", prefix="vcf2wt_")
+        self.__tmp_dirs.append(tmpdir)
+        profile_table = wt.Table(tmpdir)
+        column_map = {}
+        for j, c in enumerate(table.columns()):
+            column_map[c.get_name().encode()] = j
+            t, size, n = profiling_column(c)
+            profile_table.add_column(c.get_name(), c.get_description(), t,
+                    size, n)
+        llo = profile_table._create_ll_object(False)
+        reader = VCFReader(self.__source)
+        try:
+            reader.set_progress(self.__progress)
+            reader.set_truncate_REF_ALT(self.__truncate)
+            fixed, info, formats = reader.get_plan(column_map)
+            llo.set_vcf_plan(fixed, info, formats, int(self.__truncate))
+            chunk = []
+            for line in reader.lines():
+                chunk.append(line)
+                if len(chunk) == PARALLEL_CHUNK_LINES:
+                    llo.profile_vcf_lines(chunk)
+                    chunk = []
+                if llo.num_profiled_rows + len(chunk) == self.__profile_rows:
+                    break
+            llo.profile_vcf_lines(chunk)
+        finally:
+            reader.close()
+        return llo
+
+    def optimise_schema(self):
+        """
+        Profiles the values in the input VCF and replaces the schema with
+        the smallest schema that can hold them.
+        """
+        tmpdir = tempfile.mkdtemp(suffix=".wt", prefix="vcf2wt_")
+        self.__tmp_dirs.append(tmpdir)
+        table = wt.Table(tmpdir)
+        table.read_schema(self.__schema)
+        llo = self.profile(table)
+        num_rows = llo.num_profiled_rows
+        complete = self.__profile_rows is None
+        optimised = wt.Table(tmpdir)
+        optimised.set_row_format(table.get_row_format())
+        optimised.set_row_compression(table.get_row_compression())
+        optimised.set_address_size(table.get_address_size())
+        for j, c in enumerate(table.columns()):
+            profile = llo.get_column_profile(j)
+            col = optimised_column(c, j, profile, num_rows, complete,
+                    self.__dictionary)
+            if col is not None:
+                # Sparse columns only pay off if they are usually missing.
+                sparse = c.is_sparse() and 2 * profile[0] < num_rows
+                optimised.add_column(c.get_name(), c.get_description(), *col,
+                        sparse=sparse, family=c.get_family())
+        fd, schema_file = tempfile.mkstemp(suffix=".xml", prefix="vcf2wt_")
+        self.__tmp_files.append(schema_file)
+        os.close(fd)
+        optimised.write_schema(schema_file)
+        self.__schema = schema_file
+
     def create_table(self):
         """
         Creates the table and reads the column information for the VCF reader.
@@ -368,6 +709,12 @@ class ProgramRunner(object):
         os.mkdir(self.__destination)
         self.__table = wt.Table(self.__destination)
         self.__table.read_schema(self.__schema)
+        if self.__native_rows:
+            self.__table.set_row_format(wt.ROW_FORMAT_NATIVE)
+        if self.__compress_rows:
+            self.__table.set_row_compression(wt.ROW_COMPRESSION_DICTIONARY)
+        if self.__address_size is not None:
+            self.__table.set_address_size(self.__address_size)
         self.__table.set_db_cache_size(self.__db_cache_size)
         self.__table.open("w")
         self.__column_map = {}
@@ -383,19 +730,84 @@ class ProgramRunner(object):
         self.__reader.set_progress(self.__progress)
         self.__reader.set_truncate_REF_ALT(self.__truncate)
         self.__writer = VCFWriter(self.__table)
-        for r in self.__reader.rows(self.__column_map):
-            self.__writer.append(r)
+        plan = self.__reader.get_plan(self.__column_map)
+        # The codes for dictionary columns are assigned as rows are
+        # written, so these tables must be encoded in a single process.
+        dictionary = any(c.get_type() == wt.WT_DICT
+                for c in self.__table.columns())
+        if self.__processes > 1 and not dictionary:
+            self.write_rows_parallel(plan)
+        else:
+            self.__writer.set_plan(plan, self.__truncate)
+            for line in self.__reader.lines():
+                self.__writer.append_line(line)
         self.__reader.close()
         self.__reader = None
         self.__writer.close()
         self.__writer = None
 
+    def chunks(self):
+        """
+        Returns an iterator over lists of lines from the VCF to encode.
+        """
+        chunk = []
+        for line in self.__reader.lines():
+            chunk.append(line)
+            if len(chunk) == PARALLEL_CHUNK_LINES:
+                yield chunk
+                chunk = []
+        if len(chunk) > 0:
+            yield chunk
+
+    def write_rows_parallel(self, plan):
+        """
+        Encodes rows using a pool of worker processes and writes them to
+        the table in this process. Chunks of lines are dispatched to the
+        workers in order and we write the rows for each chunk as soon as
+        it is ready, so the table is identical to the one built serially.
+        Only a bounded number of chunks are in flight at any time.
+        """
+        pool = multiprocessing.Pool(self.__processes, _init_encoder,
+                (self.__destination, self.__schema, plan, self.__truncate,
+                self.__table.get_row_format(),
+                self.__table.get_address_size()))
+        try:
+            pending = collections.deque()
+            for chunk in self.chunks():
+                pending.append(pool.apply_async(_encode_lines, (chunk,)))
+                if len(pending) >= 2 * self.__processes:
+                    self.__writer.append_rows(pending.popleft().get())
+            while len(pending) > 0:
+                self.__writer.append_rows(pending.popleft().get())
+            pool.close()
+        except:
+            pool.terminate()
+            raise
+        finally:
+            pool.join()
+
     def run(self):
         """
         Top level entry point.
         """
+        if self.__processes < 1:
+            self.error("number of processes must be at least 1")
+        if self.__genotype_matrix and self.__schema is not None:
+            self.error("--genotype-matrix cannot be used with --schema")
+        if self.__sparse_info and self.__schema is not None:
+            self.error("--sparse-info cannot be used with --schema")
+        if not self.__column_families and self.__schema is not None:
+            self.error("--single-family cannot be used with --schema")
         if self.__schema is None:
             self.generate_schema()
+        if self.__dictionary and not self.__optimise_schema:
+            self.error("--dictionary requires --optimise-schema")
+        if self.__optimise_schema:
+            if self.__source == '-':
+                self.error("cannot optimise schema when reading from STDIN")
+            if self.__profile_rows is not None and self.__profile_rows < 1:
+                self.error("number of profile rows must be at least 1")
+            self.optimise_schema()
 
         if os.path.exists(self.__destination):
             if self.__force:
@@ -458,6 +870,64 @@ def vcf2wt_main(args=None):
             occured""")
     parser.add_argument("--cache-size", "-c", default="64M",
         help="cache size in bytes; suffixes K, M and G also supported.")
+    parser.add_argument("--processes", "-p", type=int, default=1,
+        help="""Number of worker processes used to parse the VCF. Rows are
+            still written to the table in the same order by a single
+            process.""")
+    parser.add_argument("--optimise-schema", "-O", action="store_true",
+        default=False,
+        help="""Read the VCF before building the table and use the
+            smallest schema that can hold its values: integer columns
+            are made as small as possible, variable length columns
+            whose values all have the same length are made fixed length,
+            and columns with no values are dropped, along with the FILTER
+            column if it has the same value in every row. May be
+            combined with --schema and --generate-schema.""")
+    parser.add_argument("--profile-rows", type=int, default=None,
+        help="""Read only the first PROFILE_ROWS rows of the VCF when
+            optimising the schema. The table cannot be built if
+            later rows do not fit in the resulting schema.""")
+    parser.add_argument("--dictionary", "-D", action="store_true",
+        default=False,
+        help="""When optimising the schema, store char columns with at
+            most 255 distinct values as dictionary columns, in which each
+            row holds a one byte code for its value. Tables with
+            dictionary columns are always parsed in a single process.""")
+    parser.add_argument("--genotype-matrix", "-G", action="store_true",
+        default=False,
+        help="""Store the GT values for all samples in a single packed
+            genotype column called FORMAT.GT, rather than in a char
+            column for each sample. Each allele uses two bits, so only
+            allele indexes 0 to 2 can be stored unless the schema is
+            optimised with --optimise-schema.""")
+    parser.add_argument("--sparse-info", "-S", action="store_true",
+        default=False,
+        help="""Store the INFO fields in sparse columns, which take no
+            space in rows where they are missing. With --optimise-schema,
+            only INFO fields that are missing in most rows are made
+            sparse.""")
+    parser.add_argument("--single-family", action="store_true",
+        default=False,
+        help="""Store all columns in a single data file. By default the
+            fixed VCF columns, the INFO columns and the per-sample columns
+            are stored in separate column families, so that reading
+            one group of columns does not read the others.""")
+    parser.add_argument("--native-rows", "-N", action="store_true",
+        default=False,
+        help="""Store integer and floating point values in rows in
+            little-endian native format rather than the sortable format
+            used for index keys, so that they can be read without
+            conversion.""")
+    parser.add_argument("--compress-rows", "-Z", action="store_true",
+        default=False,
+        help="""Compress each row individually using a dictionary for each
+            column family built from the first rows of the VCF.""")
+    parser.add_argument("--address-size", "-A", type=int, default=None,
+        choices=[2, 3, 4],
+        help="""The number of bytes used for addresses within rows. Rows
+            can be up to 64KiB with 2 byte addresses, 16MiB with 3 byte
+            addresses and 1GiB with 4 byte addresses. Defaults to the
+            address size in the schema, or 2.""")
     g = parser.add_mutually_exclusive_group()
     g.add_argument("--generate-schema", "-g", action="store_true",
         default=False,
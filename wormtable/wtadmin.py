@@ -26,6 +26,7 @@ from __future__ import division
 import re
 import os
 import sys
+import shutil
 import argparse
 import signal
 
@@ -151,6 +152,14 @@ class ListRunner(ProgramRunner):
             print(s)
             print("=" * (len(s) + 2))
             for n in names:
+                if n in t.get_stale_indexes():
+                    # stale indexes cannot be opened to read their columns
+                    i = wt.Index(t, n)
+                    s = fmt.format(n, self.format_size(i.get_db_file_size()),
+                            "", "stale; rebuild required",
+                            name_width=max_name_width)
+                    print(s)
+                    continue
                 i = t.open_index(n)
                 s = fmt.format(i.get_name(), self.format_size(i.get_db_file_size()),
                         len(i.key_columns()), i.get_colspec(), name_width=max_name_width)
@@ -201,8 +210,14 @@ class DeleteRunner(IndexProgramRunner):
     """
     Runner for the index delete command.
     """
+    def init(self):
+        # stale indexes cannot be opened, but can still be deleted
+        super(IndexProgramRunner, self).init()
+        self._index = wt.Index(self._table, self._index_name)
+        if not self._index.exists():
+            self.error("Index '{0}' not found".format(self._index_name))
+
     def run(self):
-        self._index.close()
         self._index.delete()
         self._index = None
 
@@ -218,6 +233,7 @@ class AddRunner(ProgramRunner):
             self._index_name = self._colspec
         self._quiet = args.quiet
         self._force = args.force
+        self._interval = args.interval
         self._index_db_cache_size = args.cache_size
         self._index = None
 
@@ -228,6 +244,7 @@ class AddRunner(ProgramRunner):
             s = "Index '{0}' exists; use --force to overwrite"
             self.error(s.format(self._index_name))
         self.parse_colspec()
+        self._index.set_interval(self._interval)
         self._index.set_db_cache_size(self._index_db_cache_size)
         self._index.open("w")
 
@@ -365,6 +382,89 @@ class DumpRunner(ProgramRunner):
         super(DumpRunner, self).cleanup()
 
 
+class CompactRunner(ProgramRunner):
+    """
+    Runner for the compact command.
+    """
+    def __init__(self, args):
+        super(CompactRunner, self).__init__(args)
+        self._db_cache_size = args.cache_size
+        self._schema = args.SCHEMA
+        self._dest_homedir = args.DEST
+        self._quiet = args.quiet
+        self._force = args.force
+        self._dest = None
+
+    def init(self):
+        super(CompactRunner, self).init()
+        dest = self._dest_homedir
+        self._dest = wt.Table(dest)
+        self._dest.read_schema(self._schema)
+        if os.path.exists(dest):
+            if os.path.samefile(self._homedir, dest):
+                self.error("Cannot compact a table into itself")
+            if not self._force:
+                self.error("'{0}' exists; use --force to overwrite".format(dest))
+            if os.path.isdir(dest):
+                shutil.rmtree(dest)
+            else:
+                os.unlink(dest)
+        os.mkdir(dest)
+        self._dest.set_db_cache_size(self._db_cache_size)
+
+    def run(self):
+        """
+        Copy the rows into the new table.
+        """
+        n = len(self._table)
+        monitor = cli.ProgressMonitor(n, "rows")
+        def progress(processed_rows):
+            monitor.update(processed_rows)
+        try:
+            if self._quiet:
+                self._table.rewrite(self._dest)
+            else:
+                self._table.rewrite(self._dest, progress,
+                        max(1, int(n / 1000)))
+        except:
+            # the rewrite removes its partial output, so remove DEST too
+            shutil.rmtree(self._dest_homedir)
+            raise
+        if not self._quiet:
+            monitor.finish()
+            old = self._table.get_data_file_size()
+            new = self._dest.get_data_file_size()
+            print("Data file size:", self.format_size(old), "->",
+                    self.format_size(new))
+
+class PackRunner(ProgramRunner):
+    """
+    Runner for the pack command.
+    """
+    def __init__(self, args):
+        super(PackRunner, self).__init__(args)
+        self._columns = args.columns
+        self._quiet = args.quiet
+
+    def run(self):
+        """
+        Write the packed column files.
+        """
+        t = self._table
+        for name in self._columns:
+            try:
+                col = t.get_column(name)
+            except KeyError:
+                self.error("Column '{0}' not found".format(name))
+            try:
+                t.pack_column(col)
+            except TypeError as te:
+                self.error(str(te))
+            if not self._quiet:
+                size = os.path.getsize(t.get_packed_column_path(col))
+                print(name, ":", self.format_size(size))
+
+
 def add_homedir_argument(parser):
     """
     Adds a positional homedir argument to the specified parser.
@@ -441,6 +541,11 @@ def wtadmin_main(cmdline_args=None):
         help="force over-writing of existing index")
     add_parser.add_argument("--name", "-n",
         help="name of the index (defaults to COLSPEC)")
+    add_parser.add_argument("--interval", "-I", action="store_true",
+        default=False,
+        help="""build an interval index, in which the last two columns
+            in COLSPEC are the start and end coordinates of a closed
+            interval. For example, seqname+start+end.""")
     add_parser.add_argument("--cache-size", "-c", default="64M",
             help="""index cache size in bytes; suffixes K, M and G also supported.
                 This option is very important for index build performance and
@@ -467,6 +572,44 @@ def wtadmin_main(cmdline_args=None):
                 of values for each column in the index.""")
     dump_parser.set_defaults(runner=DumpRunner)
 
+    # compact command
+    compact_parser = subparsers.add_parser("compact",
+            help="rewrite the table using a new schema",
+            description="""copy the rows of the table to a new table DEST
+                with the columns described in SCHEMA. Values are converted
+                to the types and sizes of the new columns, so that a table
+                can be rebuilt with a tighter schema without the original
+                source file. Indexes are not copied.""")
+    add_homedir_argument(compact_parser)
+    compact_parser.add_argument("DEST",
+        help="Wormtable home directory for the new table")
+    compact_parser.add_argument("SCHEMA",
+        help="schema for the new table")
+    compact_parser.add_argument("--quiet", "-q", action="store_true",
+        default=False, help="suppress progress monitor and messages")
+    compact_parser.add_argument("--force", "-f", action="store_true",
+        default=False, help="force over-writing of existing table")
+    compact_parser.add_argument("--cache-size", "-c", default="64M",
+            help="cache size in bytes; suffixes K, M and G also supported.")
+    compact_parser.set_defaults(runner=CompactRunner)
+
+    # pack command
+    pack_parser = subparsers.add_parser("pack",
+            help="write packed copies of integer columns",
+            description="""write a packed column file for each of the
+                specified uint or int columns, which stores the deltas
+                between the values in consecutive rows bit-packed in
+                blocks. Packed columns can be read much more quickly than
+                the full rows when a scan needs only these columns, such as
+                the coordinates in a sorted VCF. Packed column files must
+                be rebuilt after rows are appended to the table.""")
+    add_homedir_argument(pack_parser)
+    pack_parser.add_argument("columns", metavar="COLUMN", nargs="+",
+        help="Columns to pack")
+    pack_parser.add_argument("--quiet", "-q", action="store_true",
+        default=False, help="suppress messages")
+    pack_parser.set_defaults(runner=PackRunner)
+
     if os.name == "posix":
         # Set signal handler for SIGPIPE to quietly kill the program.
         signal.signal(signal.SIGPIPE, signal.SIG_DFL)